@@ -51,6 +51,18 @@
 #define IDM_ANIM_FIRST_FRAME        1072
 #define IDM_CONTEXT_MENU            1075
 #define IDM_SLIDESHOW               1076
+#define IDM_SEQUENCE_PLAY           1077
+#define IDM_HDR_EXPOSURE_UP         1080
+#define IDM_HDR_EXPOSURE_DOWN       1081
+#define IDM_HDR_EXPOSURE_RESET      1082
+#define IDM_HDR_AUTO_EXPOSURE       1083
+#define IDM_HDR_OP_REINHARD         1084
+#define IDM_HDR_OP_ACES             1085
+#define IDM_HDR_OP_HABLE            1086
+#define IDM_HDR_OP_CLIP             1087
+#define IDM_HDR_GAMMA_18            1088
+#define IDM_HDR_GAMMA_22            1089
+#define IDM_HDR_GAMMA_24            1090
 
 #define IDD_RESIZE_DIALOG           201
 #define IDC_EDIT_WIDTH              2001
@@ -76,5 +88,6 @@
 #define IDC_CHECK_SHOW_OSD          2030
 #define IDC_CHECK_ASK_DELETE        2031
 #define IDC_CHECK_PRESERVE_ZOOM     2032
+#define IDC_CHECK_LINEAR_SCALING    2033
 
 #define IDC_STATIC                  -1
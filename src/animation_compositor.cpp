@@ -0,0 +1,294 @@
+#include "animation_compositor.h"
+#include "pixel_composite.h"
+#include "pyramid_cache.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    bool DecodePixels(const std::vector<uint8_t>& encoded, uint32_t width, uint32_t height, uint8_t* pixels, size_t stride) {
+        QoiRowDecoder decoder;
+        if (!decoder.Init(encoded.data(), encoded.size()) || decoder.Width() != width || decoder.Height() != height) return false;
+        for (uint32_t y = 0; y < height; ++y) {
+            if (!decoder.NextRow(pixels + y * stride)) return false;
+        }
+        return true;
+    }
+
+    AnimationCompositor::Rect Intersect(const AnimationCompositor::Rect& a, const AnimationCompositor::Rect& b) {
+        const uint32_t left = std::max(a.left, b.left);
+        const uint32_t top = std::max(a.top, b.top);
+        const uint32_t right = std::min(a.left + a.width, b.left + b.width);
+        const uint32_t bottom = std::min(a.top + a.height, b.top + b.height);
+        if (right <= left || bottom <= top) return {};
+        return { left, top, right - left, bottom - top };
+    }
+}
+
+void AnimationCompositor::Rect::Include(const Rect& other) {
+    if (other.Empty()) return;
+    if (Empty()) {
+        *this = other;
+        return;
+    }
+    const uint32_t right = std::max(left + width, other.left + other.width);
+    const uint32_t bottom = std::max(top + height, other.top + other.height);
+    left = std::min(left, other.left);
+    top = std::min(top, other.top);
+    width = right - left;
+    height = bottom - top;
+}
+
+void AnimationCompositor::Reset(uint32_t width, uint32_t height, std::vector<Frame> frames, size_t keyframeBudget,
+    size_t frameCacheBudget) {
+    m_width = width;
+    m_height = height;
+    m_frames = std::move(frames);
+    m_canvas.assign(static_cast<size_t>(width) * height * 4, 0);
+    m_saved.clear();
+    m_savedRect = {};
+    m_current = -1;
+    m_dirty = { 0, 0, width, height };
+    m_keyframes.clear();
+    m_keyframeBytes = 0;
+    m_keyframeBudget = keyframeBudget;
+    m_interval = DefaultKeyframeInterval;
+    m_cache.assign(m_frames.size(), CachedFrame{});
+    m_loopFrame = {};
+    m_cachedFrames = 0;
+    m_cacheBytes = 0;
+    m_cacheBudget = frameCacheBudget;
+    m_cacheClosed = frameCacheBudget == 0;
+    m_before.clear();
+}
+
+void AnimationCompositor::AppendFrames(const std::vector<Frame>& frames) {
+    m_frames.insert(m_frames.end(), frames.begin(), frames.end());
+    m_cache.resize(m_frames.size());
+
+    // The loop frame was the change from the old last frame
+    if (m_loopFrame.cached) {
+        m_cacheBytes -= m_loopFrame.pixels.size();
+        --m_cachedFrames;
+    }
+    m_loopFrame = {};
+}
+
+bool AnimationCompositor::Seek(size_t index, const DrawFrame& draw) {
+    if (index >= m_frames.size()) return false;
+    if (m_current == static_cast<int64_t>(index)) return true;
+    if (index == 0 && m_frames.size() > 1 && m_current + 1 == static_cast<int64_t>(m_frames.size())) {
+        LoopToStart(draw);
+        return true;
+    }
+
+    // Resume from the nearest keyframe at or before the target when going back, or when it saves
+    // more than an interval of frames going forward
+    auto keyframe = m_keyframes.upper_bound(index);
+    const bool haveKeyframe = keyframe != m_keyframes.begin();
+    if (haveKeyframe) --keyframe;
+
+    if (m_current > static_cast<int64_t>(index)) {
+        if (!haveKeyframe || !RestoreKeyframe(keyframe->first, keyframe->second)) Restart();
+    }
+    else if (haveKeyframe && static_cast<int64_t>(keyframe->first) > m_current + static_cast<int64_t>(m_interval)) {
+        if (!RestoreKeyframe(keyframe->first, keyframe->second)) Restart();
+    }
+
+    while (m_current < static_cast<int64_t>(index)) Step(draw);
+    return true;
+}
+
+AnimationCompositor::Rect AnimationCompositor::TakeDirtyRect() {
+    const Rect dirty = m_dirty;
+    m_dirty = {};
+    return dirty;
+}
+
+void AnimationCompositor::Restart() {
+    std::fill(m_canvas.begin(), m_canvas.end(), 0);
+    m_savedRect = {};
+    m_current = -1;
+    m_dirty = { 0, 0, m_width, m_height };
+}
+
+void AnimationCompositor::Step(const DrawFrame& draw) {
+    const size_t index = static_cast<size_t>(m_current + 1);
+    if (m_cache[index].cached) {
+        ApplyCachedFrame(index, m_cache[index], false);
+    }
+    else {
+        // Everything the step can touch is the previous frame's disposal and the frame itself
+        const Frame* previous = m_current >= 0 ? &m_frames[static_cast<size_t>(m_current)] : nullptr;
+        Rect touched;
+        if (previous && previous->disposal == 2) touched = ClipToCanvas(*previous);
+        else if (previous && previous->disposal == 3) touched = m_savedRect;
+        const Rect rect = ClipToCanvas(m_frames[index]);
+        touched.Include(rect);
+
+        const bool record = !m_cacheClosed;
+        if (record) {
+            m_before.resize(static_cast<size_t>(touched.width) * touched.height * 4);
+            CopyRect(m_before.data(), static_cast<size_t>(touched.width) * 4, CanvasAt(touched), Stride(), touched.width, touched.height);
+        }
+
+        // Dispose of the frame on the canvas before drawing the next one. Restoring to previous puts
+        // back the rect it saved, which is all the frame could have drawn over.
+        if (previous && previous->disposal == 2) {
+            const Rect cleared = ClipToCanvas(*previous);
+            FillRect(CanvasAt(cleared), Stride(), cleared.width, cleared.height, 0);
+        }
+        else if (previous && previous->disposal == 3) {
+            CopyRect(CanvasAt(m_savedRect), Stride(), m_saved.data(), static_cast<size_t>(m_savedRect.width) * 4, m_savedRect.width, m_savedRect.height);
+        }
+
+        if (m_frames[index].disposal == 3) {
+            m_savedRect = rect;
+            m_saved.resize(static_cast<size_t>(rect.width) * rect.height * 4);
+            CopyRect(m_saved.data(), static_cast<size_t>(rect.width) * 4, CanvasAt(rect), Stride(), rect.width, rect.height);
+        }
+        if (!rect.Empty()) draw(index, m_canvas.data(), Stride());
+
+        if (record) CacheFrame(m_cache[index], touched, m_before.data());
+        else m_dirty.Include(touched);
+    }
+    m_current = static_cast<int64_t>(index);
+
+    if (index > 0 && index % m_interval == 0 && !m_keyframes.contains(index)) TakeKeyframe();
+}
+
+void AnimationCompositor::LoopToStart(const DrawFrame& draw) {
+    // Going round as a change from the last frame keeps the dirty rect down to what differs
+    if (m_loopFrame.cached) {
+        ApplyCachedFrame(0, m_loopFrame, true);
+        m_current = 0;
+        return;
+    }
+    if (m_cacheClosed) {
+        Restart();
+        Step(draw);
+        return;
+    }
+
+    const Rect canvasRect = { 0, 0, m_width, m_height };
+    const std::vector<uint8_t> last = m_canvas;
+    const Rect pending = m_dirty;
+    Restart();
+    Step(draw);
+    m_dirty = pending;
+    CacheFrame(m_loopFrame, canvasRect, last.data());
+}
+
+void AnimationCompositor::ApplyCachedFrame(size_t index, const CachedFrame& entry, bool fromStart) {
+    // Restore-to-previous still needs what the frame covered once the previous frame was disposed
+    // of. The canvas has not seen that disposal, so it is applied to the copy instead.
+    if (m_frames[index].disposal == 3) {
+        const Rect rect = ClipToCanvas(m_frames[index]);
+        const size_t savedStride = static_cast<size_t>(rect.width) * 4;
+        std::vector<uint8_t> saved(savedStride * rect.height, 0);
+        const Frame* previous = m_current >= 0 && !fromStart ? &m_frames[static_cast<size_t>(m_current)] : nullptr;
+        if (previous) {
+            CopyRect(saved.data(), savedStride, CanvasAt(rect), Stride(), rect.width, rect.height);
+            const Rect overlap = Intersect(rect, previous->disposal == 2 ? ClipToCanvas(*previous) : previous->disposal == 3 ? m_savedRect : Rect{});
+            if (!overlap.Empty()) {
+                uint8_t* at = saved.data() + static_cast<size_t>(overlap.top - rect.top) * savedStride + static_cast<size_t>(overlap.left - rect.left) * 4;
+                if (previous->disposal == 2) {
+                    FillRect(at, savedStride, overlap.width, overlap.height, 0);
+                }
+                else {
+                    const size_t oldStride = static_cast<size_t>(m_savedRect.width) * 4;
+                    const uint8_t* from = m_saved.data() + static_cast<size_t>(overlap.top - m_savedRect.top) * oldStride + static_cast<size_t>(overlap.left - m_savedRect.left) * 4;
+                    CopyRect(at, savedStride, from, oldStride, overlap.width, overlap.height);
+                }
+            }
+        }
+        m_saved = std::move(saved);
+        m_savedRect = rect;
+    }
+    if (!entry.rect.Empty()) DecodePixels(entry.pixels, entry.rect.width, entry.rect.height, CanvasAt(entry.rect), Stride());
+    m_dirty.Include(entry.rect);
+}
+
+void AnimationCompositor::CacheFrame(CachedFrame& entry, const Rect& touched, const uint8_t* before) {
+    // Only what actually changed is kept, and marked dirty
+    const Rect changed = ChangedArea(touched, before);
+    m_dirty.Include(changed);
+    if (!changed.Empty()) {
+        std::vector<uint8_t> packed(static_cast<size_t>(changed.width) * changed.height * 4);
+        CopyRect(packed.data(), static_cast<size_t>(changed.width) * 4, CanvasAt(changed), Stride(), changed.width, changed.height);
+        if (!QoiEncodePixels(packed.data(), changed.width, changed.height, entry.pixels) || m_cacheBytes + entry.pixels.size() > m_cacheBudget) {
+            entry.pixels = {};
+            m_cacheClosed = true;
+            return;
+        }
+    }
+    entry.rect = changed;
+    entry.cached = true;
+    m_cacheBytes += entry.pixels.size();
+    ++m_cachedFrames;
+}
+
+AnimationCompositor::Rect AnimationCompositor::ChangedArea(const Rect& touched, const uint8_t* before) const {
+    const size_t rowBytes = static_cast<size_t>(touched.width) * 4;
+    const uint8_t* canvas = m_canvas.data() + static_cast<size_t>(touched.top) * Stride() + static_cast<size_t>(touched.left) * 4;
+    uint32_t top = touched.height, bottom = 0, left = touched.width, right = 0;
+    for (uint32_t y = 0; y < touched.height; ++y) {
+        const uint8_t* was = before + y * rowBytes;
+        const uint8_t* now = canvas + y * Stride();
+        if (std::memcmp(was, now, rowBytes) == 0) continue;
+        top = std::min(top, y);
+        bottom = y + 1;
+
+        // Columns only need scanning as far as the bounds found so far
+        uint32_t first = 0;
+        while (first < left && std::memcmp(was + first * 4, now + first * 4, 4) == 0) ++first;
+        uint32_t last = touched.width;
+        while (last > right && std::memcmp(was + (last - 1) * 4, now + (last - 1) * 4, 4) == 0) --last;
+        left = std::min(left, first);
+        right = std::max(right, last);
+    }
+    if (top >= bottom) return {};
+    return { touched.left + left, touched.top + top, right - left, bottom - top };
+}
+
+void AnimationCompositor::TakeKeyframe() {
+    if (m_canvas.empty()) return;
+    const size_t index = static_cast<size_t>(m_current);
+    Keyframe keyframe;
+    if (!QoiEncodePixels(m_canvas.data(), m_width, m_height, keyframe.canvas)) return;
+    if (m_frames[index].disposal == 3 && !m_savedRect.Empty()) {
+        if (!QoiEncodePixels(m_saved.data(), m_savedRect.width, m_savedRect.height, keyframe.saved)) return;
+        keyframe.savedRect = m_savedRect;
+    }
+    m_keyframeBytes += keyframe.canvas.size() + keyframe.saved.size();
+    m_keyframes.emplace(index, std::move(keyframe));
+
+    // Thin out to every other keyframe until they fit, an interval past the end keeps none
+    while (m_keyframeBytes > m_keyframeBudget && !m_keyframes.empty()) {
+        m_interval *= 2;
+        for (auto it = m_keyframes.begin(); it != m_keyframes.end();) {
+            if (it->first % m_interval != 0 || m_interval > m_frames.size()) {
+                m_keyframeBytes -= it->second.canvas.size() + it->second.saved.size();
+                it = m_keyframes.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+}
+
+bool AnimationCompositor::RestoreKeyframe(size_t frame, const Keyframe& keyframe) {
+    m_dirty = { 0, 0, m_width, m_height };
+    if (!DecodePixels(keyframe.canvas, m_width, m_height, m_canvas.data(), Stride())) return false;
+    m_savedRect = keyframe.savedRect;
+    m_saved.resize(static_cast<size_t>(m_savedRect.width) * m_savedRect.height * 4);
+    if (!keyframe.saved.empty() && !DecodePixels(keyframe.saved, m_savedRect.width, m_savedRect.height, m_saved.data(), static_cast<size_t>(m_savedRect.width) * 4)) return false;
+    m_current = static_cast<int64_t>(frame);
+    return true;
+}
+
+AnimationCompositor::Rect AnimationCompositor::ClipToCanvas(const Frame& frame) const {
+    if (frame.left >= m_width || frame.top >= m_height) return {};
+    return { frame.left, frame.top, std::min(frame.width, m_width - frame.left), std::min(frame.height, m_height - frame.top) };
+}
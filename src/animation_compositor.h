@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <vector>
+
+// Plays an animation's frames onto a 32bpp premultiplied BGRA canvas, applying each frame's
+// disposal before the next one is drawn. Decoding and blending a frame is left to the caller.
+// Every few frames the canvas is kept as a QOI-compressed keyframe, together with the pixels a
+// restore-to-previous disposal would put back, so seeking backwards resumes from the nearest
+// keyframe instead of replaying from frame 0. When the keyframes outgrow their byte budget the
+// interval doubles and every other one is dropped.
+// The area each step touches is collected as a dirty rect, so whoever mirrors the canvas only has
+// to copy that much, and restore-to-previous keeps just the frame's own rect rather than the canvas.
+// Frames are also cached as a QOI of just the pixels they changed, nothing for a frame identical to
+// the one before, until the cache budget runs out. From the second loop on a cached frame is a
+// decompress into the canvas with no decoding or disposal, frames past the budget play live.
+
+class AnimationCompositor {
+public:
+    struct Frame {
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t disposal = 0;  // GIF numbering: 2 clears the rect, 3 restores the canvas from before the frame
+    };
+
+    struct Rect {
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        bool Empty() const { return width == 0 || height == 0; }
+        void Include(const Rect& other);
+    };
+
+    // Composites frame index onto the canvas, clipped to the canvas size and the frame's rect
+    using DrawFrame = std::function<void(size_t index, uint8_t* canvas, size_t stride)>;
+
+    static constexpr uint32_t DefaultKeyframeInterval = 16;
+    static constexpr size_t DefaultKeyframeBudget = size_t{ 64 } << 20;
+    static constexpr size_t DefaultFrameCacheBudget = size_t{ 64 } << 20;
+
+    void Reset(uint32_t width, uint32_t height, std::vector<Frame> frames, size_t keyframeBudget = DefaultKeyframeBudget,
+        size_t frameCacheBudget = DefaultFrameCacheBudget);
+
+    // Adds frames found after the reset, for an animation whose headers are still being read.
+    // Whatever is on the canvas stays valid.
+    void AppendFrames(const std::vector<Frame>& frames);
+
+    // Brings the canvas to the given frame. False for an index past the end.
+    bool Seek(size_t index, const DrawFrame& draw);
+
+    const uint8_t* Canvas() const { return m_canvas.data(); }
+    size_t Stride() const { return static_cast<size_t>(m_width) * 4; }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    size_t FrameCount() const { return m_frames.size(); }
+    const Frame& GetFrame(size_t index) const { return m_frames[index]; }
+
+    // The frame on the canvas, -1 before the first seek
+    int64_t CurrentFrame() const { return m_current; }
+
+    // Canvas area changed since the last call, all of it after a reset, restart or keyframe restore
+    Rect TakeDirtyRect();
+
+    // Widens the dirty rect, for a mirror that was left further behind the canvas than one take
+    void MarkDirty(const Rect& rect) { m_dirty.Include(rect); }
+
+    size_t KeyframeCount() const { return m_keyframes.size(); }
+    size_t KeyframeBytes() const { return m_keyframeBytes; }
+    uint32_t KeyframeInterval() const { return m_interval; }
+
+    size_t CachedFrameCount() const { return m_cachedFrames; }
+    size_t FrameCacheBytes() const { return m_cacheBytes; }
+
+private:
+    struct Keyframe {
+        std::vector<uint8_t> canvas;
+        std::vector<uint8_t> saved;  // Only for a frame that restores to previous
+        Rect savedRect;
+    };
+
+    // A frame as the pixels that differ from the one before it
+    struct CachedFrame {
+        bool cached = false;
+        Rect rect;                      // Empty when nothing changed
+        std::vector<uint8_t> pixels;    // QOI of the rect
+    };
+
+    void Restart();
+    void Step(const DrawFrame& draw);
+    void LoopToStart(const DrawFrame& draw);
+    void ApplyCachedFrame(size_t index, const CachedFrame& entry, bool fromStart);
+    void CacheFrame(CachedFrame& entry, const Rect& touched, const uint8_t* before);
+    Rect ChangedArea(const Rect& touched, const uint8_t* before) const;
+    void TakeKeyframe();
+    bool RestoreKeyframe(size_t frame, const Keyframe& keyframe);
+    Rect ClipToCanvas(const Frame& frame) const;
+    uint8_t* CanvasAt(const Rect& rect) { return m_canvas.data() + static_cast<size_t>(rect.top) * Stride() + static_cast<size_t>(rect.left) * 4; }
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<Frame> m_frames;
+    std::vector<uint8_t> m_canvas;
+    std::vector<uint8_t> m_saved;    // What the last frame that restores to previous covered, packed rows
+    Rect m_savedRect;
+    int64_t m_current = -1;
+    Rect m_dirty;
+
+    std::map<size_t, Keyframe> m_keyframes;
+    size_t m_keyframeBytes = 0;
+    size_t m_keyframeBudget = DefaultKeyframeBudget;
+    uint32_t m_interval = DefaultKeyframeInterval;
+
+    std::vector<CachedFrame> m_cache;
+    CachedFrame m_loopFrame;            // First frame as the change from the last, for looping round
+    size_t m_cachedFrames = 0;
+    size_t m_cacheBytes = 0;
+    size_t m_cacheBudget = DefaultFrameCacheBudget;
+    bool m_cacheClosed = false;         // A frame did not fit, later ones are not tried either
+    std::vector<uint8_t> m_before;      // What a step is about to touch, packed rows
+};
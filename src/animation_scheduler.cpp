@@ -0,0 +1,49 @@
+#include "animation_scheduler.h"
+#include <algorithm>
+
+void AnimationScheduler::Start(size_t frame, int64_t nowUs, const std::vector<uint32_t>& delaysMs) {
+    m_running = !delaysMs.empty();
+    m_frame = delaysMs.empty() ? 0 : frame % delaysMs.size();
+    m_deadline = nowUs + DelayUs(delaysMs, m_frame);
+}
+
+bool AnimationScheduler::Advance(int64_t nowUs, const std::vector<uint32_t>& delaysMs) {
+    if (!m_running || delaysMs.empty()) return false;
+    if (nowUs < m_deadline) {
+        ++m_stats.early;
+        return false;
+    }
+
+    const int64_t late = nowUs - m_deadline;
+    ++m_stats.ticks;
+    m_stats.totalLateUs += late;
+    m_stats.maxLateUs = std::max(m_stats.maxLateUs, late);
+
+    // Too far behind to be worth catching up frame by frame
+    if (late > ResyncAfterUs) {
+        ++m_stats.resyncs;
+        m_frame = (m_frame + 1) % delaysMs.size();
+        m_deadline = nowUs + DelayUs(delaysMs, m_frame);
+        return true;
+    }
+
+    // Every frame whose slot ended by now is passed over, the last one started is due
+    uint64_t steps = 0;
+    do {
+        m_frame = (m_frame + 1) % delaysMs.size();
+        m_deadline += DelayUs(delaysMs, m_frame);
+        ++steps;
+    } while (m_deadline <= nowUs);
+    m_stats.skipped += steps - 1;
+    return true;
+}
+
+int64_t AnimationScheduler::UntilNextUs(int64_t nowUs) const {
+    return std::max<int64_t>(m_deadline - nowUs, 0);
+}
+
+int64_t AnimationScheduler::DelayUs(const std::vector<uint32_t>& delaysMs, size_t frame) {
+    // A zero delay would never let the timeline move past the frame
+    const uint32_t delay = frame < delaysMs.size() ? delaysMs[frame] : 0;
+    return static_cast<int64_t>(std::max<uint32_t>(delay, 1)) * 1000;
+}
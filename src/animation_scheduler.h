@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Keeps animation playback on an absolute timeline. Each frame's deadline is the previous one plus
+// its delay, never the time the timer happened to fire plus the delay, so compositing time and
+// timer granularity do not add up as drift. A tick that arrives after several deadlines moves
+// straight to the frame due now and counts the ones passed over as skipped. Falling further behind
+// than ResyncAfterUs, as after a stall or a suspended session, restarts the timeline instead.
+// The clock is whatever the caller passes in, microseconds on any monotonic scale.
+
+struct AnimationTimingStats {
+    uint64_t ticks = 0;          // Ticks that found a frame due
+    uint64_t early = 0;          // Ticks that came before the next deadline
+    uint64_t skipped = 0;        // Frames whose whole slot passed between two ticks
+    uint64_t resyncs = 0;
+    int64_t totalLateUs = 0;     // How long after its deadline each due frame was picked up
+    int64_t maxLateUs = 0;
+
+    double MeanLateMs() const { return ticks ? static_cast<double>(totalLateUs) / ticks / 1000.0 : 0.0; }
+};
+
+class AnimationScheduler {
+public:
+    static constexpr int64_t ResyncAfterUs = 1000000;
+
+    // The frame goes on screen at nowUs and the timeline starts from it
+    void Start(size_t frame, int64_t nowUs, const std::vector<uint32_t>& delaysMs);
+    void Stop() { m_running = false; }
+    bool IsRunning() const { return m_running; }
+
+    // Moves to the frame due at nowUs. False when it is still the one on screen. The delays may
+    // have grown since the last call, the timeline wraps at their current count.
+    bool Advance(int64_t nowUs, const std::vector<uint32_t>& delaysMs);
+
+    size_t Frame() const { return m_frame; }
+
+    // Time left until the next deadline, zero when it has passed
+    int64_t UntilNextUs(int64_t nowUs) const;
+
+    const AnimationTimingStats& Stats() const { return m_stats; }
+    void ResetStats() { m_stats = {}; }
+
+private:
+    static int64_t DelayUs(const std::vector<uint32_t>& delaysMs, size_t frame);
+
+    bool m_running = false;
+    size_t m_frame = 0;
+    int64_t m_deadline = 0;      // When the frame on screen makes way for the next
+    AnimationTimingStats m_stats;
+};
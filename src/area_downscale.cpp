@@ -0,0 +1,171 @@
+#include "area_downscale.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+#if SIMD_X86
+    inline __m128 Load4(const uint8_t* s) {
+        int packed;
+        std::memcpy(&packed, s, 4);
+        __m128i v = _mm_cvtsi32_si128(packed);
+        const __m128i zero = _mm_setzero_si128();
+        v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+        return _mm_cvtepi32_ps(v);
+    }
+
+    inline __m128 Load4(const uint16_t* s) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s));
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+    }
+
+    inline __m128 Load4(const float* s) {
+        return _mm_loadu_ps(s);
+    }
+#endif
+
+    // acc += w * row, written as a flat loop so the compiler can vectorize it
+    inline void Accumulate(float* acc, const float* row, float w, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            acc[i] += w * row[i];
+        }
+    }
+
+    inline void Scale(float* dst, const float* row, float w, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = w * row[i];
+        }
+    }
+}
+
+bool AreaDownscaler::Init(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels) {
+    if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) return false;
+    if (dstWidth > srcWidth || dstHeight > srcHeight) return false;
+    if (channels < 1 || channels > 4) return false;
+
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+    m_channels = channels;
+    m_srcRow = 0;
+    m_dstRow = 0;
+
+    // Coordinates are scaled by the opposite dimension so every span boundary is an integer.
+    // Destination column x covers [x * srcWidth, (x + 1) * srcWidth), source pixel sx covers [sx * dstWidth, (sx + 1) * dstWidth).
+    m_tapStart.assign(dstWidth, 0);
+    m_tapOffset.assign(static_cast<size_t>(dstWidth) + 1, 0);
+    m_tapWeights.clear();
+    m_tapWeights.reserve(static_cast<size_t>(dstWidth) * (srcWidth / dstWidth + 2));
+
+    const float invSpan = 1.0f / static_cast<float>(srcWidth);
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+        const uint64_t spanStart = static_cast<uint64_t>(x) * srcWidth;
+        const uint64_t spanEnd = spanStart + srcWidth;
+        const uint32_t first = static_cast<uint32_t>(spanStart / dstWidth);
+        const uint32_t last = static_cast<uint32_t>((spanEnd + dstWidth - 1) / dstWidth);
+
+        m_tapStart[x] = first;
+        m_tapOffset[x] = static_cast<uint32_t>(m_tapWeights.size());
+        for (uint32_t sx = first; sx < last; ++sx) {
+            const uint64_t pixStart = static_cast<uint64_t>(sx) * dstWidth;
+            const uint64_t pixEnd = pixStart + dstWidth;
+            const uint64_t overlap = std::min(spanEnd, pixEnd) - std::max(spanStart, pixStart);
+            m_tapWeights.push_back(static_cast<float>(overlap) * invSpan);
+        }
+    }
+    m_tapOffset[dstWidth] = static_cast<uint32_t>(m_tapWeights.size());
+
+    const size_t rowLen = static_cast<size_t>(dstWidth) * channels;
+    m_rowH.assign(rowLen, 0.0f);
+    m_acc.assign(rowLen, 0.0f);
+    m_out.assign(rowLen, 0.0f);
+    return true;
+}
+
+template <typename Sample, int Channels>
+void AreaDownscaler::HorizontalPass(const Sample* src) {
+    float* out = m_rowH.data();
+    for (uint32_t x = 0; x < m_dstWidth; ++x, out += Channels) {
+        const Sample* s = src + static_cast<size_t>(m_tapStart[x]) * Channels;
+        const float* w = m_tapWeights.data() + m_tapOffset[x];
+        const uint32_t taps = m_tapOffset[x + 1] - m_tapOffset[x];
+
+#if SIMD_X86
+        if constexpr (Channels == 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t t = 0; t < taps; ++t, s += 4) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(Load4(s), _mm_set1_ps(w[t])));
+            }
+            _mm_storeu_ps(out, sum);
+            continue;
+        }
+#endif
+        float sum[Channels] = {};
+        for (uint32_t t = 0; t < taps; ++t, s += Channels) {
+            for (int c = 0; c < Channels; ++c) {
+                sum[c] += w[t] * static_cast<float>(s[c]);
+            }
+        }
+        for (int c = 0; c < Channels; ++c) out[c] = sum[c];
+    }
+}
+
+template <typename Sample>
+const float* AreaDownscaler::Push(const Sample* src, uint32_t* outDstRow) {
+    if (m_srcRow >= m_srcHeight || m_dstRow >= m_dstHeight) return nullptr;
+
+    switch (m_channels) {
+    case 1: HorizontalPass<Sample, 1>(src); break;
+    case 2: HorizontalPass<Sample, 2>(src); break;
+    case 3: HorizontalPass<Sample, 3>(src); break;
+    default: HorizontalPass<Sample, 4>(src); break;
+    }
+
+    // Same integer scaling vertically, source row covers [row * dstHeight, (row + 1) * dstHeight).
+    // Since dstHeight <= srcHeight a source row straddles at most one destination boundary.
+    const size_t rowLen = m_rowH.size();
+    const float invSpan = 1.0f / static_cast<float>(m_srcHeight);
+    const uint64_t rowStart = static_cast<uint64_t>(m_srcRow) * m_dstHeight;
+    const uint64_t rowEnd = rowStart + m_dstHeight;
+    const uint64_t boundary = static_cast<uint64_t>(m_dstRow + 1) * m_srcHeight;
+    ++m_srcRow;
+
+    if (rowEnd < boundary) {
+        Accumulate(m_acc.data(), m_rowH.data(), static_cast<float>(m_dstHeight) * invSpan, rowLen);
+        return nullptr;
+    }
+
+    Accumulate(m_acc.data(), m_rowH.data(), static_cast<float>(boundary - rowStart) * invSpan, rowLen);
+    m_out.swap(m_acc);
+    Scale(m_acc.data(), m_rowH.data(), static_cast<float>(rowEnd - boundary) * invSpan, rowLen);
+
+    if (outDstRow) *outDstRow = m_dstRow;
+    ++m_dstRow;
+    return m_out.data();
+}
+
+const float* AreaDownscaler::PushRow(const uint8_t* src, uint32_t* outDstRow) {
+    return Push(src, outDstRow);
+}
+
+const float* AreaDownscaler::PushRow(const uint16_t* src, uint32_t* outDstRow) {
+    return Push(src, outDstRow);
+}
+
+const float* AreaDownscaler::PushRow(const float* src, uint32_t* outDstRow) {
+    return Push(src, outDstRow);
+}
+
+void QuantizeRow(const float* src, uint16_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint16_t>(std::clamp(src[i] + 0.5f, 0.0f, 65535.0f));
+    }
+}
+
+void QuantizeRow(const float* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint8_t>(std::clamp(src[i] + 0.5f, 0.0f, 255.0f));
+    }
+}
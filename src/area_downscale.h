@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Streaming box-filter downscaler with exact fractional pixel coverage.
+// Source rows are pushed top to bottom and each destination row is emitted as soon as it is
+// complete, so memory stays at one accumulator row no matter how tall the source is.
+// Accumulation is in float, which keeps 16-bit sources exact until the caller quantizes.
+
+class AreaDownscaler {
+public:
+    // Only reductions are supported, dstWidth/dstHeight must not exceed the source size
+    bool Init(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels);
+
+    uint32_t DestWidth() const { return m_dstWidth; }
+    uint32_t DestHeight() const { return m_dstHeight; }
+    uint32_t Channels() const { return m_channels; }
+
+    // Feeds the next source row (srcWidth * channels samples).
+    // Returns the finished destination row in source units, or nullptr if none completed.
+    // outDstRow receives the index of the returned row.
+    const float* PushRow(const uint8_t* src, uint32_t* outDstRow);
+    const float* PushRow(const uint16_t* src, uint32_t* outDstRow);
+    const float* PushRow(const float* src, uint32_t* outDstRow);
+
+private:
+    template <typename Sample>
+    const float* Push(const Sample* src, uint32_t* outDstRow);
+
+    template <typename Sample, int Channels>
+    void HorizontalPass(const Sample* src);
+
+    uint32_t m_srcWidth = 0;
+    uint32_t m_srcHeight = 0;
+    uint32_t m_dstWidth = 0;
+    uint32_t m_dstHeight = 0;
+    uint32_t m_channels = 0;
+    uint32_t m_srcRow = 0;
+    uint32_t m_dstRow = 0;
+
+    // Horizontal taps per destination column, weights sum to one
+    std::vector<uint32_t> m_tapStart;
+    std::vector<uint32_t> m_tapOffset;
+    std::vector<float> m_tapWeights;
+
+    std::vector<float> m_rowH;     // Current source row after the horizontal pass
+    std::vector<float> m_acc;      // Destination row being accumulated
+    std::vector<float> m_out;      // Last completed destination row
+};
+
+// Rounds and clamps a finished row back to integer samples
+void QuantizeRow(const float* src, uint16_t* dst, size_t count);
+void QuantizeRow(const float* src, uint8_t* dst, size_t count);
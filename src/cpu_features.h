@@ -0,0 +1,71 @@
+#pragma once
+
+// Runtime CPU feature detection and per-function target attributes for SIMD kernels.
+// MSVC accepts any intrinsic without flags, GCC/Clang need the target attribute.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIMD_TARGET_SSSE3
+#define SIMD_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define SIMD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SIMD_X86 0
+#endif
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool avx2 = false;
+};
+
+inline const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures features = [] {
+        CpuFeatures f;
+#if SIMD_X86
+        auto cpuid = [](int leaf, int subLeaf, unsigned int regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int out[4];
+            __cpuidex(out, leaf, subLeaf);
+            for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(out[i]);
+#else
+            __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            };
+        auto xgetbv = []() -> unsigned long long {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return _xgetbv(0);
+#else
+            unsigned int eax = 0, edx = 0;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+            };
+
+        unsigned int regs[4] = {};
+        cpuid(0, 0, regs);
+        const unsigned int maxLeaf = regs[0];
+        if (maxLeaf < 1) return f;
+
+        cpuid(1, 0, regs);
+        f.sse2 = (regs[3] & (1u << 26)) != 0;
+        f.ssse3 = (regs[2] & (1u << 9)) != 0;
+
+        // AVX2 also needs the OS to save YMM state across context switches
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        const bool avx = (regs[2] & (1u << 28)) != 0;
+        if (maxLeaf >= 7 && osxsave && avx && (xgetbv() & 0x6) == 0x6) {
+            cpuid(7, 0, regs);
+            f.avx2 = (regs[1] & (1u << 5)) != 0;
+        }
+#endif
+        return f;
+        }();
+    return features;
+}
@@ -0,0 +1,277 @@
+#include "deep_zoom.h"
+#include "pixel_convert.h"
+#include "pyramid_cache.h"
+#include "resampler.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+    // One per worker over the shared file bytes, WIC decoders are not safe to share between threads
+    struct TileDecoder {
+        ComPtr<IWICImagingFactory> factory;
+        ComPtr<IWICBitmapFrameDecode> frame;
+        ComPtr<IWICBitmapSourceTransform> transform;   // Only codecs with native scaling (JPEG) have it
+        ComPtr<IWICFormatConverter> converter;         // Full resolution PBGRA view of the frame
+
+        bool Open(const BYTE* data, size_t size) {
+            if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) return false;
+
+            ComPtr<IWICStream> stream;
+            ComPtr<IWICBitmapDecoder> decoder;
+            if (FAILED(factory->CreateStream(&stream)) ||
+                FAILED(stream->InitializeFromMemory(const_cast<BYTE*>(data), static_cast<DWORD>(size))) ||
+                FAILED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+                FAILED(decoder->GetFrame(0, &frame))) {
+                return false;
+            }
+
+            frame.As(&transform);
+            return SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+                SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone, nullptr, 0.f, WICBitmapPaletteTypeCustom));
+        }
+
+        // Region decode at reduced size, only when the codec scales to exactly this level's size
+        bool DecodeScaled(const TileGrid& grid, const TileKey& key, TileData& out) {
+            if (!transform || key.level == 0) return false;
+
+            const UINT levelW = grid.LevelWidth(key.level);
+            const UINT levelH = grid.LevelHeight(key.level);
+            UINT closeW = levelW, closeH = levelH;
+            if (FAILED(transform->GetClosestSize(&closeW, &closeH)) || closeW != levelW || closeH != levelH) return false;
+
+            WICPixelFormatGUID format = GUID_WICPixelFormat32bppPBGRA;
+            if (FAILED(transform->GetClosestPixelFormat(&format))) return false;
+
+            PixelSource layout = PixelSource::BGRA8;
+            UINT bytesPerPixel = 4;
+            bool passThrough = false;
+            if (format == GUID_WICPixelFormat32bppPBGRA) passThrough = true;
+            else if (format == GUID_WICPixelFormat32bppBGRA) layout = PixelSource::BGRA8;
+            else if (format == GUID_WICPixelFormat32bppBGR) layout = PixelSource::BGRX8;
+            else if (format == GUID_WICPixelFormat24bppBGR) { layout = PixelSource::BGR8; bytesPerPixel = 3; }
+            else if (format == GUID_WICPixelFormat8bppGray) { layout = PixelSource::Gray8; bytesPerPixel = 1; }
+            else return false;
+
+            const UINT stride = (out.width * bytesPerPixel + 3) & ~3u;
+            std::vector<BYTE> buffer(static_cast<size_t>(stride) * out.height);
+            WICRect rc = { static_cast<INT>(key.x * grid.TileSize()), static_cast<INT>(key.y * grid.TileSize()),
+                static_cast<INT>(out.width), static_cast<INT>(out.height) };
+            if (FAILED(transform->CopyPixels(&rc, levelW, levelH, &format, WICBitmapTransformRotate0,
+                stride, static_cast<UINT>(buffer.size()), buffer.data()))) {
+                return false;
+            }
+
+            const size_t dstStride = static_cast<size_t>(out.width) * 4;
+            if (passThrough) {
+                for (UINT y = 0; y < out.height; ++y) {
+                    std::memcpy(out.pixels.data() + y * dstStride, buffer.data() + static_cast<size_t>(y) * stride, dstStride);
+                }
+            }
+            else {
+                ConvertPixels(layout, true, buffer.data(), stride, out.pixels.data(), dstStride, out.width, out.height);
+            }
+            return true;
+        }
+
+        // Full resolution region, box filtered down in strips for coarser levels
+        bool DecodeRegion(const TileGrid& grid, const TileKey& key, TileData& out) {
+            const TileRect bounds = grid.Bounds(key);
+            const UINT fullX = static_cast<UINT>(bounds.left);
+            const UINT fullY = static_cast<UINT>(bounds.top);
+            const UINT fullW = static_cast<UINT>(bounds.right) - fullX;
+            const UINT fullH = static_cast<UINT>(bounds.bottom) - fullY;
+            const UINT dstStride = out.width * 4;
+
+            if (key.level == 0) {
+                WICRect rc = { static_cast<INT>(fullX), static_cast<INT>(fullY), static_cast<INT>(fullW), static_cast<INT>(fullH) };
+                return SUCCEEDED(converter->CopyPixels(&rc, dstStride, static_cast<UINT>(out.pixels.size()), out.pixels.data()));
+            }
+
+            ResampleOptions options;
+            options.filter = ResampleFilter::Box;
+            Resampler resampler;
+            if (!resampler.Init(fullW, fullH, out.width, out.height, options)) return false;
+
+            std::vector<BYTE> strip;
+            auto fetch = [&](uint32_t y, uint32_t count, size_t& stride) -> const uint8_t* {
+                strip.resize(static_cast<size_t>(fullW) * 4 * count);
+                WICRect rc = { static_cast<INT>(fullX), static_cast<INT>(fullY + y), static_cast<INT>(fullW), static_cast<INT>(count) };
+                if (FAILED(converter->CopyPixels(&rc, fullW * 4, static_cast<UINT>(strip.size()), strip.data()))) return nullptr;
+                stride = static_cast<size_t>(fullW) * 4;
+                return strip.data();
+                };
+            return resampler.Run(fetch, out.pixels.data(), dstStride);
+        }
+    };
+}
+
+bool TiledDeepZoom::Start(const BYTE* data, size_t size, UINT fullWidth, UINT fullHeight, UINT baseWidth,
+    size_t cacheBudget, HWND notifyWnd, UINT notifyMsg) {
+    Stop();
+    if (!data || size == 0 || fullWidth == 0 || fullHeight == 0) return false;
+
+    // Parse the header once up front so an unsupported file fails here rather than in every worker
+    TileDecoder probe;
+    if (!probe.Open(data, size)) return false;
+
+    m_data = data;
+    m_size = size;
+    m_pyramidPath.clear();
+    StartWorkers(fullWidth, fullHeight, baseWidth, 16, cacheBudget, notifyWnd, notifyMsg);
+    return true;
+}
+
+bool TiledDeepZoom::StartFromPyramid(const std::filesystem::path& path, uint64_t sourceKey, UINT baseWidth,
+    size_t cacheBudget, HWND notifyWnd, UINT notifyMsg) {
+    Stop();
+    PyramidReader probe;
+    if (!probe.Open(path, sourceKey) || probe.Grid().TileSize() != TileSize) return false;
+
+    m_data = nullptr;
+    m_size = 0;
+    m_pyramidPath = path;
+    m_pyramidKey = sourceKey;
+    StartWorkers(probe.Grid().Width(), probe.Grid().Height(), baseWidth, probe.Grid().LevelCount(), cacheBudget, notifyWnd, notifyMsg);
+    return true;
+}
+
+void TiledDeepZoom::StartWorkers(UINT fullWidth, UINT fullHeight, UINT baseWidth, uint32_t maxLevels,
+    size_t cacheBudget, HWND notifyWnd, UINT notifyMsg) {
+    // Levels stop before they get coarser than the bitmap already on screen
+    uint32_t levelCount = 1;
+    while (levelCount < maxLevels && (fullWidth >> levelCount) > baseWidth) {
+        ++levelCount;
+    }
+
+    m_notifyWnd = notifyWnd;
+    m_notifyMsg = notifyMsg;
+    m_grid.Init(fullWidth, fullHeight, TileSize, levelCount);
+    m_scheduler.Init(m_grid);
+    m_cache.Clear();
+    m_cache.SetBudget(cacheBudget);
+    m_stop = false;
+
+    const uint32_t workers = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    for (uint32_t i = 0; i < workers; ++i) {
+        m_workers.emplace_back(&TiledDeepZoom::WorkerLoop, this);
+    }
+}
+
+void TiledDeepZoom::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    // A worker finishes at most the tile it is on
+    for (std::thread& worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+    m_workers.clear();
+    m_bitmaps.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cache.Clear();
+    m_queue.clear();
+    m_inFlight.clear();
+    m_failed.clear();
+}
+
+void TiledDeepZoom::Update(const TileRect& viewport, float scale, double timeSeconds, std::vector<TileDraw>& draws) {
+    std::vector<TileKey> requests;
+    bool hasWork = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_notifyPending = false;
+        m_scheduler.Update(viewport, scale, timeSeconds, m_cache, draws, requests);
+
+        // Stale requests from earlier frames are dropped, a fast pan only decodes where it is now
+        m_queue.clear();
+        for (const TileKey& key : requests) {
+            const uint64_t packed = key.Packed();
+            if (m_inFlight.count(packed) == 0 && m_failed.count(packed) == 0) {
+                m_queue.push_back(key);
+            }
+        }
+        hasWork = !m_queue.empty();
+    }
+    if (hasWork) m_wake.notify_all();
+
+    std::erase_if(m_bitmaps, [](const auto& entry) { return entry.second.tile.expired(); });
+}
+
+ID2D1Bitmap* TiledDeepZoom::GetBitmap(ID2D1DeviceContext* dc, const TileDraw& draw) {
+    DeviceTile& entry = m_bitmaps[draw.key.Packed()];
+    if (entry.bitmap && entry.tile.lock() == draw.tile) return entry.bitmap.Get();
+
+    entry.tile = draw.tile;
+    entry.bitmap = nullptr;
+    D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+        96.0f, 96.0f
+    );
+    dc->CreateBitmap(D2D1::SizeU(draw.tile->width, draw.tile->height), draw.tile->pixels.data(),
+        draw.tile->width * 4, &props, &entry.bitmap);
+    return entry.bitmap.Get();
+}
+
+size_t TiledDeepZoom::CacheBytes() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cache.Bytes();
+}
+
+void TiledDeepZoom::WorkerLoop() {
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) return;
+    wil::unique_couninitialize_call cleanupCOM;
+
+    // Pyramid tiles are stored per level, only file sources need a decoder
+    TileDecoder decoder;
+    PyramidReader pyramid;
+    const bool fromPyramid = !m_pyramidPath.empty();
+    const bool opened = fromPyramid ? pyramid.Open(m_pyramidPath, m_pyramidKey) : decoder.Open(m_data, m_size);
+
+    for (;;) {
+        TileKey key;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            key = m_queue.front();
+            m_queue.erase(m_queue.begin());
+            m_inFlight.insert(key.Packed());
+        }
+
+        auto tile = std::make_shared<TileData>();
+        tile->width = m_grid.TileWidth(key);
+        tile->height = m_grid.TileHeight(key);
+        tile->pixels.resize(static_cast<size_t>(tile->width) * tile->height * 4);
+        bool decoded = false;
+        if (opened && fromPyramid) {
+            decoded = pyramid.ReadTile(key, *tile);
+        }
+        else if (opened) {
+            decoded = decoder.DecodeScaled(m_grid, key, *tile) || decoder.DecodeRegion(m_grid, key, *tile);
+        }
+
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlight.erase(key.Packed());
+            if (m_stop) return;
+            if (decoded) {
+                m_cache.Insert(key, std::move(tile));
+                notify = !m_notifyPending;
+                m_notifyPending = true;
+            }
+            else {
+                m_failed.insert(key.Packed());
+            }
+        }
+        if (notify) PostMessage(m_notifyWnd, m_notifyMsg, 0, 0);
+    }
+}
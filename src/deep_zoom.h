@@ -0,0 +1,76 @@
+#pragma once
+
+#include <windows.h>
+#include <wincodec.h>
+#include <d2d1_1.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include "tile_cache.h"
+
+// Full-resolution tiles for zooming past the downscaled base bitmap.
+// Worker threads decode tiles straight from the in-memory file with their own WIC decoder,
+// using the codec's scaled region decode when it has one, or read them from a prebuilt tile
+// pyramid on disk. The UI thread feeds the viewport once per frame and gets back the cached tiles
+// to draw. In-memory file bytes must outlive the object.
+
+class TiledDeepZoom {
+public:
+    static constexpr uint32_t TileSize = 256;
+
+    ~TiledDeepZoom() { Stop(); }
+
+    // baseWidth is the width of the bitmap already on screen, levels stop once they are coarser than it
+    bool Start(const BYTE* data, size_t size, UINT fullWidth, UINT fullHeight, UINT baseWidth,
+        size_t cacheBudget, HWND notifyWnd, UINT notifyMsg);
+
+    // Pages tiles in from a pyramid written by PyramidWriter with TileSize tiles
+    bool StartFromPyramid(const std::filesystem::path& path, uint64_t sourceKey, UINT baseWidth,
+        size_t cacheBudget, HWND notifyWnd, UINT notifyMsg);
+    void Stop();
+    bool IsActive() const { return !m_workers.empty(); }
+
+    // Viewport in full-resolution pixels, scale in screen pixels per full-resolution pixel
+    void Update(const TileRect& viewport, float scale, double timeSeconds, std::vector<TileDraw>& draws);
+
+    // Device bitmaps follow the cache, tiles evicted since the last call are released
+    ID2D1Bitmap* GetBitmap(ID2D1DeviceContext* dc, const TileDraw& draw);
+    void DiscardBitmaps() { m_bitmaps.clear(); }
+
+    size_t CacheBytes();
+
+private:
+    struct DeviceTile {
+        std::weak_ptr<const TileData> tile;
+        Microsoft::WRL::ComPtr<ID2D1Bitmap> bitmap;
+    };
+
+    void StartWorkers(UINT fullWidth, UINT fullHeight, UINT baseWidth, uint32_t maxLevels,
+        size_t cacheBudget, HWND notifyWnd, UINT notifyMsg);
+    void WorkerLoop();
+
+    const BYTE* m_data = nullptr;
+    size_t m_size = 0;
+    std::filesystem::path m_pyramidPath;
+    uint64_t m_pyramidKey = 0;
+    TileGrid m_grid;
+    HWND m_notifyWnd = nullptr;
+    UINT m_notifyMsg = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    bool m_notifyPending = false;
+    TileCache m_cache;
+    TileScheduler m_scheduler;
+    std::vector<TileKey> m_queue;                // Replaced on every Update, front is most urgent
+    std::unordered_set<uint64_t> m_inFlight;
+    std::unordered_set<uint64_t> m_failed;       // Not retried, the decoder already gave up on them
+    std::vector<std::thread> m_workers;
+
+    std::unordered_map<uint64_t, DeviceTile> m_bitmaps;   // UI thread only
+};
@@ -0,0 +1,147 @@
+#include "frame_prefetch.h"
+#include "pixel_composite.h"
+#include <algorithm>
+
+void FramePrefetcher::Start(AnimationCompositor& compositor, AnimationCompositor::DrawFrame draw, uint32_t slots) {
+    Stop();
+    if (compositor.FrameCount() == 0 || compositor.Width() == 0 || compositor.Height() == 0) return;
+
+    m_compositor = &compositor;
+    m_draw = std::move(draw);
+    m_frameCount = compositor.FrameCount();
+
+    // Pixels are allocated by the worker as each buffer is first filled
+    m_buffers.assign(static_cast<size_t>(std::max(slots, 1u)) + 1, Buffer{});
+    m_free.clear();
+    for (size_t i = m_buffers.size(); i-- > 0;) m_free.push_back(i);
+    m_queue.clear();
+    m_presented = compositor.CurrentFrame();
+    m_presentedBuffer = SIZE_MAX;
+    m_next = m_presented + 1;
+    m_due = m_presented;
+    m_stop = false;
+    m_worker = std::thread(&FramePrefetcher::WorkerLoop, this);
+}
+
+void FramePrefetcher::Stop() {
+    if (!m_worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_worker.join();
+
+    // The canvas is at the last frame composited, the presented one is behind it by the queue
+    for (const Entry& entry : m_queue) {
+        m_compositor->MarkDirty(entry.dirty);
+    }
+    m_queue.clear();
+    m_free.clear();
+    m_buffers.clear();
+    m_buffers.shrink_to_fit();
+    m_presentedBuffer = SIZE_MAX;
+    m_draw = nullptr;
+    m_compositor = nullptr;
+}
+
+bool FramePrefetcher::Present(size_t frame, Presented& out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_worker.joinable()) return false;
+    const int64_t due = SequenceOf(frame % m_frameCount);
+    if (due == m_presented) return false;
+    m_due = std::max(m_due, due);
+
+    // Anything finished before the due frame has missed its turn, only the newest is shown
+    const int64_t previous = m_presented;
+    Rect dirty;
+    while (!m_queue.empty() && m_queue.front().sequence <= due) {
+        const Entry entry = m_queue.front();
+        m_queue.pop_front();
+        if (m_presentedBuffer != SIZE_MAX) m_free.push_back(m_presentedBuffer);
+        m_presentedBuffer = entry.buffer;
+        m_presented = entry.sequence;
+        dirty.Include(entry.dirty);
+    }
+
+    if (m_presented != due) ++m_stats.late;
+    if (m_presented == previous) {
+        lock.unlock();
+        m_wake.notify_one();
+        return false;
+    }
+    ++m_stats.presented;
+    m_stats.dropped += static_cast<uint64_t>(m_presented - previous - 1);
+
+    out.pixels = m_buffers[m_presentedBuffer].pixels.data();
+    out.frame = static_cast<size_t>(m_presented % static_cast<int64_t>(m_frameCount));
+    out.dirty = dirty;
+    lock.unlock();
+    m_wake.notify_one();
+    return true;
+}
+
+size_t FramePrefetcher::Queued() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size();
+}
+
+FramePrefetchStats FramePrefetcher::Stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void FramePrefetcher::ResetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = {};
+}
+
+int64_t FramePrefetcher::SequenceOf(size_t frame) const {
+    const int64_t count = static_cast<int64_t>(m_frameCount);
+    const int64_t ahead = ((static_cast<int64_t>(frame) - m_presented) % count + count) % count;
+    return m_presented + ahead;
+}
+
+void FramePrefetcher::WorkerLoop() {
+    AnimationCompositor& compositor = *m_compositor;
+    const size_t canvasBytes = compositor.Stride() * compositor.Height();
+
+    for (;;) {
+        int64_t sequence = 0;
+        size_t buffer = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || !m_free.empty(); });
+            if (m_stop) return;
+            buffer = m_free.back();
+            m_free.pop_back();
+
+            // Behind schedule, go straight to the due frame rather than finish ones already late
+            if (m_next < m_due) m_next = m_due;
+            sequence = m_next++;
+        }
+
+        compositor.Seek(static_cast<size_t>(sequence % static_cast<int64_t>(m_frameCount)), m_draw);
+        const Rect dirty = compositor.TakeDirtyRect();
+        for (Buffer& other : m_buffers) {
+            other.stale.Include(dirty);
+        }
+
+        Buffer& target = m_buffers[buffer];
+        if (target.pixels.size() != canvasBytes) {
+            target.pixels.resize(canvasBytes);
+            target.stale = { 0, 0, compositor.Width(), compositor.Height() };
+        }
+        const Rect& stale = target.stale;
+        if (!stale.Empty()) {
+            const size_t offset = static_cast<size_t>(stale.top) * compositor.Stride() + static_cast<size_t>(stale.left) * 4;
+            CopyRect(target.pixels.data() + offset, compositor.Stride(), compositor.Canvas() + offset, compositor.Stride(), stale.width, stale.height);
+        }
+        target.stale = {};
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back({ sequence, buffer, dirty });
+        }
+    }
+}
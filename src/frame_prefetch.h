@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "animation_compositor.h"
+
+// Composites the frames after the one on screen on a worker thread, into a small ring of reusable
+// canvas-sized buffers, so the playback timer only has to pick up a finished frame. A buffer only
+// catches up on the area that changed since it last held a frame.
+// Playback keeps to its schedule when the worker falls behind: the newest finished frame is shown
+// and counted late, and the worker jumps straight to the frame that is due, the ones in between
+// counted as dropped. While running, the worker owns the compositor and whatever the draw
+// callback touches.
+
+struct FramePrefetchStats {
+    uint64_t presented = 0;
+    uint64_t late = 0;      // Ticks where the due frame was not finished yet
+    uint64_t dropped = 0;   // Frames never shown, skipped by either side
+};
+
+class FramePrefetcher {
+public:
+    using Rect = AnimationCompositor::Rect;
+
+    struct Presented {
+        const uint8_t* pixels = nullptr;  // Canvas layout, valid until the next Present or Stop
+        size_t frame = 0;
+        Rect dirty;                       // What changed since the frame presented before it
+    };
+
+    ~FramePrefetcher() { Stop(); }
+
+    // Composites ahead of the compositor's current frame, which counts as the one on screen.
+    // slots is how many finished frames may wait, one more buffer holds the presented frame.
+    void Start(AnimationCompositor& compositor, AnimationCompositor::DrawFrame draw, uint32_t slots);
+
+    // Joins the worker and hands the compositor back. Its dirty rect then also covers the frames
+    // composited but never presented, so a mirror of the presented frame can resync from it.
+    void Stop();
+    bool IsRunning() const { return m_worker.joinable(); }
+
+    // Moves on to the frame due now, or the newest finished one short of it. False when nothing
+    // newer than the frame on screen is ready, or it already is the due one.
+    bool Present(size_t frame, Presented& out);
+
+    size_t Queued();
+    FramePrefetchStats Stats();
+    void ResetStats();
+
+private:
+    struct Buffer {
+        std::vector<uint8_t> pixels;
+        Rect stale;   // Worker only, area that changed since the buffer was filled
+    };
+
+    struct Entry {
+        int64_t sequence = 0;
+        size_t buffer = 0;
+        Rect dirty;
+    };
+
+    void WorkerLoop();
+
+    // Playback position of frame at or after the one presented, frames repeat every loop
+    int64_t SequenceOf(size_t frame) const;
+
+    AnimationCompositor* m_compositor = nullptr;
+    AnimationCompositor::DrawFrame m_draw;
+    size_t m_frameCount = 0;
+    std::vector<Buffer> m_buffers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    std::deque<Entry> m_queue;
+    std::vector<size_t> m_free;
+    int64_t m_presented = 0;         // Sequence on screen
+    size_t m_presentedBuffer = SIZE_MAX;
+    int64_t m_next = 0;              // Sequence the worker composites next
+    int64_t m_due = 0;               // Latest sequence asked for
+    FramePrefetchStats m_stats;
+    std::thread m_worker;
+};
@@ -0,0 +1,296 @@
+#include "gif_decode.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    // Frames past this many pixels are refused rather than allocated
+    constexpr size_t MaxFramePixels = size_t{ 1 } << 28;
+
+    // String copies run in whole words and may write this far past the string
+    constexpr size_t CopySlack = 8;
+
+    inline uint32_t ReadLittleEndian16(const uint8_t* p) {
+        return p[0] | (static_cast<uint32_t>(p[1]) << 8);
+    }
+
+    inline void Copy8(uint8_t* dst, const uint8_t* src) {
+        uint64_t word;
+        std::memcpy(&word, src, 8);
+        std::memcpy(dst, &word, 8);
+    }
+
+    // Skips a chain of sub-blocks, returns the position after the terminator or size if it is cut off
+    size_t SkipSubBlocks(const uint8_t* data, size_t size, size_t pos) {
+        while (pos < size) {
+            const size_t length = data[pos];
+            if (length == 0) return pos + 1;
+            pos += length + 1;
+        }
+        return size;
+    }
+}
+
+bool GifDecoder::ReadHeader(const uint8_t* data, size_t size) {
+    if (!BeginHeader(data, size)) return false;
+    ReadFrames(SIZE_MAX);
+    if (m_frames.empty()) {
+        m_data = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool GifDecoder::BeginHeader(const uint8_t* data, size_t size) {
+    m_data = nullptr;
+    m_size = 0;
+    m_walkPos = 0;
+    m_frames.clear();
+    m_cache.clear();
+    m_cacheBytes = 0;
+    if (!data || size < 13 || (std::memcmp(data, "GIF87a", 6) != 0 && std::memcmp(data, "GIF89a", 6) != 0)) return false;
+
+    m_width = ReadLittleEndian16(data + 6);
+    m_height = ReadLittleEndian16(data + 8);
+    m_sizeFromFrames = m_width == 0 || m_height == 0;
+    const uint8_t screenFlags = data[10];
+    size_t pos = 13;
+
+    m_globalPalette = nullptr;
+    m_globalPaletteSize = 0;
+    if (screenFlags & 0x80) {
+        m_globalPaletteSize = 2u << (screenFlags & 7);
+        if (pos + m_globalPaletteSize * 3 > size) return false;
+        m_globalPalette = data + pos;
+        pos += m_globalPaletteSize * 3;
+    }
+
+    m_data = data;
+    m_size = size;
+    m_walkPos = pos;
+    m_pending = Frame();
+    return true;
+}
+
+size_t GifDecoder::ReadFrames(size_t limit) {
+    const uint8_t* const data = m_data;
+    const size_t size = m_size;
+    size_t pos = m_walkPos;
+    size_t found = 0;
+
+    // The graphic control extension applies to the next image only
+    while (pos < size && found < limit) {
+        const uint8_t introducer = data[pos++];
+        if (introducer == 0x3B) break;
+
+        if (introducer == 0x21) {
+            if (pos >= size) break;
+            const uint8_t label = data[pos++];
+            if (label == 0xF9 && pos + 5 <= size && data[pos] >= 4) {
+                const uint8_t flags = data[pos + 1];
+                m_pending.disposal = (flags >> 2) & 7;
+                m_pending.delay = ReadLittleEndian16(data + pos + 2) * 10;
+                m_pending.transparentIndex = (flags & 1) ? data[pos + 4] : -1;
+            }
+            pos = SkipSubBlocks(data, size, pos);
+            continue;
+        }
+
+        if (introducer != 0x2C || pos + 9 > size) break;
+        Frame frame = m_pending;
+        m_pending = Frame();
+        frame.left = ReadLittleEndian16(data + pos);
+        frame.top = ReadLittleEndian16(data + pos + 2);
+        frame.width = ReadLittleEndian16(data + pos + 4);
+        frame.height = ReadLittleEndian16(data + pos + 6);
+        const uint8_t imageFlags = data[pos + 8];
+        frame.interlaced = (imageFlags & 0x40) != 0;
+        pos += 9;
+
+        frame.palette = m_globalPalette;
+        frame.paletteSize = m_globalPaletteSize;
+        if (imageFlags & 0x80) {
+            const uint32_t localSize = 2u << (imageFlags & 7);
+            if (pos + localSize * 3 > size) break;
+            frame.palette = data + pos;
+            frame.paletteSize = localSize;
+            pos += localSize * 3;
+        }
+
+        // A frame cut off inside its data still decodes as far as it goes
+        if (pos >= size) break;
+        frame.dataOffset = pos;
+        m_frames.push_back(frame);
+        ++found;
+        pos = SkipSubBlocks(data, size, pos + 1);
+
+        // Some encoders leave the screen size at zero
+        if (m_sizeFromFrames) {
+            m_width = std::max(m_width, frame.left + frame.width);
+            m_height = std::max(m_height, frame.top + frame.height);
+        }
+    }
+
+    // Stopping at the limit leaves pos on the next block, anything else ends the walk
+    m_walkPos = found == limit ? pos : size;
+    return found;
+}
+
+size_t GifDecoder::DecodeLzw(uint32_t minCodeSize, size_t pixels) {
+    const uint32_t clearCode = 1u << minCodeSize;
+    const uint32_t endCode = clearCode + 1;
+    uint32_t codeSize = minCodeSize + 1;
+    uint32_t nextCode = clearCode + 2;
+
+    const uint8_t* in = m_compressed.data();
+    const uint8_t* const inEnd = in + (m_compressed.size() - CopySlack);
+    int64_t bitsLeft = static_cast<int64_t>(inEnd - in) * 8;
+    uint64_t bits = 0;
+    uint32_t count = 0;
+
+    uint8_t* const out = m_indices.data();
+    uint8_t* cur = out;
+    uint8_t* const outEnd = out + pixels;
+
+    // Where the previous code's string was written, the next entry extends it by one byte
+    uint32_t prevPos = 0;
+    uint32_t prevLength = 0;
+    bool havePrev = false;
+
+    while (cur < outEnd) {
+        if (count < codeSize) {
+            // The buffer has a word of zero padding, running into it is caught by bitsLeft
+            if (in > inEnd) break;
+            uint64_t word;
+            std::memcpy(&word, in, 8);
+            bits |= word << count;
+            in += (63 - count) >> 3;
+            count |= 56;
+        }
+        bitsLeft -= codeSize;
+        if (bitsLeft < 0) break;
+        const uint32_t code = static_cast<uint32_t>(bits) & ((1u << codeSize) - 1);
+        bits >>= codeSize;
+        count -= codeSize;
+
+        if (code == clearCode) {
+            codeSize = minCodeSize + 1;
+            nextCode = clearCode + 2;
+            havePrev = false;
+            continue;
+        }
+        if (code == endCode) break;
+
+        const uint32_t pos = static_cast<uint32_t>(cur - out);
+        uint32_t length = 1;
+        if (code < clearCode) {
+            *cur = static_cast<uint8_t>(code);
+        }
+        else if (!havePrev) {
+            break;   // Only a root code can follow a clear
+        }
+        else if (code < nextCode) {
+            // Strings always lie in output already written, ahead of the cursor
+            length = m_stringLength[code];
+            const uint8_t* src = out + m_stringPos[code];
+            for (uint32_t i = 0; i < length; i += 8) Copy8(cur + i, src + i);
+        }
+        else if (code == nextCode) {
+            // The code being defined: the previous string plus its own first byte
+            length = prevLength + 1;
+            const uint8_t* src = out + prevPos;
+            for (uint32_t i = 0; i < prevLength; i += 8) Copy8(cur + i, src + i);
+            cur[prevLength] = src[0];
+        }
+        else {
+            break;
+        }
+
+        if (havePrev && nextCode < MaxCodes) {
+            m_stringPos[nextCode] = prevPos;
+            m_stringLength[nextCode] = static_cast<uint16_t>(prevLength + 1);
+            ++nextCode;
+            if (nextCode == (1u << codeSize) && codeSize < 12) ++codeSize;
+        }
+        prevPos = pos;
+        prevLength = length;
+        havePrev = true;
+        cur += length;
+    }
+    return std::min(static_cast<size_t>(cur - out), pixels);
+}
+
+bool GifDecoder::DecodeFrame(size_t index, uint8_t* dst, size_t stride) {
+    if (!m_data || index >= m_frames.size()) return false;
+    const Frame& frame = m_frames[index];
+    const size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+    if (pixels == 0) return true;
+    if (pixels > MaxFramePixels) return false;
+
+    const uint32_t minCodeSize = m_data[frame.dataOffset];
+    if (minCodeSize < 1 || minCodeSize > 11) return false;
+
+    // Sub-blocks joined so the code reader never looks for a block boundary
+    m_compressed.clear();
+    size_t pos = frame.dataOffset + 1;
+    while (pos < m_size) {
+        const size_t length = std::min<size_t>(m_data[pos], m_size - pos - 1);
+        if (length == 0) break;
+        m_compressed.insert(m_compressed.end(), m_data + pos + 1, m_data + pos + 1 + length);
+        pos += length + 1;
+    }
+    m_compressed.resize(m_compressed.size() + CopySlack, 0);
+
+    // A string that overruns the frame is cut off, the buffer has room for the longest one
+    m_indices.resize(pixels + MaxCodes + CopySlack);
+    const size_t decoded = DecodeLzw(minCodeSize, pixels);
+    const uint8_t fill = frame.transparentIndex >= 0 ? static_cast<uint8_t>(frame.transparentIndex) : 0;
+    std::fill(m_indices.begin() + decoded, m_indices.begin() + pixels, fill);
+
+    // Interlaced rows arrive as every 8th from 0, every 8th from 4, every 4th from 2, then the odd rows
+    const uint8_t* src = m_indices.data();
+    if (!frame.interlaced) {
+        for (uint32_t y = 0; y < frame.height; ++y, src += frame.width) {
+            std::memcpy(dst + y * stride, src, frame.width);
+        }
+        return true;
+    }
+    constexpr uint32_t PassStart[4] = { 0, 4, 2, 1 };
+    constexpr uint32_t PassStep[4] = { 8, 8, 4, 2 };
+    for (uint32_t pass = 0; pass < 4; ++pass) {
+        for (uint32_t y = PassStart[pass]; y < frame.height; y += PassStep[pass], src += frame.width) {
+            std::memcpy(dst + y * stride, src, frame.width);
+        }
+    }
+    return true;
+}
+
+const uint8_t* GifDecoder::FrameIndices(size_t index) {
+    if (index >= m_frames.size()) return nullptr;
+    if (m_cache.size() != m_frames.size()) m_cache.resize(m_frames.size());
+    if (!m_cache[index].empty()) return m_cache[index].data();
+
+    const Frame& frame = m_frames[index];
+    const size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+    if (pixels == 0 || pixels > MaxFramePixels) return nullptr;
+    const bool keep = m_cacheBytes + pixels <= m_cacheBudget;
+    std::vector<uint8_t>& indices = keep ? m_cache[index] : m_uncached;
+    indices.resize(pixels);
+    if (!DecodeFrame(index, indices.data(), frame.width)) {
+        indices.clear();
+        return nullptr;
+    }
+    if (keep) m_cacheBytes += pixels;
+    return indices.data();
+}
+
+void GifDecoder::GetBgraPalette(size_t index, uint32_t bgra[256]) const {
+    const Frame& frame = m_frames[index];
+    const uint32_t colors = std::min(frame.paletteSize, 256u);
+    for (uint32_t i = 0; i < colors; ++i) {
+        const uint8_t* rgb = frame.palette + i * 3;
+        bgra[i] = 0xFF000000u | (static_cast<uint32_t>(rgb[0]) << 16) | (static_cast<uint32_t>(rgb[1]) << 8) | rgb[2];
+    }
+    std::fill(bgra + colors, bgra + 256, 0u);
+    if (frame.transparentIndex >= 0) bgra[frame.transparentIndex] = 0;
+}
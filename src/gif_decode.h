@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// GIF87a/89a decoder that hands out frames as 8-bit palette indices, leaving palette lookup and
+// transparency to the compositor so both happen in the one pass that writes the canvas.
+// The LZW table keeps every string as a position and length in the output already written, so a
+// code expands with a forward word copy instead of walking and reversing a prefix chain.
+// Decoded frames are kept as those indices, a quarter of their BGRA size, until the frame cache
+// budget runs out, so later loops skip the LZW.
+
+class GifDecoder {
+public:
+    struct Frame {
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t delay = 0;               // Milliseconds, as stored
+        uint32_t disposal = 0;
+        int32_t transparentIndex = -1;
+        bool interlaced = false;
+        const uint8_t* palette = nullptr; // RGB triples, the local table or the global one
+        uint32_t paletteSize = 0;
+        size_t dataOffset = 0;            // LZW minimum code size, the sub-blocks follow
+    };
+
+    static constexpr size_t DefaultFrameCacheBudget = size_t{ 64 } << 20;
+
+    // Walks every block up to the trailer. The data must stay valid while frames are decoded.
+    bool ReadHeader(const uint8_t* data, size_t size);
+
+    // The same walk a few frames at a time, so the first frame can show before the rest are found.
+    // BeginHeader reads the screen descriptor, ReadFrames then adds up to limit frames and returns
+    // how many it found. Frame data is skipped by its sub-block lengths, never decoded.
+    bool BeginHeader(const uint8_t* data, size_t size);
+    size_t ReadFrames(size_t limit);
+    bool HeaderComplete() const { return m_walkPos >= m_size; }
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    // The screen size was zero, so Width and Height only cover the frames found so far
+    bool SizeFromFrames() const { return m_sizeFromFrames; }
+    size_t FrameCount() const { return m_frames.size(); }
+    const Frame& GetFrame(size_t index) const { return m_frames[index]; }
+
+    // Frame rows in display order, width bytes each at the given stride. Pixels the data stops
+    // short of get the transparent index, or 0 without one. False only for an unusable frame.
+    bool DecodeFrame(size_t index, uint8_t* dst, size_t stride);
+
+    // Same rows packed at the frame's width, from the cache or decoded into it while it has room.
+    // Valid until the next call, null for an unusable or empty frame.
+    const uint8_t* FrameIndices(size_t index);
+
+    void SetFrameCacheBudget(size_t bytes) { m_cacheBudget = bytes; }
+    size_t FrameCacheBytes() const { return m_cacheBytes; }
+
+    // The frame's palette as premultiplied BGRA with the transparent entry zero. Indices past
+    // the end of the palette are left transparent too, as browsers do.
+    void GetBgraPalette(size_t index, uint32_t bgra[256]) const;
+
+private:
+    static constexpr uint32_t MaxCodes = 4096;
+
+    // Returns the number of pixels written to m_indices
+    size_t DecodeLzw(uint32_t minCodeSize, size_t pixels);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<Frame> m_frames;
+
+    // Header walk
+    size_t m_walkPos = 0;                 // Next block, m_size once the trailer or a bad block is hit
+    Frame m_pending;                      // Graphic control for the next image
+    const uint8_t* m_globalPalette = nullptr;
+    uint32_t m_globalPaletteSize = 0;
+    bool m_sizeFromFrames = false;        // The screen size was zero, frames widen it as they are found
+
+    // Per decode
+    std::vector<uint8_t> m_compressed;    // Sub-blocks joined, zero padded for word reads
+    std::vector<uint8_t> m_indices;       // Frame in stream order with room for a full string past the end
+    uint32_t m_stringPos[MaxCodes] = {};
+    uint16_t m_stringLength[MaxCodes] = {};
+
+    std::vector<std::vector<uint8_t>> m_cache;   // Per frame, empty until decoded into the cache
+    std::vector<uint8_t> m_uncached;             // Frames past the budget
+    size_t m_cacheBytes = 0;
+    size_t m_cacheBudget = DefaultFrameCacheBudget;
+};
@@ -0,0 +1,399 @@
+#include "hdr_decode.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+    // RGBE mantissa scale per shared exponent, matches stb_image's ldexp(1, e - 136)
+    const float* ExponentTable() {
+        static const auto table = [] {
+            std::vector<float> t(256, 0.0f);
+            for (int e = 1; e < 256; ++e) {
+                t[e] = std::ldexp(1.0f, e - (128 + 8));
+            }
+            return t;
+            }();
+        return table.data();
+    }
+
+    float HableCurve(float x) {
+        constexpr float A = 0.15f, B = 0.50f, C = 0.10f, D = 0.20f, E = 0.02f, F = 0.30f;
+        return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+    }
+
+    // Maps scene-linear radiance to display-linear [0, 1]
+    float ApplyToneOperator(float x, HdrToneOperator op) {
+        switch (op) {
+        case HdrToneOperator::Aces: {
+            // Narkowicz fit of the ACES filmic RRT/ODT
+            x *= 0.6f;
+            return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+        }
+        case HdrToneOperator::Hable: {
+            constexpr float WhitePoint = 11.2f;
+            static const float whiteScale = 1.0f / HableCurve(WhitePoint);
+            return HableCurve(x * 2.0f) * whiteScale;
+        }
+        case HdrToneOperator::Clip:
+            return x;
+        case HdrToneOperator::Reinhard:
+        default:
+            return x / (1.0f + x);
+        }
+    }
+
+    bool ReadLine(const uint8_t* data, size_t size, size_t& pos, const char*& line, size_t& len) {
+        if (pos >= size) return false;
+        line = reinterpret_cast<const char*>(data + pos);
+        const uint8_t* nl = static_cast<const uint8_t*>(memchr(data + pos, '\n', size - pos));
+        size_t end = nl ? static_cast<size_t>(nl - data) : size;
+        len = end - pos;
+        pos = nl ? end + 1 : size;
+        return true;
+    }
+
+    bool ParseAxis(const char*& p, const char* end, char& sign, char& axis, int& value) {
+        while (p < end && *p == ' ') ++p;
+        if (end - p < 2 || (p[0] != '-' && p[0] != '+') || (p[1] != 'X' && p[1] != 'Y')) return false;
+        sign = p[0];
+        axis = p[1];
+        p += 2;
+        while (p < end && *p == ' ') ++p;
+        long long v = 0;
+        const char* digits = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v = v * 10 + (*p - '0');
+            if (v > (1 << 24)) return false;
+            ++p;
+        }
+        if (p == digits || v <= 0) return false;
+        value = static_cast<int>(v);
+        return true;
+    }
+}
+
+bool HdrScanlineReader::Open(const uint8_t* data, size_t size) {
+    m_data = data;
+    m_size = size;
+    m_pos = 0;
+    m_nextScanline = 0;
+    m_header = {};
+
+    const char* line = nullptr;
+    size_t len = 0;
+    if (!ReadLine(data, size, m_pos, line, len)) return false;
+    if (!(len >= 10 && memcmp(line, "#?RADIANCE", 10) == 0) && !(len >= 6 && memcmp(line, "#?RGBE", 6) == 0)) {
+        return false;
+    }
+
+    // Header variables end at the first blank line
+    bool validFormat = true;
+    for (;;) {
+        if (!ReadLine(data, size, m_pos, line, len)) return false;
+        if (len > 0 && line[len - 1] == '\r') --len;
+        if (len == 0) break;
+        if (len >= 7 && memcmp(line, "FORMAT=", 7) == 0) {
+            validFormat = (len == 22 && memcmp(line + 7, "32-bit_rle_rgbe", 15) == 0);
+        }
+    }
+    if (!validFormat) return false;
+
+    // Resolution string, only the non-transposed orientations are supported
+    if (!ReadLine(data, size, m_pos, line, len)) return false;
+    const char* p = line;
+    const char* end = line + len;
+    char ySign = 0, yAxis = 0, xSign = 0, xAxis = 0;
+    int height = 0, width = 0;
+    if (!ParseAxis(p, end, ySign, yAxis, height) || !ParseAxis(p, end, xSign, xAxis, width)) return false;
+    if (yAxis != 'Y' || xAxis != 'X') return false;
+
+    m_header.width = width;
+    m_header.height = height;
+    m_header.bottomUp = (ySign == '+');
+    m_header.mirrorX = (xSign == '-');
+    m_header.dataOffset = m_pos;
+    m_rgbe.resize(static_cast<size_t>(width) * 4);
+    return true;
+}
+
+bool HdrScanlineReader::ReadRgbe(uint8_t* rgbe) {
+    const int width = m_header.width;
+    auto remaining = [&]() { return m_size - m_pos; };
+
+    // New-style RLE: 2, 2, width hi, width lo, then four run-length encoded channel planes
+    if (width >= 8 && width < 0x8000 && remaining() >= 4 &&
+        m_data[m_pos] == 2 && m_data[m_pos + 1] == 2 && !(m_data[m_pos + 2] & 0x80)) {
+        int encodedWidth = (m_data[m_pos + 2] << 8) | m_data[m_pos + 3];
+        if (encodedWidth != width) return false;
+        m_pos += 4;
+
+        for (int c = 0; c < 4; ++c) {
+            int x = 0;
+            while (x < width) {
+                if (remaining() < 2) return false;
+                int count = m_data[m_pos++];
+                if (count > 128) {
+                    count -= 128;
+                    if (x + count > width) return false;
+                    uint8_t value = m_data[m_pos++];
+                    for (int i = 0; i < count; ++i) rgbe[(x + i) * 4 + c] = value;
+                }
+                else {
+                    if (count == 0 || x + count > width || remaining() < static_cast<size_t>(count)) return false;
+                    for (int i = 0; i < count; ++i) rgbe[(x + i) * 4 + c] = m_data[m_pos + i];
+                    m_pos += count;
+                }
+                x += count;
+            }
+        }
+        return true;
+    }
+
+    // Flat pixels, with the legacy 1,1,1,n repeat marker
+    int x = 0;
+    int shift = 0;
+    while (x < width) {
+        if (remaining() < 4) return false;
+        const uint8_t* px = m_data + m_pos;
+        m_pos += 4;
+        if (px[0] == 1 && px[1] == 1 && px[2] == 1) {
+            if (x == 0 || shift > 16) return false;
+            int count = px[3] << shift;
+            if (x + count > width) return false;
+            for (int i = 0; i < count; ++i, ++x) {
+                memcpy(rgbe + x * 4, rgbe + (x - 1) * 4, 4);
+            }
+            shift += 8;
+        }
+        else {
+            memcpy(rgbe + x * 4, px, 4);
+            ++x;
+            shift = 0;
+        }
+    }
+    return true;
+}
+
+bool HdrScanlineReader::ReadScanline(float* rgbOut, int* outRow) {
+    if (m_nextScanline >= m_header.height) return false;
+    if (!ReadRgbe(m_rgbe.data())) return false;
+
+    const float* expTable = ExponentTable();
+    const int width = m_header.width;
+    const uint8_t* src = m_rgbe.data();
+    for (int x = 0; x < width; ++x, src += 4) {
+        int dx = m_header.mirrorX ? (width - 1 - x) : x;
+        float scale = expTable[src[3]];
+        rgbOut[dx * 3 + 0] = src[0] * scale;
+        rgbOut[dx * 3 + 1] = src[1] * scale;
+        rgbOut[dx * 3 + 2] = src[2] * scale;
+    }
+
+    int row = m_nextScanline++;
+    *outRow = m_header.bottomUp ? (m_header.height - 1 - row) : row;
+    return true;
+}
+
+uint16_t FloatToHalf(float value) {
+    // Radiance is never negative, NaN and negatives collapse to zero
+    if (!(value > 0.0f)) return 0;
+    if (value >= 65504.0f) return 0x7BFF;
+
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (exponent <= 0) {
+        if (exponent < -10) return 0;
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u) ++half;
+        return static_cast<uint16_t>(half);
+    }
+
+    // Rounding carry may roll into the exponent, which is still the correct result
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000u) ++half;
+    return static_cast<uint16_t>(std::min(half, 0x7BFFu));
+}
+
+float HalfToFloat(uint16_t half) {
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+    float value;
+    if (exponent == 0) {
+        value = std::ldexp(static_cast<float>(mantissa), -24);
+    }
+    else if (exponent == 31) {
+        value = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+    }
+    else {
+        value = std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+    }
+    return (half & 0x8000u) ? -value : value;
+}
+
+void HdrLuminanceHistogram::Add(float luminance) {
+    if (!(luminance > 0.0f)) return;
+
+    // Exponent plus the top three mantissa bits is log2 in 1/8 stop steps
+    uint32_t bits = 0;
+    std::memcpy(&bits, &luminance, sizeof(bits));
+    int bin = static_cast<int>(bits >> 20) - ((127 + MinLog2) * BinsPerStop);
+    bins[std::clamp(bin, 0, BinCount - 1)]++;
+    total++;
+}
+
+float HdrLuminanceHistogram::AutoExposure() const {
+    if (total == 0) return 0.0f;
+
+    // Ignore the darkest 5% and brightest 2% so black borders and light sources don't dominate
+    const uint64_t low = total * 5 / 100;
+    const uint64_t high = total - total * 2 / 100;
+
+    uint64_t seen = 0;
+    double weightedLog = 0.0;
+    uint64_t counted = 0;
+    for (int i = 0; i < BinCount; ++i) {
+        uint64_t begin = seen;
+        uint64_t end = seen + bins[i];
+        seen = end;
+
+        uint64_t first = std::max(begin, low);
+        uint64_t last = std::min(end, high);
+        if (last <= first) continue;
+
+        double binLog = MinLog2 + (i + 0.5) / BinsPerStop;
+        weightedLog += binLog * static_cast<double>(last - first);
+        counted += last - first;
+    }
+    if (counted == 0) return 0.0f;
+
+    const double middleGrey = std::log2(0.18);
+    double exposure = middleGrey - weightedLog / static_cast<double>(counted);
+    return static_cast<float>(std::clamp(exposure, -10.0, 10.0));
+}
+
+void HdrToneLut::Build(const HdrToneSettings& settings) {
+    m_table.assign(1u << 16, 0);
+
+    const float scale = std::exp2(settings.exposure);
+    const float invGamma = 1.0f / std::max(settings.gamma, 0.1f);
+
+    // Only the positive finite half range needs evaluating, sign bit set stays black
+    for (uint32_t h = 1; h < 0x7C00u; ++h) {
+        float mapped = ApplyToneOperator(HalfToFloat(static_cast<uint16_t>(h)) * scale, settings.op);
+        mapped = std::clamp(mapped, 0.0f, 1.0f);
+        int out = static_cast<int>(std::pow(mapped, invGamma) * 255.0f + 0.5f);
+        m_table[h] = static_cast<uint8_t>(std::clamp(out, 0, 255));
+    }
+    std::fill(m_table.begin() + 0x7C00, m_table.begin() + 0x8000, static_cast<uint8_t>(255));
+}
+
+bool DecodeHdrToRadiance(
+    HdrScanlineReader& reader,
+    uint32_t dstWidth,
+    uint32_t dstHeight,
+    HdrRadianceBuffer& out,
+    const std::function<bool()>& shouldContinue)
+{
+    const HdrHeader& header = reader.Header();
+    const uint32_t srcWidth = static_cast<uint32_t>(header.width);
+    const uint32_t srcHeight = static_cast<uint32_t>(header.height);
+    if (dstWidth == 0 || dstHeight == 0 || dstWidth > srcWidth || dstHeight > srcHeight) return false;
+
+    out.clear();
+    out.width = dstWidth;
+    out.height = dstHeight;
+    out.pixels.resize(static_cast<size_t>(dstWidth) * dstHeight * 3);
+
+    // Box filter bins, each source column/row lands in exactly one destination column/row
+    std::vector<uint32_t> colBin(srcWidth);
+    std::vector<uint32_t> colCount(dstWidth, 0);
+    for (uint32_t x = 0; x < srcWidth; ++x) {
+        colBin[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * dstWidth / srcWidth);
+        colCount[colBin[x]]++;
+    }
+
+    std::vector<float> scanline(static_cast<size_t>(srcWidth) * 3);
+    std::vector<float> accum(static_cast<size_t>(dstWidth) * 3, 0.0f);
+
+    int64_t currentBin = -1;
+    uint32_t rowsInBin = 0;
+
+    auto flush = [&]() {
+        uint16_t* dst = out.pixels.data() + static_cast<size_t>(currentBin) * dstWidth * 3;
+        float* acc = accum.data();
+        for (uint32_t dx = 0; dx < dstWidth; ++dx, acc += 3, dst += 3) {
+            float inv = 1.0f / static_cast<float>(colCount[dx] * rowsInBin);
+            float r = acc[0] * inv;
+            float g = acc[1] * inv;
+            float b = acc[2] * inv;
+            dst[0] = FloatToHalf(r);
+            dst[1] = FloatToHalf(g);
+            dst[2] = FloatToHalf(b);
+            out.histogram.Add(0.2126f * r + 0.7152f * g + 0.0722f * b);
+            acc[0] = acc[1] = acc[2] = 0.0f;
+        }
+        };
+
+    for (uint32_t i = 0; i < srcHeight; ++i) {
+        if (shouldContinue && !shouldContinue()) return false;
+
+        int row = 0;
+        if (!reader.ReadScanline(scanline.data(), &row)) return false;
+
+        int64_t bin = static_cast<int64_t>(static_cast<uint64_t>(row) * dstHeight / srcHeight);
+        if (bin != currentBin) {
+            if (currentBin >= 0) flush();
+            currentBin = bin;
+            rowsInBin = 0;
+        }
+
+        const float* src = scanline.data();
+        if (srcWidth == dstWidth) {
+            for (size_t k = 0; k < accum.size(); ++k) accum[k] += src[k];
+        }
+        else {
+            for (uint32_t x = 0; x < srcWidth; ++x, src += 3) {
+                float* acc = accum.data() + static_cast<size_t>(colBin[x]) * 3;
+                acc[0] += src[0];
+                acc[1] += src[1];
+                acc[2] += src[2];
+            }
+        }
+        rowsInBin++;
+    }
+
+    if (currentBin >= 0) flush();
+    return true;
+}
+
+void ToneMapRadianceRect(
+    const HdrRadianceBuffer& radiance,
+    const HdrToneLut& lut,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+    uint8_t* dst,
+    size_t dstStride)
+{
+    if (lut.empty() || x >= radiance.width || y >= radiance.height) return;
+    width = std::min(width, radiance.width - x);
+    height = std::min(height, radiance.height - y);
+
+    const uint8_t* table = lut.Data();
+    for (uint32_t row = y; row < y + height; ++row) {
+        const uint16_t* src = radiance.pixels.data() + (static_cast<size_t>(row) * radiance.width + x) * 3;
+        uint32_t* out = reinterpret_cast<uint32_t*>(dst + (row - y) * dstStride);
+        for (uint32_t i = 0; i < width; ++i, src += 3) {
+            // Alpha is opaque, so premultiplied BGRA == straight BGRA
+            out[i] = static_cast<uint32_t>(table[src[2]]) |
+                (static_cast<uint32_t>(table[src[1]]) << 8) |
+                (static_cast<uint32_t>(table[src[0]]) << 16) |
+                0xFF000000u;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Streaming Radiance RGBE (.hdr) decoder.
+// Scanlines are decoded one at a time so a full float image is never materialized.
+
+struct HdrHeader {
+    int width = 0;
+    int height = 0;
+    bool bottomUp = false;   // "+Y" resolution string, scanlines stored bottom to top
+    bool mirrorX = false;    // "-X" resolution string
+    size_t dataOffset = 0;
+};
+
+class HdrScanlineReader {
+public:
+    bool Open(const uint8_t* data, size_t size);
+    const HdrHeader& Header() const { return m_header; }
+
+    // Decodes the next stored scanline into linear RGB floats (width * 3).
+    // outRow receives the top-down row index of the decoded scanline.
+    bool ReadScanline(float* rgbOut, int* outRow);
+
+private:
+    bool ReadRgbe(uint8_t* rgbeOut);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+    int m_nextScanline = 0;
+    HdrHeader m_header;
+    std::vector<uint8_t> m_rgbe;
+};
+
+enum class HdrToneOperator {
+    Reinhard = 0,
+    Aces = 1,
+    Hable = 2,
+    Clip = 3
+};
+
+struct HdrToneSettings {
+    float exposure = 0.0f;   // EV stops applied before the operator
+    float gamma = 2.2f;
+    HdrToneOperator op = HdrToneOperator::Reinhard;
+};
+
+// Log2 luminance histogram in 1/8 EV bins, filled while decoding
+struct HdrLuminanceHistogram {
+    static constexpr int BinCount = 256;
+    static constexpr int BinsPerStop = 8;
+    static constexpr int MinLog2 = -16;
+
+    uint64_t bins[BinCount] = {};
+    uint64_t total = 0;
+
+    void Add(float luminance);
+
+    // Exposure that places the trimmed log-average luminance at middle grey
+    float AutoExposure() const;
+};
+
+// Display-resolution radiance kept as half floats so the tone curve can change without re-decoding
+struct HdrRadianceBuffer {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint16_t> pixels;   // RGB half floats, width * 3 per row
+    HdrLuminanceHistogram histogram;
+
+    bool empty() const { return pixels.empty(); }
+    void clear() { width = height = 0; pixels.clear(); pixels.shrink_to_fit(); histogram = {}; }
+};
+
+// Exposure, operator and display gamma folded into one table indexed by half-float bits
+class HdrToneLut {
+public:
+    void Build(const HdrToneSettings& settings);
+    const uint8_t* Data() const { return m_table.data(); }
+    bool empty() const { return m_table.empty(); }
+
+private:
+    std::vector<uint8_t> m_table;
+};
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t half);
+
+// Decodes and box-downsamples into a half-float radiance buffer in one pass.
+// Memory use is one source scanline plus one accumulator row of the destination.
+// shouldContinue is polled once per scanline so callers can abandon stale loads.
+bool DecodeHdrToRadiance(
+    HdrScanlineReader& reader,
+    uint32_t dstWidth,
+    uint32_t dstHeight,
+    HdrRadianceBuffer& out,
+    const std::function<bool()>& shouldContinue);
+
+// Tone-maps a rectangle of the radiance buffer into opaque BGRA.
+// dst points at the first pixel of the rectangle, matching a WIC rect lock.
+void ToneMapRadianceRect(
+    const HdrRadianceBuffer& radiance,
+    const HdrToneLut& lut,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+    uint8_t* dst,
+    size_t dstStride);
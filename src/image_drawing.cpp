@@ -1,6 +1,7 @@
 #include "viewer.h"
 #include <d2d1helper.h>
 #include <numbers>
+#include <format>
 
 
 
@@ -141,7 +142,72 @@ void ViewerApp::DiscardDeviceResources() {
     m_ctx.cropRectBrush = nullptr;
     m_ctx.fadeBrush = nullptr;
     m_ctx.svgDocument = nullptr;
-    m_ctx.highResImageSource = nullptr;
+    if (m_ctx.deepZoom) m_ctx.deepZoom->DiscardBitmaps();
+    std::ranges::fill(m_ctx.mipBitmaps, nullptr);
+    m_ctx.animationD2DBitmap = nullptr;
+    m_ctx.sequenceD2DBitmap = nullptr;
+}
+
+// Builds 2x reductions of the displayed image in the background so zooming out neither aliases
+// nor samples the full bitmap every frame
+void ViewerApp::StartMipBuild() {
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    if (m_ctx.mipSource == m_ctx.wicConverter) return;
+
+    m_ctx.mipSource = m_ctx.wicConverter;
+    m_ctx.mipPyramid.reset();
+    m_ctx.stagedMipPyramid.reset();
+    m_ctx.mipBitmaps.clear();
+
+    // HDR bitmaps are retoned in place, animation frames change every tick
+    if (!m_ctx.wicConverter || m_ctx.isHdr || m_ctx.isAnimated || m_ctx.isSvg) return;
+
+    UINT width = 0, height = 0;
+    if (FAILED(m_ctx.wicConverter->GetSize(&width, &height))) return;
+
+    auto pyramid = std::make_shared<MipPyramid>();
+    if (!pyramid->Init(width, height)) return;
+
+    ComPtr<IWICBitmapSource> source = m_ctx.wicConverter;
+    int seqId = m_ctx.loadSequenceId;
+    m_ctx.RunBackgroundTask([this, source, pyramid, seqId, width, height]() {
+        if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) return;
+        wil::unique_couninitialize_call cleanupCOM;
+
+        const UINT stripRows = 64;
+        const UINT stride = width * 4;
+        std::vector<BYTE> strip(static_cast<size_t>(stride) * stripRows);
+        for (UINT y = 0; y < height; y += stripRows) {
+            const UINT count = std::min(stripRows, height - y);
+            {
+                // The source may be a lazy decoder chain over the current file, only touch it while it is still shown
+                std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+                if (!IsSequenceValid(seqId) || m_ctx.mipSource != source) return;
+                WICRect rc = { 0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(count) };
+                if (FAILED(source->CopyPixels(&rc, stride, stride * count, strip.data()))) return;
+            }
+            pyramid->PushRows(strip.data(), stride, count);
+        }
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+            if (!IsSequenceValid(seqId) || m_ctx.mipSource != source) return;
+            m_ctx.stagedMipPyramid = pyramid;
+        }
+        PostMessage(m_ctx.hWnd, WM_APP_MIPS_READY, 0, (LPARAM)seqId);
+        });
+}
+
+void ViewerApp::OnMipsReady(int seqId) {
+    if (m_ctx.loadSequenceId != seqId) return;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+        if (!m_ctx.stagedMipPyramid || m_ctx.mipSource != m_ctx.wicConverter) return;
+        m_ctx.mipPyramid = std::move(m_ctx.stagedMipPyramid);
+        m_ctx.mipBitmaps.assign(m_ctx.mipPyramid->LevelCount(), nullptr);
+    }
+    m_ctx.isOsdCacheValid = false;
+    InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
 }
 
 void ViewerApp::DrawOsdOverlay(ID2D1DeviceContext* renderTarget) {
@@ -164,6 +230,35 @@ void ViewerApp::DrawOsdOverlay(ID2D1DeviceContext* renderTarget) {
         osdText += L"F-stop: " + props.fStop + L"  Exposure: " + props.exposureTime + L"  ISO: " + props.iso + L"\n";
         osdText += L"Author: " + props.author + L"  Software: " + props.software + L"\n";
 
+        if (m_ctx.isHdr) {
+            static const wchar_t* toneNames[] = { L"Reinhard", L"ACES Filmic", L"Hable Filmic", L"Clip" };
+            osdText += std::format(L"HDR: {}  Exposure: {:+.2f} EV{}  Gamma: {:.1f}\n",
+                toneNames[static_cast<int>(m_ctx.hdrTone.op)], m_ctx.hdrTone.exposure,
+                m_ctx.hdrAutoExposure ? L" (Auto)" : L"", m_ctx.hdrTone.gamma);
+        }
+
+        if (m_ctx.isAnimated) {
+            const FramePrefetchStats stats = m_ctx.animationPrefetcher.Stats();
+            osdText += std::format(L"Playback: {} presented  {} late  {} dropped  {} queued\n",
+                stats.presented, stats.late, stats.dropped, m_ctx.animationPrefetcher.Queued());
+            const AnimationTimingStats& timing = m_ctx.animationScheduler.Stats();
+            osdText += std::format(L"Timing: {:.1f} ms avg  {:.1f} ms max behind  {} skipped  {} resyncs\n",
+                timing.MeanLateMs(), timing.maxLateUs / 1000.0, timing.skipped, timing.resyncs);
+        }
+
+        if (m_ctx.sequencePlayer.IsRunning()) {
+            const SequencePlaybackStats stats = m_ctx.sequencePlayer.Stats();
+            osdText += std::format(L"Sequence: {:.1f} of {:.0f} fps  {} late  {} dropped  {} queued  {:.1f} ms decode\n",
+                stats.AchievedFps(), m_ctx.sequencePlayer.Fps(), stats.late, stats.dropped, m_ctx.sequencePlayer.Queued(), stats.MeanDecodeMs());
+        }
+
+        if (m_ctx.mipPyramid) {
+            const double baseMB = static_cast<double>(m_ctx.mipPyramid->BaseWidth()) * m_ctx.mipPyramid->BaseHeight() * 4 / (1024.0 * 1024.0);
+            const double mipMB = m_ctx.mipPyramid->MemoryBytes() / (1024.0 * 1024.0);
+            osdText += std::format(L"Memory: Image {:.1f} MB  Mipmaps {:.1f} MB (+{:.0f}%, {} levels)\n",
+                baseMB, mipMB, baseMB > 0.0 ? mipMB * 100.0 / baseMB : 0.0, m_ctx.mipPyramid->LevelCount());
+        }
+
         m_ctx.cachedOsdText = osdText;
         m_ctx.isOsdCacheValid = true;
     }
@@ -228,7 +323,7 @@ void ViewerApp::Render() {
         m_ctx.renderTarget->Clear(color);
     }
 
-    if (m_ctx.isLoading && (GetTickCount64() - m_ctx.loadStartTime >= 700)) {
+    if (m_ctx.isLoading && !m_ctx.isPartialImage && (GetTickCount64() - m_ctx.loadStartTime >= 700)) {
         RECT rc;
         GetClientRect(m_ctx.hWnd, &rc);
         D2D1_RECT_F layoutRect = D2D1::RectF(
@@ -263,34 +358,53 @@ void ViewerApp::Render() {
         ComPtr<ID2D1Bitmap> bitmapToDraw;
         bool hasImage = false;
 
-        if (m_ctx.isAnimated) {
-           std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
-            if (m_ctx.animationD2DBitmaps.size() != m_ctx.animationFrameDelays.size()) {
-                m_ctx.animationD2DBitmaps.assign(m_ctx.animationFrameDelays.size(), nullptr);
-                m_ctx.d2dBitmap = nullptr;
-                m_ctx.wicConverter = nullptr;
+        if (const SequenceFrame* frame = m_ctx.sequenceFrame) {
+            // Frames of a sequence share one size, the device bitmap is made once and overwritten
+            if (!m_ctx.sequenceD2DBitmap) {
+                D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+                    D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+                    96.0f, 96.0f
+                );
+                m_ctx.renderTarget->CreateBitmap(D2D1::SizeU(frame->width, frame->height), frame->pixels.data(),
+                    frame->width * 4, &props, &m_ctx.sequenceD2DBitmap);
             }
-
-            // Lazy load and aggressive unload
-            if (m_ctx.currentAnimationFrame < m_ctx.animationFrameDelays.size()) {
-                if (!m_ctx.animationD2DBitmaps[m_ctx.currentAnimationFrame]) {
-
-
-                    // Vectorized clear to aggressively unload all frames except the current one
-                    std::ranges::fill(m_ctx.animationD2DBitmaps, nullptr);
-
-                    ComPtr<IWICBitmapSource> source = m_ctx.currentAnimatedConverter;
-                    ComPtr<ID2D1Bitmap> d2dFrameBitmap;
+            else if (m_ctx.sequenceD2DStale) {
+                m_ctx.sequenceD2DBitmap->CopyFromMemory(nullptr, frame->pixels.data(), frame->width * 4);
+            }
+            m_ctx.sequenceD2DStale = false;
+            bitmapToDraw = m_ctx.sequenceD2DBitmap;
+            hasImage = (bitmapToDraw != nullptr);
+        }
+        else if (m_ctx.isAnimated) {
+           std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+            // The device bitmap is created once and then only takes the rects frames changed
+            if (m_ctx.animationBitmap) {
+                const AnimationCompositor::Rect& dirty = m_ctx.animationD2DDirty;
+                if (!m_ctx.animationD2DBitmap) {
                     D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
                         D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
                         96.0f, 96.0f
                     );
-                    if (SUCCEEDED(m_ctx.renderTarget->CreateBitmapFromWicBitmap(source.Get(), &props, &d2dFrameBitmap))) {
-                        m_ctx.animationD2DBitmaps[m_ctx.currentAnimationFrame] = d2dFrameBitmap;
+                    m_ctx.renderTarget->CreateBitmapFromWicBitmap(m_ctx.animationBitmap.Get(), &props, &m_ctx.animationD2DBitmap);
+                }
+                else if (!dirty.Empty()) {
+                    // Read back from the WIC bitmap, the compositor's canvas may belong to the prefetch worker
+                    WICRect rc = { static_cast<INT>(dirty.left), static_cast<INT>(dirty.top), static_cast<INT>(dirty.width), static_cast<INT>(dirty.height) };
+                    ComPtr<IWICBitmapLock> lock;
+                    if (SUCCEEDED(m_ctx.animationBitmap->Lock(&rc, WICBitmapLockRead, &lock))) {
+                        UINT cbStride = 0, cbBufferSize = 0;
+                        BYTE* pbBuffer = nullptr;
+                        lock->GetStride(&cbStride);
+                        lock->GetDataPointer(&cbBufferSize, &pbBuffer);
+                        if (pbBuffer) {
+                            D2D1_RECT_U dstRect = D2D1::RectU(dirty.left, dirty.top, dirty.left + dirty.width, dirty.top + dirty.height);
+                            m_ctx.animationD2DBitmap->CopyFromMemory(&dstRect, pbBuffer, cbStride);
+                        }
                     }
                 }
-                bitmapToDraw = m_ctx.animationD2DBitmaps[m_ctx.currentAnimationFrame];
+                m_ctx.animationD2DDirty = {};
             }
+            bitmapToDraw = m_ctx.animationD2DBitmap;
             hasImage = (bitmapToDraw != nullptr);
         }
         else if (!m_ctx.isSvg) {
@@ -306,7 +420,8 @@ void ViewerApp::Render() {
                     &props,
                     &m_ctx.d2dBitmap
                 );
-                m_ctx.animationD2DBitmaps.clear();
+                m_ctx.animationD2DBitmap = nullptr;
+                StartMipBuild();
             }
             bitmapToDraw = m_ctx.d2dBitmap;
             hasImage = (m_ctx.wicConverter != nullptr);
@@ -366,58 +481,92 @@ void ViewerApp::Render() {
                 D2D1_BITMAP_INTERPOLATION_MODE interpModeBmp = (!m_ctx.smoothScaling || isIntegerZoom) ?
                     D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR : D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
 
+                // Below half size draw the reduction closest to the screen size, stretched over the base bitmap's rect.
+                // With smoothing off the base bitmap is sampled directly, reductions are averaged.
+                ComPtr<ID2D1Bitmap> mipBitmap;
+                if (m_ctx.mipPyramid && m_ctx.smoothScaling && !m_ctx.isAnimated && !m_ctx.sequenceFrame && m_ctx.mipSource == m_ctx.wicConverter) {
+                    int level = SelectMipLevel(m_ctx.zoomFactor * std::min(nativeScaleX, nativeScaleY), m_ctx.mipPyramid->LevelCount());
+                    if (level >= 0) {
+                        if (!m_ctx.mipBitmaps[level]) {
+                            const MipLevel& mip = m_ctx.mipPyramid->Level(level);
+                            D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+                                D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+                                96.0f, 96.0f
+                            );
+                            m_ctx.renderTarget->CreateBitmap(D2D1::SizeU(mip.width, mip.height), mip.pixels.data(),
+                                static_cast<UINT32>(mip.Stride()), &props, &m_ctx.mipBitmaps[level]);
+                        }
+                        mipBitmap = m_ctx.mipBitmaps[level];
+                    }
+                }
+
                 // Draw base bitmap 
-                m_ctx.renderTarget->DrawBitmap(
-                    bitmapToDraw.Get(), nullptr, opacity,
-                    interpModeBmp
-                );
+                if (mipBitmap) {
+                    m_ctx.renderTarget->DrawBitmap(
+                        mipBitmap.Get(), D2D1::RectF(0.0f, 0.0f, bmpSize.width, bmpSize.height), opacity,
+                        interpModeBmp
+                    );
+                }
+                else {
+                    m_ctx.renderTarget->DrawBitmap(
+                        bitmapToDraw.Get(), nullptr, opacity,
+                        interpModeBmp
+                    );
+                }
+
+                CheckDecodeResolution();
 
-                // Hardware-Accelerated Deep Zoom
-                bool useHighRes = m_ctx.isDownscaled && m_ctx.zoomFactor > m_ctx.downscaleRatio && !m_ctx.rawFileData.empty() && !m_ctx.isFading;
+                // Tiled deep zoom, full-resolution tiles for the visible area decoded in the background
+                bool useHighRes = m_ctx.isDownscaled && m_ctx.zoomFactor > m_ctx.downscaleRatio && HasDeepZoomSource() && !m_ctx.isFading && !m_ctx.sequenceFrame;
                 if (useHighRes) {
-                    ComPtr<ID2D1DeviceContext5> dc5;
-                    if (SUCCEEDED(m_ctx.renderTarget->QueryInterface(IID_PPV_ARGS(&dc5)))) {
-
-                        // Natively initialize virtualized image source on demand
-                        if (!m_ctx.highResImageSource) {
-                            ComPtr<IWICBitmapDecoder> decoder;
-                            if (SUCCEEDED(m_ctx.wicFactory->CreateDecoderFromStream(m_ctx.wicStream.Get(), NULL, WICDecodeMetadataCacheOnLoad, &decoder))) {
-                                ComPtr<IWICBitmapFrameDecode> frame;
-                                if (SUCCEEDED(decoder->GetFrame(0, &frame))) {
-                                    ComPtr<IWICFormatConverter> converter;
-                                    if (SUCCEEDED(m_ctx.wicFactory->CreateFormatConverter(&converter))) {
-                                        if (SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone, nullptr, 0.f, WICBitmapPaletteTypeCustom))) {
-                                            dc5->CreateImageSourceFromWic(
-                                                converter.Get(),
-                                                D2D1_IMAGE_SOURCE_LOADING_OPTIONS_NONE,
-                                                D2D1_ALPHA_MODE_PREMULTIPLIED,
-                                                &m_ctx.highResImageSource
-                                            );
-                                        }
-                                    }
-                                }
-                            }
+                    if (!m_ctx.deepZoom) {
+                        // Stays around inactive when the file cannot be tiled, so the attempt is not repeated every frame
+                        m_ctx.deepZoom = std::make_unique<TiledDeepZoom>();
+                        if (!m_ctx.tilePyramidPath.empty()) {
+                            m_ctx.deepZoom->StartFromPyramid(m_ctx.tilePyramidPath, m_ctx.tilePyramidKey, static_cast<UINT>(bmpSize.width),
+                                GetTileCacheBudget(), m_ctx.hWnd, WM_APP_HIGH_RES_READY);
                         }
+                        else {
+                            m_ctx.deepZoom->Start(m_ctx.rawFileData.data(), m_ctx.rawFileData.size(),
+                                m_ctx.originalWidth, m_ctx.originalHeight, static_cast<UINT>(bmpSize.width),
+                                GetTileCacheBudget(), m_ctx.hWnd, WM_APP_HIGH_RES_READY);
+                        }
+                    }
 
-                        // Draw natively 
-                        if (m_ctx.highResImageSource) {
-                            D2D1::Matrix3x2F currentTransform;
-                            dc5->GetTransform(&currentTransform);
-
-                            // Scale massive image source down to match the coordinate space of base bitmap
-                            dc5->SetTransform(D2D1::Matrix3x2F::Scale(ratioX, ratioY, D2D1::Point2F(0, 0)) * currentTransform);
+                    D2D1::Matrix3x2F currentTransform;
+                    m_ctx.renderTarget->GetTransform(&currentTransform);
+
+                    // Tiles are placed in full-resolution pixels, scaled down into the base bitmap's space
+                    D2D1::Matrix3x2F fullResTransform = D2D1::Matrix3x2F::Scale(ratioX, ratioY, D2D1::Point2F(0, 0)) * currentTransform;
+                    D2D1::Matrix3x2F screenToImage = fullResTransform;
+                    if (m_ctx.deepZoom->IsActive() && screenToImage.Invert()) {
+                        const D2D1_POINT_2F corners[4] = {
+                            screenToImage.TransformPoint(D2D1::Point2F(0.0f, 0.0f)),
+                            screenToImage.TransformPoint(D2D1::Point2F(rtSize.width, 0.0f)),
+                            screenToImage.TransformPoint(D2D1::Point2F(0.0f, rtSize.height)),
+                            screenToImage.TransformPoint(D2D1::Point2F(rtSize.width, rtSize.height))
+                        };
+                        TileRect viewport = { corners[0].x, corners[0].y, corners[0].x, corners[0].y };
+                        for (const D2D1_POINT_2F& corner : corners) {
+                            viewport.left = std::min<double>(viewport.left, corner.x);
+                            viewport.top = std::min<double>(viewport.top, corner.y);
+                            viewport.right = std::max<double>(viewport.right, corner.x);
+                            viewport.bottom = std::max<double>(viewport.bottom, corner.y);
+                        }
 
-                            dc5->DrawImage(
-                                m_ctx.highResImageSource.Get(),
-                                nullptr,
-                                nullptr,
-                                D2D1_INTERPOLATION_MODE_LINEAR,
-                                D2D1_COMPOSITE_MODE_SOURCE_OVER
-                            );
+                        std::vector<TileDraw> draws;
+                        m_ctx.deepZoom->Update(viewport, m_ctx.zoomFactor, GetTickCount64() / 1000.0, draws);
 
-                            // Restore original transform
-                            dc5->SetTransform(currentTransform);
+                        m_ctx.renderTarget->SetTransform(fullResTransform);
+                        for (const TileDraw& draw : draws) {
+                            if (ID2D1Bitmap* tileBitmap = m_ctx.deepZoom->GetBitmap(m_ctx.renderTarget.Get(), draw)) {
+                                m_ctx.renderTarget->DrawBitmap(tileBitmap,
+                                    D2D1::RectF(static_cast<float>(draw.dest.left), static_cast<float>(draw.dest.top),
+                                        static_cast<float>(draw.dest.right), static_cast<float>(draw.dest.bottom)),
+                                    opacity, interpModeBmp);
+                            }
                         }
+                        m_ctx.renderTarget->SetTransform(currentTransform);
                     }
                 }
             }
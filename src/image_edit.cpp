@@ -1,4 +1,5 @@
 #include "viewer.h"
+#include "resampler.h"
 #include <objidl.h>
 #include <format>
 
@@ -56,6 +57,7 @@ void ViewerApp::CommitCrop() {
                             m_ctx.animationFrameMetadata.clear();
                             m_ctx.animationFrameDelays.clear();
                             KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
+                            m_ctx.animationPrefetcher.Stop();
                         }
                     }
                 
@@ -106,7 +108,10 @@ void ViewerApp::ApplyEffectsToView() {
             UINT newH = static_cast<UINT>(h * ratio);
 
             ComPtr<IWICBitmapScaler> scaler;
-            if (SUCCEEDED(m_ctx.wicFactory->CreateBitmapScaler(&scaler))) {
+            if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(m_ctx.wicFactory.Get(), source.Get(), newW, newH)) {
+                source = scaled;
+            }
+            else if (SUCCEEDED(m_ctx.wicFactory->CreateBitmapScaler(&scaler))) {
                 if (SUCCEEDED(scaler->Initialize(source.Get(), newW, newH, WICBitmapInterpolationModeFant))) {
                     source = scaler;
                 }
@@ -157,12 +162,226 @@ ComPtr<IWICBitmapSource> ViewerApp::ApplyCropAndTransform(ComPtr<IWICBitmapSourc
     return source;
 }
 
+// Scales into a new 32bpp PBGRA bitmap with the threaded resampler. Null on failure, callers fall back to WIC
+ComPtr<IWICBitmap> ViewerApp::ResampleToBitmap(IWICImagingFactory* pFactory, IWICBitmapSource* pSource, UINT width, UINT height) {
+    UINT srcW = 0, srcH = 0;
+    if (!pFactory || !pSource || FAILED(pSource->GetSize(&srcW, &srcH))) return nullptr;
+
+    ResampleOptions options;
+    options.linearLight = m_ctx.linearLightScaling;
+    Resampler resampler;
+    if (!resampler.Init(srcW, srcH, width, height, options)) return nullptr;
+
+    ComPtr<IWICBitmap> dst;
+    if (FAILED(pFactory->CreateBitmap(width, height, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &dst))) return nullptr;
+
+    WICRect dstRect = { 0, 0, static_cast<INT>(width), static_cast<INT>(height) };
+    ComPtr<IWICBitmapLock> dstLock;
+    UINT dstStride = 0, dstSize = 0;
+    BYTE* dstData = nullptr;
+    if (FAILED(dst->Lock(&dstRect, WICBitmapLockWrite, &dstLock)) ||
+        FAILED(dstLock->GetStride(&dstStride)) ||
+        FAILED(dstLock->GetDataPointer(&dstSize, &dstData))) {
+        return nullptr;
+    }
+
+    // Bitmaps already in display format are read in place, anything else is converted strip by strip
+    ComPtr<IWICBitmapLock> srcLock;
+    const BYTE* srcData = nullptr;
+    UINT srcStride = 0;
+    WICPixelFormatGUID srcFormat{};
+    ComPtr<IWICBitmap> srcBitmap;
+    if (SUCCEEDED(pSource->GetPixelFormat(&srcFormat)) && srcFormat == GUID_WICPixelFormat32bppPBGRA &&
+        SUCCEEDED(pSource->QueryInterface(IID_PPV_ARGS(&srcBitmap)))) {
+        WICRect srcRect = { 0, 0, static_cast<INT>(srcW), static_cast<INT>(srcH) };
+        UINT srcSize = 0;
+        BYTE* data = nullptr;
+        if (SUCCEEDED(srcBitmap->Lock(&srcRect, WICBitmapLockRead, &srcLock)) &&
+            SUCCEEDED(srcLock->GetStride(&srcStride)) &&
+            SUCCEEDED(srcLock->GetDataPointer(&srcSize, &data))) {
+            srcData = data;
+        }
+        else {
+            srcLock = nullptr;
+        }
+    }
+
+    ComPtr<IWICFormatConverter> converter;
+    if (!srcData) {
+        converter = ConvertToFormat(pFactory, pSource);
+        if (!converter) return nullptr;
+    }
+
+    std::vector<BYTE> strip;
+    auto fetch = [&](uint32_t y, uint32_t count, size_t& stride) -> const uint8_t* {
+        if (srcData) {
+            stride = srcStride;
+            return srcData + static_cast<size_t>(y) * srcStride;
+        }
+        const UINT rowBytes = srcW * 4;
+        strip.resize(static_cast<size_t>(rowBytes) * count);
+        WICRect rc = { 0, static_cast<INT>(y), static_cast<INT>(srcW), static_cast<INT>(count) };
+        if (FAILED(converter->CopyPixels(&rc, rowBytes, static_cast<UINT>(strip.size()), strip.data()))) return nullptr;
+        stride = rowBytes;
+        return strip.data();
+        };
+
+    if (!resampler.Run(fetch, dstData, dstStride)) return nullptr;
+    return dst;
+}
+
+bool ViewerApp::CanRetoneHdr() {
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    return m_ctx.isHdr && m_ctx.hdrBitmap && !m_ctx.hdrRadiance.empty() &&
+        m_ctx.wicConverterOriginal && m_ctx.wicConverterOriginal == m_ctx.hdrSource;
+}
+
+bool ViewerApp::CanUpdateHdrBitmapInPlace() {
+    // The device bitmap must be a 1:1 copy of hdrBitmap, crops and render scaling break that
+    if (!m_ctx.d2dBitmap || m_ctx.isCropActive || m_ctx.renderScale != 1.0f) return false;
+    D2D1_SIZE_U size = m_ctx.d2dBitmap->GetPixelSize();
+    return size.width == m_ctx.hdrRadiance.width && size.height == m_ctx.hdrRadiance.height;
+}
+
+WICRect ViewerApp::GetVisibleHdrRect() {
+    const HdrRadianceBuffer& radiance = m_ctx.hdrRadiance;
+    RECT cr;
+    GetClientRect(m_ctx.hWnd, &cr);
+    if (IsRectEmpty(&cr) || m_ctx.originalWidth == 0 || m_ctx.originalHeight == 0) {
+        return { 0, 0, static_cast<INT>(radiance.width), static_cast<INT>(radiance.height) };
+    }
+
+    // Any window corner can be the extreme once the view is rotated
+    const POINT corners[4] = { { cr.left, cr.top }, { cr.right, cr.top }, { cr.left, cr.bottom }, { cr.right, cr.bottom } };
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        float localX = 0.0f, localY = 0.0f;
+        ConvertWindowToImagePoint(corners[i], localX, localY);
+        minX = (i == 0) ? localX : std::min(minX, localX);
+        minY = (i == 0) ? localY : std::min(minY, localY);
+        maxX = (i == 0) ? localX : std::max(maxX, localX);
+        maxY = (i == 0) ? localY : std::max(maxY, localY);
+    }
+
+    // Image space is the original resolution, the radiance buffer may be downscaled.
+    // One pixel of slack covers the linear filter footprint at the edges.
+    const float scaleX = static_cast<float>(radiance.width) / m_ctx.originalWidth;
+    const float scaleY = static_cast<float>(radiance.height) / m_ctx.originalHeight;
+    const int maxW = static_cast<int>(radiance.width);
+    const int maxH = static_cast<int>(radiance.height);
+    int left = std::clamp(static_cast<int>(std::floor(minX * scaleX)) - 1, 0, maxW);
+    int top = std::clamp(static_cast<int>(std::floor(minY * scaleY)) - 1, 0, maxH);
+    int right = std::clamp(static_cast<int>(std::ceil(maxX * scaleX)) + 1, left, maxW);
+    int bottom = std::clamp(static_cast<int>(std::ceil(maxY * scaleY)) + 1, top, maxH);
+    return { left, top, right - left, bottom - top };
+}
+
+void ViewerApp::RetoneHdrRect(const WICRect& rc) {
+    if (rc.Width <= 0 || rc.Height <= 0) return;
+
+    ComPtr<IWICBitmapLock> lock;
+    if (FAILED(m_ctx.hdrBitmap->Lock(&rc, WICBitmapLockWrite, &lock))) return;
+
+    UINT cbStride = 0, cbBufferSize = 0;
+    BYTE* pbBuffer = nullptr;
+    lock->GetStride(&cbStride);
+    lock->GetDataPointer(&cbBufferSize, &pbBuffer);
+    if (!pbBuffer) return;
+
+    ToneMapRadianceRect(m_ctx.hdrRadiance, m_ctx.hdrToneLut,
+        static_cast<uint32_t>(rc.X), static_cast<uint32_t>(rc.Y),
+        static_cast<uint32_t>(rc.Width), static_cast<uint32_t>(rc.Height),
+        pbBuffer, cbStride);
+
+    // Push straight into the existing device bitmap instead of recreating it
+    if (CanUpdateHdrBitmapInPlace()) {
+        D2D1_RECT_U dstRect = D2D1::RectU(
+            static_cast<UINT32>(rc.X), static_cast<UINT32>(rc.Y),
+            static_cast<UINT32>(rc.X + rc.Width), static_cast<UINT32>(rc.Y + rc.Height));
+        m_ctx.d2dBitmap->CopyFromMemory(&dstRect, pbBuffer, cbStride);
+    }
+}
+
+void ViewerApp::AdjustHdrTone(WORD cmd) {
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    if (!CanRetoneHdr()) return;
+
+    constexpr float EXPOSURE_STEP = 1.0f / 3.0f;
+    constexpr float EXPOSURE_LIMIT = 16.0f;
+    HdrToneSettings& tone = m_ctx.hdrTone;
+    switch (cmd) {
+    case IDM_HDR_EXPOSURE_UP:   tone.exposure = std::min(tone.exposure + EXPOSURE_STEP, EXPOSURE_LIMIT); break;
+    case IDM_HDR_EXPOSURE_DOWN: tone.exposure = std::max(tone.exposure - EXPOSURE_STEP, -EXPOSURE_LIMIT); break;
+    case IDM_HDR_AUTO_EXPOSURE:
+        m_ctx.hdrAutoExposure = !m_ctx.hdrAutoExposure;
+        [[fallthrough]];
+    case IDM_HDR_EXPOSURE_RESET:
+        tone.exposure = m_ctx.hdrAutoExposure ? m_ctx.hdrRadiance.histogram.AutoExposure() : 0.0f;
+        break;
+    case IDM_HDR_OP_REINHARD:   tone.op = HdrToneOperator::Reinhard; break;
+    case IDM_HDR_OP_ACES:       tone.op = HdrToneOperator::Aces; break;
+    case IDM_HDR_OP_HABLE:      tone.op = HdrToneOperator::Hable; break;
+    case IDM_HDR_OP_CLIP:       tone.op = HdrToneOperator::Clip; break;
+    case IDM_HDR_GAMMA_18:      tone.gamma = 1.8f; break;
+    case IDM_HDR_GAMMA_22:      tone.gamma = 2.2f; break;
+    case IDM_HDR_GAMMA_24:      tone.gamma = 2.4f; break;
+    default: return;
+    }
+
+    m_ctx.hdrToneLut.Build(tone);
+
+    if (CanUpdateHdrBitmapInPlace()) {
+        // Visible region now, the rest once adjustments settle
+        m_ctx.hdrRetonedRect = GetVisibleHdrRect();
+        RetoneHdrRect(m_ctx.hdrRetonedRect);
+        m_ctx.hdrRetonePending = true;
+        SetTimer(m_ctx.hWnd, HDR_RETONE_TIMER_ID, 100, nullptr);
+    }
+    else {
+        // Device bitmap is rebuilt from the WIC chain on the next paint, so every pixel must be current
+        m_ctx.d2dBitmap = nullptr;
+        RetoneHdrRect({ 0, 0, static_cast<INT>(m_ctx.hdrRadiance.width), static_cast<INT>(m_ctx.hdrRadiance.height) });
+        m_ctx.hdrRetonePending = false;
+        KillTimer(m_ctx.hWnd, HDR_RETONE_TIMER_ID);
+    }
+
+    m_ctx.isOsdCacheValid = false;
+    InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
+}
+
+void ViewerApp::FinishHdrRetone() {
+    KillTimer(m_ctx.hWnd, HDR_RETONE_TIMER_ID);
+
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    if (!m_ctx.hdrRetonePending) return;
+    m_ctx.hdrRetonePending = false;
+    if (!CanRetoneHdr()) return;
+
+    if (!CanUpdateHdrBitmapInPlace()) {
+        m_ctx.d2dBitmap = nullptr;
+    }
+
+    // Bands above and below the already updated rect, then the slabs either side of it
+    const WICRect& done = m_ctx.hdrRetonedRect;
+    const INT width = static_cast<INT>(m_ctx.hdrRadiance.width);
+    const INT height = static_cast<INT>(m_ctx.hdrRadiance.height);
+    RetoneHdrRect({ 0, 0, width, done.Y });
+    RetoneHdrRect({ 0, done.Y + done.Height, width, height - (done.Y + done.Height) });
+    RetoneHdrRect({ 0, done.Y, done.X, done.Height });
+    RetoneHdrRect({ done.X + done.Width, done.Y, width - (done.X + done.Width), done.Height });
+
+    InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
+}
+
 ComPtr<IWICBitmapSource> ViewerApp::GetSaveSource(const GUID& targetFormat) {
    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
     ComPtr<IWICBitmapSource> source;
 
     if (m_ctx.isAnimated && m_ctx.currentAnimationFrame < m_ctx.animationFrameDelays.size()) {
-        source = m_ctx.currentAnimatedConverter;
+        // The animation bitmap is updated in place as playback goes on, save a copy of this frame
+        ComPtr<IWICBitmap> frameCopy;
+        if (FAILED(m_ctx.wicFactory->CreateBitmapFromSource(m_ctx.currentAnimatedConverter.Get(), WICBitmapCacheOnLoad, &frameCopy))) return nullptr;
+        source = frameCopy;
     }
     else if (m_ctx.wicConverterOriginal) {
         source = m_ctx.wicConverterOriginal;
@@ -299,7 +518,12 @@ void ViewerApp::SaveImageWithResize(const std::wstring& filePath, const GUID& co
     {
        std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
         if (m_ctx.isAnimated && m_ctx.currentAnimationFrame < m_ctx.animationFrameDelays.size()) {
-            source = m_ctx.currentAnimatedConverter;
+            ComPtr<IWICBitmap> frameCopy;
+            if (FAILED(m_ctx.wicFactory->CreateBitmapFromSource(m_ctx.currentAnimatedConverter.Get(), WICBitmapCacheOnLoad, &frameCopy))) {
+                MessageBoxW(m_ctx.hWnd, L"Could not get image source to resize.", L"Resize Error", MB_ICONERROR);
+                return;
+            }
+            source = frameCopy;
         }
         else if (m_ctx.wicConverterOriginal) {
             source = m_ctx.wicConverterOriginal;
@@ -313,7 +537,10 @@ void ViewerApp::SaveImageWithResize(const std::wstring& filePath, const GUID& co
     source = ApplyCropAndTransform(source);
 
     ComPtr<IWICBitmapScaler> scaler;
-    if (SUCCEEDED(m_ctx.wicFactory->CreateBitmapScaler(&scaler))) {
+    if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(m_ctx.wicFactory.Get(), source.Get(), newWidth, newHeight)) {
+        source = scaled;
+    }
+    else if (SUCCEEDED(m_ctx.wicFactory->CreateBitmapScaler(&scaler))) {
         if (SUCCEEDED(scaler->Initialize(source.Get(), newWidth, newHeight, WICBitmapInterpolationModeFant))) {
             source = scaler;
         }
@@ -1,9 +1,20 @@
 #include "viewer.h"
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <shlwapi.h> 
 #include <filesystem>
 #include <propkey.h>
+#include "hdr_decode.h"
+#include "pixel_convert.h"
+#include "area_downscale.h"
+#include "raw_formats.h"
+#include "pyramid_cache.h"
+#include "resampler.h"
+#include "jpeg_decode.h"
+#include "png_decode.h"
+#include "pixel_composite.h"
+#include "parallel.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4996) // Suppress 'fopen' unsafe error
@@ -12,7 +23,7 @@
 #define QOI_IMPLEMENTATION
 #include "qoi.h"
 
-// stb_image is used only for Radiance HDR (.hdr) float decoding
+// stb_image is used for the TGA/PSD/PNM/PIC fallback formats
 
 #define STBI_NO_STDIO
 #define STB_IMAGE_IMPLEMENTATION
@@ -31,6 +42,277 @@ static bool IsImageFile(const wchar_t* filePath) {
         L"*.tga;*.psd;*.ppm;*.pgm;*.pbm;*.pnm;*.pic") == TRUE;
 }
 
+// Builds the PBGRA display bitmap from rows in the given layout, pushed top to bottom. Downscaling
+// averages at the source bit depth so quantization to 8 bits happens once, at the end.
+template <typename Sample>
+class DisplayBitmapWriter {
+public:
+    bool Begin(IWICImagingFactory* factory, PixelSource layout, UINT srcW, UINT srcH, UINT dstW, UINT dstH) {
+        const UINT channels = static_cast<UINT>(PixelSourceBytesPerPixel(layout) / sizeof(Sample));
+        m_convert = GetPixelRowConverter(layout, true);
+        if (!m_convert || channels < 1 || channels > 4) return false;
+
+        if (FAILED(factory->CreateBitmap(dstW, dstH, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &m_bitmap))) return false;
+
+        WICRect rc = { 0, 0, (INT)dstW, (INT)dstH };
+        UINT size = 0;
+        if (FAILED(m_bitmap->Lock(&rc, WICBitmapLockWrite, &m_lock))) return false;
+        m_lock->GetStride(&m_stride);
+        m_lock->GetDataPointer(&size, &m_dest);
+        if (!m_dest) return false;
+
+        m_srcW = srcW;
+        m_dstW = dstW;
+        m_direct = dstW == srcW && dstH == srcH;
+        if (m_direct) return true;
+
+        m_quantized.resize(static_cast<size_t>(dstW) * channels);
+        return m_downscaler.Init(srcW, srcH, dstW, dstH, channels);
+    }
+
+    void PushRow(const Sample* row) {
+        if (m_direct) {
+            m_convert(row, m_dest + static_cast<size_t>(m_row++) * m_stride, m_srcW);
+            return;
+        }
+        uint32_t dstRow = 0;
+        if (const float* done = m_downscaler.PushRow(row, &dstRow)) {
+            QuantizeRow(done, m_quantized.data(), m_quantized.size());
+            m_convert(m_quantized.data(), m_dest + static_cast<size_t>(dstRow) * m_stride, m_dstW);
+        }
+    }
+
+    // Unlocks the bitmap once every source row has been pushed
+    ComPtr<IWICBitmap> Finish() {
+        m_lock = nullptr;
+        m_dest = nullptr;
+        return std::move(m_bitmap);
+    }
+
+private:
+    PixelRowConverter m_convert = nullptr;
+    ComPtr<IWICBitmap> m_bitmap;
+    ComPtr<IWICBitmapLock> m_lock;
+    UINT m_stride = 0;
+    BYTE* m_dest = nullptr;
+    UINT m_srcW = 0;
+    UINT m_dstW = 0;
+    bool m_direct = false;
+    UINT m_row = 0;
+    AreaDownscaler m_downscaler;
+    std::vector<Sample> m_quantized;
+};
+
+// getRow returns source rows top to bottom, or nullptr to abandon the load
+template <typename Sample>
+static ComPtr<IWICBitmap> CreateDisplayBitmap(
+    IWICImagingFactory* factory,
+    PixelSource layout,
+    UINT srcW, UINT srcH,
+    UINT dstW, UINT dstH,
+    const std::function<const Sample* (UINT y)>& getRow)
+{
+    DisplayBitmapWriter<Sample> writer;
+    if (!writer.Begin(factory, layout, srcW, srcH, dstW, dstH)) return nullptr;
+
+    for (UINT y = 0; y < srcH; ++y) {
+        const Sample* row = getRow(y);
+        if (!row) return nullptr;
+        writer.PushRow(row);
+    }
+    return writer.Finish();
+}
+
+// 16-bit WIC frames (PNG, TIFF) downscaled without the 8-bit round trip of the Fant scaler.
+// Rows are pulled in strips so the full-resolution frame is never held in memory.
+static ComPtr<IWICBitmap> DownscaleHighBitDepthFrame(IWICImagingFactory* factory, IWICBitmapSource* frame, UINT newW, UINT newH) {
+    WICPixelFormatGUID format = {};
+    if (FAILED(frame->GetPixelFormat(&format))) return nullptr;
+
+    UINT channels = 0;
+    PixelSource layout = PixelSource::Gray16;
+    ComPtr<IWICBitmapSource> source = frame;
+    if (format == GUID_WICPixelFormat16bppGray) {
+        channels = 1;
+    }
+    else if (format == GUID_WICPixelFormat48bppRGB || format == GUID_WICPixelFormat48bppBGR ||
+        format == GUID_WICPixelFormat64bppRGBA || format == GUID_WICPixelFormat64bppBGRA ||
+        format == GUID_WICPixelFormat64bppPRGBA || format == GUID_WICPixelFormat64bppPBGRA) {
+        ComPtr<IWICFormatConverter> converter;
+        if (FAILED(factory->CreateFormatConverter(&converter))) return nullptr;
+        if (FAILED(converter->Initialize(frame, GUID_WICPixelFormat64bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0f, WICBitmapPaletteTypeCustom))) return nullptr;
+        source = converter;
+        channels = 4;
+        layout = PixelSource::RGBA16;
+    }
+    else {
+        return nullptr;
+    }
+
+    UINT width = 0, height = 0;
+    if (FAILED(source->GetSize(&width, &height)) || newW == 0 || newH == 0) return nullptr;
+
+    constexpr UINT StripRows = 64;
+    const UINT rowStride = width * channels * sizeof(uint16_t);
+    std::vector<uint16_t> strip(static_cast<size_t>(width) * channels * StripRows);
+    UINT stripStart = 0, stripCount = 0;
+
+    return CreateDisplayBitmap<uint16_t>(factory, layout, width, height, newW, newH,
+        [&](UINT y) -> const uint16_t* {
+            if (y >= stripStart + stripCount) {
+                stripStart = y;
+                stripCount = std::min(StripRows, height - y);
+                WICRect rc = { 0, (INT)stripStart, (INT)width, (INT)stripCount };
+                if (FAILED(source->CopyPixels(&rc, rowStride, rowStride * stripCount, reinterpret_cast<BYTE*>(strip.data())))) return nullptr;
+            }
+            return strip.data() + static_cast<size_t>(y - stripStart) * width * channels;
+        });
+}
+
+// Baseline and progressive JPEGs are reduced by 1/2, 1/4 or 1/8 inside the IDCT, so only the
+// step from there to the display size goes through the resampler
+static ComPtr<IWICBitmap> DecodeJpegScaled(IWICImagingFactory* factory, const uint8_t* data, size_t size, UINT newW, UINT newH, const ResampleOptions& options) {
+    JpegDecoder jpeg;
+    if (newW == 0 || newH == 0 || !jpeg.ReadHeader(data, size)) return nullptr;
+
+    const uint32_t scale = ChooseJpegScale(jpeg.Width(), jpeg.Height(), newW, newH);
+    const uint32_t decodedW = JpegDecoder::ScaledSize(jpeg.Width(), scale);
+    const uint32_t decodedH = JpegDecoder::ScaledSize(jpeg.Height(), scale);
+
+    ComPtr<IWICBitmap> bmp;
+    if (FAILED(factory->CreateBitmap(newW, newH, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &bmp))) return nullptr;
+
+    WICRect rc = { 0, 0, (INT)newW, (INT)newH };
+    ComPtr<IWICBitmapLock> lock;
+    UINT stride = 0, bufferSize = 0;
+    BYTE* dest = nullptr;
+    if (FAILED(bmp->Lock(&rc, WICBitmapLockWrite, &lock))) return nullptr;
+    lock->GetStride(&stride);
+    lock->GetDataPointer(&bufferSize, &dest);
+    if (!dest) return nullptr;
+
+    // Output is opaque, so BGRA is already premultiplied
+    if (decodedW == newW && decodedH == newH) {
+        return jpeg.Decode(scale, dest, stride) ? bmp : nullptr;
+    }
+
+    std::vector<uint8_t> decoded(static_cast<size_t>(decodedW) * decodedH * 4);
+    if (!jpeg.Decode(scale, decoded.data(), static_cast<size_t>(decodedW) * 4)) return nullptr;
+    if (!ResampleBgra8(decoded.data(), static_cast<size_t>(decodedW) * 4, decodedW, decodedH, dest, stride, newW, newH, options)) return nullptr;
+    return bmp;
+}
+
+// Interlaced PNGs show an early Adam7 pass when the rest is predicted to take at least this long
+constexpr ULONGLONG PartialPngMinRemainingMs = 250;
+
+// Finished animation frames waiting in the prefetch ring
+constexpr size_t AnimationPrefetchBudget = size_t{ 48 } << 20;
+
+// Decoded frames queued ahead in image sequence playback
+#ifdef _WIN64
+constexpr size_t SequencePrefetchBudget = size_t{ 384 } << 20;
+#else
+constexpr size_t SequencePrefetchBudget = size_t{ 96 } << 20;
+#endif
+
+static int64_t PlaybackClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// GIF frame headers walked per message once the first frame is on screen
+constexpr size_t AnimationHeaderBatch = 256;
+
+static AppContext::AnimationFrameMetadata GifFrameMetadata(const GifDecoder::Frame& frame) {
+    AppContext::AnimationFrameMetadata meta;
+    meta.width = frame.width;
+    meta.height = frame.height;
+    meta.left = frame.left;
+    meta.top = frame.top;
+    meta.disposal = frame.disposal;
+    meta.delay = frame.delay <= 10 ? 100 : frame.delay;
+    return meta;
+}
+
+// APNG disposal in the compositor's GIF numbering. Restoring before the first frame means
+// clearing, as there is nothing earlier to restore.
+static AppContext::AnimationFrameMetadata ApngFrameMetadata(const PngDecoder::AnimationFrame& frame, size_t index) {
+    AppContext::AnimationFrameMetadata meta;
+    meta.width = frame.width;
+    meta.height = frame.height;
+    meta.left = frame.left;
+    meta.top = frame.top;
+    meta.disposal = frame.dispose == 1 || (frame.dispose == 2 && index == 0) ? 2 : frame.dispose == 2 ? 3 : 0;
+    // Unlike GIF, short delays are meant: 0 or 10 ms is as fast as possible, the scheduler's floor applies
+    meta.delay = frame.delay;
+    return meta;
+}
+
+using PngPartialSink = std::function<bool(const ComPtr<IWICBitmap>& partial)>;
+
+template <typename Sample>
+static ComPtr<IWICBitmap> DecodePngAs(IWICImagingFactory* factory, PngDecoder& png, UINT newW, UINT newH,
+    const std::function<bool()>& stillWanted, const PngPartialSink& onPartial)
+{
+    DisplayBitmapWriter<Sample> writer;
+    if (!writer.Begin(factory, png.Layout(), png.Width(), png.Height(), newW, newH)) return nullptr;
+
+    bool abandoned = false;
+    const auto onRow = [&](uint32_t y, const uint8_t* row) {
+        if ((y & 255) == 0 && !stillWanted()) {
+            abandoned = true;
+            return false;
+        }
+        writer.PushRow(reinterpret_cast<const Sample*>(row));
+        return true;
+        };
+
+    // Passes 1-3 hold 1/16 of the pixels and 1-5 a quarter, which predicts the time still to go
+    const ULONGLONG start = GetTickCount64();
+    const auto onPass = [&](uint32_t pass) {
+        if (!stillWanted()) {
+            abandoned = true;
+            return false;
+        }
+        if (!onPartial || (pass != 3 && pass != 5)) return true;
+        const ULONGLONG remaining = (GetTickCount64() - start) * ((pass == 3) ? 15 : 3);
+        if (remaining < PartialPngMinRemainingMs) return true;
+
+        uint32_t previewW = 0, previewH = 0;
+        png.PreviewSize(previewW, previewH);
+        const bool shrink = previewW > newW || previewH > newH;
+        DisplayBitmapWriter<Sample> preview;
+        if (!preview.Begin(factory, png.Layout(), previewW, previewH, shrink ? newW : previewW, shrink ? newH : previewH)) return true;
+        for (uint32_t y = 0; y < previewH; ++y) {
+            preview.PushRow(reinterpret_cast<const Sample*>(png.PreviewRow(y)));
+        }
+        abandoned = !onPartial(preview.Finish());
+        return !abandoned;
+        };
+
+    if (!png.Decode(onRow, onPass) || abandoned) return nullptr;
+    return writer.Finish();
+}
+
+// PNGs decode natively: the next band of scanlines inflates while the one before is unfiltered and
+// converted or averaged down to the display size. onPartial receives coarse images of interlaced
+// files and returns false to abandon the load.
+static ComPtr<IWICBitmap> DecodePngToDisplay(IWICImagingFactory* factory, const uint8_t* data, size_t size, UINT newW, UINT newH,
+    const std::function<bool()>& stillWanted, const PngPartialSink& onPartial)
+{
+    PngDecoder png;
+    if (newW == 0 || newH == 0 || !png.ReadHeader(data, size)) return nullptr;
+
+    switch (png.Layout()) {
+    case PixelSource::Gray16:
+    case PixelSource::GrayA16:
+    case PixelSource::RGB16:
+    case PixelSource::RGBA16:
+        return DecodePngAs<uint16_t>(factory, png, newW, newH, stillWanted, onPartial);
+    default:
+        return DecodePngAs<uint8_t>(factory, png, newW, newH, stillWanted, onPartial);
+    }
+}
+
 bool ViewerApp::IsSequenceValid(int seqId) {
     return m_ctx.loadSequenceId == seqId;
 }
@@ -59,8 +341,462 @@ HRESULT ViewerApp::CreateDecoderFromFile(const wchar_t* filePath, IWICBitmapDeco
     return CreateDecoderFromStream_FullFileRead(m_ctx.wicFactory.Get(), filePath, ppDecoder, -1);
 }
 
+// Binary PNM and uncompressed BMP are plain pixel arrays, so they are converted straight from a
+// file mapping into the display bitmap. Returns false for anything outside that subset.
+bool ViewerApp::LoadMappedRawImage(const std::wstring& filePath, int seqId, UINT maxDim) {
+    wil::unique_hfile hFile(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (!hFile) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile.get(), &size) || size.QuadPart <= 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) return false;
+
+    wil::unique_handle mapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping) return false;
+
+    wil::unique_mapview_ptr<uint8_t> view(static_cast<uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    if (!view) return false;
+
+    const uint8_t* data = view.get();
+    const size_t dataSize = static_cast<size_t>(size.QuadPart);
+    const wchar_t* ext = PathFindExtensionW(filePath.c_str());
+    const bool isBmp = ext && _wcsicmp(ext, L".bmp") == 0;
+
+    RawImageInfo info;
+    if (!(isBmp ? ParseBmpHeader(data, dataSize, info) : ParsePnmHeader(data, dataSize, info))) return false;
+
+    bool downscaled = false;
+    float ratio = 1.0f;
+    UINT newW = info.width, newH = info.height;
+    if (info.width > maxDim || info.height > maxDim) {
+        // Large BMPs within the read cap stay on WIC, deep zoom re-decodes them from the file bytes
+        if (isBmp && dataSize <= 1024 * 1024 * 1024) return false;
+
+        downscaled = true;
+        ratio = std::min(static_cast<float>(maxDim) / info.width, static_cast<float>(maxDim) / info.height);
+        newW = std::max(1u, static_cast<UINT>(info.width * ratio));
+        newH = std::max(1u, static_cast<UINT>(info.height * ratio));
+    }
+
+    ComPtr<IWICImagingFactory> localFactory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&localFactory)))) return false;
+
+    // Multi-GB dumps take a while to stream, check for a newer load every 256 rows
+    auto stillWanted = [&](UINT y) { return (y & 255) != 0 || IsSequenceValid(seqId); };
+
+    ComPtr<IWICBitmap> bmp;
+    if (info.Is16Bit()) {
+        std::vector<uint16_t> row(static_cast<size_t>(info.width) * info.Channels());
+        PixelSource layout = (info.layout == RawPixelLayout::Gray16BE) ? PixelSource::Gray16 : PixelSource::RGB16;
+        bmp = CreateDisplayBitmap<uint16_t>(localFactory.Get(), layout, info.width, info.height, newW, newH,
+            [&](UINT y) -> const uint16_t* {
+                if (!stillWanted(y)) return nullptr;
+                LoadBigEndian16(info.Row(data, y), row.data(), row.size(), info.maxValue);
+                return row.data();
+            });
+    }
+    else {
+        PixelSource layout = PixelSource::Gray8;
+        switch (info.layout) {
+        case RawPixelLayout::RGB8:  layout = PixelSource::RGB8; break;
+        case RawPixelLayout::BGR8:  layout = PixelSource::BGR8; break;
+        case RawPixelLayout::BGRX8: layout = PixelSource::BGRX8; break;
+        case RawPixelLayout::BGRA8: layout = PixelSource::BGRA8; break;
+        default: break;
+        }
+        bmp = CreateDisplayBitmap<uint8_t>(localFactory.Get(), layout, info.width, info.height, newW, newH,
+            [&](UINT y) -> const uint8_t* { return stillWanted(y) ? info.Row(data, y) : nullptr; });
+    }
+    if (!bmp) return false;
+
+    ComPtr<IWICFormatConverter> finalConverter = ConvertToFormat(localFactory.Get(), bmp.Get());
+    if (!finalConverter) return false;
+
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    if (!IsSequenceValid(seqId)) return true;
+
+    m_ctx.stagedStaticConverter = finalConverter;
+
+    // Nothing to keep, the mapping is released and the file stays unlocked
+    m_ctx.stagedRawFileData.clear();
+    m_ctx.stagedWicStream = nullptr;
+
+    m_ctx.stagedWidth = info.width;
+    m_ctx.stagedHeight = info.height;
+    m_ctx.originalContainerFormat = isBmp ? GUID_ContainerFormatBmp : GUID_NULL;
+    m_ctx.stagedOrientation = 1;
+    m_ctx.isDownscaled = downscaled;
+    m_ctx.downscaleRatio = ratio;
+
+    PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)seqId);
+    return true;
+}
+
+// Pyramids live in the local app data cache, named after the file's path, size and modification time
+std::wstring ViewerApp::GetTilePyramidPath(const std::wstring& filePath, uint64_t& sourceKey) {
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExW(filePath.c_str(), GetFileExInfoStandard, &attr)) return {};
+
+    // FNV-1a over the case-folded path and the file's size and timestamp
+    std::wstring folded = filePath;
+    CharLowerBuffW(folded.data(), static_cast<DWORD>(folded.size()));
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        };
+    mix(folded.data(), folded.size() * sizeof(wchar_t));
+    mix(&attr.nFileSizeHigh, sizeof(attr.nFileSizeHigh));
+    mix(&attr.nFileSizeLow, sizeof(attr.nFileSizeLow));
+    mix(&attr.ftLastWriteTime, sizeof(attr.ftLastWriteTime));
+    sourceKey = hash;
+
+    PWSTR localAppDataPath = nullptr;
+    if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &localAppDataPath))) return {};
+    std::wstring folder = std::wstring(localAppDataPath) + L"\\deminimis\\MinimalImageViewer\\TileCache";
+    CoTaskMemFree(localAppDataPath);
+
+    wchar_t name[32];
+    swprintf_s(name, L"\\%016llx.mivtiles", static_cast<unsigned long long>(hash));
+    return folder + name;
+}
+
+// Decoded size, as 32bpp, from which an image is paged in from a tile pyramid instead
+constexpr uint64_t TilePyramidMinPixelBytes = 1024ull * 1024 * 1024;
+
+// Whether a file could be large enough for a tile pyramid, decided before the cache lookup or any
+// decoder. Only formats the builder streams are considered. A file too short to hold that many
+// pixels at its format's best compression is turned down on its size, and QOI, PNG, BMP and PNM
+// have their dimensions read from the header. TIFF has no header reader of its own, WIC decides.
+static bool MayNeedTilePyramid(const std::wstring& filePath) {
+    constexpr uint64_t minPixels = TilePyramidMinPixelBytes / 4;
+    const wchar_t* ext = PathFindExtensionW(filePath.c_str());
+    if (!ext) return false;
+
+    // Smallest file for minPixels: QOI runs code 62 pixels a byte, deflate in PNG and TIFF tops out
+    // near 1032:1 on 1-bit rows, the raw BMP and PNM subsets store at least a byte per pixel
+    enum class Kind { Qoi, Png, Tiff, Bmp, Pnm } kind;
+    uint64_t minFileBytes = 0;
+    if (_wcsicmp(ext, L".qoi") == 0) { kind = Kind::Qoi; minFileBytes = minPixels / 62; }
+    else if (_wcsicmp(ext, L".png") == 0) { kind = Kind::Png; minFileBytes = minPixels / 8 / 1032; }
+    else if (_wcsicmp(ext, L".tif") == 0 || _wcsicmp(ext, L".tiff") == 0) { kind = Kind::Tiff; minFileBytes = minPixels / 8 / 1032; }
+    else if (_wcsicmp(ext, L".bmp") == 0) { kind = Kind::Bmp; minFileBytes = minPixels; }
+    else if (_wcsicmp(ext, L".ppm") == 0 || _wcsicmp(ext, L".pgm") == 0 || _wcsicmp(ext, L".pnm") == 0) { kind = Kind::Pnm; minFileBytes = minPixels; }
+    else return false;
+
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExW(filePath.c_str(), GetFileExInfoStandard, &attr)) return false;
+    const uint64_t fileBytes = (static_cast<uint64_t>(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+    if (fileBytes < minFileBytes) return false;
+    if (kind == Kind::Tiff) return true;
+
+    // The header is all that is touched, the mapping only spares sizing a read for it
+    wil::unique_hfile hFile(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL));
+    if (!hFile || fileBytes > SIZE_MAX) return false;
+    wil::unique_handle mapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping) return false;
+    wil::unique_mapview_ptr<uint8_t> view(static_cast<uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    if (!view) return false;
+
+    const uint8_t* data = view.get();
+    const size_t size = static_cast<size_t>(fileBytes);
+    uint64_t width = 0, height = 0;
+    switch (kind) {
+    case Kind::Qoi: {
+        QoiRowDecoder decoder;
+        if (!decoder.Init(data, size)) return false;
+        width = decoder.Width();
+        height = decoder.Height();
+        break;
+    }
+    case Kind::Png: {
+        // IHDR is always the first chunk. An acTL ahead of the image data makes it an APNG,
+        // which goes to the animation path whatever its size.
+        static constexpr uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        if (size < 33 || std::memcmp(data, signature, 8) != 0 || std::memcmp(data + 12, "IHDR", 4) != 0) return false;
+        auto readBigEndian32 = [&](size_t pos) {
+            return (static_cast<uint32_t>(data[pos]) << 24) | (static_cast<uint32_t>(data[pos + 1]) << 16) |
+                (static_cast<uint32_t>(data[pos + 2]) << 8) | data[pos + 3];
+            };
+        width = readBigEndian32(16);
+        height = readBigEndian32(20);
+        for (size_t pos = 33; pos + 8 <= size;) {
+            if (std::memcmp(data + pos + 4, "acTL", 4) == 0) return false;
+            if (std::memcmp(data + pos + 4, "IDAT", 4) == 0) break;
+            pos += static_cast<size_t>(readBigEndian32(pos)) + 12;
+        }
+        break;
+    }
+    case Kind::Bmp:
+    case Kind::Pnm: {
+        RawImageInfo info;
+        if (!(kind == Kind::Bmp ? ParseBmpHeader(data, size, info) : ParsePnmHeader(data, size, info))) return false;
+        width = info.width;
+        height = info.height;
+        break;
+    }
+    default:
+        return false;
+    }
+    return width * height * 4 >= TilePyramidMinPixelBytes;
+}
+
+// Streams a gigapixel source into a disk tile pyramid a strip at a time, so peak memory is a few
+// tile rows whatever the image size. False for images small enough to decode normally, for JPEG,
+// which already zooms through scaled region decode, and for anything that cannot be streamed.
+bool ViewerApp::BuildTilePyramid(const std::wstring& filePath, int seqId, const std::wstring& pyramidPath, uint64_t sourceKey) {
+    const std::filesystem::path target(pyramidPath);
+    const wchar_t* ext = PathFindExtensionW(filePath.c_str());
+    PyramidWriter writer;
+
+    if (ext && _wcsicmp(ext, L".qoi") == 0) {
+        // The bundled QOI decoder wants the whole image in memory, rows are decoded straight from a mapping instead
+        wil::unique_hfile hFile(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+        if (!hFile) return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(hFile.get(), &size) || size.QuadPart <= 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) return false;
+
+        wil::unique_handle mapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!mapping) return false;
+
+        wil::unique_mapview_ptr<uint8_t> view(static_cast<uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+        if (!view) return false;
+
+        QoiRowDecoder decoder;
+        if (!decoder.Init(view.get(), static_cast<size_t>(size.QuadPart))) return false;
+        const uint32_t width = decoder.Width();
+        const uint32_t height = decoder.Height();
+        if (static_cast<uint64_t>(width) * height * 4 < TilePyramidMinPixelBytes) return false;
+
+        SHCreateDirectoryExW(nullptr, target.parent_path().c_str(), nullptr);
+        if (!writer.Open(target, width, height, sourceKey, TiledDeepZoom::TileSize)) return false;
+
+        const size_t rowBytes = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> rgba(rowBytes);
+        std::vector<uint8_t> row(rowBytes);
+        for (uint32_t y = 0; y < height; ++y) {
+            if ((y & 255) == 0 && !IsSequenceValid(seqId)) return false;
+            if (!decoder.NextRow(rgba.data())) return false;
+            ConvertPixels(PixelSource::RGBA8, true, rgba.data(), rowBytes, row.data(), rowBytes, width, 1);
+            if (!writer.PushRows(row.data(), rowBytes, 1)) return false;
+        }
+        return writer.Finish();
+    }
+
+    ComPtr<IWICImagingFactory> localFactory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&localFactory)))) return false;
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (FAILED(localFactory->CreateDecoderFromFilename(filePath.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+        FAILED(decoder->GetFrame(0, &frame))) {
+        return false;
+    }
+
+    UINT width = 0, height = 0;
+    if (FAILED(frame->GetSize(&width, &height)) || static_cast<uint64_t>(width) * height * 4 < TilePyramidMinPixelBytes) return false;
+
+    ComPtr<IWICBitmapSourceTransform> transform;
+    if (SUCCEEDED(frame.As(&transform))) return false;
+
+    ComPtr<IWICFormatConverter> converter;
+    if (FAILED(localFactory->CreateFormatConverter(&converter)) ||
+        FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone, nullptr, 0.f, WICBitmapPaletteTypeCustom))) {
+        return false;
+    }
+
+    SHCreateDirectoryExW(nullptr, target.parent_path().c_str(), nullptr);
+    if (!writer.Open(target, width, height, sourceKey, TiledDeepZoom::TileSize)) return false;
+
+    // Strips in file order, so codecs that decode sequentially never seek back
+    constexpr UINT stripRows = 64;
+    const UINT stride = width * 4;
+    std::vector<BYTE> strip(static_cast<size_t>(stride) * stripRows);
+    for (UINT y = 0; y < height; y += stripRows) {
+        if (!IsSequenceValid(seqId)) return false;
+        const UINT count = std::min(stripRows, height - y);
+        WICRect rc = { 0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(count) };
+        if (FAILED(converter->CopyPixels(&rc, stride, stride * count, strip.data()))) return false;
+        if (!writer.PushRows(strip.data(), stride, count)) return false;
+    }
+    return writer.Finish();
+}
+
+// Gigapixel images are shown from their tile pyramid in the disk cache, built on first open.
+// The display bitmap is resampled from the coarsest level that still covers it.
+bool ViewerApp::LoadTilePyramidImage(const std::wstring& filePath, int seqId, UINT maxDim) {
+    constexpr uint64_t maxCacheBytes = 16ull * 1024 * 1024 * 1024;
+
+    uint64_t sourceKey = 0;
+    const std::wstring pyramidPath = GetTilePyramidPath(filePath, sourceKey);
+    if (pyramidPath.empty()) return false;
+
+    PyramidReader reader;
+    if (!reader.Open(pyramidPath, sourceKey)) {
+        if (!BuildTilePyramid(filePath, seqId, pyramidPath, sourceKey) || !reader.Open(pyramidPath, sourceKey)) return false;
+        PrunePyramidCache(std::filesystem::path(pyramidPath).parent_path(), maxCacheBytes);
+    }
+    if (!IsSequenceValid(seqId)) return false;
+
+    const TileGrid& grid = reader.Grid();
+    const UINT fullW = grid.Width();
+    const UINT fullH = grid.Height();
+    const float ratio = std::min({ 1.0f, static_cast<float>(maxDim) / fullW, static_cast<float>(maxDim) / fullH });
+    const UINT newW = std::max(1u, static_cast<UINT>(fullW * ratio));
+    const UINT newH = std::max(1u, static_cast<UINT>(fullH * ratio));
+
+    uint32_t level = 0;
+    while (level + 1 < grid.LevelCount() && grid.LevelWidth(level + 1) >= newW && grid.LevelHeight(level + 1) >= newH) {
+        ++level;
+    }
+    const UINT srcW = grid.LevelWidth(level);
+    const UINT srcH = grid.LevelHeight(level);
+
+    ResampleOptions options;
+    options.linearLight = m_ctx.linearLightScaling;
+    Resampler resampler;
+    if (!resampler.Init(srcW, srcH, newW, newH, options)) return false;
+
+    ComPtr<IWICImagingFactory> localFactory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&localFactory)))) return false;
+
+    ComPtr<IWICBitmap> bmp;
+    if (FAILED(localFactory->CreateBitmap(newW, newH, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &bmp))) return false;
+    {
+        WICRect rect = { 0, 0, static_cast<INT>(newW), static_cast<INT>(newH) };
+        ComPtr<IWICBitmapLock> lock;
+        UINT dstStride = 0, dstSize = 0;
+        BYTE* dstData = nullptr;
+        if (FAILED(bmp->Lock(&rect, WICBitmapLockWrite, &lock)) ||
+            FAILED(lock->GetStride(&dstStride)) ||
+            FAILED(lock->GetDataPointer(&dstSize, &dstData))) {
+            return false;
+        }
+
+        // Level rows come from one decoded band of tiles at a time
+        const size_t rowBytes = static_cast<size_t>(srcW) * 4;
+        const uint32_t tileSize = grid.TileSize();
+        std::vector<uint8_t> band(rowBytes * tileSize);
+        std::vector<uint8_t> strip;
+        uint32_t loadedBand = UINT32_MAX;
+        auto fetch = [&](uint32_t y, uint32_t count, size_t& stride) -> const uint8_t* {
+            if (!IsSequenceValid(seqId)) return nullptr;
+            strip.resize(rowBytes * count);
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t row = y + i;
+                if (row / tileSize != loadedBand) {
+                    if (!reader.ReadBand(level, row / tileSize, band.data(), rowBytes)) return nullptr;
+                    loadedBand = row / tileSize;
+                }
+                std::memcpy(strip.data() + i * rowBytes, band.data() + (row % tileSize) * rowBytes, rowBytes);
+            }
+            stride = rowBytes;
+            return strip.data();
+            };
+        if (!resampler.Run(fetch, dstData, dstStride)) return false;
+    }
+
+    ComPtr<IWICFormatConverter> finalConverter = ConvertToFormat(localFactory.Get(), bmp.Get());
+    if (!finalConverter) return false;
+
+    std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+    if (!IsSequenceValid(seqId)) return true;
+
+    m_ctx.stagedStaticConverter = finalConverter;
+
+    // Deep zoom pages tiles in from the pyramid, the source file is never held in memory
+    m_ctx.stagedRawFileData.clear();
+    m_ctx.stagedWicStream = nullptr;
+    m_ctx.stagedTilePyramidPath = pyramidPath;
+    m_ctx.stagedTilePyramidKey = sourceKey;
+
+    m_ctx.stagedWidth = fullW;
+    m_ctx.stagedHeight = fullH;
+    m_ctx.originalContainerFormat = GUID_NULL;
+    m_ctx.stagedOrientation = 1;
+    m_ctx.isDownscaled = ratio < 1.0f;
+    m_ctx.downscaleRatio = ratio;
+
+    PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)seqId);
+    return true;
+}
+
+// Deep zoom reads either the in-memory file through WIC or the image's disk tile pyramid
+bool ViewerApp::HasDeepZoomSource() {
+    return (m_ctx.wicStream && !m_ctx.rawFileData.empty()) || !m_ctx.tilePyramidPath.empty();
+}
+
+// Bitmap and memory bound on any decode, independent of the display
+UINT ViewerApp::GetDecodeLimitCap() {
+    double cap = m_ctx.renderTarget ? m_ctx.renderTarget->GetMaximumBitmapSize() : 16384.0;
+
+    // A square 32bpp image at the cap has to fit in a quarter of the free memory
+    MEMORYSTATUSEX mem = { sizeof(mem) };
+    if (GlobalMemoryStatusEx(&mem)) {
+        double budget = static_cast<double>(mem.ullAvailPhys) / 4.0;
+#ifndef _WIN64
+        budget = std::min(budget, 256.0 * 1024 * 1024); // Address space, not RAM, is the limit here
+#endif
+        cap = std::min(cap, std::max(1024.0, std::sqrt(budget / 4.0)));
+    }
+    return static_cast<UINT>(cap);
+}
+
+// Deep zoom tiles get an eighth of free memory, within sane bounds
+size_t ViewerApp::GetTileCacheBudget() {
+    double budget = 256.0 * 1024 * 1024;
+    MEMORYSTATUSEX mem = { sizeof(mem) };
+    if (GlobalMemoryStatusEx(&mem)) {
+        budget = std::clamp(static_cast<double>(mem.ullAvailPhys) / 8.0, 64.0 * 1024 * 1024, 1024.0 * 1024 * 1024);
+    }
+#ifndef _WIN64
+    budget = std::min(budget, 128.0 * 1024 * 1024);
+#endif
+    return static_cast<size_t>(budget);
+}
+
+// Longest edge a new image is decoded to: enough to fill the monitor the window is on
+UINT ViewerApp::ComputeDecodeLimit() {
+    UINT screenEdge = 1920;
+    MONITORINFO mi = { sizeof(mi) };
+    if (GetMonitorInfoW(MonitorFromWindow(m_ctx.hWnd, MONITOR_DEFAULTTONEAREST), &mi)) {
+        // Per-monitor DPI aware, the monitor rect is already in physical pixels
+        screenEdge = static_cast<UINT>(std::max(mi.rcMonitor.right - mi.rcMonitor.left, mi.rcMonitor.bottom - mi.rcMonitor.top));
+    }
+    return std::max(1u, std::min(screenEdge, GetDecodeLimitCap()));
+}
+
+// Downscaled images with no deep zoom source are re-decoded once zoom outruns the decoded size
+void ViewerApp::CheckDecodeResolution() {
+    if (!m_ctx.isDownscaled || m_ctx.isLoading || m_ctx.isAnimated || m_ctx.isSvg || HasDeepZoomSource()) return;
+    if (m_ctx.isCropActive || m_ctx.isCropPending || !m_ctx.currentFilePathOverride.empty() || m_ctx.sequenceFrame) return;
+    if (m_ctx.zoomFactor <= m_ctx.downscaleRatio * 1.1f) return;
+
+    // Restarted on every repaint, so it fires once zooming settles
+    SetTimer(m_ctx.hWnd, DECODE_BOOST_TIMER_ID, 300, nullptr);
+}
+
+void ViewerApp::ApplyDecodeBoost() {
+    KillTimer(m_ctx.hWnd, DECODE_BOOST_TIMER_ID);
+    if (!m_ctx.isDownscaled || m_ctx.isLoading || m_ctx.isAnimated || m_ctx.isSvg || HasDeepZoomSource()) return;
+    if (m_ctx.isCropActive || m_ctx.isCropPending || !m_ctx.currentFilePathOverride.empty() || m_ctx.loadingFilePath.empty()) return;
+
+    const double fullEdge = std::max(m_ctx.originalWidth, m_ctx.originalHeight);
+    const double decodedEdge = fullEdge * m_ctx.downscaleRatio;
+    const double wanted = std::min({ fullEdge * m_ctx.zoomFactor, fullEdge, static_cast<double>(GetDecodeLimitCap()) });
+    if (wanted <= decodedEdge * 1.1) return;
+
+    m_ctx.decodeBoostPath = m_ctx.loadingFilePath;
+    m_ctx.decodeBoostLimit = static_cast<UINT>(std::ceil(wanted));
+    m_ctx.isDecodeBoostReload = true;
+    m_ctx.preserveView = true;
+    LoadImageFromFile(m_ctx.loadingFilePath);
+}
 
 void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd) {
+    StopSequencePlayback();
     CleanupPreloadingThreads();
     m_ctx.cancelPreloading = false;
     int mySeqId = ++m_ctx.loadSequenceId;
@@ -81,7 +817,15 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
         m_ctx.stagedHeight = 0;
         m_ctx.stagedOrientation = 1;
         m_ctx.stagedSvgData.clear();
+        m_ctx.stagedHdrRadiance.clear();
+        m_ctx.stagedHdrBitmap = nullptr;
+        m_ctx.stagedTilePyramidPath.clear();
+        m_ctx.stagedTilePyramidKey = 0;
+        m_ctx.stagedIsPartial = false;
+        m_ctx.stagedGifDecoder.reset();
+        m_ctx.stagedApngDecoder.reset();
     }
+    m_ctx.isPartialImage = false;
     m_ctx.currentFilePathOverride.clear();
     // Check if directory changed
     wchar_t folder[MAX_PATH] = { 0 };
@@ -93,8 +837,20 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
         m_ctx.currentDirectory = folder;
     }
 
+    // Decode for the display, a zoom-triggered reload of the same file may ask for more
+    UINT maxDim = ComputeDecodeLimit();
+    if (filePath == m_ctx.decodeBoostPath) {
+        maxDim = std::max(maxDim, m_ctx.decodeBoostLimit);
+    }
+    else {
+        m_ctx.decodeBoostPath.clear();
+        m_ctx.decodeBoostLimit = 0;
+        m_ctx.isDecodeBoostReload = false;
+    }
+    KillTimer(m_ctx.hWnd, DECODE_BOOST_TIMER_ID);
+
     InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
-    m_ctx.RunBackgroundTask([this, filePath, mySeqId]() {
+    m_ctx.RunBackgroundTask([this, filePath, mySeqId, maxDim]() {
         // Abort obsolete tasks on thread wake up
         if (!IsSequenceValid(mySeqId)) return;
 
@@ -110,6 +866,22 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
         // Check before touching the disk
         if (!IsSequenceValid(mySeqId)) return;
 
+        const wchar_t* ext = PathFindExtensionW(filePath.c_str());
+
+        // Images too large to decode whole are paged in from a disk tile pyramid. The header probe
+        // turns everything else away, GIF and APNG included, before the cache or WIC is touched.
+        if (MayNeedTilePyramid(filePath)) {
+            if (LoadTilePyramidImage(filePath, mySeqId, maxDim)) return;
+            if (!IsSequenceValid(mySeqId)) return;
+        }
+
+        // Raw pixel arrays skip the full read and convert straight from a file mapping
+        if (ext && (_wcsicmp(ext, L".ppm") == 0 || _wcsicmp(ext, L".pgm") == 0 ||
+            _wcsicmp(ext, L".pnm") == 0 || _wcsicmp(ext, L".bmp") == 0)) {
+            if (LoadMappedRawImage(filePath, mySeqId, maxDim)) return;
+            if (!IsSequenceValid(mySeqId)) return;
+        }
+
         // Read entire file to avoid locking
         wil::unique_hfile hFile(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL));
         if (!hFile) { PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId); return; }
@@ -136,7 +908,6 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
         // Final check 
         if (!IsSequenceValid(mySeqId)) return;
 
-        const wchar_t* ext = PathFindExtensionW(filePath.c_str());
         if (ext && _wcsicmp(ext, L".svg") == 0) {
             std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
             m_ctx.stagedSvgData = std::move(rawData);
@@ -144,6 +915,59 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
             return;
         }
 
+        // GIFs are posted as soon as the first frame's header is found, the rest are walked on
+        // the UI thread once it shows. WIC would open every frame and query its metadata first.
+        // The second header only tells a still GIF from an animated one. Without a screen size
+        // the canvas has to cover every frame, so those are walked to the end here.
+        if (auto gif = std::make_unique<GifDecoder>(); gif->BeginHeader(rawData.data(), rawData.size()) && gif->ReadFrames(2) > 0) {
+            if (gif->SizeFromFrames()) gif->ReadFrames(SIZE_MAX);
+            std::vector<AppContext::AnimationFrameMetadata> frames;
+            std::vector<UINT> delays;
+            for (size_t i = 0; i < gif->FrameCount(); ++i) {
+                frames.push_back(GifFrameMetadata(gif->GetFrame(i)));
+                delays.push_back(frames.back().delay);
+            }
+            std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+            // A newer load may have reset the staging since, only one decoder ever points into it
+            if (!IsSequenceValid(mySeqId)) return;
+            m_ctx.stagedApngDecoder.reset();
+            m_ctx.stagedDelays = std::move(delays);
+            m_ctx.stagedFrameMetadata = std::move(frames);
+            m_ctx.stagedWidth = gif->Width();
+            m_ctx.stagedHeight = gif->Height();
+            m_ctx.stagedGifDecoder = std::move(gif);
+            m_ctx.stagedRawFileData = std::move(rawData); // The decoder points into it, the buffer itself stays put
+            m_ctx.originalContainerFormat = GUID_ContainerFormatGif;
+            m_ctx.stagedOrientation = 1;
+
+            PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)mySeqId);
+            return;
+        }
+
+        // APNG frame headers are all in the one chunk walk, a still PNG goes on to the usual path
+        if (auto apng = std::make_unique<PngDecoder>(); apng->ReadHeader(rawData.data(), rawData.size()) && apng->AnimationFrameCount() > 1) {
+            std::vector<AppContext::AnimationFrameMetadata> frames;
+            std::vector<UINT> delays;
+            for (size_t i = 0; i < apng->AnimationFrameCount(); ++i) {
+                frames.push_back(ApngFrameMetadata(apng->GetAnimationFrame(i), i));
+                delays.push_back(frames.back().delay);
+            }
+            std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+            if (!IsSequenceValid(mySeqId)) return;
+            m_ctx.stagedGifDecoder.reset();
+            m_ctx.stagedDelays = std::move(delays);
+            m_ctx.stagedFrameMetadata = std::move(frames);
+            m_ctx.stagedWidth = apng->Width();
+            m_ctx.stagedHeight = apng->Height();
+            m_ctx.stagedApngDecoder = std::move(apng);
+            m_ctx.stagedRawFileData = std::move(rawData);
+            m_ctx.originalContainerFormat = GUID_ContainerFormatPng;
+            m_ctx.stagedOrientation = 1;
+
+            PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)mySeqId);
+            return;
+        }
+
         ComPtr<IWICFormatConverter> preloadedConverter;
         GUID containerFormat = {};
         UINT exifOrientation = 1;
@@ -199,10 +1023,11 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
 
         if (ext && _wcsicmp(ext, L".qoi") == 0) {
             qoi_desc desc;
-            void* pixels = qoi_decode(rawData.data(), static_cast<int>(rawData.size()), &desc, 4);
+            // Native channel count, RGB files skip the alpha expansion entirely
+            void* pixels = qoi_decode(rawData.data(), static_cast<int>(rawData.size()), &desc, 0);
             if (pixels) {
                 ComPtr<IWICBitmap> qoiBmp;
-                if (SUCCEEDED(localFactory->CreateBitmap(desc.width, desc.height, GUID_WICPixelFormat32bppRGBA, WICBitmapCacheOnLoad, &qoiBmp))) {
+                if (SUCCEEDED(localFactory->CreateBitmap(desc.width, desc.height, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &qoiBmp))) {
                     WICRect rc = { 0, 0, (INT)desc.width, (INT)desc.height };
                     ComPtr<IWICBitmapLock> lock;
                     if (SUCCEEDED(qoiBmp->Lock(&rc, WICBitmapLockWrite, &lock))) {
@@ -211,14 +1036,15 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                         lock->GetStride(&cbStride);
                         lock->GetDataPointer(&cbBufferSize, &pbBuffer);
                         if (pbBuffer) {
-                            memcpy(pbBuffer, pixels, desc.width * desc.height * 4);
+                            PixelSource layout = (desc.channels == 3) ? PixelSource::RGB8 : PixelSource::RGBA8;
+                            ConvertPixels(layout, true, pixels, static_cast<size_t>(desc.width) * desc.channels,
+                                pbBuffer, cbStride, desc.width, desc.height);
                         }
                     }
 
                     ComPtr<IWICBitmapSource> sourceToCache = qoiBmp;
                     bool downscaled = false;
                     float ratio = 1.0f;
-                    UINT maxDim = 3840; // Hooking into scaling constant
 
                     // Route directly into existing CPU scaler 
                     if (desc.width > maxDim || desc.height > maxDim) {
@@ -228,7 +1054,10 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                         UINT newH = static_cast<UINT>(desc.height * ratio);
 
                         ComPtr<IWICBitmapScaler> scaler;
-                        if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
+                        if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(localFactory.Get(), sourceToCache.Get(), newW, newH)) {
+                            sourceToCache = scaled;
+                        }
+                        else if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
                             if (SUCCEEDED(scaler->Initialize(sourceToCache.Get(), newW, newH, WICBitmapInterpolationModeFant))) {
                                 sourceToCache = scaler;
                             }
@@ -258,164 +1087,96 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
         }
 
         if (ext && _wcsicmp(ext, L".hdr") == 0) {
-            int hdrW = 0;
-            int hdrH = 0;
-            int hdrComp = 0;
-
-            if (!stbi_info_from_memory(
-                rawData.data(),
-                static_cast<int>(rawData.size()),
-                &hdrW,
-                &hdrH,
-                &hdrComp))
-            {
-                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
-                return;
-            }
-
-            if (hdrW <= 0 || hdrH <= 0) {
+            // Native scanline decoder, box-downsamples as it goes so arbitrarily large
+            // panoramas never need a full float intermediate
+            HdrScanlineReader hdrReader;
+            if (!hdrReader.Open(rawData.data(), rawData.size())) {
                 PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
                 return;
             }
 
-            // HDR via stb_image requires a full float decode in memory.
-            // Keep this cap isolated to HDR so it does not disturb the existing WIC massive-image path.
-            constexpr uint64_t HDR_MAX_PIXELS = 40ull * 1000ull * 1000ull;
-            uint64_t hdrPixelsCount = static_cast<uint64_t>(hdrW) * static_cast<uint64_t>(hdrH);
-
-            if (hdrPixelsCount > HDR_MAX_PIXELS) {
-                MessageBoxW(
-                    m_ctx.hWnd,
-                    L"This HDR image is too large for the stb_image HDR loader safety limit.",
-                    L"HDR Image Too Large",
-                    MB_ICONWARNING
-                );
-                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
-                return;
-            }
+            const UINT hdrW = static_cast<UINT>(hdrReader.Header().width);
+            const UINT hdrH = static_cast<UINT>(hdrReader.Header().height);
 
-            float* hdrPixels = stbi_loadf_from_memory(
-                rawData.data(),
-                static_cast<int>(rawData.size()),
-                &hdrW,
-                &hdrH,
-                &hdrComp,
-                3
-            );
+            bool downscaled = false;
+            float ratio = 1.0f;
+            UINT newW = hdrW;
+            UINT newH = hdrH;
 
-            if (!hdrPixels) {
-                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
-                return;
+            if (hdrW > maxDim || hdrH > maxDim) {
+                downscaled = true;
+                ratio = std::min(static_cast<float>(maxDim) / hdrW, static_cast<float>(maxDim) / hdrH);
+                newW = std::max(1u, static_cast<UINT>(hdrW * ratio));
+                newH = std::max(1u, static_cast<UINT>(hdrH * ratio));
             }
 
-            ComPtr<IWICBitmap> hdrBmp;
-            HRESULT hdrHr = localFactory->CreateBitmap(
-                static_cast<UINT>(hdrW),
-                static_cast<UINT>(hdrH),
-                GUID_WICPixelFormat32bppPBGRA,
-                WICBitmapCacheOnLoad,
-                &hdrBmp
-            );
-
-            if (FAILED(hdrHr)) {
-                stbi_image_free(hdrPixels);
-                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
+            HdrRadianceBuffer radiance;
+            if (!DecodeHdrToRadiance(hdrReader, newW, newH, radiance, [this, mySeqId]() { return IsSequenceValid(mySeqId); })) {
+                if (IsSequenceValid(mySeqId)) {
+                    PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
+                }
                 return;
             }
 
-            WICRect hdrRc = { 0, 0, hdrW, hdrH };
-            ComPtr<IWICBitmapLock> hdrLock;
-
-            hdrHr = hdrBmp->Lock(&hdrRc, WICBitmapLockWrite, &hdrLock);
-            if (FAILED(hdrHr)) {
-                stbi_image_free(hdrPixels);
-                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
-                return;
+            HdrToneSettings tone;
+            bool autoExposure = false;
+            {
+                std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+                tone = m_ctx.hdrTone;
+                autoExposure = m_ctx.hdrAutoExposure;
             }
+            tone.exposure = autoExposure ? radiance.histogram.AutoExposure() : 0.0f;
 
-            UINT cbStride = 0;
-            UINT cbBufferSize = 0;
-            BYTE* pbBuffer = nullptr;
-
-            hdrLock->GetStride(&cbStride);
-            hdrLock->GetDataPointer(&cbBufferSize, &pbBuffer);
+            HdrToneLut toneLut;
+            toneLut.Build(tone);
 
-            if (!pbBuffer) {
-                stbi_image_free(hdrPixels);
+            ComPtr<IWICBitmap> hdrBmp;
+            if (FAILED(localFactory->CreateBitmap(newW, newH, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &hdrBmp))) {
                 PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
                 return;
             }
 
-            auto FloatHdrToByte = [](float v) -> BYTE {
-                if (!std::isfinite(v) || v <= 0.0f) {
-                    return 0;
-                }
-
-            // Simple Reinhard tone map, then display gamma.
-            float mapped = v / (1.0f + v);
-            float gammaCorrected = powf(mapped, 1.0f / 2.2f);
-
-            int out = static_cast<int>(gammaCorrected * 255.0f + 0.5f);
-            if (out < 0) return 0;
-            if (out > 255) return 255;
-            return static_cast<BYTE>(out);
-            };
-
-            for (int y = 0; y < hdrH; ++y) {
-                const float* srcRow = hdrPixels + (static_cast<size_t>(y) * static_cast<size_t>(hdrW) * 3u);
-                BYTE* dstRow = pbBuffer + (static_cast<size_t>(y) * cbStride);
-
-                for (int x = 0; x < hdrW; ++x) {
-                    const float r = srcRow[x * 3 + 0];
-                    const float g = srcRow[x * 3 + 1];
-                    const float b = srcRow[x * 3 + 2];
-
-                    BYTE* dst = dstRow + (static_cast<size_t>(x) * 4u);
-
-                    // Alpha is opaque, so premultiplied RGB == normal RGB.
-                    dst[0] = FloatHdrToByte(b);
-                    dst[1] = FloatHdrToByte(g);
-                    dst[2] = FloatHdrToByte(r);
-                    dst[3] = 255;
+            bool toneMapped = false;
+            {
+                WICRect hdrRc = { 0, 0, static_cast<INT>(newW), static_cast<INT>(newH) };
+                ComPtr<IWICBitmapLock> hdrLock;
+                if (SUCCEEDED(hdrBmp->Lock(&hdrRc, WICBitmapLockWrite, &hdrLock))) {
+                    UINT cbStride = 0, cbBufferSize = 0;
+                    BYTE* pbBuffer = nullptr;
+                    hdrLock->GetStride(&cbStride);
+                    hdrLock->GetDataPointer(&cbBufferSize, &pbBuffer);
+
+                    if (pbBuffer) {
+                        ToneMapRadianceRect(radiance, toneLut, 0, 0, newW, newH, pbBuffer, cbStride);
+                        toneMapped = true;
+                    }
                 }
             }
 
-            stbi_image_free(hdrPixels);
-
-            ComPtr<IWICBitmapSource> sourceToCache = hdrBmp;
-            bool downscaled = false;
-            float ratio = 1.0f;
-            UINT maxDim = 3840; 
-
-            if (static_cast<UINT>(hdrW) > maxDim || static_cast<UINT>(hdrH) > maxDim) {
-                downscaled = true;
-                ratio = std::min(
-                    static_cast<float>(maxDim) / static_cast<float>(hdrW),
-                    static_cast<float>(maxDim) / static_cast<float>(hdrH)
-                );
-
-                UINT newW = static_cast<UINT>(hdrW * ratio);
-                UINT newH = static_cast<UINT>(hdrH * ratio);
-
-                ComPtr<IWICBitmapScaler> scaler;
-                if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
-                    if (SUCCEEDED(scaler->Initialize(sourceToCache.Get(), newW, newH, WICBitmapInterpolationModeFant))) {
-                        sourceToCache = scaler;
-                    }
+            if (!toneMapped) {
+                if (IsSequenceValid(mySeqId)) {
+                    PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
                 }
+                return;
             }
 
-            if (ComPtr<IWICFormatConverter> finalConverter = ConvertToFormat(localFactory.Get(), sourceToCache.Get())) {
+            if (ComPtr<IWICFormatConverter> finalConverter = ConvertToFormat(localFactory.Get(), hdrBmp.Get())) {
                 std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
 
+                if (!IsSequenceValid(mySeqId)) return;
                 m_ctx.stagedStaticConverter = finalConverter;
 
-                // Don't add stb to high-res path
+                // No WIC codec for HDR, keep it off the high-res path
                 m_ctx.stagedRawFileData.clear();
                 m_ctx.stagedWicStream = nullptr;
 
-                m_ctx.stagedWidth = static_cast<UINT>(hdrW);
-                m_ctx.stagedHeight = static_cast<UINT>(hdrH);
+                // Radiance is kept so exposure and tone-mapping can change without re-decoding
+                m_ctx.stagedHdrRadiance = std::move(radiance);
+                m_ctx.stagedHdrBitmap = hdrBmp;
+                m_ctx.stagedHdrExposure = tone.exposure;
+
+                m_ctx.stagedWidth = hdrW;
+                m_ctx.stagedHeight = hdrH;
                 m_ctx.originalContainerFormat = GUID_NULL;
                 m_ctx.stagedOrientation = 1;
                 m_ctx.isDownscaled = downscaled;
@@ -456,11 +1217,70 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                 return;
             }
 
+            // 16-bit PNM/PSD are averaged at full precision and only quantized for display
+            if (stbi_is_16_bit_from_memory(rawData.data(), static_cast<int>(rawData.size())))
+            {
+                stbi_us* pixels16 = stbi_load_16_from_memory(
+                    rawData.data(),
+                    static_cast<int>(rawData.size()),
+                    &w, &h, &comp,
+                    0
+                );
+
+                if (!pixels16)
+                {
+                    PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
+                    return;
+                }
+
+                bool downscaled = false;
+                float ratio = 1.0f;
+                UINT newW = (UINT)w, newH = (UINT)h;
+
+                if ((UINT)w > maxDim || (UINT)h > maxDim)
+                {
+                    downscaled = true;
+                    ratio = std::min((float)maxDim / w, (float)maxDim / h);
+                    newW = std::max(1u, (UINT)(w * ratio));
+                    newH = std::max(1u, (UINT)(h * ratio));
+                }
+
+                const size_t rowSamples = static_cast<size_t>(w) * comp;
+                static const PixelSource layouts16[] = { PixelSource::Gray16, PixelSource::GrayA16, PixelSource::RGB16, PixelSource::RGBA16 };
+                ComPtr<IWICBitmap> bmp16 = CreateDisplayBitmap<uint16_t>(localFactory.Get(), layouts16[std::clamp(comp, 1, 4) - 1], (UINT)w, (UINT)h, newW, newH,
+                    [&](UINT y) -> const uint16_t* { return pixels16 + y * rowSamples; });
+                stbi_image_free(pixels16);
+
+                if (bmp16)
+                {
+                    if (ComPtr<IWICFormatConverter> finalConverter = ConvertToFormat(localFactory.Get(), bmp16.Get()))
+                    {
+                        std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+
+                        m_ctx.stagedStaticConverter = finalConverter;
+                        m_ctx.stagedRawFileData = std::move(rawData);
+                        m_ctx.stagedWidth = (UINT)w;
+                        m_ctx.stagedHeight = (UINT)h;
+                        m_ctx.originalContainerFormat = GUID_NULL;
+                        m_ctx.stagedOrientation = 1;
+                        m_ctx.isDownscaled = downscaled;
+                        m_ctx.downscaleRatio = ratio;
+
+                        PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)mySeqId);
+                        return;
+                    }
+                }
+
+                PostMessage(m_ctx.hWnd, WM_APP_IMAGE_LOAD_FAILED, 0, (LPARAM)mySeqId);
+                return;
+            }
+
+            // Native component count, the swizzle kernels expand to BGRA
             unsigned char* pixels = stbi_load_from_memory(
                 rawData.data(),
                 static_cast<int>(rawData.size()),
                 &w, &h, &comp,
-                4
+                0
             );
 
             if (!pixels)
@@ -473,7 +1293,7 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
 
             if (SUCCEEDED(localFactory->CreateBitmap(
                 (UINT)w, (UINT)h,
-                GUID_WICPixelFormat32bppRGBA,
+                GUID_WICPixelFormat32bppPBGRA,
                 WICBitmapCacheOnLoad,
                 &bmp)))
             {
@@ -490,7 +1310,9 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
 
                     if (dest)
                     {
-                        memcpy(dest, pixels, (size_t)w * h * 4);
+                        static const PixelSource layouts[] = { PixelSource::Gray8, PixelSource::GrayA8, PixelSource::RGB8, PixelSource::RGBA8 };
+                        ConvertPixels(layouts[std::clamp(comp, 1, 4) - 1], true, pixels, static_cast<size_t>(w) * comp,
+                            dest, stride, (UINT)w, (UINT)h);
                     }
                 }
 
@@ -498,7 +1320,6 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
 
                 bool downscaled = false;
                 float ratio = 1.0f;
-                UINT maxDim = 3840;
 
                 if ((UINT)w > maxDim || (UINT)h > maxDim)
                 {
@@ -509,7 +1330,11 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                     UINT newH = (UINT)(h * ratio);
 
                     ComPtr<IWICBitmapScaler> scaler;
-                    if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler)) &&
+                    if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(localFactory.Get(), sourceToCache.Get(), newW, newH))
+                    {
+                        sourceToCache = scaled;
+                    }
+                    else if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler)) &&
                         SUCCEEDED(scaler->Initialize(sourceToCache.Get(), newW, newH, WICBitmapInterpolationModeFant)))
                     {
                         sourceToCache = scaler;
@@ -581,7 +1406,6 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                 UINT frameWidth = 0, frameHeight = 0;
                 frame->GetSize(&frameWidth, &frameHeight);
 
-                UINT maxDim = 3840; // 4K max base 
                 ComPtr<IWICBitmapSource> sourceToCache = frame;
                 bool downscaled = false;
                 float ratio = 1.0f;
@@ -608,7 +1432,12 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                             UINT newH = static_cast<UINT>(previewH * prevRatio);
 
                             ComPtr<IWICBitmapScaler> scaler;
-                            if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
+                            if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(localFactory.Get(), preview.Get(), newW, newH)) {
+                                sourceToCache = scaled;
+                                downscaled = true;
+                                ratio = std::min(static_cast<float>(newW) / frameWidth, static_cast<float>(newH) / frameHeight);
+                            }
+                            else if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
                                 if (SUCCEEDED(scaler->Initialize(preview.Get(), newW, newH, WICBitmapInterpolationModeFant))) {
                                     sourceToCache = scaler;
                                     downscaled = true;
@@ -619,8 +1448,52 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                     }
                 }
 
+                // PNG skips WIC, downscaling while it decodes
+                bool decodedNatively = false;
+                if (!loadedPreview && containerFormat == GUID_ContainerFormatPng) {
+                    const bool shrink = frameWidth > maxDim || frameHeight > maxDim;
+                    const float pngRatio = shrink ? std::min(static_cast<float>(maxDim) / frameWidth, static_cast<float>(maxDim) / frameHeight) : 1.0f;
+                    const UINT newW = shrink ? std::max(1u, static_cast<UINT>(frameWidth * pngRatio)) : frameWidth;
+                    const UINT newH = shrink ? std::max(1u, static_cast<UINT>(frameHeight * pngRatio)) : frameHeight;
+
+                    // Coarse passes are shown as they land, the file bytes stay with this thread until the end
+                    auto showPartial = [&](const ComPtr<IWICBitmap>& partial) {
+                        UINT partialW = 0, partialH = 0;
+                        partial->GetSize(&partialW, &partialH);
+                        ComPtr<IWICFormatConverter> partialConverter = ConvertToFormat(localFactory.Get(), partial.Get());
+                        std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+                        if (!IsSequenceValid(mySeqId)) return false;
+                        if (!partialConverter) return true;
+
+                        m_ctx.stagedStaticConverter = partialConverter;
+                        m_ctx.stagedRawFileData.clear();
+                        m_ctx.stagedWicStream = nullptr;
+                        m_ctx.stagedWidth = frameWidth;
+                        m_ctx.stagedHeight = frameHeight;
+                        m_ctx.originalContainerFormat = containerFormat;
+                        m_ctx.stagedOrientation = exifOrientation;
+                        m_ctx.stagedIsPartial = true;
+                        m_ctx.isDownscaled = true;
+                        m_ctx.downscaleRatio = std::min(static_cast<float>(partialW) / frameWidth, static_cast<float>(partialH) / frameHeight);
+
+                        PostMessage(m_ctx.hWnd, WM_APP_IMAGE_READY, 1, (LPARAM)mySeqId);
+                        return true;
+                        };
+
+                    if (ComPtr<IWICBitmap> png = DecodePngToDisplay(localFactory.Get(), rawData.data(), rawData.size(), newW, newH,
+                        [&]() { return IsSequenceValid(mySeqId); }, showPartial)) {
+                        sourceToCache = png;
+                        downscaled = shrink;
+                        ratio = pngRatio;
+                        decodedNatively = true;
+                    }
+                    else if (!IsSequenceValid(mySeqId)) {
+                        return;
+                    }
+                }
+
                 // Standard load if no preview 
-                if (!loadedPreview && (frameWidth > maxDim || frameHeight > maxDim)) {
+                if (!loadedPreview && !decodedNatively && (frameWidth > maxDim || frameHeight > maxDim)) {
                     downscaled = true;
                     ratio = std::min(static_cast<float>(maxDim) / frameWidth, static_cast<float>(maxDim) / frameHeight);
                     UINT newW = static_cast<UINT>(frameWidth * ratio);
@@ -628,8 +1501,18 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                     bool nativeScaled = false;
                     ComPtr<IWICBitmapSourceTransform> sourceTransform;
 
+                    // JPEG scales in the DCT domain without depending on the installed codec
+                    if (containerFormat == GUID_ContainerFormatJpeg) {
+                        ResampleOptions options;
+                        options.linearLight = m_ctx.linearLightScaling;
+                        if (ComPtr<IWICBitmap> jpegScaled = DecodeJpegScaled(localFactory.Get(), rawData.data(), rawData.size(), newW, newH, options)) {
+                            sourceToCache = jpegScaled;
+                            nativeScaled = true;
+                        }
+                    }
+
                     // Native codec rapid downscaling 
-                    if (SUCCEEDED(frame.As(&sourceTransform))) {
+                    if (!nativeScaled && SUCCEEDED(frame.As(&sourceTransform))) {
                         UINT actualWidth = newW, actualHeight = newH;
                         if (SUCCEEDED(sourceTransform->GetClosestSize(&actualWidth, &actualHeight))) {
                             // Only proceed if codec smaller than original
@@ -658,7 +1541,21 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                         }
                     }
 
-                    // Fallback to CPU scaler 
+                    // High bit depth frames keep their precision through the downscale
+                    if (!nativeScaled) {
+                        if (ComPtr<IWICBitmap> deepScaled = DownscaleHighBitDepthFrame(localFactory.Get(), frame.Get(), newW, newH)) {
+                            sourceToCache = deepScaled;
+                            nativeScaled = true;
+                        }
+                    }
+
+                    // Fallback to CPU scaler, frame rows are pulled in strips so the full image is never resident
+                    if (!nativeScaled) {
+                        if (ComPtr<IWICBitmap> scaled = ResampleToBitmap(localFactory.Get(), frame.Get(), newW, newH)) {
+                            sourceToCache = scaled;
+                            nativeScaled = true;
+                        }
+                    }
                     if (!nativeScaled) {
                         ComPtr<IWICBitmapScaler> scaler;
                         if (SUCCEEDED(localFactory->CreateBitmapScaler(&scaler))) {
@@ -681,6 +1578,7 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
                     m_ctx.stagedHeight = frameHeight;
                     m_ctx.originalContainerFormat = containerFormat;
                     m_ctx.stagedOrientation = exifOrientation;
+                    m_ctx.stagedIsPartial = false;
                     m_ctx.isDownscaled = downscaled;
                     m_ctx.downscaleRatio = ratio;
 
@@ -742,6 +1640,8 @@ void ViewerApp::LoadImageFromFile(const std::wstring& filePath, bool startAtEnd)
             std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
             m_ctx.stagedDelays = std::move(allFramesDelays);
             m_ctx.stagedFrameMetadata = std::move(allFramesMetadata);
+            m_ctx.stagedGifDecoder.reset();
+            m_ctx.stagedApngDecoder.reset();
             m_ctx.stagedRawFileData = std::move(rawData); // Transfer file memory to context
 
             m_ctx.stagedWidth = canvasWidth;
@@ -829,12 +1729,37 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             return;
         }
 
+        // A zoom reload keeps the sharper image on screen until its final pass
+        if (m_ctx.stagedIsPartial && m_ctx.isDecodeBoostReload) {
+            m_ctx.stagedStaticConverter = nullptr;
+            m_ctx.stagedIsPartial = false;
+            return;
+        }
+        const bool refinesPartial = m_ctx.isPartialImage;
+        m_ctx.isPartialImage = m_ctx.stagedIsPartial;
+        m_ctx.stagedIsPartial = false;
+
         // Clear the old image state before displaying new
         KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
+        m_ctx.animationPrefetcher.Stop();
+        m_ctx.animationPrefetcher.ResetStats();
+        m_ctx.animationScheduler.Stop();
+        m_ctx.animationScheduler.ResetStats();
         m_ctx.d2dBitmap = nullptr;
-        m_ctx.highResImageSource = nullptr;
-        m_ctx.animationD2DBitmaps.clear();
+        m_ctx.deepZoom.reset();
+        m_ctx.tilePyramidPath.clear();
+        m_ctx.tilePyramidKey = 0;
+        m_ctx.mipSource = nullptr;
+        m_ctx.mipPyramid.reset();
+        m_ctx.stagedMipPyramid.reset();
+        m_ctx.mipBitmaps.clear();
+        m_ctx.animationBitmap = nullptr;
+        m_ctx.animationD2DBitmap = nullptr;
+        m_ctx.animationD2DDirty = {};
         m_ctx.animationFrameDelays.clear();
+        m_ctx.animationDecoder = nullptr;
+        m_ctx.gifDecoder.reset();
+        m_ctx.apngDecoder.reset();
         m_ctx.wicConverter = nullptr;
         m_ctx.wicConverterOriginal = nullptr;
         m_ctx.svgDocument = nullptr;
@@ -842,6 +1767,14 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
         m_ctx.isSvg = false;
         m_ctx.isAnimated = false;
         m_ctx.isAnimationPaused = false;
+        m_ctx.isHdr = false;
+        m_ctx.hdrRadiance.clear();
+        m_ctx.hdrBitmap = nullptr;
+        m_ctx.hdrSource = nullptr;
+        m_ctx.hdrRetonePending = false;
+        KillTimer(m_ctx.hWnd, HDR_RETONE_TIMER_ID);
+        const int keptRotation = m_ctx.rotationAngle;
+        const bool keptFlip = m_ctx.isFlippedHorizontal;
         m_ctx.rotationAngle = 0;
         m_ctx.isFlippedHorizontal = false;
 
@@ -850,8 +1783,18 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             m_ctx.wicConverterOriginal = m_ctx.stagedStaticConverter;
             m_ctx.rawFileData = std::move(m_ctx.stagedRawFileData);
             m_ctx.wicStream = m_ctx.stagedWicStream;
+            m_ctx.tilePyramidPath = std::move(m_ctx.stagedTilePyramidPath);
+            m_ctx.tilePyramidKey = m_ctx.stagedTilePyramidKey;
+            m_ctx.stagedTilePyramidPath.clear();
             m_ctx.originalWidth = m_ctx.stagedWidth;
             m_ctx.originalHeight = m_ctx.stagedHeight;
+            if (m_ctx.stagedHdrBitmap) {
+                m_ctx.isHdr = true;
+                m_ctx.hdrRadiance = std::move(m_ctx.stagedHdrRadiance);
+                m_ctx.hdrBitmap = std::move(m_ctx.stagedHdrBitmap);
+                m_ctx.hdrSource = m_ctx.stagedStaticConverter;
+                m_ctx.hdrTone.exposure = m_ctx.stagedHdrExposure;
+            }
             m_ctx.stagedStaticConverter = nullptr;
             m_ctx.stagedWicStream = nullptr;
             m_ctx.isAnimated = false;
@@ -865,6 +1808,8 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             CreateDeviceResources();
         }
         else if (!m_ctx.stagedFrameMetadata.empty()) {
+            m_ctx.gifDecoder = std::move(m_ctx.stagedGifDecoder);
+            m_ctx.apngDecoder = std::move(m_ctx.stagedApngDecoder);
             bool animated = m_ctx.stagedFrameMetadata.size() > 1;
             if (m_ctx.originalContainerFormat == GUID_ContainerFormatTiff ||
                 m_ctx.originalContainerFormat == GUID_ContainerFormatIco) {
@@ -881,16 +1826,25 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             ComPtr<IWICStream> stream;
             if (SUCCEEDED(m_ctx.wicFactory->CreateStream(&stream)) &&
                 SUCCEEDED(stream->InitializeFromMemory(m_ctx.rawFileData.data(), static_cast<DWORD>(m_ctx.rawFileData.size())))) {
-                m_ctx.wicFactory->CreateDecoderFromStream(stream.Get(), NULL, WICDecodeMetadataCacheOnLoad, &m_ctx.animationDecoder);
+                // GIFs and APNGs the loader walked are decoded natively, WIC is only opened for the rest
+                if (!m_ctx.gifDecoder && !m_ctx.apngDecoder) {
+                    m_ctx.wicFactory->CreateDecoderFromStream(stream.Get(), NULL, WICDecodeMetadataCacheOnLoad, &m_ctx.animationDecoder);
+                }
 
                 // Keep  stream alive in the context
                 m_ctx.wicStream = stream;
             }
 
-            m_ctx.lastCompositedFrame = -1;
-            UINT canvasSize = m_ctx.stagedWidth * m_ctx.stagedHeight * 4;
-            m_ctx.animationCanvas.assign(canvasSize, 0);
-            m_ctx.animationCanvasPrev.assign(canvasSize, 0);
+            std::vector<AnimationCompositor::Frame> compositorFrames;
+            compositorFrames.reserve(m_ctx.animationFrameMetadata.size());
+            for (const auto& meta : m_ctx.animationFrameMetadata) {
+                compositorFrames.push_back({ meta.left, meta.top, meta.width, meta.height, meta.disposal });
+            }
+            // Native GIF frames keep their own palette indices, a quarter of a BGRA copy, WIC and
+            // APNG frames are worth keeping composited after the first loop
+            const size_t frameCacheBudget = m_ctx.gifDecoder ? 0 : AnimationCompositor::DefaultFrameCacheBudget;
+            m_ctx.animationCompositor.Reset(m_ctx.stagedWidth, m_ctx.stagedHeight, std::move(compositorFrames),
+                AnimationCompositor::DefaultKeyframeBudget, frameCacheBudget);
             m_ctx.currentAnimatedConverter = nullptr;
 
             m_ctx.currentAnimationFrame = 0;
@@ -898,21 +1852,28 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
                 m_ctx.currentAnimationFrame = static_cast<UINT>(m_ctx.animationFrameMetadata.size() - 1);
             }
 
-            if (m_ctx.animationDecoder) {
+            if (m_ctx.animationDecoder || m_ctx.gifDecoder || m_ctx.apngDecoder) {
                 m_ctx.currentAnimatedConverter = GetCompositedAnimationFrame(m_ctx.currentAnimationFrame);
                 m_ctx.wicConverter = m_ctx.currentAnimatedConverter;
                 m_ctx.wicConverterOriginal = m_ctx.currentAnimatedConverter;
             }
 
             if (animated && !m_ctx.animationFrameDelays.empty()) {
-                SetTimer(m_ctx.hWnd, ANIMATION_TIMER_ID, m_ctx.animationFrameDelays[m_ctx.currentAnimationFrame], nullptr);
+                StartAnimationPlayback();
+            }
+
+            // The rest of the headers are walked once the first frame is painted
+            if (m_ctx.gifDecoder && !m_ctx.gifDecoder->HeaderComplete()) {
+                PostMessage(m_ctx.hWnd, WM_APP_ANIMATION_HEADERS, 0, (LPARAM)seqId);
             }
         }
         m_ctx.startAtEnd = false;
         m_ctx.stagedFrames.clear();
         m_ctx.stagedDelays.clear();
+        m_ctx.stagedGifDecoder.reset();
+        m_ctx.stagedApngDecoder.reset();
         m_ctx.stagedSvgData.clear();
-        m_ctx.isLoading = false;
+        m_ctx.isLoading = m_ctx.isPartialImage;
 
         if (!m_ctx.isSvg) {
             m_ctx.currentOrientation = m_ctx.stagedOrientation;
@@ -928,7 +1889,14 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             }
         }
 
-        if (m_ctx.enableFadeAnimation) {
+        // Same image at a higher resolution, keep the user's orientation and skip the fade
+        if (m_ctx.isDecodeBoostReload || refinesPartial) {
+            m_ctx.isDecodeBoostReload = false;
+            m_ctx.rotationAngle = keptRotation;
+            m_ctx.isFlippedHorizontal = keptFlip;
+            m_ctx.isFading = false;
+        }
+        else if (m_ctx.enableFadeAnimation) {
             m_ctx.isFading = true;
             m_ctx.fadeStartTime = GetTickCount64();
         }
@@ -936,7 +1904,7 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
             m_ctx.isFading = false;
         }
 
-        if (m_ctx.preserveView) {
+        if (m_ctx.preserveView || refinesPartial) {
             m_ctx.preserveView = false;
         }
         else if (m_ctx.defaultZoomMode == DefaultZoomMode::Actual) {
@@ -948,6 +1916,12 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
 
         UpdateWindowTitle();
 
+        // Directory scan and preloading wait for the final pass
+        if (m_ctx.isPartialImage) {
+            InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
+            return;
+        }
+
         WIN32_FILE_ATTRIBUTE_DATA fad = {};
         if (GetFileAttributesExW(m_ctx.loadingFilePath.c_str(), GetFileExInfoStandard, &fad)) {
             m_ctx.lastWriteTime = fad.ftLastWriteTime;
@@ -997,6 +1971,8 @@ void ViewerApp::OnImageReady(bool success, int seqId) {
     }
     else {
         m_ctx.isLoading = false;
+        m_ctx.isDecodeBoostReload = false;
+        m_ctx.isPartialImage = false;
         std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
         m_ctx.wicConverter = nullptr;
         m_ctx.wicConverterOriginal = nullptr;
@@ -1062,114 +2038,335 @@ void ViewerApp::StartPreloading() {
     m_ctx.cancelPreloading = false;
 }
 
-ComPtr<IWICBitmapSource> ViewerApp::GetCompositedAnimationFrame(UINT targetIndex) {
-    if (!m_ctx.animationDecoder || targetIndex >= m_ctx.animationFrameMetadata.size()) return nullptr;
-
-    UINT canvasWidth = m_ctx.originalWidth;
-    UINT canvasHeight = m_ctx.originalHeight;
-    UINT canvasStride = canvasWidth * 4;
-
-    // GIF rendering sequence
-    UINT startIndex = m_ctx.lastCompositedFrame + 1;
-    if (m_ctx.lastCompositedFrame == -1 || targetIndex < startIndex) {
-        std::fill(m_ctx.animationCanvas.begin(), m_ctx.animationCanvas.end(), 0);
-        std::fill(m_ctx.animationCanvasPrev.begin(), m_ctx.animationCanvasPrev.end(), 0);
-        startIndex = 0;
-    }
-
-    for (UINT i = startIndex; i <= targetIndex; ++i) {
-
-        // Apply disposal of previosu frame first
-        if (i > 0) {
-            const auto& prevMeta = m_ctx.animationFrameMetadata[i - 1];
-            if (prevMeta.disposal == 2) {
-                for (UINT y = 0; y < prevMeta.height; ++y) {
-                    if (prevMeta.top + y >= canvasHeight) break;
-                    BYTE* destRow = m_ctx.animationCanvas.data() + (prevMeta.top + y) * canvasStride + (prevMeta.left * 4);
-                    for (UINT x = 0; x < prevMeta.width; ++x) {
-                        if (prevMeta.left + x >= canvasWidth) break;
-                        UINT dp = x * 4;
-                        destRow[dp] = 0; destRow[dp + 1] = 0; destRow[dp + 2] = 0;
-                        destRow[dp + 3] = 0;
-                    }
-                }
-            }
-            else if (prevMeta.disposal == 3) {
-                m_ctx.animationCanvas = m_ctx.animationCanvasPrev;
+// Draws one frame onto the canvas, the compositor has already applied the previous frame's
+// disposal. Everything it touches is captured, so the prefetch worker can run it as well.
+AnimationCompositor::DrawFrame ViewerApp::MakeAnimationFrameDrawer() {
+    const AnimationCompositor* compositor = &m_ctx.animationCompositor;
+    GifDecoder* gifDecoder = m_ctx.gifDecoder.get();
+    PngDecoder* apngDecoder = m_ctx.apngDecoder.get();
+    ComPtr<IWICBitmapDecoder> decoder = m_ctx.animationDecoder;
+    ComPtr<IWICImagingFactory> factory = m_ctx.wicFactory;
+
+    return [=, this](size_t i, uint8_t* canvas, size_t canvasStride) {
+        const UINT canvasWidth = compositor->Width();
+        const UINT canvasHeight = compositor->Height();
+        if (gifDecoder) {
+            // Indices stay cached between loops and only expand to BGRA here, palette entries are
+            // opaque or zero so source-over is a lookup and a skip
+            const GifDecoder::Frame& gifFrame = gifDecoder->GetFrame(i);
+            const BYTE* indices = gifDecoder->FrameIndices(i);
+            if (indices && gifFrame.left < canvasWidth && gifFrame.top < canvasHeight) {
+                uint32_t palette[256];
+                gifDecoder->GetBgraPalette(i, palette);
+                BlendRectPalette(canvas + static_cast<size_t>(gifFrame.top) * canvasStride + static_cast<size_t>(gifFrame.left) * 4, canvasStride, indices, gifFrame.width, palette,
+                    std::min(gifFrame.width, canvasWidth - gifFrame.left), std::min(gifFrame.height, canvasHeight - gifFrame.top));
             }
+            return;
         }
-
-        const auto& meta = m_ctx.animationFrameMetadata[i];
-
-        // Save previous state for disposal method before compositing
-        if (meta.disposal == 3) {
-            m_ctx.animationCanvasPrev = m_ctx.animationCanvas;
+        if (apngDecoder) {
+            apngDecoder->DrawAnimationFrame(i, canvas, canvasStride);
+            return;
         }
 
-        // Decode and composite the current frame
+        // The prefetch worker has no apartment of its own, it joins the MTA for the WIC calls
+        const HRESULT comInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        const AnimationCompositor::Frame& meta = compositor->GetFrame(i);
         ComPtr<IWICBitmapFrameDecode> frame;
-        if (SUCCEEDED(m_ctx.animationDecoder->GetFrame(i, &frame))) {
-            if (ComPtr<IWICFormatConverter> converter = ConvertToFormat(m_ctx.wicFactory.Get(), frame.Get())) {
+        if (SUCCEEDED(decoder->GetFrame(static_cast<UINT>(i), &frame))) {
+            if (ComPtr<IWICFormatConverter> converter = ConvertToFormat(factory.Get(), frame.Get())) {
                 UINT frameStride = meta.width * 4;
                 UINT frameSize = frameStride * meta.height;
                 std::vector<BYTE> framePixels(frameSize);
 
-                if (SUCCEEDED(converter->CopyPixels(nullptr, frameStride, frameSize, framePixels.data()))) {
-                    for (UINT y = 0; y < meta.height; ++y) {
-                        if (meta.top + y >= canvasHeight) break;
-                        BYTE* destRow = m_ctx.animationCanvas.data() + (meta.top + y) * canvasStride + (meta.left * 4);
-                        BYTE* srcRow = framePixels.data() + y * frameStride;
-
-                        for (UINT x = 0; x < meta.width; ++x) {
-                            if (meta.left + x >= canvasWidth) break;
-                            UINT dp = x * 4, sp = x * 4;
-                            BYTE alpha = srcRow[sp + 3];
-
-                            // PBGRA SrcOver Blending
-                            if (alpha == 255) {
-                                destRow[dp] = srcRow[sp];
-                                destRow[dp + 1] = srcRow[sp + 1];
-                                destRow[dp + 2] = srcRow[sp + 2];
-                                destRow[dp + 3] = 255;
-                            }
-                            else if (alpha > 0) {
-                                BYTE inv = 255 - alpha;
-                                destRow[dp] = srcRow[sp] + (destRow[dp] * inv) / 255;
-                                destRow[dp + 1] = srcRow[sp + 1] + (destRow[dp + 1] * inv) / 255;
-                                destRow[dp + 2] = srcRow[sp + 2] + (destRow[dp + 2] * inv) / 255;
-                                destRow[dp + 3] = alpha + (destRow[dp + 3] * inv) / 255;
-                            }
-                        }
-                    }
+                if (SUCCEEDED(converter->CopyPixels(nullptr, frameStride, frameSize, framePixels.data())) && meta.left < canvasWidth && meta.top < canvasHeight) {
+                    BlendRect(canvas + static_cast<size_t>(meta.top) * canvasStride + static_cast<size_t>(meta.left) * 4, canvasStride, framePixels.data(), frameStride,
+                        std::min(meta.width, canvasWidth - meta.left), std::min(meta.height, canvasHeight - meta.top));
                 }
             }
         }
-    }
-
-    m_ctx.lastCompositedFrame = targetIndex;
+        if (SUCCEEDED(comInit)) CoUninitialize();
+        };
+}
 
-    // Bitmap with deep copy of the memory
-    ComPtr<IWICBitmap> finalBmp;
-    if (SUCCEEDED(m_ctx.wicFactory->CreateBitmap(canvasWidth, canvasHeight, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &finalBmp))) {
-        WICRect rc = { 0, 0, static_cast<INT>(canvasWidth), static_cast<INT>(canvasHeight) };
+// Copies the rect a frame changed into the bitmap handed out, which stays the same for the whole animation
+bool ViewerApp::UpdateAnimationBitmap(const BYTE* pixels, AnimationCompositor::Rect dirty) {
+    const UINT canvasWidth = m_ctx.animationCompositor.Width();
+    const UINT canvasHeight = m_ctx.animationCompositor.Height();
+    const size_t canvasStride = m_ctx.animationCompositor.Stride();
+    if (!m_ctx.animationBitmap) {
+        if (FAILED(m_ctx.wicFactory->CreateBitmap(canvasWidth, canvasHeight, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &m_ctx.animationBitmap))) return false;
+        dirty = { 0, 0, canvasWidth, canvasHeight };
+    }
+    if (!dirty.Empty()) {
+        WICRect rc = { static_cast<INT>(dirty.left), static_cast<INT>(dirty.top), static_cast<INT>(dirty.width), static_cast<INT>(dirty.height) };
         ComPtr<IWICBitmapLock> lock;
-        if (SUCCEEDED(finalBmp->Lock(&rc, WICBitmapLockWrite, &lock))) {
+        if (SUCCEEDED(m_ctx.animationBitmap->Lock(&rc, WICBitmapLockWrite, &lock))) {
             UINT cbStride = 0, cbBufferSize = 0;
             BYTE* pbBuffer = nullptr;
             lock->GetStride(&cbStride);
             lock->GetDataPointer(&cbBufferSize, &pbBuffer);
 
             if (pbBuffer) {
-                // Copy row by row to respect WIC 
-                for (UINT y = 0; y < canvasHeight; ++y) {
-                    memcpy(pbBuffer + y * cbStride, m_ctx.animationCanvas.data() + y * canvasStride, canvasStride);
+                // The lock points at the rect's first pixel, rows follow at the bitmap's stride
+                const BYTE* src = pixels + static_cast<size_t>(dirty.top) * canvasStride + static_cast<size_t>(dirty.left) * 4;
+                CopyRect(pbBuffer, cbStride, src, canvasStride, dirty.width, dirty.height);
+            }
+        }
+        m_ctx.animationD2DDirty.Include(dirty);
+    }
+    return true;
+}
+
+ComPtr<IWICBitmapSource> ViewerApp::GetCompositedAnimationFrame(UINT targetIndex) {
+    if ((!m_ctx.animationDecoder && !m_ctx.gifDecoder && !m_ctx.apngDecoder) || targetIndex >= m_ctx.animationFrameMetadata.size()) return nullptr;
+    if (m_ctx.animationCompositor.Width() == 0 || m_ctx.animationCompositor.Height() == 0) return nullptr;
+
+    // Stepping takes the compositor back from playback, its dirty rect then also covers the
+    // frames the worker had got ahead by
+    m_ctx.animationPrefetcher.Stop();
+
+    // Resumes from the frame on the canvas, or the nearest keyframe when going back
+    if (!m_ctx.animationCompositor.Seek(targetIndex, MakeAnimationFrameDrawer())) return nullptr;
+    if (!UpdateAnimationBitmap(m_ctx.animationCompositor.Canvas(), m_ctx.animationCompositor.TakeDirtyRect())) return nullptr;
+    return m_ctx.animationBitmap;
+}
+
+void ViewerApp::StartAnimationPrefetch() {
+    if (m_ctx.animationPrefetcher.IsRunning() || (!m_ctx.animationDecoder && !m_ctx.gifDecoder && !m_ctx.apngDecoder)) return;
+
+    // As many slots as fit the budget, at least two so one fills while the other waits
+    const size_t canvasBytes = std::max<size_t>(m_ctx.animationCompositor.Stride() * m_ctx.animationCompositor.Height(), 1);
+    const uint32_t slots = static_cast<uint32_t>(std::clamp<size_t>(AnimationPrefetchBudget / canvasBytes, 2, 6));
+    m_ctx.animationPrefetcher.Start(m_ctx.animationCompositor, MakeAnimationFrameDrawer(), slots);
+}
+
+// The frame on screen starts the timeline, from now on frames go up when it says they are due
+void ViewerApp::StartAnimationPlayback() {
+    m_ctx.animationScheduler.Start(m_ctx.currentAnimationFrame, PlaybackClockUs(), m_ctx.animationFrameDelays);
+    ScheduleAnimationTick();
+    StartAnimationPrefetch();
+}
+
+// Timer tick, true when the timeline moved on and the scheduler's Frame() is now due. The frame on
+// screen only changes once PresentAnimationFrame has shown one.
+bool ViewerApp::AdvanceAnimationSchedule() {
+    return m_ctx.animationScheduler.Advance(PlaybackClockUs(), m_ctx.animationFrameDelays);
+}
+
+// Arms the timer for the next deadline, measured after the tick's own work so that is not added on.
+// Windows fires no sooner than 10 ms, shorter frames are skipped to keep time rather than slowed.
+void ViewerApp::ScheduleAnimationTick() {
+    if (!m_ctx.animationScheduler.IsRunning()) return;
+    const int64_t wait = m_ctx.animationScheduler.UntilNextUs(PlaybackClockUs());
+    SetTimer(m_ctx.hWnd, ANIMATION_TIMER_ID, static_cast<UINT>(std::max<int64_t>((wait + 999) / 1000, 1)), nullptr);
+}
+
+static bool ReadWholeFile(const std::wstring& path, FastByteBuffer& data) {
+    wil::unique_hfile hFile(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (!hFile) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile.get(), &size) || size.HighPart != 0 || size.LowPart == 0) return false;
+    data.allocate(size.LowPart);
+
+    DWORD bytesRead = 0;
+    return ReadFile(hFile.get(), data.data(), size.LowPart, &bytesRead, NULL) && bytesRead == size.LowPart;
+}
+
+// One frame of an image sequence at the size the still is shown at. PNG and JPEG go through the
+// native decoders, which scale while decoding, anything else through WIC.
+static bool DecodeSequenceFrame(IWICImagingFactory* factory, const std::wstring& path, UINT width, UINT height,
+    const ResampleOptions& options, SequenceFrame& out)
+{
+    FastByteBuffer data;
+    if (!ReadWholeFile(path, data)) return false;
+
+    const uint8_t* bytes = data.data();
+    ComPtr<IWICBitmapSource> source;
+    if (data.size() >= 8 && bytes[0] == 0x89 && bytes[1] == 'P' && bytes[2] == 'N' && bytes[3] == 'G') {
+        source = DecodePngToDisplay(factory, bytes, data.size(), width, height, []() { return true; }, nullptr);
+    }
+    else if (data.size() >= 3 && bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF) {
+        source = DecodeJpegScaled(factory, bytes, data.size(), width, height, options);
+    }
+
+    if (!source) {
+        ComPtr<IWICStream> stream;
+        ComPtr<IWICBitmapDecoder> decoder;
+        ComPtr<IWICBitmapFrameDecode> frame;
+        UINT frameWidth = 0, frameHeight = 0;
+        if (FAILED(factory->CreateStream(&stream)) || FAILED(stream->InitializeFromMemory(data.data(), static_cast<DWORD>(data.size()))) ||
+            FAILED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+            FAILED(decoder->GetFrame(0, &frame)) || FAILED(frame->GetSize(&frameWidth, &frameHeight))) {
+            return false;
+        }
+        source = frame;
+        if (frameWidth != width || frameHeight != height) {
+            ComPtr<IWICBitmapScaler> scaler;
+            if (FAILED(factory->CreateBitmapScaler(&scaler)) || FAILED(scaler->Initialize(frame.Get(), width, height, WICBitmapInterpolationModeFant))) return false;
+            source = scaler;
+        }
+    }
+
+    WICPixelFormatGUID format = {};
+    if (FAILED(source->GetPixelFormat(&format))) return false;
+    if (format != GUID_WICPixelFormat32bppPBGRA) {
+        ComPtr<IWICFormatConverter> converter;
+        if (FAILED(factory->CreateFormatConverter(&converter)) ||
+            FAILED(converter->Initialize(source.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone, nullptr, 0.f, WICBitmapPaletteTypeCustom))) {
+            return false;
+        }
+        source = converter;
+    }
+
+    const UINT stride = width * 4;
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(stride) * height);
+    return SUCCEEDED(source->CopyPixels(nullptr, stride, static_cast<UINT>(out.pixels.size()), out.pixels.data()));
+}
+
+// Plays the numbered run the current file belongs to, starting from it. Frames decode at the size
+// the still is shown at, so zoom, pan and rotation carry over. Toggling again loads the frame on
+// screen as an ordinary image.
+void ViewerApp::ToggleSequencePlayback() {
+    if (m_ctx.sequencePlayer.IsRunning()) {
+        {
+            // The last frame stays up while its file loads
+            std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+            if (const SequenceFrame* frame = m_ctx.sequenceFrame) {
+                ComPtr<IWICBitmap> still;
+                if (SUCCEEDED(m_ctx.wicFactory->CreateBitmapFromMemory(frame->width, frame->height, GUID_WICPixelFormat32bppPBGRA,
+                    frame->width * 4, static_cast<UINT>(frame->pixels.size()), const_cast<BYTE*>(frame->pixels.data()), &still))) {
+                    m_ctx.wicConverterOriginal = still;
+                    m_ctx.wicConverter = still;
+                    m_ctx.d2dBitmap = nullptr;
                 }
             }
         }
+        StopSequencePlayback();
+        if (m_ctx.currentImageIndex >= 0 && m_ctx.currentImageIndex < static_cast<int>(m_ctx.imageFiles.size())) {
+            m_ctx.preserveView = true;
+            LoadImageFromFile(m_ctx.imageFiles[m_ctx.currentImageIndex]);
+        }
+        return;
+    }
+
+    if (m_ctx.isLoading || m_ctx.isAnimated || m_ctx.isSvg || m_ctx.isHdr) return;
+    if (m_ctx.currentImageIndex < 0 || m_ctx.currentImageIndex >= static_cast<int>(m_ctx.imageFiles.size())) return;
+    const FrameSequenceRange range = FindFrameSequence(m_ctx.imageFiles, m_ctx.currentImageIndex);
+    if (range.count < 2) return;
+
+    UINT width = 0, height = 0;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
+        if (!m_ctx.wicConverter || FAILED(m_ctx.wicConverter->GetSize(&width, &height)) || width == 0 || height == 0) return;
+    }
+
+    if (m_ctx.isSlideshowActive) {
+        m_ctx.isSlideshowActive = false;
+        KillTimer(m_ctx.hWnd, SLIDESHOW_TIMER_ID);
+    }
+
+    std::vector<std::wstring> files(m_ctx.imageFiles.begin() + range.first, m_ctx.imageFiles.begin() + range.first + range.count);
+    ResampleOptions options;
+    options.linearLight = m_ctx.linearLightScaling;
+    auto decode = [files = std::move(files), factory = m_ctx.wicFactory, width, height, options](size_t frame, SequenceFrame& out) {
+        // Player workers have no apartment of their own, each decode joins the MTA for the WIC calls
+        const HRESULT comInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        const bool decoded = DecodeSequenceFrame(factory.Get(), files[frame], width, height, options, out);
+        if (SUCCEEDED(comInit)) CoUninitialize();
+        return decoded;
+        };
+
+    // As many frames queue as fit the budget. The PNG and JPEG decoders spread each frame over the
+    // pool as well, so half the cores are enough to decode frames side by side.
+    const size_t frameBytes = static_cast<size_t>(width) * height * 4;
+    const uint32_t slots = static_cast<uint32_t>(std::clamp<size_t>(SequencePrefetchBudget / frameBytes, 4, 96));
+    const uint32_t threads = std::clamp<uint32_t>(ParallelThreadCount() / 2, 2, 8);
+
+    m_ctx.sequenceFirst = range.first;
+    m_ctx.sequenceCount = range.count;
+    m_ctx.sequencePlayer.Start(range.count, static_cast<size_t>(m_ctx.currentImageIndex) - range.first, m_ctx.sequenceFps, PlaybackClockUs, std::move(decode), slots, threads);
+    m_ctx.isOsdCacheValid = false;
+    OnSequenceTick();
+}
+
+void ViewerApp::StopSequencePlayback() {
+    if (!m_ctx.sequencePlayer.IsRunning()) return;
+    KillTimer(m_ctx.hWnd, SEQUENCE_TIMER_ID);
+    m_ctx.sequencePlayer.Stop();
+    m_ctx.sequenceFrame = nullptr;
+    m_ctx.sequenceD2DBitmap = nullptr;
+    m_ctx.isOsdCacheValid = false;
+}
+
+// Timer tick, puts up the frame due now if one is ready and arms the timer for the next deadline.
+// Windows fires no sooner than 10 ms, so rates above 100 fps drop frames to keep time.
+void ViewerApp::OnSequenceTick() {
+    if (!m_ctx.sequencePlayer.IsRunning()) return;
+
+    SequencePlayer::Presented presented;
+    if (m_ctx.sequencePlayer.Present(presented)) {
+        m_ctx.sequenceFrame = presented.frame;
+        m_ctx.sequenceD2DStale = true;
+
+        const size_t index = m_ctx.sequenceFirst + presented.index;
+        if (index < m_ctx.imageFiles.size()) {
+            m_ctx.currentImageIndex = static_cast<int>(index);
+            m_ctx.loadingFilePath = m_ctx.imageFiles[index];
+        }
+        if (m_ctx.isOsdVisible) m_ctx.isOsdCacheValid = false;
+
+        UpdateWindowTitle();
+        InvalidateRect(m_ctx.hWnd, nullptr, FALSE);
+    }
 
-        // Return the WIC bitmap directly 
-        return finalBmp;
+    const int64_t wait = m_ctx.sequencePlayer.UntilNextUs();
+    SetTimer(m_ctx.hWnd, SEQUENCE_TIMER_ID, static_cast<UINT>(std::max<int64_t>((wait + 999) / 1000, 1)), nullptr);
+}
+
+// Walks the next batch of GIF frame headers after the first frame went up, playback then sees
+// the frame count, delays and title grow until the walk reaches the trailer
+void ViewerApp::ContinueAnimationHeaders(int seqId) {
+    if (m_ctx.loadSequenceId != seqId || !m_ctx.isAnimated || !m_ctx.gifDecoder || m_ctx.gifDecoder->HeaderComplete()) return;
+
+    // Posted messages come ahead of WM_PAINT, so the frame on screen is painted first
+    UpdateWindow(m_ctx.hWnd);
+
+    // The worker reads the frame lists, it restarts on the next tick
+    m_ctx.animationPrefetcher.Stop();
+
+    GifDecoder& gif = *m_ctx.gifDecoder;
+    const size_t first = gif.FrameCount();
+    gif.ReadFrames(AnimationHeaderBatch);
+    std::vector<AnimationCompositor::Frame> compositorFrames;
+    compositorFrames.reserve(gif.FrameCount() - first);
+    for (size_t i = first; i < gif.FrameCount(); ++i) {
+        const AppContext::AnimationFrameMetadata meta = GifFrameMetadata(gif.GetFrame(i));
+        m_ctx.animationFrameMetadata.push_back(meta);
+        m_ctx.animationFrameDelays.push_back(meta.delay);
+        compositorFrames.push_back({ meta.left, meta.top, meta.width, meta.height, meta.disposal });
+    }
+    m_ctx.animationCompositor.AppendFrames(compositorFrames);
+
+    if (!gif.HeaderComplete()) {
+        PostMessage(m_ctx.hWnd, WM_APP_ANIMATION_HEADERS, 0, (LPARAM)seqId);
     }
+    m_ctx.isOsdCacheValid = false;
+    UpdateWindowTitle();
+}
 
-    return nullptr;
+// Playback tick, shows a frame the worker has finished and never composites on this thread.
+// That can be an older frame than the target, currentAnimationFrame follows what actually went up.
+// False when the frame on screen stays because nothing newer is ready.
+bool ViewerApp::PresentAnimationFrame(UINT targetIndex) {
+    if (targetIndex >= m_ctx.animationFrameMetadata.size()) return false;
+    StartAnimationPrefetch();
+
+    FramePrefetcher::Presented presented;
+    if (!m_ctx.animationPrefetcher.Present(targetIndex, presented)) return false;
+    if (!UpdateAnimationBitmap(presented.pixels, presented.dirty)) return false;
+    m_ctx.currentAnimationFrame = static_cast<UINT>(presented.frame);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,546 @@
+#include "inflate.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    constexpr size_t WindowSize = 32 * 1024;
+    constexpr size_t BufferSize = 512 * 1024;
+    constexpr uint32_t MaxMatch = 258;
+
+    // Match copies and literal pairs may write this far past the bytes they produce
+    constexpr uint32_t CopySlack = 16;
+
+    constexpr uint16_t LengthBase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    constexpr uint8_t LengthExtra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    constexpr uint16_t DistanceBase[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+    };
+    constexpr uint8_t DistanceExtra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    // Order the code length code lengths are stored in
+    constexpr uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    enum EntryKind : uint32_t { KindLiteral, KindMatch, KindEnd, KindSubtable, KindInvalid };
+
+    constexpr uint32_t MakeEntry(EntryKind kind, uint32_t length, uint32_t extra, uint32_t value) {
+        return length | (kind << 5) | (extra << 8) | (value << 16);
+    }
+
+    inline uint32_t EntryLength(uint32_t entry) { return entry & 31; }
+    inline uint32_t EntryKindOf(uint32_t entry) { return (entry >> 5) & 7; }
+    inline uint32_t EntryExtra(uint32_t entry) { return (entry >> 8) & 15; }
+    inline uint32_t EntryValue(uint32_t entry) { return entry >> 16; }
+
+    inline void Copy8(uint8_t* dst, const uint8_t* src) {
+        uint64_t word;
+        std::memcpy(&word, src, 8);
+        std::memcpy(dst, &word, 8);
+    }
+
+    // Whole words regardless of the length, the output buffer has CopySlack bytes to spare
+    inline void CopyMatch(uint8_t* dst, size_t distance, uint32_t length) {
+        const uint8_t* src = dst - distance;
+        uint8_t* const end = dst + length;
+        if (distance >= 8) {
+            // Each word reads only bytes already written, two of them cover most matches
+            Copy8(dst, src);
+            Copy8(dst + 8, src + 8);
+            dst += 16;
+            src += 16;
+            while (dst < end) {
+                Copy8(dst, src);
+                dst += 8;
+                src += 8;
+            }
+        }
+        else if (distance == 1) {
+            const uint64_t run = src[0] * 0x0101010101010101ull;
+            do {
+                std::memcpy(dst, &run, 8);
+                dst += 8;
+            } while (dst < end);
+        }
+        else {
+            // Short periods step by the distance, so every word starts on bytes already written
+            do {
+                Copy8(dst, src);
+                dst += distance;
+                src += distance;
+            } while (dst < end);
+        }
+    }
+
+    uint32_t ReverseBits(uint32_t value, uint32_t count) {
+        uint32_t out = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            out = (out << 1) | (value & 1);
+            value >>= 1;
+        }
+        return out;
+    }
+}
+
+Inflater::Inflater(Format format) : m_state(format == Format::Raw ? State::BlockHeader : State::Header), m_window(BufferSize) {}
+
+void Inflater::AddInput(const uint8_t* data, size_t size) {
+    if (data && size > 0) m_input.push_back({ data, size });
+}
+
+bool Inflater::BuildTable(uint32_t* table, uint32_t tableSize, uint32_t rootBits, const uint8_t* lengths, uint32_t count, Alphabet alphabet) {
+    uint32_t counts[16] = {};
+    for (uint32_t i = 0; i < count; ++i) ++counts[lengths[i]];
+    counts[0] = 0;
+
+    // Incomplete codes are allowed, their unused entries decode as invalid
+    int32_t left = 1;
+    uint32_t nextCode[16] = {};
+    uint32_t code = 0;
+    for (uint32_t len = 1; len < 16; ++len) {
+        left = left * 2 - static_cast<int32_t>(counts[len]);
+        if (left < 0) return false;   // Over-subscribed
+        nextCode[len] = code;
+        code = (code + counts[len]) << 1;
+    }
+
+    // Input is LSB first, so tables are indexed by the codes reversed. Codes longer than the root
+    // bits share one subtable per root prefix, sized for the longest of them.
+    const uint32_t rootSize = 1u << rootBits;
+    uint32_t codes[288] = {};
+    uint8_t deepest[1 << LiteralRootBits] = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t len = lengths[i];
+        if (len == 0) continue;
+        codes[i] = ReverseBits(nextCode[len]++, len);
+        if (len > rootBits) {
+            uint8_t& depth = deepest[codes[i] & (rootSize - 1)];
+            depth = std::max(depth, static_cast<uint8_t>(len));
+        }
+    }
+
+    const uint32_t invalid = MakeEntry(KindInvalid, 0, 0, 0);
+    std::fill(table, table + rootSize, invalid);
+    uint32_t next = rootSize;
+    for (uint32_t prefix = 0; prefix < rootSize; ++prefix) {
+        if (deepest[prefix] == 0) continue;
+        const uint32_t subBits = deepest[prefix] - rootBits;
+        if (next + (1u << subBits) > tableSize) return false;
+        table[prefix] = MakeEntry(KindSubtable, 0, subBits, next);
+        std::fill(table + next, table + next + (1u << subBits), invalid);
+        next += 1u << subBits;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t len = lengths[i];
+        if (len == 0) continue;
+
+        uint32_t entry = invalid;
+        if (alphabet == Alphabet::CodeLengths || (alphabet == Alphabet::Literals && i < 256)) {
+            entry = MakeEntry(KindLiteral, len, 1, i);
+        }
+        else if (alphabet == Alphabet::Literals && i == 256) {
+            entry = MakeEntry(KindEnd, len, 0, 0);
+        }
+        else if (alphabet == Alphabet::Literals && i - 257 < 29) {
+            entry = MakeEntry(KindMatch, len, LengthExtra[i - 257], LengthBase[i - 257]);
+        }
+        else if (alphabet == Alphabet::Distances && i < 30) {
+            entry = MakeEntry(KindMatch, len, DistanceExtra[i], DistanceBase[i]);
+        }
+        else {
+            entry = MakeEntry(KindInvalid, len, 0, 0);
+        }
+
+        if (len <= rootBits) {
+            for (uint32_t j = codes[i]; j < rootSize; j += 1u << len) table[j] = entry;
+            continue;
+        }
+        const uint32_t link = table[codes[i] & (rootSize - 1)];
+        uint32_t* sub = table + EntryValue(link);
+        for (uint32_t j = codes[i] >> rootBits; j < (1u << EntryExtra(link)); j += 1u << (len - rootBits)) sub[j] = entry;
+    }
+
+    // Two short literal codes in a row resolve in one lookup. Walking down keeps the entry for
+    // the second code, at a lower index, a single literal.
+    if (alphabet == Alphabet::Literals) {
+        for (uint32_t i = rootSize; i-- > 0;) {
+            const uint32_t first = table[i];
+            if (EntryKindOf(first) != KindLiteral) continue;
+            const uint32_t used = EntryLength(first);
+            const uint32_t second = table[i >> used];
+            if (EntryKindOf(second) != KindLiteral || EntryLength(second) > rootBits - used) continue;
+            table[i] = MakeEntry(KindLiteral, used + EntryLength(second), 2, EntryValue(first) | (EntryValue(second) << 8));
+        }
+    }
+    return true;
+}
+
+const Inflater::LiteralTable& Inflater::FixedLiterals() {
+    static const LiteralTable table = [] {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, uint8_t{ 8 });
+        std::fill(lengths + 144, lengths + 256, uint8_t{ 9 });
+        std::fill(lengths + 256, lengths + 280, uint8_t{ 7 });
+        std::fill(lengths + 280, lengths + 288, uint8_t{ 8 });
+        LiteralTable built;
+        BuildTable(built.entries, LiteralTableSize, LiteralRootBits, lengths, 288, Alphabet::Literals);
+        return built;
+        }();
+    return table;
+}
+
+const Inflater::DistanceTable& Inflater::FixedDistances() {
+    static const DistanceTable table = [] {
+        uint8_t lengths[32];
+        std::fill(lengths, lengths + 32, uint8_t{ 5 });
+        DistanceTable built;
+        BuildTable(built.entries, DistanceTableSize, DistanceRootBits, lengths, 32, Alphabet::Distances);
+        return built;
+        }();
+    return table;
+}
+
+void Inflater::Refill() {
+    // Whole words while the current span has them, otherwise byte by byte across spans
+    if (m_span < m_input.size() && m_input[m_span].size - m_pos >= 8) {
+        uint64_t word;
+        std::memcpy(&word, m_input[m_span].data + m_pos, 8);
+        m_bits |= word << m_count;
+        m_pos += (63 - m_count) >> 3;
+        m_count |= 56;
+        return;
+    }
+    while (m_count <= 56) {
+        uint64_t byte = 0;
+        while (m_span < m_input.size() && m_pos == m_input[m_span].size) {
+            ++m_span;
+            m_pos = 0;
+        }
+        if (m_span < m_input.size()) {
+            byte = m_input[m_span].data[m_pos++];
+        }
+        else {
+            ++m_padding;
+        }
+        m_bits |= byte << m_count;
+        m_count += 8;
+    }
+}
+
+uint32_t Inflater::GetBits(uint32_t n) {
+    if (m_count < n) Refill();
+    const uint32_t value = PeekBits(n);
+    m_bits >>= n;
+    m_count -= n;
+    return value;
+}
+
+uint32_t Inflater::DecodeEntry(const uint32_t* table, uint32_t rootBits) {
+    if (m_count < 16) Refill();
+    uint32_t entry = table[PeekBits(rootBits)];
+    if (EntryKindOf(entry) == KindSubtable) {
+        entry = table[EntryValue(entry) + ((m_bits >> rootBits) & ((1u << EntryExtra(entry)) - 1))];
+    }
+    m_bits >>= EntryLength(entry);
+    m_count -= EntryLength(entry);
+    return entry;
+}
+
+bool Inflater::ReadDynamicTables() {
+    const uint32_t literalCount = GetBits(5) + 257;
+    const uint32_t distanceCount = GetBits(5) + 1;
+    const uint32_t codeLengthCount = GetBits(4) + 4;
+    if (literalCount > 286 || distanceCount > 30) return false;
+
+    uint8_t codeLengthLengths[19] = {};
+    for (uint32_t i = 0; i < codeLengthCount; ++i) codeLengthLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(GetBits(3));
+    uint32_t codeLengths[CodeLengthTableSize];
+    if (!BuildTable(codeLengths, CodeLengthTableSize, CodeLengthRootBits, codeLengthLengths, 19, Alphabet::CodeLengths)) return false;
+
+    // Literal and distance lengths form one sequence, repeats may run across the boundary
+    uint8_t lengths[286 + 30] = {};
+    const uint32_t total = literalCount + distanceCount;
+    for (uint32_t n = 0; n < total;) {
+        const uint32_t entry = DecodeEntry(codeLengths, CodeLengthRootBits);
+        if (EntryKindOf(entry) != KindLiteral) return false;
+        const uint32_t symbol = EntryValue(entry);
+        if (symbol < 16) {
+            lengths[n++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t fill = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16) {
+            if (n == 0) return false;
+            fill = lengths[n - 1];
+            repeat = 3 + GetBits(2);
+        }
+        else if (symbol == 17) {
+            repeat = 3 + GetBits(3);
+        }
+        else {
+            repeat = 11 + GetBits(7);
+        }
+        if (n + repeat > total) return false;
+        std::fill(lengths + n, lengths + n + repeat, fill);
+        n += repeat;
+    }
+    if (lengths[256] == 0) return false;   // No end of block code
+
+    return BuildTable(m_dynamicLiterals.entries, LiteralTableSize, LiteralRootBits, lengths, literalCount, Alphabet::Literals) &&
+        BuildTable(m_dynamicDistances.entries, DistanceTableSize, DistanceRootBits, lengths + literalCount, distanceCount, Alphabet::Distances);
+}
+
+size_t Inflater::Read(uint8_t* dst, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        if (m_readPos < m_out) {
+            const size_t n = std::min(size - written, m_out - m_readPos);
+            std::memcpy(dst + written, m_window.data() + m_readPos, n);
+            m_readPos += n;
+            written += n;
+            continue;
+        }
+        if (m_state == State::Done || m_state == State::Failed) break;
+        Advance();
+    }
+    return written;
+}
+
+bool Inflater::Inflate(const OutputSink& sink) {
+    for (;;) {
+        if (m_readPos < m_out) {
+            if (!sink(m_window.data() + m_readPos, m_out - m_readPos)) return false;
+            m_readPos = m_out;
+        }
+        if (m_state == State::Done) return true;
+        if (m_state == State::Failed) return false;
+        Advance();
+    }
+}
+
+void Inflater::Advance() {
+    // Everything has been read, so only the history has to survive the slide
+    if (m_out + MaxMatch + CopySlack > m_window.size()) {
+        std::memmove(m_window.data(), m_window.data() + m_out - WindowSize, WindowSize);
+        m_out = WindowSize;
+        m_readPos = WindowSize;
+    }
+    Step();
+    if (Truncated() && m_state != State::Done) m_state = State::Failed;
+}
+
+void Inflater::Step() {
+    switch (m_state) {
+    case State::Header: {
+        const uint32_t cmf = GetBits(8);
+        const uint32_t flags = GetBits(8);
+        const bool valid = (cmf & 15) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flags) % 31 == 0 && !(flags & 32);
+        m_state = valid ? State::BlockHeader : State::Failed;
+        break;
+    }
+    case State::BlockHeader: {
+        if (m_lastBlock) {
+            m_state = State::Done;
+            break;
+        }
+        m_lastBlock = GetBits(1) != 0;
+        const uint32_t type = GetBits(2);
+        if (type == 0) {
+            // Stored: byte aligned length and its complement
+            GetBits(m_count & 7);
+            const uint32_t length = GetBits(16);
+            const uint32_t check = GetBits(16);
+            if ((length ^ 0xFFFF) != check) {
+                m_state = State::Failed;
+                break;
+            }
+            m_storedLeft = length;
+            m_state = State::Stored;
+        }
+        else if (type == 1) {
+            m_literals = FixedLiterals().entries;
+            m_distances = FixedDistances().entries;
+            m_state = State::Compressed;
+        }
+        else if (type == 2 && ReadDynamicTables()) {
+            m_literals = m_dynamicLiterals.entries;
+            m_distances = m_dynamicDistances.entries;
+            m_state = State::Compressed;
+        }
+        else {
+            m_state = State::Failed;
+        }
+        break;
+    }
+    case State::Stored:
+        DecodeStored();
+        break;
+    case State::Compressed:
+        DecodeCompressed();
+        break;
+    default:
+        break;
+    }
+}
+
+void Inflater::DecodeStored() {
+    const size_t room = m_window.size() - m_out;
+    size_t n = std::min<size_t>(m_storedLeft, room);
+    m_storedLeft -= static_cast<uint32_t>(n);
+
+    // Bytes already in the bit buffer first, not the padding, then straight from the input spans
+    while (n > 0 && m_count >= m_padding * 8 + 8) {
+        m_window[m_out++] = static_cast<uint8_t>(GetBits(8));
+        --n;
+    }
+
+    // Word refills leave the start of the next byte above m_count, it must not survive a direct read
+    if (n > 0) m_bits = 0;
+    while (n > 0) {
+        while (m_span < m_input.size() && m_pos == m_input[m_span].size) {
+            ++m_span;
+            m_pos = 0;
+        }
+        if (m_span == m_input.size()) {
+            m_state = State::Failed;
+            return;
+        }
+        const size_t take = std::min(n, m_input[m_span].size - m_pos);
+        std::memcpy(m_window.data() + m_out, m_input[m_span].data + m_pos, take);
+        m_pos += take;
+        m_out += take;
+        n -= take;
+    }
+    if (m_storedLeft == 0) m_state = State::BlockHeader;
+}
+
+void Inflater::DecodeCompressed() {
+    uint8_t* const window = m_window.data();
+    uint8_t* out = window + m_out;
+    uint8_t* const limit = window + m_window.size() - MaxMatch - CopySlack;
+    const uint32_t* const literals = m_literals;
+    const uint32_t* const distances = m_distances;
+
+    // Bit buffer and input position in locals so they stay in registers. Word refills run while
+    // the current span has 8 bytes left, anything else goes through Refill.
+    uint64_t bits = m_bits;
+    uint32_t count = m_count;
+    uint32_t paddingBits = m_padding * 8;
+    const uint8_t* in = nullptr;
+    const uint8_t* inLast = nullptr;
+    auto loadInput = [&]() {
+        in = inLast = nullptr;
+        if (m_span < m_input.size() && m_input[m_span].size - m_pos >= 8) {
+            in = m_input[m_span].data + m_pos;
+            inLast = m_input[m_span].data + m_input[m_span].size - 8;
+        }
+        };
+    auto saveInput = [&]() {
+        if (in) m_pos = static_cast<size_t>(in - m_input[m_span].data);
+        };
+    loadInput();
+
+    auto refill = [&]() {
+        if (in && in <= inLast) {
+            uint64_t word;
+            std::memcpy(&word, in, 8);
+            bits |= word << count;
+            in += (63 - count) >> 3;
+            count |= 56;
+        }
+        else {
+            saveInput();
+            m_bits = bits;
+            m_count = count;
+            Refill();
+            bits = m_bits;
+            count = m_count;
+            paddingBits = m_padding * 8;
+            loadInput();
+        }
+        };
+    auto lookupLiteral = [&]() {
+        const uint32_t entry = literals[bits & ((1u << LiteralRootBits) - 1)];
+        if (EntryKindOf(entry) != KindSubtable) return entry;
+        return literals[EntryValue(entry) + ((bits >> LiteralRootBits) & ((1u << EntryExtra(entry)) - 1))];
+        };
+
+    // Stops short of the buffer end with room for the longest match, Read slides and comes back
+    while (out <= limit && count >= paddingBits) {
+        // A length and a distance code with their extra bits take at most 48
+        if (count < 48) refill();
+
+        // Runs of literals stay here while the buffer holds a whole code, one or two per entry with
+        // both bytes stored either way
+        uint32_t entry = lookupLiteral();
+        if (count < paddingBits + EntryLength(entry)) {
+            // A code reaching into the zero padding means the data ends early. The literal run
+            // below only goes on while a whole code of real bits is left.
+            m_state = State::Failed;
+            break;
+        }
+        while (EntryKindOf(entry) == KindLiteral) {
+            bits >>= EntryLength(entry);
+            count -= EntryLength(entry);
+            out[0] = static_cast<uint8_t>(entry >> 16);
+            out[1] = static_cast<uint8_t>(entry >> 24);
+            out += EntryExtra(entry);
+            if (count < paddingBits + 15 || out > limit) break;
+            entry = lookupLiteral();
+        }
+        const uint32_t kind = EntryKindOf(entry);
+        if (kind == KindLiteral) continue;
+
+        bits >>= EntryLength(entry);
+        count -= EntryLength(entry);
+        if (kind != KindMatch) {
+            m_state = (kind == KindEnd) ? State::BlockHeader : State::Failed;
+            break;
+        }
+        if (count < 33) refill();
+
+        const uint32_t lengthExtra = EntryExtra(entry);
+        const uint32_t length = EntryValue(entry) + static_cast<uint32_t>(bits & ((1u << lengthExtra) - 1));
+        bits >>= lengthExtra;
+        count -= lengthExtra;
+
+        entry = distances[bits & ((1u << DistanceRootBits) - 1)];
+        if (EntryKindOf(entry) == KindSubtable) {
+            entry = distances[EntryValue(entry) + ((bits >> DistanceRootBits) & ((1u << EntryExtra(entry)) - 1))];
+        }
+        bits >>= EntryLength(entry);
+        count -= EntryLength(entry);
+        if (EntryKindOf(entry) != KindMatch) {
+            m_state = State::Failed;
+            break;
+        }
+
+        const uint32_t distanceExtra = EntryExtra(entry);
+        const size_t distance = EntryValue(entry) + static_cast<uint32_t>(bits & ((1u << distanceExtra) - 1));
+        bits >>= distanceExtra;
+        count -= distanceExtra;
+        if (count < paddingBits || distance > static_cast<size_t>(out - window)) {
+            m_state = State::Failed;
+            break;
+        }
+
+        CopyMatch(out, distance, length);
+        out += length;
+    }
+
+    saveInput();
+    m_bits = bits;
+    m_count = count;
+    m_out = static_cast<size_t>(out - window);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Streaming deflate (RFC 1951) decoder, zlib wrapped (RFC 1950) as in PNG or raw as in ZIP
+// members. The compressed stream is handed over as one or more spans, such as the IDAT chunks of
+// a PNG, and output is pulled in pieces of any size or pushed to a callback as it is produced, so
+// a large image can be worked through a band at a time while only the 32 KB history stays resident.
+// The Adler-32 trailer is skipped, not verified.
+
+class Inflater {
+public:
+    enum class Format { Zlib, Raw };
+
+    explicit Inflater(Format format = Format::Zlib);
+
+    // Appends compressed data. Spans must stay valid until reading is done.
+    void AddInput(const uint8_t* data, size_t size);
+
+    // Fills dst with up to size bytes and returns how many were written. Short only at the end of
+    // the stream or where the data is truncated or corrupt.
+    size_t Read(uint8_t* dst, size_t size);
+
+    // Decodes to the end of the stream, handing output over in pieces as it is produced. False when
+    // the data is truncated or corrupt, or the sink returned false.
+    using OutputSink = std::function<bool(const uint8_t* data, size_t size)>;
+    bool Inflate(const OutputSink& sink);
+
+    bool Finished() const { return m_state == State::Done; }
+    bool Failed() const { return m_state == State::Failed; }
+
+private:
+    // Decode tables resolve a code in one lookup, or two for codes longer than the root bits, to
+    // an entry that carries everything the decode loop needs:
+    //   bits 0-4    code length to consume, zero for a subtable link
+    //   bits 5-7    kind
+    //   bits 8-11   literal count, extra bits, or subtable index bits
+    //   bits 16-31  literal bytes, base length or distance, or subtable offset
+    // The literal table packs two literals into one entry when both codes fit in the root bits.
+    static constexpr uint32_t LiteralRootBits = 11;
+    static constexpr uint32_t DistanceRootBits = 8;
+    static constexpr uint32_t CodeLengthRootBits = 7;
+
+    // Root table plus the largest set of subtables a valid code can need
+    static constexpr uint32_t LiteralTableSize = 2342;
+    static constexpr uint32_t DistanceTableSize = 402;
+    static constexpr uint32_t CodeLengthTableSize = 1 << CodeLengthRootBits;
+
+    enum class Alphabet { CodeLengths, Literals, Distances };
+
+    struct LiteralTable {
+        uint32_t entries[LiteralTableSize];
+    };
+    struct DistanceTable {
+        uint32_t entries[DistanceTableSize];
+    };
+
+    enum class State { Header, BlockHeader, Stored, Compressed, Done, Failed };
+
+    static bool BuildTable(uint32_t* table, uint32_t tableSize, uint32_t rootBits, const uint8_t* lengths, uint32_t count, Alphabet alphabet);
+    static const LiteralTable& FixedLiterals();
+    static const DistanceTable& FixedDistances();
+
+    void Refill();
+    uint32_t PeekBits(uint32_t n) const { return static_cast<uint32_t>(m_bits & ((uint64_t{ 1 } << n) - 1)); }
+    uint32_t GetBits(uint32_t n);
+    uint32_t DecodeEntry(const uint32_t* table, uint32_t rootBits);
+    bool ReadDynamicTables();
+    bool Truncated() const { return m_count < m_padding * 8; }
+
+    void Advance();
+    void Step();
+    void DecodeStored();
+    void DecodeCompressed();
+
+    struct Span {
+        const uint8_t* data;
+        size_t size;
+    };
+    std::vector<Span> m_input;
+    size_t m_span = 0;
+    size_t m_pos = 0;                 // Within the current span
+    uint64_t m_bits = 0;              // LSB first
+    uint32_t m_count = 0;
+    uint32_t m_padding = 0;           // Zero bytes fed after the input ran out
+
+    State m_state = State::Header;
+    bool m_lastBlock = false;
+    uint32_t m_storedLeft = 0;
+    const uint32_t* m_literals = nullptr;
+    const uint32_t* m_distances = nullptr;
+    LiteralTable m_dynamicLiterals;
+    DistanceTable m_dynamicDistances;
+
+    // History window followed by fresh output. Read drains [m_readPos, m_out) before decoding
+    // more, and once the buffer fills the last 32 KB slide back to the front.
+    std::vector<uint8_t> m_window;
+    size_t m_out = 0;
+    size_t m_readPos = 0;
+};
@@ -0,0 +1,1147 @@
+#include "jpeg_decode.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+    // Zigzag position to natural (row-major) position within the 8x8 block
+    constexpr uint8_t Natural[64] = {
+        0,  1,  8, 16,  9,  2,  3, 10,
+       17, 24, 32, 25, 18, 11,  4,  5,
+       12, 19, 26, 33, 40, 48, 41, 34,
+       27, 20, 13,  6,  7, 14, 21, 28,
+       35, 42, 49, 56, 57, 50, 43, 36,
+       29, 22, 15, 23, 30, 37, 44, 51,
+       58, 59, 52, 45, 38, 31, 39, 46,
+       53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    uint32_t ReadBigEndian16(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+    }
+
+    uint8_t Clamp8(int v) {
+        return static_cast<uint8_t>(std::clamp(v, 0, 255));
+    }
+
+    // Next marker that ends entropy-coded data: not a stuffed zero, a fill byte or a restart marker
+    size_t FindScanEnd(const uint8_t* data, size_t size, size_t pos) {
+        while (pos + 1 < size) {
+            const void* hit = std::memchr(data + pos, 0xFF, size - pos - 1);
+            if (!hit) return size;
+            pos = static_cast<const uint8_t*>(hit) - data;
+            const uint8_t next = data[pos + 1];
+            if (next != 0x00 && next != 0xFF && (next & 0xF8) != 0xD0) return pos;
+            pos += (next == 0xFF) ? 1 : 2;
+        }
+        return size;
+    }
+
+    // Start of each restart interval in an entropy-coded segment, and the marker that ends it.
+    // False unless exactly count intervals are found with RST0-RST7 in sequence.
+    bool FindRestartIntervals(const uint8_t* data, size_t size, size_t pos, uint32_t count, std::vector<size_t>& starts, size_t& end) {
+        starts.clear();
+        starts.reserve(count);
+        starts.push_back(pos);
+        end = size;
+        while (pos + 1 < size) {
+            const void* hit = std::memchr(data + pos, 0xFF, size - pos - 1);
+            if (!hit) break;
+            pos = static_cast<const uint8_t*>(hit) - data;
+            const uint8_t next = data[pos + 1];
+            if (next == 0x00 || next == 0xFF) {
+                pos += (next == 0xFF) ? 1 : 2;
+                continue;
+            }
+            if ((next & 0xF8) != 0xD0) {
+                end = pos;
+                break;
+            }
+            if (next != 0xD0 + (starts.size() - 1) % 8 || starts.size() == count) return false;   // Out of sequence or extra
+            pos += 2;
+            starts.push_back(pos);
+        }
+        return starts.size() == count;
+    }
+
+    // Integer 8x8 IDCT (LLM factorization, 12-bit fixed point constants)
+    inline int Fix(float x) { return static_cast<int>(x * 4096.0f + 0.5f); }
+
+    // Valid data stays far inside these limits. Corrupt coefficients are held to them so neither
+    // pass can overflow 32 bits.
+    constexpr int CoefLimit = 16383;
+
+    inline int ClampPass(int v) { return std::clamp(v, -CoefLimit, CoefLimit); }
+
+    inline int32_t Dequantize(int value, uint16_t quant) {
+        return std::clamp(value * static_cast<int>(quant), -CoefLimit, CoefLimit);
+    }
+
+#define JPEG_IDCT_1D(s0, s1, s2, s3, s4, s5, s6, s7) \
+        int t0, t1, t2, t3, p1, p2, p3, p4, p5, x0, x1, x2, x3; \
+        p2 = s2; \
+        p3 = s6; \
+        p1 = (p2 + p3) * Fix(0.5411961f); \
+        t2 = p1 + p3 * Fix(-1.847759065f); \
+        t3 = p1 + p2 * Fix(0.765366865f); \
+        p2 = s0; \
+        p3 = s4; \
+        t0 = (p2 + p3) * 4096; \
+        t1 = (p2 - p3) * 4096; \
+        x0 = t0 + t3; \
+        x3 = t0 - t3; \
+        x1 = t1 + t2; \
+        x2 = t1 - t2; \
+        t0 = s7; \
+        t1 = s5; \
+        t2 = s3; \
+        t3 = s1; \
+        p3 = t0 + t2; \
+        p4 = t1 + t3; \
+        p1 = t0 + t3; \
+        p2 = t1 + t2; \
+        p5 = (p3 + p4) * Fix(1.175875602f); \
+        t0 = t0 * Fix(0.298631336f); \
+        t1 = t1 * Fix(2.053119869f); \
+        t2 = t2 * Fix(3.072711026f); \
+        t3 = t3 * Fix(1.501321110f); \
+        p1 = p5 + p1 * Fix(-0.899976223f); \
+        p2 = p5 + p2 * Fix(-2.562915447f); \
+        p3 = p3 * Fix(-1.961570560f); \
+        p4 = p4 * Fix(-0.390180644f); \
+        t3 += p1 + p4; \
+        t2 += p2 + p3; \
+        t1 += p2 + p4; \
+        t0 += p1 + p3;
+
+    void Idct8(const int32_t* in, uint8_t* out, size_t stride) {
+        int tmp[64];
+        for (int i = 0; i < 8; ++i) {
+            const int32_t* d = in + i;
+            int* v = tmp + i;
+            if (d[8] == 0 && d[16] == 0 && d[24] == 0 && d[32] == 0 && d[40] == 0 && d[48] == 0 && d[56] == 0) {
+                const int dc = ClampPass(d[0] * 4);
+                v[0] = v[8] = v[16] = v[24] = v[32] = v[40] = v[48] = v[56] = dc;
+                continue;
+            }
+            JPEG_IDCT_1D(d[0], d[8], d[16], d[24], d[32], d[40], d[48], d[56])
+            x0 += 512; x1 += 512; x2 += 512; x3 += 512;
+            v[0] = ClampPass((x0 + t3) >> 10);
+            v[56] = ClampPass((x0 - t3) >> 10);
+            v[8] = ClampPass((x1 + t2) >> 10);
+            v[48] = ClampPass((x1 - t2) >> 10);
+            v[16] = ClampPass((x2 + t1) >> 10);
+            v[40] = ClampPass((x2 - t1) >> 10);
+            v[24] = ClampPass((x3 + t0) >> 10);
+            v[32] = ClampPass((x3 - t0) >> 10);
+        }
+        for (int i = 0; i < 8; ++i) {
+            const int* v = tmp + i * 8;
+            uint8_t* o = out + i * stride;
+            JPEG_IDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7])
+            // Rounding and the +128 level shift folded into one bias
+            x0 += 65536 + (128 << 17); x1 += 65536 + (128 << 17); x2 += 65536 + (128 << 17); x3 += 65536 + (128 << 17);
+            o[0] = Clamp8((x0 + t3) >> 17);
+            o[7] = Clamp8((x0 - t3) >> 17);
+            o[1] = Clamp8((x1 + t2) >> 17);
+            o[6] = Clamp8((x1 - t2) >> 17);
+            o[2] = Clamp8((x2 + t1) >> 17);
+            o[5] = Clamp8((x2 - t1) >> 17);
+            o[3] = Clamp8((x3 + t0) >> 17);
+            o[4] = Clamp8((x3 - t0) >> 17);
+        }
+    }
+
+#undef JPEG_IDCT_1D
+
+    // Reduced IDCTs take the 4-point or 2-point transform of the top-left coefficients, which
+    // low-passes and decimates the block in one step. The 1/2 factor per axis keeps the DC gain
+    // of the 8-point transform.
+    void Idct4(const int32_t* in, uint8_t* out, size_t stride) {
+        // Columns keep two fractional bits
+        int tmp[16];
+        for (int u = 0; u < 4; ++u) {
+            const int e0 = (in[u] + in[16 + u]) * Fix(0.707106781f);
+            const int e1 = (in[u] - in[16 + u]) * Fix(0.707106781f);
+            const int o0 = in[8 + u] * Fix(0.923879533f) + in[24 + u] * Fix(0.382683432f);
+            const int o1 = in[8 + u] * Fix(0.382683432f) - in[24 + u] * Fix(0.923879533f);
+            tmp[u] = ClampPass((e0 + o0 + 1024) >> 11);
+            tmp[4 + u] = ClampPass((e1 + o1 + 1024) >> 11);
+            tmp[8 + u] = ClampPass((e1 - o1 + 1024) >> 11);
+            tmp[12 + u] = ClampPass((e0 - o0 + 1024) >> 11);
+        }
+        for (int y = 0; y < 4; ++y) {
+            const int* t = tmp + y * 4;
+            const int bias = (128 << 15) + (1 << 14);
+            const int e0 = (t[0] + t[2]) * Fix(0.707106781f) + bias;
+            const int e1 = (t[0] - t[2]) * Fix(0.707106781f) + bias;
+            const int o0 = t[1] * Fix(0.923879533f) + t[3] * Fix(0.382683432f);
+            const int o1 = t[1] * Fix(0.382683432f) - t[3] * Fix(0.923879533f);
+            uint8_t* o = out + y * stride;
+            o[0] = Clamp8((e0 + o0) >> 15);
+            o[1] = Clamp8((e1 + o1) >> 15);
+            o[2] = Clamp8((e1 - o1) >> 15);
+            o[3] = Clamp8((e0 - o0) >> 15);
+        }
+    }
+
+    // Every 2-point basis value is +-1/(2*sqrt(2)), so the 2x2 output is sums and differences over 8
+    void Idct2(const int32_t* in, uint8_t* out, size_t stride) {
+        const int s0 = in[0] + in[8];
+        const int d0 = in[0] - in[8];
+        const int s1 = in[1] + in[9];
+        const int d1 = in[1] - in[9];
+        out[0] = Clamp8(((s0 + s1 + 4) >> 3) + 128);
+        out[1] = Clamp8(((s0 - s1 + 4) >> 3) + 128);
+        out[stride] = Clamp8(((d0 + d1 + 4) >> 3) + 128);
+        out[stride + 1] = Clamp8(((d0 - d1 + 4) >> 3) + 128);
+    }
+
+    // Where output pixels sample a component plane along one axis. Subsampled components are
+    // interpolated at sample centers, which for 2x gives the usual 3:1 taps.
+    struct AxisMap {
+        std::vector<uint32_t> i0;
+        std::vector<uint32_t> i1;
+        std::vector<uint16_t> w;    // Weight of i1 in 1/256
+        bool identity = true;
+        bool twice = false;         // Exact 2x, interior taps are computed inline
+        uint32_t valid = 0;
+    };
+
+    // samples / pixels is plane samples per output pixel
+    AxisMap BuildAxis(uint32_t outSize, uint32_t samples, uint32_t pixels, uint32_t valid) {
+        AxisMap map;
+        map.identity = (samples == pixels);
+        map.twice = (samples * 2 == pixels);
+        map.valid = valid;
+        if (map.identity) return map;
+        map.i0.resize(outSize);
+        map.i1.resize(outSize);
+        map.w.resize(outSize);
+        const double ratio = static_cast<double>(samples) / pixels;
+        for (uint32_t i = 0; i < outSize; ++i) {
+            const double pos = std::max(0.0, (i + 0.5) * ratio - 0.5);
+            const uint32_t base = std::min(static_cast<uint32_t>(pos), valid - 1);
+            map.i0[i] = base;
+            map.i1[i] = std::min(base + 1, valid - 1);
+            map.w[i] = static_cast<uint16_t>(std::lround((pos - std::floor(pos)) * 256.0));
+        }
+        return map;
+    }
+
+    // Horizontal taps over one row. 16-bit rows carry 8 fractional bits from the vertical blend.
+    template <typename Sample>
+    void InterpolateRow(const Sample* row, const AxisMap& map, uint32_t outW, uint8_t* out) {
+        constexpr uint32_t shift = (sizeof(Sample) == 1) ? 8 : 16;
+        constexpr uint32_t round = 1u << (shift - 1);
+        if (map.identity) {
+            for (uint32_t x = 0; x < outW; ++x) out[x] = static_cast<uint8_t>((row[x] * 256u + round) >> shift);
+            return;
+        }
+
+        uint32_t x = 0;
+        auto gather = [&](uint32_t end) {
+            for (; x < end; ++x) {
+                const uint32_t w = map.w[x];
+                out[x] = static_cast<uint8_t>((row[map.i0[x]] * (256 - w) + row[map.i1[x]] * w + round) >> shift);
+            }
+            };
+        if (map.twice) {
+            // Pixels 2i+1 and 2i+2 both fall between samples i and i+1
+            gather(std::min(outW, 1u));
+            for (; x + 1 < outW && (x >> 1) + 1 < map.valid; x += 2) {
+                const uint32_t a = row[x >> 1];
+                const uint32_t b = row[(x >> 1) + 1];
+                out[x] = static_cast<uint8_t>((a * 192 + b * 64 + round) >> shift);
+                out[x + 1] = static_cast<uint8_t>((a * 64 + b * 192 + round) >> shift);
+            }
+        }
+        gather(outW);
+    }
+}
+
+// MSB-first reader over entropy-coded data. Stuffed zero bytes are dropped and a marker stops
+// the input, after which zero bits are returned, so a truncated scan decodes as flat blocks.
+class JpegDecoder::BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size, size_t pos) : m_data(data), m_size(size), m_pos(pos) {}
+
+    uint32_t Get(uint32_t n) {
+        if (n == 0) return 0;
+        if (m_count < n) Fill();
+        const uint32_t value = static_cast<uint32_t>(m_bits >> (64 - n));
+        m_bits <<= n;
+        m_count -= n;
+        return value;
+    }
+
+    bool Bit() { return Get(1) != 0; }
+
+    // Sign-extended magnitude of s bits
+    int Receive(uint32_t s) {
+        if (s == 0) return 0;
+        const int value = static_cast<int>(Get(s));
+        return (value < (1 << (s - 1))) ? value - (1 << s) + 1 : value;
+    }
+
+    int Decode(const Huffman& table) {
+        if (m_count < 16) Fill();
+        const uint16_t fast = table.fast[m_bits >> (64 - FastBits)];
+        if (fast) {
+            m_bits <<= (fast >> 8);
+            m_count -= (fast >> 8);
+            return fast & 0xff;
+        }
+        return DecodeLong(table);
+    }
+
+    // Fast table entry for the next AC code, consumed when nonzero
+    int32_t FastAc(const Huffman& table) {
+        if (m_count < 16) Fill();
+        const int32_t entry = table.fastAc[m_bits >> (64 - FastBits)];
+        if (entry) {
+            m_bits <<= (entry & 0xff);
+            m_count -= (entry & 0xff);
+        }
+        return entry;
+    }
+
+    // Drops the partial byte and steps over the RSTn marker, resynchronizing on the next one if
+    // the interval was damaged
+    void Restart() {
+        m_bits = 0;
+        m_count = 0;
+        m_marker = false;
+        while (m_pos + 1 < m_size) {
+            if (m_data[m_pos] == 0xFF && m_data[m_pos + 1] != 0x00 && m_data[m_pos + 1] != 0xFF) {
+                if ((m_data[m_pos + 1] & 0xF8) == 0xD0) m_pos += 2;
+                else m_marker = true;
+                return;
+            }
+            ++m_pos;
+        }
+    }
+
+    size_t Position() const { return m_pos; }
+
+private:
+    // Codes longer than the lookahead, kept out of line so Decode stays small enough to inline
+    int DecodeLong(const Huffman& table) {
+        const int32_t look = static_cast<int32_t>(m_bits >> 48);
+        for (uint32_t len = FastBits + 1; len <= 16; ++len) {
+            if (look < table.maxCode[len]) {
+                const int32_t index = (look >> (16 - len)) + table.delta[len];
+                m_bits <<= len;
+                m_count -= len;
+                return (index >= 0 && index < 256) ? table.symbols[index] : 0;
+            }
+        }
+        // Not a valid code, consume it so a corrupt scan still makes progress
+        m_bits <<= 16;
+        m_count -= 16;
+        return 0;
+    }
+
+    void Fill() {
+        // Whole bytes at once while the next eight hold no 0xFF, which covers nearly all of a scan
+        if (!m_marker && m_pos + 8 <= m_size) {
+            uint64_t word = 0;
+            for (uint32_t i = 0; i < 8; ++i) word = (word << 8) | m_data[m_pos + i];
+            const uint64_t inverted = ~word;
+            if (((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) == 0) {
+                const uint32_t bytes = (64 - m_count) >> 3;
+                const uint32_t spare = 64 - m_count - bytes * 8;
+                m_bits |= (word >> m_count) & ~((uint64_t{ 1 } << spare) - 1);
+                m_pos += bytes;
+                m_count += bytes * 8;
+                return;
+            }
+        }
+        while (m_count <= 56) {
+            uint32_t byte = 0;
+            if (!m_marker && m_pos < m_size) {
+                byte = m_data[m_pos];
+                if (byte == 0xFF) {
+                    const uint8_t next = (m_pos + 1 < m_size) ? m_data[m_pos + 1] : 0xD9;
+                    if (next == 0x00) {
+                        m_pos += 2;
+                    }
+                    else {
+                        m_marker = true;
+                        byte = 0;
+                    }
+                }
+                else {
+                    ++m_pos;
+                }
+            }
+            m_bits |= static_cast<uint64_t>(byte) << (56 - m_count);
+            m_count += 8;
+        }
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos;
+    uint64_t m_bits = 0;
+    uint32_t m_count = 0;
+    bool m_marker = false;
+};
+
+bool JpegDecoder::BuildHuffman(Huffman& table, const uint8_t* counts, const uint8_t* symbols, uint32_t total) {
+    if (total > 256) return false;
+    std::memset(table.fast, 0, sizeof(table.fast));
+    std::memcpy(table.symbols, symbols, total);
+    uint32_t code = 0;
+    uint32_t k = 0;
+    for (uint32_t len = 1; len <= 16; ++len) {
+        // More codes than the length allows would index past the lookahead table
+        if (code + counts[len - 1] > (1u << len)) return false;
+        table.delta[len] = static_cast<int32_t>(k) - static_cast<int32_t>(code);
+        for (uint32_t i = 0; i < counts[len - 1]; ++i, ++code, ++k) {
+            if (len <= FastBits) {
+                const uint32_t first = code << (FastBits - len);
+                for (uint32_t j = 0; j < (1u << (FastBits - len)); ++j) {
+                    table.fast[first + j] = static_cast<uint16_t>((len << 8) | symbols[k]);
+                }
+            }
+        }
+        table.maxCode[len] = static_cast<int32_t>(code << (16 - len));
+        code <<= 1;
+    }
+    table.maxCode[17] = 0x7fffffff;
+
+    for (uint32_t i = 0; i < (1u << FastBits); ++i) {
+        table.fastAc[i] = 0;
+        const uint32_t len = table.fast[i] >> 8;
+        const uint32_t run = (table.fast[i] >> 4) & 15;
+        const uint32_t size = table.fast[i] & 15;
+        if (len == 0 || size == 0 || len + size > FastBits) continue;
+        const int raw = static_cast<int>((i >> (FastBits - len - size)) & ((1u << size) - 1));
+        const int value = (raw < (1 << (size - 1))) ? raw - (1 << size) + 1 : raw;
+        table.fastAc[i] = value * 65536 + static_cast<int32_t>((run << 8) | (len + size));
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadHeader(const uint8_t* data, size_t size) {
+    m_data = nullptr;
+    m_components.clear();
+    m_adobeTransform = -1;
+    m_restartInterval = 0;
+    for (Huffman& table : m_dcTables) table.present = false;
+    for (Huffman& table : m_acTables) table.present = false;
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            ++pos;
+            continue;
+        }
+        const uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {
+            ++pos;
+            continue;
+        }
+        pos += 2;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+        if (marker == 0xD9 || marker == 0xDA) return false;   // No frame before the image data
+
+        const uint32_t length = ReadBigEndian16(data + pos);
+        if (length < 2 || pos + length > size) return false;
+        const uint8_t* segment = data + pos + 2;
+        const size_t segmentLength = length - 2;
+
+        if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+            if (segmentLength < 6 || segment[0] != 8) return false;
+            m_height = ReadBigEndian16(segment + 1);
+            m_width = ReadBigEndian16(segment + 3);
+            const uint32_t count = segment[5];
+            if (m_width == 0 || m_height == 0 || (count != 1 && count != 3 && count != 4) || segmentLength < 6 + count * 3) return false;
+
+            m_progressive = (marker == 0xC2);
+            m_maxH = 1;
+            m_maxV = 1;
+            for (uint32_t i = 0; i < count; ++i) {
+                Component comp;
+                comp.id = segment[6 + i * 3];
+                comp.h = segment[7 + i * 3] >> 4;
+                comp.v = segment[7 + i * 3] & 15;
+                comp.quantTable = segment[8 + i * 3];
+                if (comp.h < 1 || comp.h > 4 || comp.v < 1 || comp.v > 4 || comp.quantTable > 3) return false;
+                m_maxH = std::max(m_maxH, comp.h);
+                m_maxV = std::max(m_maxV, comp.v);
+                m_components.push_back(comp);
+            }
+
+            m_mcusX = (m_width + 8 * m_maxH - 1) / (8 * m_maxH);
+            m_mcusY = (m_height + 8 * m_maxV - 1) / (8 * m_maxV);
+            for (Component& comp : m_components) {
+                comp.blocksW = m_mcusX * comp.h;
+                comp.blocksH = m_mcusY * comp.v;
+                comp.dataBlocksW = ((m_width * comp.h + m_maxH - 1) / m_maxH + 7) / 8;
+                comp.dataBlocksH = ((m_height * comp.v + m_maxV - 1) / m_maxV + 7) / 8;
+            }
+
+            m_data = data;
+            m_size = size;
+            m_framePos = pos + length;
+            return true;
+        }
+
+        // Lossless, hierarchical and arithmetic-coded frames
+        if ((marker >= 0xC3 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) return false;
+
+        if (marker == 0xEE && segmentLength >= 12 && std::memcmp(segment, "Adobe", 5) == 0) {
+            m_adobeTransform = segment[11];
+        }
+        else if (!ParseTables(marker, segment, segmentLength)) {
+            return false;
+        }
+        pos += length;
+    }
+    return false;
+}
+
+bool JpegDecoder::ParseTables(uint8_t marker, const uint8_t* segment, size_t length) {
+    size_t i = 0;
+    if (marker == 0xDB) {
+        while (i < length) {
+            const uint32_t precision = segment[i] >> 4;
+            const uint32_t id = segment[i] & 15;
+            ++i;
+            if (id > 3 || precision > 1 || i + (precision ? 128 : 64) > length) return false;
+            for (uint32_t k = 0; k < 64; ++k) {
+                m_quant[id][Natural[k]] = static_cast<uint16_t>(precision ? ReadBigEndian16(segment + i + k * 2) : segment[i + k]);
+            }
+            i += precision ? 128 : 64;
+        }
+    }
+    else if (marker == 0xC4) {
+        while (i + 17 <= length) {
+            const uint32_t tableClass = segment[i] >> 4;
+            const uint32_t id = segment[i] & 15;
+            if (tableClass > 1 || id > 3) return false;
+            const uint8_t* counts = segment + i + 1;
+            uint32_t total = 0;
+            for (uint32_t k = 0; k < 16; ++k) total += counts[k];
+            i += 17;
+            if (total > 256 || i + total > length) return false;
+
+            // A DC symbol is a magnitude category, 11 is the largest an 8-bit frame can have
+            if (tableClass == 0) {
+                for (uint32_t k = 0; k < total; ++k) {
+                    if (segment[i + k] > 11) return false;
+                }
+            }
+
+            Huffman& table = tableClass ? m_acTables[id] : m_dcTables[id];
+            if (!BuildHuffman(table, counts, segment + i, total)) return false;
+            table.present = true;
+            i += total;
+        }
+    }
+    else if (marker == 0xDD) {
+        if (length < 2) return false;
+        m_restartInterval = ReadBigEndian16(segment);
+    }
+    return true;
+}
+
+uint32_t ChooseJpegScale(uint32_t width, uint32_t height, uint32_t targetWidth, uint32_t targetHeight) {
+    for (uint32_t scale = 8; scale > 1; scale /= 2) {
+        if (JpegDecoder::ScaledSize(width, scale) >= targetWidth && JpegDecoder::ScaledSize(height, scale) >= targetHeight) return scale;
+    }
+    return 1;
+}
+
+bool JpegDecoder::Decode(uint32_t scale, uint8_t* dst, size_t dstStride) {
+    if (!m_data || !dst || (scale != 1 && scale != 2 && scale != 4 && scale != 8)) return false;
+
+    m_scale = scale;
+    for (Component& comp : m_components) {
+        // Subsampled components get a larger IDCT where the scale leaves room, which lands them at
+        // luma resolution with full chroma detail instead of upsampling a coarser plane later
+        comp.blockOut = 8 / scale;
+        if (m_maxH % comp.h == 0 && m_maxV % comp.v == 0) {
+            const uint32_t reach = (8 / scale) * std::min(m_maxH / comp.h, m_maxV / comp.v);
+            while (comp.blockOut < 8 && comp.blockOut * 2 <= reach) comp.blockOut *= 2;
+        }
+        comp.maxZigzag = (comp.blockOut == 8) ? 63 : (comp.blockOut == 4) ? 24 : (comp.blockOut == 2) ? 4 : 0;
+        comp.coefStride = comp.maxZigzag + 1;
+
+        const uint64_t planeW = static_cast<uint64_t>(comp.blocksW) * comp.blockOut;
+        const uint64_t planeH = static_cast<uint64_t>(comp.blocksH) * comp.blockOut;
+        if (planeW * planeH > SIZE_MAX / 4) return false;
+        comp.planeStride = static_cast<size_t>(planeW);
+        comp.plane.assign(static_cast<size_t>(planeW * planeH), 128);   // Missing data shows as flat grey
+        if (m_progressive) {
+            comp.coefs.assign(static_cast<size_t>(comp.blocksW) * comp.blocksH * comp.coefStride, 0);
+            comp.nonzero.assign(static_cast<size_t>(comp.blocksW) * comp.blocksH, 0);
+        }
+    }
+
+    if (m_progressive) PlanProgressiveScans();
+
+    size_t pos = m_framePos;
+    uint32_t scans = 0;
+    while (pos + 2 <= m_size) {
+        if (m_data[pos] != 0xFF) {
+            ++pos;
+            continue;
+        }
+        const uint8_t marker = m_data[pos + 1];
+        if (marker == 0xFF) {
+            ++pos;
+            continue;
+        }
+        pos += 2;
+        if (marker == 0xD9) break;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+        if (pos + 2 > m_size) break;
+
+        const uint32_t length = ReadBigEndian16(m_data + pos);
+        if (length < 2 || pos + length > m_size) break;
+        const uint8_t* segment = m_data + pos + 2;
+
+        if (marker == 0xDA) {
+            size_t next = 0;
+            if (!DecodeScan(segment, length - 2, next)) break;
+            ++scans;
+            pos = next;
+            continue;
+        }
+        if (!ParseTables(marker, segment, length - 2)) break;
+        pos += length;
+    }
+    if (scans == 0) return false;
+
+    if (m_progressive) FinishProgressive();
+    ConvertToBgra(dst, dstStride);
+
+    for (Component& comp : m_components) {
+        comp.plane.clear();
+        comp.plane.shrink_to_fit();
+        comp.coefs.clear();
+        comp.coefs.shrink_to_fit();
+        comp.nonzero.clear();
+        comp.nonzero.shrink_to_fit();
+    }
+    return true;
+}
+
+// A band past maxZigzag can only be skipped when no decoded scan reads it again: a refinement
+// scan needs every nonzero position of its band, including ones that are not kept. Walks the scan
+// headers and widens each component's reach until it covers every band a decoded scan overlaps.
+void JpegDecoder::PlanProgressiveScans() {
+    struct Band {
+        uint32_t component;
+        uint32_t start;
+        uint32_t end;
+    };
+    std::vector<Band> bands;
+    size_t pos = m_framePos;
+    while (pos + 4 <= m_size) {
+        if (m_data[pos] != 0xFF || m_data[pos + 1] == 0xFF) {
+            ++pos;
+            continue;
+        }
+        const uint8_t marker = m_data[pos + 1];
+        pos += 2;
+        if (marker == 0xD9) break;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+
+        const uint32_t length = ReadBigEndian16(m_data + pos);
+        if (length < 2 || pos + length > m_size) break;
+        if (marker == 0xDA && length >= 6) {
+            const uint8_t* segment = m_data + pos + 2;
+            const uint32_t count = segment[0];
+            if (count == 1 && length >= 8) {
+                for (size_t c = 0; c < m_components.size(); ++c) {
+                    if (m_components[c].id == segment[1]) bands.push_back({ static_cast<uint32_t>(c), segment[3], segment[4] });
+                }
+            }
+            pos = FindScanEnd(m_data, m_size, pos + length);
+            continue;
+        }
+        pos += length;
+    }
+
+    for (Component& comp : m_components) comp.scanReach = comp.maxZigzag;
+    for (bool widened = true; widened;) {
+        widened = false;
+        for (const Band& band : bands) {
+            Component& comp = m_components[band.component];
+            if (band.start <= comp.scanReach && band.end > comp.scanReach && band.end <= 63) {
+                comp.scanReach = band.end;
+                widened = true;
+            }
+        }
+    }
+}
+
+bool JpegDecoder::DecodeScan(const uint8_t* segment, size_t length, size_t& pos) {
+    if (length < 1) return false;
+    m_scanCount = segment[0];
+    if (m_scanCount < 1 || m_scanCount > 4 || length < 4 + m_scanCount * 2) return false;
+
+    for (uint32_t i = 0; i < m_scanCount; ++i) {
+        const uint8_t id = segment[1 + i * 2];
+        auto it = std::find_if(m_components.begin(), m_components.end(), [&](const Component& c) { return c.id == id; });
+        if (it == m_components.end()) return false;
+        it->dcTable = segment[2 + i * 2] >> 4;
+        it->acTable = segment[2 + i * 2] & 15;
+        if (it->dcTable > 3 || it->acTable > 3) return false;
+        m_scanComps[i] = static_cast<uint32_t>(it - m_components.begin());
+    }
+    const uint8_t* tail = segment + 1 + m_scanCount * 2;
+    m_spectralStart = tail[0];
+    m_spectralEnd = tail[1];
+    m_approxHigh = tail[2] >> 4;
+    m_approxLow = tail[2] & 15;
+
+    const size_t dataStart = static_cast<size_t>(segment + length - m_data);
+    if (m_progressive) {
+        if (m_spectralEnd > 63 || m_spectralStart > m_spectralEnd || (m_spectralStart == 0 && m_spectralEnd != 0) ||
+            (m_spectralStart > 0 && m_scanCount != 1) || m_approxLow > 13) {
+            return false;
+        }
+
+        // Bands the scaled IDCT never reads are skipped without entropy decoding
+        if (m_spectralStart > m_components[m_scanComps[0]].scanReach) {
+            pos = FindScanEnd(m_data, m_size, dataStart);
+            return true;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_scanCount; ++i) {
+        const Component& comp = m_components[m_scanComps[i]];
+        const bool needsDc = !m_progressive || (m_spectralStart == 0 && m_approxHigh == 0);
+        const bool needsAc = !m_progressive ? true : m_spectralStart > 0;
+        if ((needsDc && !m_dcTables[comp.dcTable].present) || (needsAc && !m_acTables[comp.acTable].present)) return false;
+    }
+
+    // MCUs of a single-component scan are its data blocks in raster order
+    const Component& first = m_components[m_scanComps[0]];
+    const uint32_t rowMcus = (m_scanCount == 1) ? first.dataBlocksW : m_mcusX;
+    const uint32_t mcuRows = (m_scanCount == 1) ? first.dataBlocksH : m_mcusY;
+    const uint32_t mcuCount = rowMcus * mcuRows;
+
+    // Runs block(bits, state, c, bx, by) over MCUs [begin, end), restarting at interval boundaries
+    auto decodeMcus = [&](BitReader& bits, IntervalState& state, uint32_t begin, uint32_t end, auto&& block) {
+        for (uint32_t mcu = begin; mcu < end; ++mcu) {
+            if (m_restartInterval != 0 && mcu != begin && mcu % m_restartInterval == 0) {
+                bits.Restart();
+                state = IntervalState{};
+            }
+            const uint32_t mx = mcu % rowMcus;
+            const uint32_t my = mcu / rowMcus;
+            if (m_scanCount == 1) {
+                block(bits, state, m_scanComps[0], mx, my);
+                continue;
+            }
+            for (uint32_t i = 0; i < m_scanCount; ++i) {
+                const Component& comp = m_components[m_scanComps[i]];
+                for (uint32_t v = 0; v < comp.v; ++v) {
+                    for (uint32_t h = 0; h < comp.h; ++h) {
+                        block(bits, state, m_scanComps[i], mx * comp.h + h, my * comp.v + v);
+                    }
+                }
+            }
+        }
+        };
+    auto decodeBlock = [&](BitReader& bits, IntervalState& state, uint32_t c, uint32_t bx, uint32_t by) {
+        if (m_progressive) {
+            DecodeBlockProgressive(bits, state, c, bx, by);
+            return;
+        }
+        int32_t coefs[64] = {};
+        DecodeBlockBaseline(bits, state, c, coefs);
+        OutputBlock(m_components[c], coefs, bx, by);
+        };
+
+    const uint32_t threads = ParallelThreadCount();
+    const uint32_t intervals = (m_restartInterval != 0) ? (mcuCount + m_restartInterval - 1) / m_restartInterval : 1;
+    if (threads > 1 && intervals > 1) {
+        // Each interval starts on byte alignment with fresh predictors, so once the markers are
+        // found the intervals are independent. A damaged marker sequence takes the serial path,
+        // which resynchronizes instead.
+        std::vector<size_t> starts;
+        size_t scanEnd = 0;
+        if (FindRestartIntervals(m_data, m_size, dataStart, intervals, starts, scanEnd)) {
+            ParallelFor(intervals, 1, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    BitReader bits(m_data, m_size, starts[i]);
+                    IntervalState state;
+                    const uint32_t mcu = i * m_restartInterval;
+                    decodeMcus(bits, state, mcu, std::min(mcuCount, mcu + m_restartInterval), decodeBlock);
+                }
+                });
+            pos = scanEnd;
+            return true;
+        }
+    }
+
+    BitReader bits(m_data, m_size, dataStart);
+    IntervalState state;
+
+    // Without restarts the Huffman decode is serial, so the IDCT moves off that thread: one task
+    // decodes the coefficients of an MCU row while the rest transform the row before it. Once no
+    // component needs the full 8x8 IDCT it is too cheap to be worth the handoff.
+    bool pipelined = false;
+    for (uint32_t i = 0; i < m_scanCount; ++i) pipelined |= (m_components[m_scanComps[i]].blockOut == 8);
+    if (m_progressive || m_restartInterval != 0 || threads == 1 || mcuRows < 2) pipelined = false;
+    if (!pipelined) {
+        decodeMcus(bits, state, 0, mcuCount, decodeBlock);
+        pos = FindScanEnd(m_data, m_size, bits.Position());
+        return true;
+    }
+
+    struct PendingBlock {
+        uint32_t c;
+        uint32_t bx;
+        uint32_t by;
+    };
+    struct Band {
+        std::vector<PendingBlock> blocks;
+        std::vector<int32_t> coefs;
+    };
+    uint32_t blocksPerMcu = 0;
+    for (uint32_t i = 0; i < m_scanCount; ++i) {
+        const Component& comp = m_components[m_scanComps[i]];
+        blocksPerMcu += (m_scanCount == 1) ? 1 : comp.h * comp.v;
+    }
+    Band bands[2];
+    for (Band& band : bands) {
+        band.blocks.reserve(static_cast<size_t>(rowMcus) * blocksPerMcu);
+        band.coefs.resize(static_cast<size_t>(rowMcus) * blocksPerMcu * 64);
+    }
+
+    // One item per ParallelFor task, so the Huffman decode never shares a task with IDCT work
+    const uint32_t parts = threads * 4 - 1;
+    for (uint32_t row = 0; row <= mcuRows; ++row) {
+        Band& fill = bands[row & 1];
+        Band& drain = bands[(row + 1) & 1];
+        ParallelFor(parts + 1, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t part = begin; part < end; ++part) {
+                if (part == 0) {
+                    fill.blocks.clear();
+                    if (row == mcuRows) continue;
+                    decodeMcus(bits, state, row * rowMcus, (row + 1) * rowMcus,
+                        [&](BitReader& rowBits, IntervalState& rowState, uint32_t c, uint32_t bx, uint32_t by) {
+                            int32_t* coefs = fill.coefs.data() + fill.blocks.size() * 64;
+                            std::fill(coefs, coefs + 64, 0);
+                            DecodeBlockBaseline(rowBits, rowState, c, coefs);
+                            fill.blocks.push_back({ c, bx, by });
+                        });
+                    continue;
+                }
+                const size_t count = drain.blocks.size();
+                for (size_t b = count * (part - 1) / parts; b < count * part / parts; ++b) {
+                    const PendingBlock& pending = drain.blocks[b];
+                    OutputBlock(m_components[pending.c], drain.coefs.data() + b * 64, pending.bx, pending.by);
+                }
+            }
+            });
+    }
+
+    pos = FindScanEnd(m_data, m_size, bits.Position());
+    return true;
+}
+
+void JpegDecoder::DecodeBlockBaseline(BitReader& bits, IntervalState& state, uint32_t c, int32_t* coefs) const {
+    const Component& comp = m_components[c];
+    const Huffman& dc = m_dcTables[comp.dcTable];
+    const Huffman& ac = m_acTables[comp.acTable];
+    const uint16_t* quant = m_quant[comp.quantTable];
+
+    int32_t& dcPred = state.dcPred[c];
+    dcPred = ClampPass(dcPred + bits.Receive(bits.Decode(dc)));
+    coefs[0] = Dequantize(dcPred, quant[0]);
+
+    // Every AC code has to be read to find the next block, only the ones the IDCT uses are kept
+    for (uint32_t k = 1; k < 64;) {
+        const int32_t fast = bits.FastAc(ac);
+        if (fast) {
+            k += (fast >> 8) & 15;
+            if (k > 63) break;
+            if (k <= comp.maxZigzag) {
+                const uint32_t n = Natural[k];
+                coefs[n] = Dequantize(fast >> 16, quant[n]);
+            }
+            ++k;
+            continue;
+        }
+        const int rs = bits.Decode(ac);
+        const uint32_t run = rs >> 4;
+        const uint32_t size = rs & 15;
+        if (size == 0) {
+            if (run != 15) break;
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) break;
+        const int value = bits.Receive(size);
+        if (k <= comp.maxZigzag) {
+            const uint32_t n = Natural[k];
+            coefs[n] = Dequantize(value, quant[n]);
+        }
+        ++k;
+    }
+}
+
+void JpegDecoder::DecodeBlockProgressive(BitReader& bits, IntervalState& state, uint32_t c, uint32_t bx, uint32_t by) {
+    Component& comp = m_components[c];
+    const size_t index = static_cast<size_t>(by) * comp.blocksW + bx;
+    int16_t* block = comp.coefs.data() + index * comp.coefStride;
+    uint64_t& nonzero = comp.nonzero[index];
+
+    if (m_spectralStart == 0) {
+        if (m_approxHigh == 0) {
+            int32_t& dcPred = state.dcPred[c];
+            dcPred = ClampPass(dcPred + bits.Receive(bits.Decode(m_dcTables[comp.dcTable])));
+            block[0] = static_cast<int16_t>(dcPred * (1 << m_approxLow));
+        }
+        else if (bits.Bit()) {
+            block[0] = static_cast<int16_t>(block[0] | (1 << m_approxLow));
+        }
+        return;
+    }
+
+    const Huffman& ac = m_acTables[comp.acTable];
+    if (m_approxHigh == 0) {
+        // First pass over a band, with end-of-band runs spanning blocks
+        if (state.eobRun > 0) {
+            --state.eobRun;
+            return;
+        }
+        for (uint32_t k = m_spectralStart; k <= m_spectralEnd;) {
+            const int32_t fast = bits.FastAc(ac);
+            if (fast) {
+                k += (fast >> 8) & 15;
+                if (k > 63) break;
+                if (k < comp.coefStride) block[k] = static_cast<int16_t>((fast >> 16) * (1 << m_approxLow));
+                nonzero |= uint64_t{ 1 } << k;
+                ++k;
+                continue;
+            }
+            const int rs = bits.Decode(ac);
+            const uint32_t run = rs >> 4;
+            const uint32_t size = rs & 15;
+            if (size == 0) {
+                if (run < 15) {
+                    state.eobRun = (1u << run) - 1;
+                    if (run) state.eobRun += bits.Get(run);
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+            k += run;
+            if (k > 63) break;
+            const int value = bits.Receive(size);
+            if (k < comp.coefStride) block[k] = static_cast<int16_t>(value * (1 << m_approxLow));
+            nonzero |= uint64_t{ 1 } << k;
+            ++k;
+        }
+        return;
+    }
+
+    // Refinement: one correction bit for every coefficient already nonzero, new ones are +-1.
+    // The nonzero mask finds runs of zeros without walking the band, and coefficients past the
+    // ones kept for a scaled decode only have their bits consumed.
+    const int p1 = 1 << m_approxLow;
+    auto refine = [&](uint32_t k) {
+        const uint32_t bit = bits.Get(1);
+        if (k >= comp.coefStride) return;
+        int16_t& coef = block[k];
+        const int sign = coef >> 15;
+        const int apply = -static_cast<int>(bit & ((coef & p1) == 0));
+        coef = static_cast<int16_t>(coef + (((p1 ^ sign) - sign) & apply));
+        };
+    auto bandFrom = [&](uint32_t first) {
+        const uint64_t upTo = (m_spectralEnd == 63) ? ~uint64_t{ 0 } : (uint64_t{ 1 } << (m_spectralEnd + 1)) - 1;
+        return (first > 63) ? 0 : upTo & ~((uint64_t{ 1 } << first) - 1);
+        };
+
+    uint32_t k = m_spectralStart;
+    if (state.eobRun == 0) {
+        while (k <= m_spectralEnd) {
+            const int rs = bits.Decode(ac);
+            uint32_t run = rs >> 4;
+            const uint32_t size = rs & 15;
+            int value = 0;
+            if (size != 0) {
+                value = bits.Get(1) ? p1 : -p1;
+            }
+            else if (run != 15) {
+                state.eobRun = 1u << run;
+                if (run) state.eobRun += bits.Get(run);
+                break;
+            }
+
+            // Land on the zero coefficient after run zeros, refining the nonzero ones passed on the way
+            uint64_t zeros = ~nonzero & bandFrom(k);
+            for (; run > 0 && zeros; --run) zeros &= zeros - 1;
+            const uint32_t target = zeros ? std::countr_zero(zeros) : m_spectralEnd + 1;
+            for (uint64_t passed = nonzero & bandFrom(k) & ~bandFrom(target); passed; passed &= passed - 1) {
+                refine(std::countr_zero(passed));
+            }
+            k = target;
+            if (value != 0 && k <= m_spectralEnd) {
+                if (k < comp.coefStride) block[k] = static_cast<int16_t>(value);
+                nonzero |= uint64_t{ 1 } << k;
+            }
+            ++k;
+        }
+    }
+
+    if (state.eobRun > 0) {
+        // Inside an end-of-band run only the nonzero coefficients carry bits
+        for (uint64_t rest = nonzero & bandFrom(k); rest; rest &= rest - 1) {
+            refine(std::countr_zero(rest));
+        }
+        --state.eobRun;
+    }
+}
+
+void JpegDecoder::OutputBlock(Component& comp, const int32_t* coefs, uint32_t bx, uint32_t by) const {
+    uint8_t* out = comp.plane.data() + static_cast<size_t>(by) * comp.blockOut * comp.planeStride + static_cast<size_t>(bx) * comp.blockOut;
+    switch (comp.blockOut) {
+    case 8: Idct8(coefs, out, comp.planeStride); break;
+    case 4: Idct4(coefs, out, comp.planeStride); break;
+    case 2: Idct2(coefs, out, comp.planeStride); break;
+    default: out[0] = Clamp8(((coefs[0] + 4) >> 3) + 128); break;   // DC is 8x the block mean
+    }
+}
+
+void JpegDecoder::FinishProgressive() {
+    for (Component& comp : m_components) {
+        const uint16_t* quant = m_quant[comp.quantTable];
+        ParallelFor(comp.blocksH, 4, [&](uint32_t begin, uint32_t end) {
+            int32_t coefs[64] = {};
+            for (uint32_t by = begin; by < end; ++by) {
+                for (uint32_t bx = 0; bx < comp.blocksW; ++bx) {
+                    const int16_t* block = comp.coefs.data() + (static_cast<size_t>(by) * comp.blocksW + bx) * comp.coefStride;
+                    // Up to the last coefficient the scaled IDCT reads
+                    for (uint32_t k = 0; k <= comp.maxZigzag; ++k) {
+                        const uint32_t n = Natural[k];
+                        coefs[n] = Dequantize(block[k], quant[n]);
+                    }
+                    OutputBlock(comp, coefs, bx, by);
+                }
+            }
+            });
+    }
+}
+
+void JpegDecoder::ConvertToBgra(uint8_t* dst, size_t dstStride) const {
+    const uint32_t outW = ScaledSize(m_width, m_scale);
+    const uint32_t outH = ScaledSize(m_height, m_scale);
+    const size_t count = m_components.size();
+
+    std::vector<AxisMap> mapX(count);
+    std::vector<AxisMap> mapY(count);
+    for (size_t c = 0; c < count; ++c) {
+        const Component& comp = m_components[c];
+        const uint32_t blockIn = 8 / m_scale;
+        const uint32_t validW = std::max(1u, ScaledSize((m_width * comp.h + m_maxH - 1) / m_maxH * comp.blockOut, 8));
+        const uint32_t validH = std::max(1u, ScaledSize((m_height * comp.v + m_maxV - 1) / m_maxV * comp.blockOut, 8));
+        mapX[c] = BuildAxis(outW, comp.h * comp.blockOut, m_maxH * blockIn, validW);
+        mapY[c] = BuildAxis(outH, comp.v * comp.blockOut, m_maxV * blockIn, validH);
+    }
+
+    const bool rgb = (count == 3) && (m_adobeTransform == 0 ||
+        (m_components[0].id == 'R' && m_components[1].id == 'G' && m_components[2].id == 'B'));
+    const bool ycck = (count == 4) && (m_adobeTransform == 2);
+
+    ParallelFor(outH, 16, [&](uint32_t begin, uint32_t end) {
+        std::vector<uint8_t> scratch(static_cast<size_t>(outW) * count);
+        std::vector<uint16_t> blended;
+        const uint8_t* rows[4] = {};
+        for (uint32_t y = begin; y < end; ++y) {
+            for (size_t c = 0; c < count; ++c) {
+                const Component& comp = m_components[c];
+                const AxisMap& mx = mapX[c];
+                const AxisMap& my = mapY[c];
+
+                // Vertical blend first, over the plane width and kept at 16 bits, then the horizontal taps
+                const uint8_t* row = comp.plane.data() + static_cast<size_t>(my.identity ? y : my.i0[y]) * comp.planeStride;
+                uint8_t* out = scratch.data() + c * outW;
+                if (!my.identity && my.w[y] != 0) {
+                    const uint8_t* next = comp.plane.data() + static_cast<size_t>(my.i1[y]) * comp.planeStride;
+                    const uint32_t wy = my.w[y];
+                    blended.resize(comp.planeStride);
+                    for (size_t x = 0; x < comp.planeStride; ++x) {
+                        blended[x] = static_cast<uint16_t>(row[x] * (256 - wy) + next[x] * wy);
+                    }
+                    InterpolateRow(blended.data(), mx, outW, out);
+                    row = out;
+                }
+                else if (!mx.identity) {
+                    InterpolateRow(row, mx, outW, out);
+                    row = out;
+                }
+                rows[c] = row;
+            }
+
+            uint8_t* o = dst + static_cast<size_t>(y) * dstStride;
+            if (count == 1) {
+                const uint8_t* gray = rows[0];
+                for (uint32_t x = 0; x < outW; ++x, o += 4) {
+                    o[0] = o[1] = o[2] = gray[x];
+                    o[3] = 255;
+                }
+            }
+            else if (rgb) {
+                for (uint32_t x = 0; x < outW; ++x, o += 4) {
+                    o[0] = rows[2][x];
+                    o[1] = rows[1][x];
+                    o[2] = rows[0][x];
+                    o[3] = 255;
+                }
+            }
+            else if (count == 3) {
+                const uint8_t* luma = rows[0];
+                const uint8_t* blue = rows[1];
+                const uint8_t* red = rows[2];
+                for (uint32_t x = 0; x < outW; ++x, o += 4) {
+                    // BT.601 full range in 16.16 fixed point
+                    const int l = (luma[x] << 16) + 32768;
+                    const int cb = blue[x] - 128;
+                    const int cr = red[x] - 128;
+                    o[0] = Clamp8((l + 116130 * cb) >> 16);
+                    o[1] = Clamp8((l - 22554 * cb - 46802 * cr) >> 16);
+                    o[2] = Clamp8((l + 91881 * cr) >> 16);
+                    o[3] = 255;
+                }
+            }
+            else {
+                // Adobe stores CMYK inverted, so each channel is just the product with K
+                for (uint32_t x = 0; x < outW; ++x, o += 4) {
+                    int r = rows[0][x];
+                    int g = rows[1][x];
+                    int b = rows[2][x];
+                    if (ycck) {
+                        const int l = (r << 16) + 32768;
+                        const int cb = g - 128;
+                        const int cr = b - 128;
+                        r = Clamp8((l + 91881 * cr) >> 16);
+                        g = Clamp8((l - 22554 * cb - 46802 * cr) >> 16);
+                        b = Clamp8((l + 116130 * cb) >> 16);
+                    }
+                    const int k = rows[3][x];
+                    o[0] = static_cast<uint8_t>(b * k / 255);
+                    o[1] = static_cast<uint8_t>(g * k / 255);
+                    o[2] = static_cast<uint8_t>(r * k / 255);
+                    o[3] = 255;
+                }
+            }
+        }
+        });
+}
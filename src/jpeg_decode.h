@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Baseline and progressive JPEG decoder that can scale by 1/2, 1/4 or 1/8 inside the IDCT,
+// so a large photo previews at screen size without ever producing its full-resolution pixels.
+// At 1/8 only the DC coefficients are used and progressive AC scans are skipped unread.
+// Scans with restart intervals decode the intervals in parallel. Baseline scans without them
+// overlap Huffman decoding of one MCU row with the IDCT of the previous row on the other cores.
+// Huffman coded 8-bit frames with 1 (gray), 3 (YCbCr or RGB) or 4 (Adobe CMYK/YCCK) components
+// are handled. Arithmetic coding, lossless and 12-bit frames fail ReadHeader so callers fall back.
+
+class JpegDecoder {
+public:
+    // Parses markers up to the frame header. The data must stay valid until Decode returns.
+    bool ReadHeader(const uint8_t* data, size_t size);
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t ComponentCount() const { return static_cast<uint32_t>(m_components.size()); }
+    bool IsProgressive() const { return m_progressive; }
+
+    // Output size at 1/scale, rounded up like the IDCT output
+    static uint32_t ScaledSize(uint32_t size, uint32_t scale) { return (size + scale - 1) / scale; }
+
+    // Opaque 32bpp BGRA at 1/scale (1, 2, 4 or 8). Truncated data decodes as far as it goes.
+    bool Decode(uint32_t scale, uint8_t* dst, size_t dstStride);
+
+private:
+    static constexpr uint32_t FastBits = 10;
+
+    struct Huffman {
+        uint16_t fast[1 << FastBits] = {};      // Lookahead: code length << 8 | symbol, 0 when longer
+        int32_t fastAc[1 << FastBits] = {};     // Code and magnitude bits together when both fit: value << 16 | run << 8 | length
+        int32_t maxCode[18] = {};     // Largest code of each length, left aligned to 16 bits
+        int32_t delta[17] = {};       // Symbol index minus code for each length
+        uint8_t symbols[256] = {};
+        bool present = false;
+    };
+
+    struct Component {
+        uint8_t id = 0;
+        uint32_t h = 1;
+        uint32_t v = 1;
+        uint32_t quantTable = 0;
+        uint32_t dcTable = 0;
+        uint32_t acTable = 0;
+        uint32_t blocksW = 0;         // Padded to whole MCUs
+        uint32_t blocksH = 0;
+        uint32_t dataBlocksW = 0;     // Blocks that hold image data, used by single-component scans
+        uint32_t dataBlocksH = 0;
+        uint32_t blockOut = 8;        // Output samples per block edge at the current scale
+        uint32_t maxZigzag = 63;      // Coefficients past this do not reach the scaled IDCT
+        uint32_t coefStride = 64;     // Coefficients kept per progressive block, up to maxZigzag
+        uint32_t scanReach = 63;      // Progressive: highest coefficient a decoded scan touches, later bands are skipped
+
+        // Progressive only: quantized coefficients in zigzag order, and per block a mask of every
+        // nonzero position including the ones not kept, which refinement scans need to stay in sync
+        std::vector<int16_t> coefs;
+        std::vector<uint64_t> nonzero;
+        std::vector<uint8_t> plane;
+        size_t planeStride = 0;
+    };
+
+    // Entropy state that restarts at every RSTn, so restart intervals decode independently
+    struct IntervalState {
+        int32_t dcPred[4] = {};       // By component index
+        uint32_t eobRun = 0;
+    };
+
+    class BitReader;
+
+    static bool BuildHuffman(Huffman& table, const uint8_t* counts, const uint8_t* symbols, uint32_t total);
+    bool ParseTables(uint8_t marker, const uint8_t* segment, size_t length);
+    void PlanProgressiveScans();
+    bool DecodeScan(const uint8_t* segment, size_t length, size_t& pos);
+    void DecodeBlockBaseline(BitReader& bits, IntervalState& state, uint32_t c, int32_t* coefs) const;
+    void DecodeBlockProgressive(BitReader& bits, IntervalState& state, uint32_t c, uint32_t bx, uint32_t by);
+    void OutputBlock(Component& comp, const int32_t* coefs, uint32_t bx, uint32_t by) const;
+    void FinishProgressive();
+    void ConvertToBgra(uint8_t* dst, size_t dstStride) const;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_framePos = 0;            // First marker after the frame header
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    bool m_progressive = false;
+    int m_adobeTransform = -1;        // APP14 color transform, -1 without the marker
+    uint32_t m_restartInterval = 0;
+    uint32_t m_maxH = 1;
+    uint32_t m_maxV = 1;
+    uint32_t m_mcusX = 0;
+    uint32_t m_mcusY = 0;
+    std::vector<Component> m_components;
+    uint16_t m_quant[4][64] = {};     // Natural order
+    Huffman m_dcTables[4];
+    Huffman m_acTables[4];
+
+    // Per decode
+    uint32_t m_scale = 1;
+    uint32_t m_scanComps[4] = {};
+    uint32_t m_scanCount = 0;
+    uint32_t m_spectralStart = 0;
+    uint32_t m_spectralEnd = 63;
+    uint32_t m_approxHigh = 0;
+    uint32_t m_approxLow = 0;
+};
+
+// Largest IDCT reduction that keeps the decode at least targetWidth x targetHeight
+uint32_t ChooseJpegScale(uint32_t width, uint32_t height, uint32_t targetWidth, uint32_t targetHeight);
@@ -211,6 +211,7 @@ int ViewerApp::Run(HINSTANCE hInstance, int nCmdShow, LPWSTR lpCmdLine) {
     m_ctx.d2dBitmap = nullptr;
     m_ctx.animationFrameMetadata.clear();
     m_ctx.animationFrameDelays.clear();
+    m_ctx.animationPrefetcher.Stop();
     m_ctx.textBrush = nullptr;
     m_ctx.textFormat = nullptr;
     m_ctx.renderTarget = nullptr;
@@ -0,0 +1,173 @@
+#include "mip_pyramid.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+    void HalveScalar(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth, uint8_t* dst, uint32_t firstDst) {
+        const uint32_t dstWidth = (srcWidth + 1) / 2;
+        for (uint32_t x = firstDst; x < dstWidth; ++x) {
+            const uint32_t x0 = x * 2;
+            const uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                const uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+                dst[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+            }
+        }
+    }
+
+#if SIMD_X86
+    // 4 source pixels of both rows widened and summed into [p0+p1, p2+p3] per channel
+    inline __m128i SumQuadSse2(__m128i a, __m128i b) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    }
+
+    uint32_t HalveSse2(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth, uint8_t* dst) {
+        const __m128i two = _mm_set1_epi16(2);
+        uint32_t x = 0;
+        for (; x + 8 <= srcWidth; x += 8) {
+            const __m128i s0 = SumQuadSse2(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 4)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 4)));
+            const __m128i s1 = SumQuadSse2(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 4 + 16)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 4 + 16)));
+            const __m128i r0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+            const __m128i r1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2), _mm_packus_epi16(r0, r1));
+        }
+        return x / 2;
+    }
+
+    SIMD_TARGET_AVX2 inline __m256i SumQuadAvx2(__m256i a, __m256i b) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+        const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+        return _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+    }
+
+    SIMD_TARGET_AVX2 uint32_t HalveAvx2(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth, uint8_t* dst) {
+        const __m256i two = _mm256_set1_epi16(2);
+        uint32_t x = 0;
+        for (; x + 16 <= srcWidth; x += 16) {
+            const __m256i s0 = SumQuadAvx2(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 4)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 4)));
+            const __m256i s1 = SumQuadAvx2(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 4 + 32)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 4 + 32)));
+            const __m256i r0 = _mm256_srli_epi16(_mm256_add_epi16(s0, two), 2);
+            const __m256i r1 = _mm256_srli_epi16(_mm256_add_epi16(s1, two), 2);
+
+            // Packing works per 128-bit lane, put the four 64-bit groups back in pixel order
+            const __m256i packed = _mm256_packus_epi16(r0, r1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 2), _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+        return x / 2;
+    }
+#endif
+}
+
+void HalveRowsBgra8(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth, uint8_t* dst) {
+    uint32_t done = 0;
+#if SIMD_X86
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if (cpu.avx2) done = HalveAvx2(row0, row1, srcWidth, dst);
+    else if (cpu.sse2) done = HalveSse2(row0, row1, srcWidth, dst);
+#endif
+    HalveScalar(row0, row1, srcWidth, dst, done);
+}
+
+bool MipPyramid::Init(uint32_t width, uint32_t height, uint32_t minEdge) {
+    m_levels.clear();
+    m_rowsDone.clear();
+    m_baseWidth = width;
+    m_baseHeight = height;
+    m_baseRows = 0;
+    m_hasPending = false;
+    if (width == 0 || height == 0) return false;
+
+    uint32_t w = width, h = height;
+    while (std::max(w, h) > std::max(1u, minEdge)) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        MipLevel level;
+        level.width = w;
+        level.height = h;
+        level.pixels.resize(level.Stride() * h);
+        m_levels.push_back(std::move(level));
+    }
+    m_rowsDone.assign(m_levels.size(), 0);
+    m_pendingRow.resize(static_cast<size_t>(width) * 4);
+    return !m_levels.empty();
+}
+
+void MipPyramid::PushRows(const uint8_t* rows, size_t stride, uint32_t count) {
+    if (m_levels.empty()) return;
+    count = std::min(count, m_baseHeight - m_baseRows);
+
+    MipLevel& first = m_levels[0];
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t* row = rows + i * stride;
+        const uint32_t y = m_baseRows++;
+        const bool last = (m_baseRows == m_baseHeight);
+
+        if ((y & 1) == 0 && !last) {
+            // Rows of a pair usually arrive together, only copy when the strip ends between them
+            if (i + 1 < count) {
+                HalveRowsBgra8(row, row + stride, m_baseWidth, first.pixels.data() + (y / 2) * first.Stride());
+                ++i;
+                ++m_baseRows;
+                ++m_rowsDone[0];
+            }
+            else {
+                std::memcpy(m_pendingRow.data(), row, m_pendingRow.size());
+                m_hasPending = true;
+            }
+            continue;
+        }
+
+        const uint8_t* top = ((y & 1) != 0) ? (m_hasPending ? m_pendingRow.data() : row - stride) : row;
+        HalveRowsBgra8(top, row, m_baseWidth, first.pixels.data() + (y / 2) * first.Stride());
+        m_hasPending = false;
+        ++m_rowsDone[0];
+    }
+
+    for (size_t level = 1; level < m_levels.size(); ++level) {
+        ReduceFrom(level);
+    }
+}
+
+void MipPyramid::ReduceFrom(size_t level) {
+    const MipLevel& src = m_levels[level - 1];
+    MipLevel& dst = m_levels[level];
+    const uint32_t srcRows = m_rowsDone[level - 1];
+
+    while (m_rowsDone[level] < dst.height) {
+        const uint32_t y = m_rowsDone[level];
+        const uint32_t y0 = y * 2;
+        const uint32_t y1 = std::min(y0 + 1, src.height - 1);
+        if (y1 >= srcRows) break;
+        HalveRowsBgra8(src.Row(y0), src.Row(y1), src.width, dst.pixels.data() + y * dst.Stride());
+        ++m_rowsDone[level];
+    }
+}
+
+size_t MipPyramid::MemoryBytes() const {
+    size_t bytes = m_pendingRow.capacity();
+    for (const MipLevel& level : m_levels) {
+        bytes += level.pixels.capacity();
+    }
+    return bytes;
+}
+
+int SelectMipLevel(float scale, size_t levelCount) {
+    if (!(scale > 0.0f) || scale > 0.5f || levelCount == 0) return -1;
+    const int level = static_cast<int>(std::floor(std::log2(1.0f / scale))) - 1;
+    return std::clamp(level, -1, static_cast<int>(levelCount) - 1);
+}
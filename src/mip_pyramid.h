@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Chain of 2x box-reduced copies of a 32bpp premultiplied image for drawing at small zoom factors.
+// Base rows are pushed top to bottom in strips of any size and every level is filled as soon as
+// the rows it depends on exist, so the source never has to be resident in full.
+// Odd edges average the last row or column with itself, each level is ceil(size / 2).
+
+struct MipLevel {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;   // Tightly packed, width * 4 bytes per row
+
+    size_t Stride() const { return static_cast<size_t>(width) * 4; }
+    const uint8_t* Row(uint32_t y) const { return pixels.data() + y * Stride(); }
+};
+
+class MipPyramid {
+public:
+    // Reduces until the longest edge is at most minEdge. False if the image is already that small.
+    bool Init(uint32_t width, uint32_t height, uint32_t minEdge = 32);
+
+    void PushRows(const uint8_t* rows, size_t stride, uint32_t count);
+    bool IsComplete() const { return m_baseRows == m_baseHeight && m_baseHeight != 0; }
+
+    // Level 0 is the first reduction (half size), the base image itself is not stored
+    size_t LevelCount() const { return m_levels.size(); }
+    const MipLevel& Level(size_t index) const { return m_levels[index]; }
+
+    uint32_t BaseWidth() const { return m_baseWidth; }
+    uint32_t BaseHeight() const { return m_baseHeight; }
+    size_t MemoryBytes() const;
+
+private:
+    void ReduceFrom(size_t level);
+
+    uint32_t m_baseWidth = 0;
+    uint32_t m_baseHeight = 0;
+    uint32_t m_baseRows = 0;                 // Base rows consumed so far
+    std::vector<uint8_t> m_pendingRow;       // Even base row waiting for its partner across a strip boundary
+    bool m_hasPending = false;
+    std::vector<MipLevel> m_levels;
+    std::vector<uint32_t> m_rowsDone;        // Rows written per level
+};
+
+// Halves two rows into one: dst[x] = round(mean of the 2x2 block), odd widths clamp the last column
+void HalveRowsBgra8(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth, uint8_t* dst);
+
+// Pyramid index to draw for a screen-pixels-per-base-pixel scale: -1 for the base image, otherwise
+// the smallest reduction that is still at least as large as the drawn size
+int SelectMipLevel(float scale, size_t levelCount);
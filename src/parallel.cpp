@@ -0,0 +1,126 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+    class WorkerPool {
+    public:
+        explicit WorkerPool(uint32_t workers) {
+            for (uint32_t i = 0; i < workers; ++i) {
+                std::thread(&WorkerPool::WorkerLoop, this).detach();
+            }
+            m_workers = workers;
+        }
+
+        uint32_t Workers() const { return m_workers; }
+
+        // Runs task(0..count-1) on the workers and the caller. False if the pool is already running a job.
+        bool TryRun(uint32_t count, const std::function<void(uint32_t)>& task) {
+            std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+            if (!runLock.owns_lock()) return false;
+
+            Job job;
+            job.task = &task;
+            job.count = count;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_job = &job;
+                ++m_generation;
+            }
+            m_wake.notify_all();
+
+            Drain(job);
+
+            // Workers register under the lock, so once none are active the job can be retired safely
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [&] { return job.active == 0; });
+            m_job = nullptr;
+            return true;
+        }
+
+    private:
+        struct Job {
+            const std::function<void(uint32_t)>* task = nullptr;
+            uint32_t count = 0;
+            std::atomic<uint32_t> next{ 0 };
+            uint32_t active = 0;   // Guarded by m_mutex
+        };
+
+        static void Drain(Job& job) {
+            for (;;) {
+                const uint32_t i = job.next.fetch_add(1);
+                if (i >= job.count) break;
+                (*job.task)(i);
+            }
+        }
+
+        void WorkerLoop() {
+            uint64_t seen = 0;
+            for (;;) {
+                Job* job = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [&] { return m_job && m_generation != seen; });
+                    seen = m_generation;
+                    job = m_job;
+                    ++job->active;
+                }
+
+                Drain(*job);
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --job->active;
+                }
+                m_done.notify_all();
+            }
+        }
+
+        std::mutex m_runMutex;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        Job* m_job = nullptr;
+        uint64_t m_generation = 0;
+        uint32_t m_workers = 0;
+    };
+
+    WorkerPool& Pool() {
+        // Never destroyed, detached workers may still be parked in wait() at process exit
+        static WorkerPool* pool = new WorkerPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return *pool;
+    }
+}
+
+uint32_t ParallelThreadCount() {
+    return Pool().Workers() + 1;
+}
+
+void ParallelFor(uint32_t count, uint32_t minPerTask, const std::function<void(uint32_t begin, uint32_t end)>& body) {
+    if (count == 0) return;
+
+    WorkerPool& pool = Pool();
+    const uint32_t grain = std::max(1u, minPerTask);
+    const uint32_t maxTasks = (count + grain - 1) / grain;
+
+    // A few tasks per thread evens out rows that cost more than others
+    const uint32_t tasks = std::min(maxTasks, (pool.Workers() + 1) * 4);
+    if (tasks <= 1 || pool.Workers() == 0) {
+        body(0, count);
+        return;
+    }
+
+    auto runTask = [&](uint32_t i) {
+        const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / tasks);
+        const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / tasks);
+        if (begin < end) body(begin, end);
+        };
+
+    if (!pool.TryRun(tasks, runTask)) {
+        body(0, count);
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// Persistent worker pool for data-parallel loops over image rows.
+// Workers are started on first use and live for the rest of the process.
+
+uint32_t ParallelThreadCount();
+
+// Splits [0, count) into contiguous ranges of at least minPerTask items and runs body(begin, end)
+// on the pool, with the calling thread taking a share. Returns once every range has finished.
+// Calls made while the pool is busy (another thread, or nested inside body) run inline instead.
+void ParallelFor(uint32_t count, uint32_t minPerTask, const std::function<void(uint32_t begin, uint32_t end)>& body);
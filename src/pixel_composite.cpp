@@ -0,0 +1,196 @@
+#include "pixel_composite.h"
+#include "cpu_features.h"
+#include <cstring>
+
+namespace {
+
+    void BlendScalar(uint8_t* dst, const uint8_t* src, uint32_t width, uint32_t first) {
+        for (uint32_t x = first; x < width; ++x) {
+            const uint8_t* s = src + x * 4;
+            uint8_t* d = dst + x * 4;
+            const uint32_t alpha = s[3];
+            if (alpha == 255) {
+                std::memcpy(d, s, 4);
+            }
+            else if (alpha > 0) {
+                const uint32_t inv = 255 - alpha;
+                d[0] = static_cast<uint8_t>(s[0] + (d[0] * inv) / 255);
+                d[1] = static_cast<uint8_t>(s[1] + (d[1] * inv) / 255);
+                d[2] = static_cast<uint8_t>(s[2] + (d[2] * inv) / 255);
+                d[3] = static_cast<uint8_t>(alpha + (d[3] * inv) / 255);
+            }
+        }
+    }
+
+    void PaletteScalar(uint8_t* dst, const uint8_t* indices, const uint32_t* palette, uint32_t width, uint32_t first) {
+        for (uint32_t x = first; x < width; ++x) {
+            const uint32_t color = palette[indices[x]];
+            if (color) std::memcpy(dst + x * 4, &color, 4);
+        }
+    }
+
+#if SIMD_X86
+    // floor(x / 255) for any 16-bit x is (x * 0x8081) >> 23
+    inline __m128i Div255Sse2(__m128i x) {
+        return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16(static_cast<short>(0x8081))), 7);
+    }
+
+    uint32_t BlendSse2(uint8_t* dst, const uint8_t* src, uint32_t width) {
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            const __m128i alpha = _mm_and_si128(s, alphaMask);
+            const int opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask));
+            if (opaque == 0xFFFF) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), s);
+                continue;
+            }
+            const __m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+            if (_mm_movemask_epi8(transparent) == 0xFFFF) continue;
+
+            // Inverse alpha spread to all four bytes of its pixel
+            __m128i inv = _mm_srli_epi32(_mm_xor_si128(alpha, alphaMask), 24);
+            inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 8));
+            inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 16));
+
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x * 4));
+            const __m128i lo = Div255Sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero)));
+            const __m128i hi = Div255Sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero)));
+            const __m128i blended = _mm_add_epi8(s, _mm_packus_epi16(lo, hi));
+            const __m128i result = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, blended));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), result);
+        }
+        return x;
+    }
+
+    SIMD_TARGET_AVX2 inline __m256i Div255Avx2(__m256i x) {
+        return _mm256_srli_epi16(_mm256_mulhi_epu16(x, _mm256_set1_epi16(static_cast<short>(0x8081))), 7);
+    }
+
+    SIMD_TARGET_AVX2 uint32_t BlendAvx2(uint8_t* dst, const uint8_t* src, uint32_t width) {
+        const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaOrder = _mm256_setr_epi8(
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+            const __m256i alpha = _mm256_and_si256(s, alphaMask);
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), s);
+                continue;
+            }
+            const __m256i transparent = _mm256_cmpeq_epi32(alpha, zero);
+            if (_mm256_movemask_epi8(transparent) == -1) continue;
+
+            const __m256i inv = _mm256_shuffle_epi8(_mm256_xor_si256(s, alphaMask), alphaOrder);
+            const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x * 4));
+
+            // Unpack and pack are both lane-local, so pixel order survives the round trip
+            const __m256i lo = Div255Avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(inv, zero)));
+            const __m256i hi = Div255Avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(inv, zero)));
+            const __m256i blended = _mm256_add_epi8(s, _mm256_packus_epi16(lo, hi));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_blendv_epi8(blended, d, transparent));
+        }
+        return x;
+    }
+
+    // Eight lookups per gather, transparent entries are zero and keep the pixel underneath
+    SIMD_TARGET_AVX2 uint32_t PaletteAvx2(uint8_t* dst, const uint8_t* indices, const uint32_t* palette, uint32_t width) {
+        const __m256i zero = _mm256_setzero_si256();
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + x)));
+            const __m256i color = _mm256_i32gather_epi32(reinterpret_cast<const int*>(palette), index, 4);
+            const __m256i transparent = _mm256_cmpeq_epi32(color, zero);
+            const int mask = _mm256_movemask_epi8(transparent);
+            if (mask == -1) continue;
+            __m256i* out = reinterpret_cast<__m256i*>(dst + x * 4);
+            if (mask == 0) {
+                _mm256_storeu_si256(out, color);
+                continue;
+            }
+            _mm256_storeu_si256(out, _mm256_blendv_epi8(color, _mm256_loadu_si256(out), transparent));
+        }
+        return x;
+    }
+
+    uint32_t FillSse2(uint8_t* dst, uint32_t bgra, uint32_t width) {
+        const __m128i value = _mm_set1_epi32(static_cast<int>(bgra));
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), value);
+        }
+        return x;
+    }
+#endif
+}
+
+void BlendRowSourceOver(uint8_t* dst, const uint8_t* src, uint32_t width) {
+    uint32_t done = 0;
+#if SIMD_X86
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if (cpu.avx2) done = BlendAvx2(dst, src, width);
+    else if (cpu.sse2) done = BlendSse2(dst, src, width);
+#endif
+    BlendScalar(dst, src, width, done);
+}
+
+void BlendRowSourceOverScalar(uint8_t* dst, const uint8_t* src, uint32_t width) {
+    BlendScalar(dst, src, width, 0);
+}
+
+// No SSE2 body, without a gather the lookups cost the same as the scalar loop
+void BlendRowPalette(uint8_t* dst, const uint8_t* indices, const uint32_t palette[256], uint32_t width) {
+    uint32_t done = 0;
+#if SIMD_X86
+    if (GetCpuFeatures().avx2) done = PaletteAvx2(dst, indices, palette, width);
+#endif
+    PaletteScalar(dst, indices, palette, width, done);
+}
+
+void BlendRowPaletteScalar(uint8_t* dst, const uint8_t* indices, const uint32_t palette[256], uint32_t width) {
+    PaletteScalar(dst, indices, palette, width, 0);
+}
+
+void FillRow(uint8_t* dst, uint32_t bgra, uint32_t width) {
+    uint32_t x = 0;
+#if SIMD_X86
+    if (GetCpuFeatures().sse2) x = FillSse2(dst, bgra, width);
+#endif
+    for (; x < width; ++x) std::memcpy(dst + x * 4, &bgra, 4);
+}
+
+void BlendRect(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, uint32_t width, uint32_t height) {
+    for (uint32_t y = 0; y < height; ++y) {
+        BlendRowSourceOver(dst + y * dstStride, src + y * srcStride, width);
+    }
+}
+
+void BlendRectPalette(uint8_t* dst, size_t dstStride, const uint8_t* indices, size_t indexStride, const uint32_t palette[256], uint32_t width, uint32_t height) {
+    for (uint32_t y = 0; y < height; ++y) {
+        BlendRowPalette(dst + y * dstStride, indices + y * indexStride, palette, width);
+    }
+}
+
+void FillRect(uint8_t* dst, size_t stride, uint32_t width, uint32_t height, uint32_t bgra) {
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* row = dst + y * stride;
+        if (bgra == 0) std::memset(row, 0, static_cast<size_t>(width) * 4);
+        else FillRow(row, bgra, width);
+    }
+}
+
+void CopyRect(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, uint32_t width, uint32_t height) {
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    if (dstStride == rowBytes && srcStride == rowBytes) {
+        std::memcpy(dst, src, rowBytes * height);
+        return;
+    }
+    for (uint32_t y = 0; y < height; ++y) {
+        std::memcpy(dst + y * dstStride, src + y * srcStride, rowBytes);
+    }
+}
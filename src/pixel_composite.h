@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Compositing kernels for 32bpp premultiplied BGRA canvases, with SSE2/AVX2 bodies picked at
+// runtime. Source-over keeps the animation compositor's rounding exactly:
+//   dst = src + floor(dst * (255 - srcAlpha) / 255), per channel and wrapping like a byte add
+// and a fully transparent source pixel leaves dst as it is. Blocks whose source is all opaque or
+// all transparent skip the arithmetic.
+
+void BlendRowSourceOver(uint8_t* dst, const uint8_t* src, uint32_t width);
+
+// Same without SIMD, the reference the vector paths must match exactly
+void BlendRowSourceOverScalar(uint8_t* dst, const uint8_t* src, uint32_t width);
+
+void FillRow(uint8_t* dst, uint32_t bgra, uint32_t width);
+
+// Source-over of palette indices whose entries are opaque BGRA or zero, so each pixel is either
+// replaced by its entry or left alone
+void BlendRowPalette(uint8_t* dst, const uint8_t* indices, const uint32_t palette[256], uint32_t width);
+void BlendRowPaletteScalar(uint8_t* dst, const uint8_t* indices, const uint32_t palette[256], uint32_t width);
+
+void BlendRect(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, uint32_t width, uint32_t height);
+void BlendRectPalette(uint8_t* dst, size_t dstStride, const uint8_t* indices, size_t indexStride, const uint32_t palette[256], uint32_t width, uint32_t height);
+void FillRect(uint8_t* dst, size_t stride, uint32_t width, uint32_t height, uint32_t bgra);
+void CopyRect(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, uint32_t width, uint32_t height);
@@ -0,0 +1,407 @@
+#include "pixel_convert.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    // Exact round(c * a / 255) for 8-bit inputs
+    inline uint32_t MulDiv255(uint32_t c, uint32_t a) {
+        uint32_t t = c * a + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    inline uint32_t To8(uint16_t v) {
+        return (static_cast<uint32_t>(v) + 128) / 257;
+    }
+
+    inline uint32_t To8(float v) {
+        // NaN fails both comparisons and lands on zero
+        if (!(v > 0.0f)) return 0;
+        if (v >= 1.0f) return 255;
+        return static_cast<uint32_t>(v * 255.0f + 0.5f);
+    }
+
+    template <PixelSource S> struct SourceTraits;
+
+    template <> struct SourceTraits<PixelSource::Gray8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 1;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = g = b = s[0]; a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::GrayA8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 2;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = g = b = s[0]; a = s[1]; }
+    };
+    template <> struct SourceTraits<PixelSource::RGB8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 3;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = s[0]; g = s[1]; b = s[2]; a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::BGR8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 3;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { b = s[0]; g = s[1]; r = s[2]; a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::RGBA8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 4;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = s[0]; g = s[1]; b = s[2]; a = s[3]; }
+    };
+    template <> struct SourceTraits<PixelSource::BGRA8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 4;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { b = s[0]; g = s[1]; r = s[2]; a = s[3]; }
+    };
+    template <> struct SourceTraits<PixelSource::BGRX8> {
+        using Sample = uint8_t;
+        static constexpr int Channels = 4;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { b = s[0]; g = s[1]; r = s[2]; a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::Gray16> {
+        using Sample = uint16_t;
+        static constexpr int Channels = 1;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = g = b = To8(s[0]); a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::GrayA16> {
+        using Sample = uint16_t;
+        static constexpr int Channels = 2;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = g = b = To8(s[0]); a = To8(s[1]); }
+    };
+    template <> struct SourceTraits<PixelSource::RGB16> {
+        using Sample = uint16_t;
+        static constexpr int Channels = 3;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = To8(s[0]); g = To8(s[1]); b = To8(s[2]); a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::RGBA16> {
+        using Sample = uint16_t;
+        static constexpr int Channels = 4;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = To8(s[0]); g = To8(s[1]); b = To8(s[2]); a = To8(s[3]); }
+    };
+    template <> struct SourceTraits<PixelSource::RGBFloat> {
+        using Sample = float;
+        static constexpr int Channels = 3;
+        static constexpr bool HasAlpha = false;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = To8(s[0]); g = To8(s[1]); b = To8(s[2]); a = 255; }
+    };
+    template <> struct SourceTraits<PixelSource::RGBAFloat> {
+        using Sample = float;
+        static constexpr int Channels = 4;
+        static constexpr bool HasAlpha = true;
+        static void Load(const Sample* s, uint32_t& r, uint32_t& g, uint32_t& b, uint32_t& a) { r = To8(s[0]); g = To8(s[1]); b = To8(s[2]); a = To8(s[3]); }
+    };
+
+    template <PixelSource S, bool Premultiply>
+    void ConvertRowScalar(const void* srcRow, uint8_t* dst, uint32_t width) {
+        using Traits = SourceTraits<S>;
+        const auto* src = static_cast<const typename Traits::Sample*>(srcRow);
+        for (uint32_t x = 0; x < width; ++x, src += Traits::Channels, dst += 4) {
+            uint32_t r, g, b, a;
+            Traits::Load(src, r, g, b, a);
+            if constexpr (Premultiply && Traits::HasAlpha) {
+                r = MulDiv255(r, a);
+                g = MulDiv255(g, a);
+                b = MulDiv255(b, a);
+            }
+            dst[0] = static_cast<uint8_t>(b);
+            dst[1] = static_cast<uint8_t>(g);
+            dst[2] = static_cast<uint8_t>(r);
+            dst[3] = static_cast<uint8_t>(a);
+        }
+    }
+
+#if SIMD_X86
+    // 4-channel 8-bit sources. SwapRB turns RGBA into BGRA, Premultiply scales colour by alpha.
+
+    inline __m128i SwapRedBlue(__m128i v) {
+        const __m128i agMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+        __m128i ag = _mm_and_si128(v, agMask);
+        __m128i rb = _mm_andnot_si128(agMask, v);
+        return _mm_or_si128(ag, _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16)));
+    }
+
+    // Two pixels widened to 16-bit lanes, alpha lane keeps its value via a 255 multiplier
+    inline __m128i PremultiplyWide(__m128i px) {
+        const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        const __m128i bias = _mm_set1_epi16(128);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm_or_si128(alpha, alphaOne);
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(px, alpha), bias);
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    template <bool SwapRB, bool Premultiply>
+    void ConvertRow4x8Sse2(const void* srcRow, uint8_t* dst, uint32_t width) {
+        const uint8_t* src = static_cast<const uint8_t*>(srcRow);
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            if constexpr (SwapRB) v = SwapRedBlue(v);
+            if constexpr (Premultiply) {
+                __m128i lo = PremultiplyWide(_mm_unpacklo_epi8(v, zero));
+                __m128i hi = PremultiplyWide(_mm_unpackhi_epi8(v, zero));
+                v = _mm_packus_epi16(lo, hi);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), v);
+        }
+        if (x < width) {
+            constexpr PixelSource tail = SwapRB ? PixelSource::RGBA8 : PixelSource::BGRA8;
+            ConvertRowScalar<tail, Premultiply>(src + x * 4, dst + x * 4, width - x);
+        }
+    }
+
+    SIMD_TARGET_AVX2 inline __m256i SwapRedBlueAvx2(__m256i v) {
+        const __m256i order = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        return _mm256_shuffle_epi8(v, order);
+    }
+
+    SIMD_TARGET_AVX2 inline __m256i PremultiplyWideAvx2(__m256i px) {
+        const __m256i alphaOrder = _mm256_setr_epi8(
+            6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+            6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+        const __m256i alphaOne = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+        const __m256i bias = _mm256_set1_epi16(128);
+        __m256i alpha = _mm256_or_si256(_mm256_shuffle_epi8(px, alphaOrder), alphaOne);
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), bias);
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    template <bool SwapRB, bool Premultiply>
+    SIMD_TARGET_AVX2 void ConvertRow4x8Avx2(const void* srcRow, uint8_t* dst, uint32_t width) {
+        const uint8_t* src = static_cast<const uint8_t*>(srcRow);
+        const __m256i zero = _mm256_setzero_si256();
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+            if constexpr (SwapRB) v = SwapRedBlueAvx2(v);
+            if constexpr (Premultiply) {
+                // Unpack and pack are both lane-local, so pixel order survives the round trip
+                __m256i lo = PremultiplyWideAvx2(_mm256_unpacklo_epi8(v, zero));
+                __m256i hi = PremultiplyWideAvx2(_mm256_unpackhi_epi8(v, zero));
+                v = _mm256_packus_epi16(lo, hi);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), v);
+        }
+        if (x < width) {
+            ConvertRow4x8Sse2<SwapRB, Premultiply>(src + x * 4, dst + x * 4, width - x);
+        }
+    }
+
+    // 3-channel 8-bit sources, four pixels per 16-byte shuffle
+    template <bool SwapRB>
+    SIMD_TARGET_SSSE3 void ConvertRow3x8Ssse3(const void* srcRow, uint8_t* dst, uint32_t width) {
+        const uint8_t* src = static_cast<const uint8_t*>(srcRow);
+        const __m128i order = SwapRB ?
+            _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+            _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        uint32_t x = 0;
+
+        // Each load reads 16 bytes but consumes 12, stop while a full load still fits
+        for (; x + 6 <= width; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+            v = _mm_or_si128(_mm_shuffle_epi8(v, order), opaque);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), v);
+        }
+        if (x < width) {
+            constexpr PixelSource tail = SwapRB ? PixelSource::RGB8 : PixelSource::BGR8;
+            ConvertRowScalar<tail, false>(src + x * 3, dst + x * 4, width - x);
+        }
+    }
+
+    void ConvertRowGray8Sse2(const void* srcRow, uint8_t* dst, uint32_t width) {
+        const uint8_t* src = static_cast<const uint8_t*>(srcRow);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            __m128i gg0 = _mm_unpacklo_epi8(g, g);
+            __m128i gg1 = _mm_unpackhi_epi8(g, g);
+            __m128i* out = reinterpret_cast<__m128i*>(dst + x * 4);
+            _mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(gg0, gg0), opaque));
+            _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(gg0, gg0), opaque));
+            _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(gg1, gg1), opaque));
+            _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(gg1, gg1), opaque));
+        }
+        if (x < width) {
+            ConvertRowScalar<PixelSource::Gray8, false>(src + x, dst + x * 4, width - x);
+        }
+    }
+
+    void ConvertRowBgrx8Sse2(const void* srcRow, uint8_t* dst, uint32_t width) {
+        const uint8_t* src = static_cast<const uint8_t*>(srcRow);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(v, opaque));
+        }
+        if (x < width) {
+            ConvertRowScalar<PixelSource::BGRX8, false>(src + x * 4, dst + x * 4, width - x);
+        }
+    }
+
+    // Exact (v + 128) / 257 on eight samples, widened to 32-bit lanes so the bias cannot wrap
+    inline __m128i Narrow16To8(__m128i v) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi32(128);
+        __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(v, zero), bias);
+        __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(v, zero), bias);
+        lo = _mm_srli_epi32(_mm_sub_epi32(lo, _mm_srli_epi32(lo, 8)), 8);
+        hi = _mm_srli_epi32(_mm_sub_epi32(hi, _mm_srli_epi32(hi, 8)), 8);
+        return _mm_packs_epi32(lo, hi);
+    }
+
+    void NarrowRow16Sse2(const uint16_t* src, uint8_t* dst, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i a = Narrow16To8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            __m128i b = Narrow16To8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+        }
+        for (; i < count; ++i) {
+            dst[i] = static_cast<uint8_t>(To8(src[i]));
+        }
+    }
+
+    // 16-bit sources are narrowed a chunk at a time, then finished by the matching 8-bit kernel.
+    // The scalar path also narrows before premultiplying, so both produce identical output.
+    template <PixelSource Narrow, int Channels, bool Premultiply>
+    void ConvertRow16Sse2(const void* srcRow, uint8_t* dst, uint32_t width) {
+        constexpr uint32_t ChunkPixels = 256;
+        static const PixelRowConverter finish = GetPixelRowConverter(Narrow, Premultiply);
+        alignas(16) uint8_t narrowed[ChunkPixels * Channels];
+        const uint16_t* src = static_cast<const uint16_t*>(srcRow);
+        for (uint32_t x = 0; x < width; x += ChunkPixels) {
+            const uint32_t n = std::min(ChunkPixels, width - x);
+            NarrowRow16Sse2(src + static_cast<size_t>(x) * Channels, narrowed, static_cast<size_t>(n) * Channels);
+            finish(narrowed, dst + static_cast<size_t>(x) * 4, n);
+        }
+    }
+#endif
+
+    void CopyRowBgra8(const void* src, uint8_t* dst, uint32_t width) {
+        std::memcpy(dst, src, static_cast<size_t>(width) * 4);
+    }
+
+    template <PixelSource S>
+    PixelRowConverter ScalarFor(bool premultiply) {
+        return premultiply ? &ConvertRowScalar<S, true> : &ConvertRowScalar<S, false>;
+    }
+}
+
+size_t PixelSourceBytesPerPixel(PixelSource source) {
+    switch (source) {
+    case PixelSource::Gray8:     return 1;
+    case PixelSource::GrayA8:    return 2;
+    case PixelSource::RGB8:
+    case PixelSource::BGR8:      return 3;
+    case PixelSource::RGBA8:
+    case PixelSource::BGRA8:
+    case PixelSource::BGRX8:     return 4;
+    case PixelSource::Gray16:    return 2;
+    case PixelSource::GrayA16:   return 4;
+    case PixelSource::RGB16:     return 6;
+    case PixelSource::RGBA16:    return 8;
+    case PixelSource::RGBFloat:  return 12;
+    case PixelSource::RGBAFloat: return 16;
+    }
+    return 0;
+}
+
+PixelRowConverter GetScalarPixelRowConverter(PixelSource source, bool premultiply) {
+    switch (source) {
+    case PixelSource::Gray8:     return ScalarFor<PixelSource::Gray8>(premultiply);
+    case PixelSource::GrayA8:    return ScalarFor<PixelSource::GrayA8>(premultiply);
+    case PixelSource::RGB8:      return ScalarFor<PixelSource::RGB8>(premultiply);
+    case PixelSource::BGR8:      return ScalarFor<PixelSource::BGR8>(premultiply);
+    case PixelSource::RGBA8:     return ScalarFor<PixelSource::RGBA8>(premultiply);
+    case PixelSource::BGRA8:     return ScalarFor<PixelSource::BGRA8>(premultiply);
+    case PixelSource::BGRX8:     return ScalarFor<PixelSource::BGRX8>(premultiply);
+    case PixelSource::Gray16:    return ScalarFor<PixelSource::Gray16>(premultiply);
+    case PixelSource::GrayA16:   return ScalarFor<PixelSource::GrayA16>(premultiply);
+    case PixelSource::RGB16:     return ScalarFor<PixelSource::RGB16>(premultiply);
+    case PixelSource::RGBA16:    return ScalarFor<PixelSource::RGBA16>(premultiply);
+    case PixelSource::RGBFloat:  return ScalarFor<PixelSource::RGBFloat>(premultiply);
+    case PixelSource::RGBAFloat: return ScalarFor<PixelSource::RGBAFloat>(premultiply);
+    }
+    return nullptr;
+}
+
+PixelRowConverter GetPixelRowConverter(PixelSource source, bool premultiply) {
+#if SIMD_X86
+    const CpuFeatures& cpu = GetCpuFeatures();
+    switch (source) {
+    case PixelSource::RGBA8:
+        if (cpu.avx2) return premultiply ? &ConvertRow4x8Avx2<true, true> : &ConvertRow4x8Avx2<true, false>;
+        if (cpu.sse2) return premultiply ? &ConvertRow4x8Sse2<true, true> : &ConvertRow4x8Sse2<true, false>;
+        break;
+    case PixelSource::BGRA8:
+        if (!premultiply) return &CopyRowBgra8;
+        if (cpu.avx2) return &ConvertRow4x8Avx2<false, true>;
+        if (cpu.sse2) return &ConvertRow4x8Sse2<false, true>;
+        break;
+    case PixelSource::BGRX8:
+        if (cpu.sse2) return &ConvertRowBgrx8Sse2;
+        break;
+    case PixelSource::RGB8:
+        if (cpu.ssse3) return &ConvertRow3x8Ssse3<true>;
+        break;
+    case PixelSource::BGR8:
+        if (cpu.ssse3) return &ConvertRow3x8Ssse3<false>;
+        break;
+    case PixelSource::Gray8:
+        if (cpu.sse2) return &ConvertRowGray8Sse2;
+        break;
+    case PixelSource::Gray16:
+        if (cpu.sse2) return &ConvertRow16Sse2<PixelSource::Gray8, 1, false>;
+        break;
+    case PixelSource::GrayA16:
+        if (cpu.sse2) return premultiply ? &ConvertRow16Sse2<PixelSource::GrayA8, 2, true> : &ConvertRow16Sse2<PixelSource::GrayA8, 2, false>;
+        break;
+    case PixelSource::RGB16:
+        if (cpu.sse2) return &ConvertRow16Sse2<PixelSource::RGB8, 3, false>;
+        break;
+    case PixelSource::RGBA16:
+        if (cpu.sse2) return premultiply ? &ConvertRow16Sse2<PixelSource::RGBA8, 4, true> : &ConvertRow16Sse2<PixelSource::RGBA8, 4, false>;
+        break;
+    default:
+        break;
+    }
+#endif
+    return GetScalarPixelRowConverter(source, premultiply);
+}
+
+void ConvertPixels(
+    PixelSource source,
+    bool premultiply,
+    const void* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    uint32_t width,
+    uint32_t height)
+{
+    PixelRowConverter convert = GetPixelRowConverter(source, premultiply);
+    if (!convert) return;
+
+    const uint8_t* srcRow = static_cast<const uint8_t*>(src);
+    for (uint32_t y = 0; y < height; ++y, srcRow += srcStride, dst += dstStride) {
+        convert(srcRow, dst, width);
+    }
+}
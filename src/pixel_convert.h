@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Row conversion from decoder output layouts to 32bpp BGRA / premultiplied BGRA.
+// Kernels are specialized at compile time per source layout and premultiply mode,
+// with SSE2/SSSE3/AVX2 bodies picked at runtime for the common 8-bit layouts.
+
+enum class PixelSource {
+    Gray8,
+    GrayA8,
+    RGB8,
+    BGR8,
+    RGBA8,
+    BGRA8,
+    BGRX8,      // Fourth byte is padding, written as opaque
+    Gray16,
+    GrayA16,
+    RGB16,
+    RGBA16,
+    RGBFloat,
+    RGBAFloat
+};
+
+using PixelRowConverter = void (*)(const void* src, uint8_t* dst, uint32_t width);
+
+size_t PixelSourceBytesPerPixel(PixelSource source);
+
+// Picks the fastest kernel for this CPU. premultiply selects PBGRA over straight BGRA.
+PixelRowConverter GetPixelRowConverter(PixelSource source, bool premultiply);
+
+// Same kernels without SIMD, the reference the vector paths must match exactly
+PixelRowConverter GetScalarPixelRowConverter(PixelSource source, bool premultiply);
+
+void ConvertPixels(
+    PixelSource source,
+    bool premultiply,
+    const void* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    uint32_t width,
+    uint32_t height);
@@ -0,0 +1,592 @@
+#include "png_decode.h"
+#include "cpu_features.h"
+#include "inflate.h"
+#include "parallel.h"
+#include "pixel_composite.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    constexpr uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    // Filtered data inflated per pipeline step
+    constexpr size_t BandBytes = 1024 * 1024;
+
+    // Adam7 pass origins and steps, index 0 is the whole image
+    constexpr uint8_t PassX[8] = { 0, 0, 4, 0, 2, 0, 1, 0 };
+    constexpr uint8_t PassY[8] = { 0, 0, 0, 4, 0, 2, 0, 1 };
+    constexpr uint8_t PassStepX[8] = { 1, 8, 8, 4, 4, 2, 2, 1 };
+    constexpr uint8_t PassStepY[8] = { 1, 8, 8, 8, 4, 4, 2, 2 };
+
+    // Grid the image is fully decoded on after each pass
+    constexpr uint8_t GridX[8] = { 1, 8, 4, 4, 2, 2, 1, 1 };
+    constexpr uint8_t GridY[8] = { 1, 8, 8, 4, 4, 2, 2, 1 };
+
+    uint32_t ReadBigEndian32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    inline uint8_t Paeth(int a, int b, int c) {
+        const int pa = std::abs(b - c);
+        const int pb = std::abs(a - c);
+        const int pc = std::abs(a + b - 2 * c);
+        if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+        return static_cast<uint8_t>((pb <= pc) ? b : c);
+    }
+
+    void UnfilterScalar(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t stride) {
+        switch (filter) {
+        case 1:
+            for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+            break;
+        case 2:
+            for (size_t i = 0; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+            break;
+        case 3:
+            for (size_t i = 0; i < stride && i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+            for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + ((row[i - stride] + prior[i]) >> 1));
+            break;
+        case 4:
+            for (size_t i = 0; i < stride && i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+            for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - stride], prior[i], prior[i - stride]));
+            break;
+        default:
+            break;
+        }
+    }
+
+#if SIMD_X86
+    // Sub, Avg and Paeth depend on the pixel to the left, so the vector paths hold one 3 or 4 byte
+    // pixel per register and step across the row. Up has no such chain and goes 16 bytes at a time.
+
+    // Three byte pixels are assembled in a register, a 3 byte memcpy goes through the stack and
+    // stalls store forwarding
+    template <size_t Stride>
+    inline __m128i LoadPixel(const uint8_t* p) {
+        uint32_t v;
+        if constexpr (Stride == 4) std::memcpy(&v, p, 4);
+        else v = p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+        return _mm_cvtsi32_si128(static_cast<int>(v));
+    }
+
+    template <size_t Stride>
+    inline void StorePixel(uint8_t* p, __m128i v) {
+        const uint32_t x = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+        if constexpr (Stride == 4) {
+            std::memcpy(p, &x, 4);
+        }
+        else {
+            p[0] = static_cast<uint8_t>(x);
+            p[1] = static_cast<uint8_t>(x >> 8);
+            p[2] = static_cast<uint8_t>(x >> 16);
+        }
+    }
+
+    void UnfilterUpSse2(uint8_t* row, const uint8_t* prior, size_t bytes) {
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(a, b));
+        }
+        for (; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+    }
+
+    template <size_t Stride>
+    void UnfilterSse2(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes) {
+        const size_t count = bytes / Stride;
+        const __m128i zero = _mm_setzero_si128();
+        switch (filter) {
+        case 1: {
+            __m128i a = zero;
+            for (size_t i = 0; i < count; ++i, row += Stride) {
+                a = _mm_add_epi8(a, LoadPixel<Stride>(row));
+                StorePixel<Stride>(row, a);
+            }
+            break;
+        }
+        case 3: {
+            // avg_epu8 rounds up, the filter rounds down
+            const __m128i one = _mm_set1_epi8(1);
+            __m128i a = zero;
+            for (size_t i = 0; i < count; ++i, row += Stride, prior += Stride) {
+                const __m128i b = LoadPixel<Stride>(prior);
+                const __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+                a = _mm_add_epi8(average, LoadPixel<Stride>(row));
+                StorePixel<Stride>(row, a);
+            }
+            break;
+        }
+        case 4: {
+            // Predictor distances in 16-bit lanes, ties go to a, then b, then c
+            __m128i a = zero;
+            __m128i c = zero;
+            for (size_t i = 0; i < count; ++i, row += Stride, prior += Stride) {
+                const __m128i b = _mm_unpacklo_epi8(LoadPixel<Stride>(prior), zero);
+                const __m128i x = _mm_unpacklo_epi8(LoadPixel<Stride>(row), zero);
+                __m128i pa = _mm_sub_epi16(b, c);
+                __m128i pb = _mm_sub_epi16(a, c);
+                __m128i pc = _mm_add_epi16(pa, pb);
+                pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+                const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                const __m128i useA = _mm_cmpeq_epi16(smallest, pa);
+                const __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(smallest, pb));
+                const __m128i nearest = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)),
+                    _mm_andnot_si128(_mm_or_si128(useA, useB), c));
+
+                // Byte adds wrap each sample modulo 256 and leave the zero high bytes alone
+                a = _mm_add_epi8(x, nearest);
+                StorePixel<Stride>(row, _mm_packus_epi16(a, a));
+                c = b;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+#endif
+}
+
+bool PngDecoder::ReadHeader(const uint8_t* data, size_t size) {
+    m_data = nullptr;
+    m_idat = {};
+    m_animation.clear();
+    m_animationData.clear();
+    m_paletteSize = 0;
+    m_hasKey = false;
+    if (!data || size < 8 + 25 || std::memcmp(data, Signature, 8) != 0) return false;
+
+    for (auto& entry : m_palette) {
+        entry[0] = entry[1] = entry[2] = 0;
+        entry[3] = 255;
+    }
+
+    const uint8_t* transparency = nullptr;
+    uint32_t transparencySize = 0;
+    bool header = false;
+    bool seenImage = false;
+    bool animated = false;
+    bool defaultIsFrame = false;      // fcTL came before IDAT
+    bool badFrame = false;
+    size_t pos = 8;
+    while (pos + 8 <= size) {
+        const uint32_t length = ReadBigEndian32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if (length > 0x7FFFFFFF) return false;
+
+        // A file cut off inside its image or frame data still decodes as far as it goes
+        const bool complete = length <= size - pos - 8;
+        if (!complete && std::memcmp(type, "IDAT", 4) != 0 && std::memcmp(type, "fdAT", 4) != 0) break;
+        const uint32_t available = complete ? length : static_cast<uint32_t>(size - pos - 8);
+
+        if (!header) {
+            if (std::memcmp(type, "IHDR", 4) != 0 || length != 13) return false;
+            m_width = ReadBigEndian32(body);
+            m_height = ReadBigEndian32(body + 4);
+            m_bitDepth = body[8];
+            m_colorType = body[9];
+            if (m_width == 0 || m_height == 0 || m_width > 0x7FFFFFFF || m_height > 0x7FFFFFFF) return false;
+            if (body[10] != 0 || body[11] != 0 || body[12] > 1) return false;
+            m_interlaced = body[12] == 1;
+
+            const uint32_t depth = m_bitDepth;
+            bool valid = false;
+            switch (m_colorType) {
+            case 0: valid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; m_channels = 1; break;
+            case 2: valid = depth == 8 || depth == 16; m_channels = 3; break;
+            case 3: valid = depth == 1 || depth == 2 || depth == 4 || depth == 8; m_channels = 1; break;
+            case 4: valid = depth == 8 || depth == 16; m_channels = 2; break;
+            case 6: valid = depth == 8 || depth == 16; m_channels = 4; break;
+            default: break;
+            }
+            if (!valid) return false;
+            header = true;
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length / 3 > 256) return false;
+            m_paletteSize = length / 3;
+            for (uint32_t i = 0; i < m_paletteSize; ++i) {
+                m_palette[i][0] = body[i * 3];
+                m_palette[i][1] = body[i * 3 + 1];
+                m_palette[i][2] = body[i * 3 + 2];
+            }
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0) {
+            transparency = body;
+            transparencySize = length;
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0) {
+            if (available > 0) {
+                m_idat.chunks.push_back(body);
+                m_idat.sizes.push_back(available);
+            }
+            seenImage = true;
+        }
+        else if (std::memcmp(type, "acTL", 4) == 0) {
+            animated = length >= 8 && !seenImage;
+        }
+        else if (std::memcmp(type, "fcTL", 4) == 0) {
+            if (!seenImage && m_animation.empty()) defaultIsFrame = true;
+            if (length < 26) {
+                badFrame = true;
+            }
+            else {
+                AnimationFrame frame;
+                frame.width = ReadBigEndian32(body + 4);
+                frame.height = ReadBigEndian32(body + 8);
+                frame.left = ReadBigEndian32(body + 12);
+                frame.top = ReadBigEndian32(body + 16);
+                const uint32_t numerator = (body[20] << 8) | body[21];
+                const uint32_t denominator = (body[22] << 8) | body[23];
+                frame.delay = numerator * 1000 / (denominator ? denominator : 100);
+                frame.dispose = body[24];
+                frame.blendOver = body[25] == 1;
+                if (frame.width == 0 || frame.height == 0 || frame.left > m_width || frame.top > m_height ||
+                    frame.width > m_width - frame.left || frame.height > m_height - frame.top ||
+                    frame.dispose > 2 || body[25] > 1) {
+                    badFrame = true;
+                }
+                m_animation.push_back(frame);
+                m_animationData.emplace_back();
+            }
+        }
+        else if (std::memcmp(type, "fdAT", 4) == 0) {
+            // The data follows a sequence number, frames are taken in file order
+            if (!m_animation.empty() && available > 4) {
+                m_animationData.back().chunks.push_back(body + 4);
+                m_animationData.back().sizes.push_back(available - 4);
+            }
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        else if (!(type[0] & 0x20)) {
+            return false;   // Critical chunk this decoder does not know
+        }
+        if (!complete) break;
+        pos += static_cast<size_t>(length) + 12;
+    }
+    if (!header || m_idat.chunks.empty() || (m_colorType == 3 && m_paletteSize == 0)) return false;
+
+    // The default image is frame 0 when its fcTL came first. Frames cut off before any data end
+    // the animation there, anything malformed falls back to the default image.
+    if (defaultIsFrame && !m_animationData.empty()) {
+        m_animationData[0] = m_idat;
+    }
+    while (!m_animationData.empty() && m_animationData.back().chunks.empty()) {
+        m_animation.pop_back();
+        m_animationData.pop_back();
+    }
+    const bool emptyFrame = std::any_of(m_animationData.begin(), m_animationData.end(),
+        [](const FrameData& frame) { return frame.chunks.empty(); });
+    if (!animated || badFrame || emptyFrame) {
+        m_animation.clear();
+        m_animationData.clear();
+    }
+
+    // tRNS turns into an alpha channel: per palette entry, or a single colour key
+    if (transparency) {
+        if (m_colorType == 3) {
+            for (uint32_t i = 0; i < std::min(transparencySize, 256u); ++i) m_palette[i][3] = transparency[i];
+            m_hasKey = transparencySize > 0;
+        }
+        else if (m_colorType == 0 && transparencySize >= 2) {
+            m_key[0] = static_cast<uint16_t>((transparency[0] << 8) | transparency[1]);
+            m_hasKey = true;
+        }
+        else if (m_colorType == 2 && transparencySize >= 6) {
+            for (uint32_t i = 0; i < 3; ++i) m_key[i] = static_cast<uint16_t>((transparency[i * 2] << 8) | transparency[i * 2 + 1]);
+            m_hasKey = true;
+        }
+    }
+
+    const bool wide = m_bitDepth == 16;
+    switch (m_colorType) {
+    case 0: m_layout = m_hasKey ? (wide ? PixelSource::GrayA16 : PixelSource::GrayA8) : (wide ? PixelSource::Gray16 : PixelSource::Gray8); break;
+    case 2: m_layout = m_hasKey ? (wide ? PixelSource::RGBA16 : PixelSource::RGBA8) : (wide ? PixelSource::RGB16 : PixelSource::RGB8); break;
+    case 3: m_layout = m_hasKey ? PixelSource::RGBA8 : PixelSource::RGB8; break;
+    case 4: m_layout = wide ? PixelSource::GrayA16 : PixelSource::GrayA8; break;
+    default: m_layout = wide ? PixelSource::RGBA16 : PixelSource::RGBA8; break;
+    }
+    m_outBytesPerPixel = PixelSourceBytesPerPixel(m_layout);
+    m_filterStride = std::max(1u, m_channels * m_bitDepth / 8);
+    m_passThrough = m_bitDepth == 8 && m_colorType != 3 && !m_hasKey;
+
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+uint32_t PngDecoder::PassWidth(uint32_t width, uint32_t pass) {
+    if (width <= PassX[pass]) return 0;
+    return (width - PassX[pass] + PassStepX[pass] - 1) / PassStepX[pass];
+}
+
+uint32_t PngDecoder::PassHeight(uint32_t height, uint32_t pass) {
+    if (height <= PassY[pass]) return 0;
+    return (height - PassY[pass] + PassStepY[pass] - 1) / PassStepY[pass];
+}
+
+size_t PngDecoder::PassRowBytes(uint32_t width, uint32_t pass) const {
+    const uint32_t passWidth = PassWidth(width, pass);
+    if (passWidth == 0) return 0;
+    return 1 + (static_cast<size_t>(passWidth) * m_channels * m_bitDepth + 7) / 8;
+}
+
+void PngDecoder::Unfilter(uint8_t* row, const uint8_t* prior, size_t bytes) const {
+    const uint8_t filter = row[0];
+    uint8_t* pixels = row + 1;
+    if (filter == 0) return;
+#if SIMD_X86
+    if (GetCpuFeatures().sse2) {
+        if (filter == 2) {
+            UnfilterUpSse2(pixels, prior, bytes);
+            return;
+        }
+        if (m_filterStride == 4) {
+            UnfilterSse2<4>(filter, pixels, prior, bytes);
+            return;
+        }
+        if (m_filterStride == 3) {
+            UnfilterSse2<3>(filter, pixels, prior, bytes);
+            return;
+        }
+    }
+#endif
+    UnfilterScalar(filter, pixels, prior, bytes, m_filterStride);
+}
+
+void PngDecoder::ExpandRow(const uint8_t* src, uint8_t* dst, uint32_t width) const {
+    const uint32_t depth = m_bitDepth;
+    auto sample = [&](uint32_t x) -> uint32_t {
+        const uint32_t bit = x * depth;
+        return (src[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+        };
+    auto wide = [&](uint32_t i) -> uint16_t {
+        return static_cast<uint16_t>((src[i * 2] << 8) | src[i * 2 + 1]);
+        };
+
+    if (m_colorType == 3) {
+        const size_t channels = m_hasKey ? 4 : 3;
+        for (uint32_t x = 0; x < width; ++x, dst += channels) {
+            std::memcpy(dst, m_palette[depth == 8 ? src[x] : sample(x)], channels);
+        }
+        return;
+    }
+
+    if (depth == 16) {
+        uint16_t* out = reinterpret_cast<uint16_t*>(dst);
+        if (!m_hasKey) {
+            const uint32_t count = width * m_channels;
+            for (uint32_t i = 0; i < count; ++i) out[i] = wide(i);
+            return;
+        }
+        const uint32_t channels = m_channels;
+        for (uint32_t x = 0; x < width; ++x) {
+            bool keyed = true;
+            for (uint32_t c = 0; c < channels; ++c) {
+                const uint16_t v = wide(x * channels + c);
+                *out++ = v;
+                keyed &= (v == m_key[c]);
+            }
+            *out++ = keyed ? 0 : 0xFFFF;
+        }
+        return;
+    }
+
+    if (m_colorType == 0) {
+        // Low bit depths scale to the full 8-bit range
+        const uint32_t scale = (depth == 1) ? 255 : (depth == 2) ? 85 : (depth == 4) ? 17 : 1;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t v = (depth == 8) ? src[x] : sample(x);
+            *dst++ = static_cast<uint8_t>(v * scale);
+            if (m_hasKey) *dst++ = (v == m_key[0]) ? 0 : 255;
+        }
+        return;
+    }
+
+    // 8-bit RGB with a colour key, the remaining 8-bit layouts pass straight through
+    for (uint32_t x = 0; x < width; ++x, src += 3, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = (src[0] == m_key[0] && src[1] == m_key[1] && src[2] == m_key[2]) ? 0 : 255;
+    }
+}
+
+bool PngDecoder::ProcessSegment(DecodeJob& job, const Segment& segment, uint8_t* band, const RowSink& onRow) const {
+    const size_t rowBytes = PassRowBytes(job.width, segment.pass);
+    const uint32_t width = PassWidth(job.width, segment.pass);
+    if (segment.firstRow == 0) std::fill(job.prior.begin(), job.prior.begin() + (rowBytes - 1), uint8_t{ 0 });
+
+    const size_t outStride = static_cast<size_t>(job.width) * m_outBytesPerPixel;
+    const uint8_t* prior = job.prior.data();
+    for (uint32_t r = 0; r < segment.rows; ++r) {
+        uint8_t* row = band + r * rowBytes;
+        Unfilter(row, prior, rowBytes - 1);
+        const uint8_t* pixels = row + 1;
+        prior = pixels;
+
+        const uint8_t* expanded = pixels;
+        if (!m_passThrough) {
+            ExpandRow(pixels, job.expanded.data(), width);
+            expanded = job.expanded.data();
+        }
+        if (segment.pass == 0) {
+            if (!onRow(segment.firstRow + r, expanded)) return false;
+            continue;
+        }
+
+        // Interlaced rows scatter into the full image
+        const uint32_t y = PassY[segment.pass] + (segment.firstRow + r) * PassStepY[segment.pass];
+        uint8_t* out = job.image.data() + y * outStride + PassX[segment.pass] * m_outBytesPerPixel;
+        const size_t step = PassStepX[segment.pass] * m_outBytesPerPixel;
+        for (uint32_t x = 0; x < width; ++x, out += step, expanded += m_outBytesPerPixel) {
+            std::memcpy(out, expanded, m_outBytesPerPixel);
+        }
+    }
+    std::memcpy(job.prior.data(), prior, rowBytes - 1);
+    return true;
+}
+
+bool PngDecoder::RunDecode(DecodeJob& job, const RowSink& onRow, const PassSink& onPass) const {
+    // Runs of scanlines within one pass, sized so the pipeline steps stay coarse
+    std::vector<Segment> segments;
+    size_t bandSize = 0;
+    const uint32_t firstPass = m_interlaced ? 1 : 0;
+    const uint32_t lastPass = m_interlaced ? 7 : 0;
+    for (uint32_t pass = firstPass; pass <= lastPass; ++pass) {
+        const uint32_t rows = PassHeight(job.height, pass);
+        const size_t rowBytes = PassRowBytes(job.width, pass);
+        if (rows == 0 || rowBytes == 0) continue;
+        const uint32_t perBand = static_cast<uint32_t>(std::clamp<size_t>(BandBytes / rowBytes, 1, rows));
+        for (uint32_t first = 0; first < rows; first += perBand) {
+            segments.push_back({ pass, first, std::min(perBand, rows - first) });
+            bandSize = std::max(bandSize, rowBytes * segments.back().rows);
+        }
+    }
+
+    const size_t outStride = static_cast<size_t>(job.width) * m_outBytesPerPixel;
+    if (m_interlaced) {
+        if (outStride > SIZE_MAX / job.height) return false;
+        job.image.assign(outStride * job.height, 0);
+    }
+    job.expanded.resize(outStride);
+    job.prior.assign(PassRowBytes(job.width, 0), 0);   // The widest pass
+    job.passesDone = 0;
+
+    Inflater inflater;
+    for (size_t i = 0; i < job.data->chunks.size(); ++i) inflater.AddInput(job.data->chunks[i], job.data->sizes[i]);
+
+    std::vector<uint8_t> bands[2];
+    bands[0].resize(bandSize);
+    bands[1].resize(bandSize);
+
+    // Step i inflates segment i while the previous one is unfiltered and delivered
+    bool stopped = false;
+    for (size_t i = 0; i <= segments.size() && !stopped; ++i) {
+        ParallelFor(2, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t task = begin; task < end; ++task) {
+                if (task == 0 && i < segments.size()) {
+                    const Segment& segment = segments[i];
+                    const size_t bytes = PassRowBytes(job.width, segment.pass) * segment.rows;
+                    uint8_t* band = bands[i & 1].data();
+                    const size_t got = inflater.Read(band, bytes);
+                    std::memset(band + got, 0, bytes - got);   // Unfilters to zero pixels
+                }
+                else if (task == 1 && i > 0) {
+                    if (!ProcessSegment(job, segments[i - 1], bands[(i - 1) & 1].data(), onRow)) stopped = true;
+                }
+            }
+            });
+
+        if (m_interlaced && i > 0 && !stopped) {
+            const Segment& done = segments[i - 1];
+            if (done.firstRow + done.rows == PassHeight(job.height, done.pass)) {
+                job.passesDone = done.pass;
+                if (onPass && done.pass < 7 && !onPass(done.pass)) stopped = true;
+            }
+        }
+    }
+
+    if (m_interlaced) {
+        for (uint32_t y = 0; y < job.height && !stopped; ++y) {
+            stopped = !onRow(y, job.image.data() + y * outStride);
+        }
+        job.image.clear();
+        job.image.shrink_to_fit();
+    }
+    return true;
+}
+
+bool PngDecoder::Decode(const RowSink& onRow, const PassSink& onPass) {
+    if (!m_data) return false;
+    m_job.width = m_width;
+    m_job.height = m_height;
+    m_job.data = &m_idat;
+    return RunDecode(m_job, onRow, onPass);
+}
+
+bool PngDecoder::DecodeAnimationFrame(size_t index, const RowSink& onRow) const {
+    if (!m_data || index >= m_animation.size()) return false;
+    DecodeJob job;
+    job.width = m_animation[index].width;
+    job.height = m_animation[index].height;
+    job.data = &m_animationData[index];
+    return RunDecode(job, onRow, nullptr);
+}
+
+void PngDecoder::DrawAnimationFrame(size_t index, uint8_t* canvas, size_t canvasStride) const {
+    if (index >= m_animation.size()) return;
+    const AnimationFrame& frame = m_animation[index];
+    if (frame.left >= m_width || frame.top >= m_height) return;
+
+    // Rows convert straight into the canvas when they replace it, through a scratch row when they
+    // blend over it
+    const PixelRowConverter convert = GetPixelRowConverter(m_layout, true);
+    const uint32_t width = std::min(frame.width, m_width - frame.left);
+    const uint32_t height = std::min(frame.height, m_height - frame.top);
+    uint8_t* origin = canvas + static_cast<size_t>(frame.top) * canvasStride + static_cast<size_t>(frame.left) * 4;
+    std::vector<uint8_t> scratch(frame.blendOver ? static_cast<size_t>(width) * 4 : 0);
+    if (!frame.blendOver) FillRect(origin, canvasStride, width, height, 0);   // Rows the data stops short of
+    DecodeAnimationFrame(index, [&](uint32_t y, const uint8_t* row) {
+        if (y >= height) return false;
+        uint8_t* dst = origin + static_cast<size_t>(y) * canvasStride;
+        if (frame.blendOver) {
+            convert(row, scratch.data(), width);
+            BlendRowSourceOver(dst, scratch.data(), width);
+        }
+        else {
+            convert(row, dst, width);
+        }
+        return true;
+        });
+}
+
+void PngDecoder::PreviewSize(uint32_t& width, uint32_t& height) const {
+    width = (m_width + GridX[m_job.passesDone] - 1) / GridX[m_job.passesDone];
+    height = (m_height + GridY[m_job.passesDone] - 1) / GridY[m_job.passesDone];
+}
+
+const uint8_t* PngDecoder::PreviewRow(uint32_t y) {
+    uint32_t width = 0, height = 0;
+    PreviewSize(width, height);
+    if (m_job.image.empty() || y >= height) return nullptr;
+
+    const size_t outStride = static_cast<size_t>(m_width) * m_outBytesPerPixel;
+    const uint8_t* src = m_job.image.data() + static_cast<size_t>(y) * GridY[m_job.passesDone] * outStride;
+    const size_t step = GridX[m_job.passesDone] * m_outBytesPerPixel;
+    m_previewRow.resize(static_cast<size_t>(width) * m_outBytesPerPixel);
+    uint8_t* dst = m_previewRow.data();
+    for (uint32_t x = 0; x < width; ++x, src += step, dst += m_outBytesPerPixel) {
+        std::memcpy(dst, src, m_outBytesPerPixel);
+    }
+    return m_previewRow.data();
+}
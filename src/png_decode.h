@@ -0,0 +1,124 @@
+#pragma once
+
+#include "pixel_convert.h"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// PNG decoder for every standard colour type and bit depth, interlaced or not.
+// Inflate and unfiltering run as a two-stage pipeline on the worker pool: while one task inflates
+// the next band of scanlines, another unfilters the band before it and hands its rows to the
+// caller, which can convert or downscale them without the whole image ever being resident.
+// Chunk CRCs and the zlib checksum are not verified. Unknown critical chunks fail ReadHeader.
+// APNG frames (acTL, fcTL, fdAT) are found by the same walk and decode through the same pipeline,
+// each at its own size. DrawAnimationFrame blends one onto a canvas, disposal is left to the caller.
+
+class PngDecoder {
+public:
+    struct AnimationFrame {
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t delay = 0;         // Milliseconds, from the fraction as stored
+        uint32_t dispose = 0;       // APNG numbering: 1 clears the rect, 2 restores what was there before
+        bool blendOver = false;     // Source-over onto the canvas, otherwise the rect is replaced
+    };
+
+    // Walks the chunks up to IEND. The data must stay valid until Decode returns, or for as long
+    // as animation frames are decoded.
+    bool ReadHeader(const uint8_t* data, size_t size);
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    bool IsInterlaced() const { return m_interlaced; }
+
+    // Layout of the rows Decode hands out. Palettes and bit depths below 8 are expanded, tRNS
+    // becomes an alpha channel and 16-bit samples are in native byte order.
+    PixelSource Layout() const { return m_layout; }
+
+    // Receives rows top to bottom, from a pool thread but never two at once. False stops the decode.
+    using RowSink = std::function<bool(uint32_t y, const uint8_t* row)>;
+
+    // Interlaced images only, runs on the calling thread after each Adam7 pass (1 to 6) with
+    // PreviewSize and PreviewRow describing what has been decoded so far. False stops the decode.
+    using PassSink = std::function<bool(uint32_t pass)>;
+
+    // Data that ends early decodes as far as it goes, with the missing rows left black or transparent
+    bool Decode(const RowSink& onRow, const PassSink& onPass = nullptr);
+
+    // APNG frames in play order, none for a still PNG or an animation whose frame headers do not
+    // fit the image, which then shows its default image. Frame 0 may be the default image itself.
+    size_t AnimationFrameCount() const { return m_animation.size(); }
+    const AnimationFrame& GetAnimationFrame(size_t index) const { return m_animation[index]; }
+
+    // Rows of the frame at its own size, in the same layout and with the same early ending as Decode.
+    // Leaves the decoder untouched, so frames may decode on several threads at once.
+    bool DecodeAnimationFrame(size_t index, const RowSink& onRow) const;
+
+    // The frame onto a premultiplied BGRA canvas of the image's size, source-over or replacing its
+    // rect as the frame says and clipped to the canvas. The previous frame's disposal is already done.
+    void DrawAnimationFrame(size_t index, uint8_t* canvas, size_t canvasStride) const;
+
+    // Inside PassSink: the image on the coarsest grid the finished passes fill completely
+    void PreviewSize(uint32_t& width, uint32_t& height) const;
+    const uint8_t* PreviewRow(uint32_t y);
+
+private:
+    struct Segment {
+        uint32_t pass;                // 0 without interlacing, otherwise the Adam7 pass 1-7
+        uint32_t firstRow;            // Within the pass
+        uint32_t rows;
+    };
+
+    struct FrameData {
+        std::vector<const uint8_t*> chunks;   // fdAT bodies past the sequence number, or the IDATs
+        std::vector<uint32_t> sizes;
+    };
+
+    // One run through the pipeline, over the image or an animation frame at its own size
+    struct DecodeJob {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        const FrameData* data = nullptr;
+        std::vector<uint8_t> prior;   // Last unfiltered scanline of the pass in progress
+        std::vector<uint8_t> expanded;
+        std::vector<uint8_t> image;   // Interlaced only, assembled at full size
+        uint32_t passesDone = 0;
+    };
+
+    static uint32_t PassWidth(uint32_t width, uint32_t pass);
+    static uint32_t PassHeight(uint32_t height, uint32_t pass);
+    size_t PassRowBytes(uint32_t width, uint32_t pass) const;   // Filtered scanline, including the filter byte
+    void Unfilter(uint8_t* row, const uint8_t* prior, size_t bytes) const;
+    void ExpandRow(const uint8_t* src, uint8_t* dst, uint32_t width) const;
+    bool ProcessSegment(DecodeJob& job, const Segment& segment, uint8_t* band, const RowSink& onRow) const;
+    bool RunDecode(DecodeJob& job, const RowSink& onRow, const PassSink& onPass) const;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    FrameData m_idat;
+    std::vector<AnimationFrame> m_animation;
+    std::vector<FrameData> m_animationData;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_bitDepth = 8;
+    uint32_t m_colorType = 0;
+    bool m_interlaced = false;
+    uint32_t m_channels = 1;          // In the stored data, before expansion
+    uint32_t m_filterStride = 1;      // Bytes per complete pixel, at least 1
+    PixelSource m_layout = PixelSource::Gray8;
+    size_t m_outBytesPerPixel = 1;
+    bool m_passThrough = false;       // Stored rows are already in m_layout
+
+    uint8_t m_palette[256][4] = {};
+    uint32_t m_paletteSize = 0;
+    bool m_hasKey = false;            // tRNS colour key for gray and RGB
+    uint16_t m_key[3] = {};
+
+    // Decode of the image itself, the preview reads it between passes
+    DecodeJob m_job;
+    std::vector<uint8_t> m_previewRow;
+};
@@ -0,0 +1,429 @@
+#include "pyramid_cache.h"
+#include "mip_pyramid.h"
+#include "qoi.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    constexpr char Magic[8] = { 'M', 'I', 'V', 'T', 'I', 'L', 'E', '1' };
+    constexpr size_t HeaderSize = 40;
+    constexpr size_t EntrySize = 12;
+
+    struct PyramidHeader {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tileSize = 0;
+        uint32_t levelCount = 0;
+        uint64_t sourceKey = 0;
+        uint64_t indexOffset = 0;
+    };
+
+    // Windows and every x86 target are little endian, fields are stored as they sit in memory
+    void PackHeader(const PyramidHeader& header, uint8_t* out) {
+        std::memcpy(out, Magic, 8);
+        std::memcpy(out + 8, &header.width, 4);
+        std::memcpy(out + 12, &header.height, 4);
+        std::memcpy(out + 16, &header.tileSize, 4);
+        std::memcpy(out + 20, &header.levelCount, 4);
+        std::memcpy(out + 24, &header.sourceKey, 8);
+        std::memcpy(out + 32, &header.indexOffset, 8);
+    }
+
+    bool UnpackHeader(const uint8_t* in, PyramidHeader& header) {
+        if (std::memcmp(in, Magic, 8) != 0) return false;
+        std::memcpy(&header.width, in + 8, 4);
+        std::memcpy(&header.height, in + 12, 4);
+        std::memcpy(&header.tileSize, in + 16, 4);
+        std::memcpy(&header.levelCount, in + 20, 4);
+        std::memcpy(&header.sourceKey, in + 24, 8);
+        std::memcpy(&header.indexOffset, in + 32, 8);
+        return true;
+    }
+
+    uint32_t ReadBigEndian32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+}
+
+uint32_t PyramidWriter::LevelCountFor(uint32_t width, uint32_t height, uint32_t tileSize) {
+    uint32_t count = 1;
+    while (std::max(width, height) > tileSize && count < 24) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ++count;
+    }
+    return count;
+}
+
+bool PyramidWriter::Open(const std::filesystem::path& path, uint32_t width, uint32_t height, uint64_t sourceKey, uint32_t tileSize) {
+    Abort();
+    m_failed = false;
+
+    // Even tile sizes keep both rows of every reduced pair inside one band
+    if (width == 0 || height == 0 || tileSize < 2 || (tileSize & 1) != 0) return false;
+
+    m_path = path;
+    m_tempPath = path;
+    m_tempPath += ".tmp";
+    m_sourceKey = sourceKey;
+    m_grid.Init(width, height, tileSize, LevelCountFor(width, height, tileSize));
+
+    m_file.open(m_tempPath, std::ios::binary | std::ios::trunc);
+    if (!m_file) return false;
+
+    // Placeholder until Finish knows where the index goes
+    uint8_t header[HeaderSize];
+    PackHeader({}, header);
+    m_file.write(reinterpret_cast<const char*>(header), HeaderSize);
+    m_offset = HeaderSize;
+
+    m_levels.assign(m_grid.LevelCount(), {});
+    m_index.assign(m_grid.LevelCount(), {});
+    for (uint32_t level = 0; level < m_grid.LevelCount(); ++level) {
+        Level& lv = m_levels[level];
+        lv.band.resize(static_cast<size_t>(m_grid.LevelWidth(level)) * 4 * std::min(tileSize, m_grid.LevelHeight(level)));
+        if (level + 1 < m_grid.LevelCount()) {
+            lv.reduced.resize(static_cast<size_t>(m_grid.LevelWidth(level + 1)) * 4);
+        }
+        m_index[level].resize(static_cast<size_t>(m_grid.TilesX(level)) * m_grid.TilesY(level));
+    }
+    return m_file.good();
+}
+
+bool PyramidWriter::PushRows(const uint8_t* rows, size_t stride, uint32_t count) {
+    if (m_failed || !m_file.is_open()) return false;
+    count = std::min(count, m_grid.Height() - m_levels[0].rowsDone);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!AddRow(0, rows + i * stride)) {
+            m_failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PyramidWriter::AddRow(uint32_t level, const uint8_t* row) {
+    Level& lv = m_levels[level];
+    const uint32_t width = m_grid.LevelWidth(level);
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    uint8_t* dst = lv.band.data() + lv.bandRows * rowBytes;
+    std::memcpy(dst, row, rowBytes);
+    const uint32_t y = lv.rowsDone++;
+    ++lv.bandRows;
+
+    // Each completed pair of rows becomes one row of the next level, an odd last row pairs with itself
+    if (level + 1 < m_grid.LevelCount()) {
+        const bool last = (lv.rowsDone == m_grid.LevelHeight(level));
+        if ((y & 1) != 0 || last) {
+            const uint8_t* top = ((y & 1) != 0) ? dst - rowBytes : dst;
+            HalveRowsBgra8(top, dst, width, lv.reduced.data());
+            if (!AddRow(level + 1, lv.reduced.data())) return false;
+        }
+    }
+
+    if (lv.bandRows == m_grid.TileSize() || lv.rowsDone == m_grid.LevelHeight(level)) {
+        return FlushBand(level);
+    }
+    return true;
+}
+
+bool PyramidWriter::FlushBand(uint32_t level) {
+    Level& lv = m_levels[level];
+    const uint32_t tileSize = m_grid.TileSize();
+    const uint32_t width = m_grid.LevelWidth(level);
+    const uint32_t rows = lv.bandRows;
+    const uint32_t tileRow = (lv.rowsDone - 1) / tileSize;
+    const uint32_t tilesX = m_grid.TilesX(level);
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+
+    for (uint32_t tx = 0; tx < tilesX; ++tx) {
+        const uint32_t tileW = std::min(tileSize, width - tx * tileSize);
+        const size_t tileRowBytes = static_cast<size_t>(tileW) * 4;
+        m_tile.resize(tileRowBytes * rows);
+        for (uint32_t y = 0; y < rows; ++y) {
+            std::memcpy(m_tile.data() + y * tileRowBytes, lv.band.data() + y * rowBytes + static_cast<size_t>(tx) * tileSize * 4, tileRowBytes);
+        }
+
+        if (!QoiEncodePixels(m_tile.data(), tileW, rows, m_encoded)) return false;
+        m_file.write(reinterpret_cast<const char*>(m_encoded.data()), static_cast<std::streamsize>(m_encoded.size()));
+        if (!m_file) return false;
+
+        m_index[level][static_cast<size_t>(tileRow) * tilesX + tx] = { m_offset, static_cast<uint32_t>(m_encoded.size()) };
+        m_offset += m_encoded.size();
+    }
+    lv.bandRows = 0;
+    return true;
+}
+
+bool PyramidWriter::Finish() {
+    if (m_failed || !m_file.is_open()) {
+        Abort();
+        return false;
+    }
+    for (uint32_t level = 0; level < m_grid.LevelCount(); ++level) {
+        if (m_levels[level].rowsDone != m_grid.LevelHeight(level)) {
+            Abort();
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> index;
+    for (const std::vector<PyramidTileEntry>& entries : m_index) {
+        for (const PyramidTileEntry& entry : entries) {
+            uint8_t packed[EntrySize];
+            std::memcpy(packed, &entry.offset, 8);
+            std::memcpy(packed + 8, &entry.size, 4);
+            index.insert(index.end(), packed, packed + EntrySize);
+        }
+    }
+    m_file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+
+    PyramidHeader info;
+    info.width = m_grid.Width();
+    info.height = m_grid.Height();
+    info.tileSize = m_grid.TileSize();
+    info.levelCount = m_grid.LevelCount();
+    info.sourceKey = m_sourceKey;
+    info.indexOffset = m_offset;
+    uint8_t header[HeaderSize];
+    PackHeader(info, header);
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(header), HeaderSize);
+    m_file.close();
+    m_levels.clear();
+    m_index.clear();
+
+    std::error_code ec;
+    if (m_file.fail()) {
+        std::filesystem::remove(m_tempPath, ec);
+        return false;
+    }
+    std::filesystem::rename(m_tempPath, m_path, ec);
+    if (ec) {
+        std::filesystem::remove(m_tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+void PyramidWriter::Abort() {
+    m_levels.clear();
+    m_index.clear();
+    if (!m_file.is_open()) return;
+    m_file.close();
+    std::error_code ec;
+    std::filesystem::remove(m_tempPath, ec);
+}
+
+size_t PyramidWriter::MemoryBytes() const {
+    size_t bytes = m_tile.capacity() + m_encoded.capacity();
+    for (const Level& lv : m_levels) {
+        bytes += lv.band.capacity() + lv.reduced.capacity();
+    }
+    for (const std::vector<PyramidTileEntry>& entries : m_index) {
+        bytes += entries.capacity() * sizeof(PyramidTileEntry);
+    }
+    return bytes;
+}
+
+bool PyramidReader::Open(const std::filesystem::path& path, uint64_t sourceKey) {
+    m_file.close();
+    m_file.clear();
+    m_entries.clear();
+    m_levelStart.clear();
+
+    // Reads count as use for pruning
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    m_file.open(path, std::ios::binary);
+    if (!m_file) return false;
+
+    auto fail = [&]() {
+        m_file.close();
+        m_entries.clear();
+        m_levelStart.clear();
+        return false;
+        };
+
+    uint8_t raw[HeaderSize];
+    PyramidHeader header;
+    if (!m_file.read(reinterpret_cast<char*>(raw), HeaderSize) || !UnpackHeader(raw, header)) return fail();
+    if (header.sourceKey != sourceKey || header.width == 0 || header.height == 0 || header.tileSize < 2 ||
+        header.levelCount != PyramidWriter::LevelCountFor(header.width, header.height, header.tileSize)) {
+        return fail();
+    }
+    m_grid.Init(header.width, header.height, header.tileSize, header.levelCount);
+
+    size_t count = 0;
+    for (uint32_t level = 0; level < m_grid.LevelCount(); ++level) {
+        m_levelStart.push_back(count);
+        count += static_cast<size_t>(m_grid.TilesX(level)) * m_grid.TilesY(level);
+    }
+
+    // The index is written last, a file cut short anywhere fails this
+    m_file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+    if (header.indexOffset < HeaderSize || header.indexOffset + count * EntrySize != fileSize) return fail();
+
+    std::vector<uint8_t> index(count * EntrySize);
+    m_file.seekg(static_cast<std::streamoff>(header.indexOffset));
+    if (!m_file.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size()))) return fail();
+
+    m_entries.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        PyramidTileEntry& entry = m_entries[i];
+        std::memcpy(&entry.offset, index.data() + i * EntrySize, 8);
+        std::memcpy(&entry.size, index.data() + i * EntrySize + 8, 4);
+        if (entry.offset < HeaderSize || entry.size == 0 || entry.offset + entry.size > header.indexOffset) return fail();
+    }
+    return true;
+}
+
+const PyramidTileEntry* PyramidReader::Find(const TileKey& key) const {
+    if (key.level >= m_grid.LevelCount() || key.x >= m_grid.TilesX(key.level) || key.y >= m_grid.TilesY(key.level)) return nullptr;
+    return &m_entries[m_levelStart[key.level] + static_cast<size_t>(key.y) * m_grid.TilesX(key.level) + key.x];
+}
+
+bool PyramidReader::DecodeTile(const PyramidTileEntry& entry, uint32_t width, uint32_t height, uint8_t* dst, size_t stride) {
+    m_buffer.resize(entry.size);
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!m_file.read(reinterpret_cast<char*>(m_buffer.data()), entry.size)) return false;
+
+    QoiRowDecoder decoder;
+    if (!decoder.Init(m_buffer.data(), m_buffer.size()) || decoder.Width() != width || decoder.Height() != height) return false;
+    for (uint32_t y = 0; y < height; ++y) {
+        if (!decoder.NextRow(dst + y * stride)) return false;
+    }
+    return true;
+}
+
+bool PyramidReader::ReadTile(const TileKey& key, TileData& out) {
+    const PyramidTileEntry* entry = Find(key);
+    if (!entry) return false;
+    out.width = m_grid.TileWidth(key);
+    out.height = m_grid.TileHeight(key);
+    out.pixels.resize(static_cast<size_t>(out.width) * out.height * 4);
+    return DecodeTile(*entry, out.width, out.height, out.pixels.data(), static_cast<size_t>(out.width) * 4);
+}
+
+bool PyramidReader::ReadBand(uint32_t level, uint32_t tileRow, uint8_t* dst, size_t stride) {
+    if (level >= m_grid.LevelCount() || tileRow >= m_grid.TilesY(level)) return false;
+    for (uint32_t tx = 0; tx < m_grid.TilesX(level); ++tx) {
+        const TileKey key = { level, tx, tileRow };
+        const PyramidTileEntry* entry = Find(key);
+        if (!entry || !DecodeTile(*entry, m_grid.TileWidth(key), m_grid.TileHeight(key),
+            dst + static_cast<size_t>(tx) * m_grid.TileSize() * 4, stride)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QoiEncodePixels(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& out) {
+    qoi_desc desc = { width, height, 4, QOI_SRGB };
+    int encodedSize = 0;
+    void* encoded = qoi_encode(pixels, &desc, &encodedSize);
+    if (!encoded) return false;
+    out.assign(static_cast<const uint8_t*>(encoded), static_cast<const uint8_t*>(encoded) + encodedSize);
+    free(encoded);
+    return true;
+}
+
+bool QoiRowDecoder::Init(const uint8_t* data, size_t size) {
+    constexpr size_t headerSize = 14;
+    constexpr size_t paddingSize = 8;
+    if (!data || size < headerSize + paddingSize || std::memcmp(data, "qoif", 4) != 0) return false;
+
+    m_width = ReadBigEndian32(data + 4);
+    m_height = ReadBigEndian32(data + 8);
+    const uint8_t channels = data[12];
+    if (m_width == 0 || m_height == 0 || (channels != 3 && channels != 4) || data[13] > 1) return false;
+
+    m_data = data;
+    m_size = size - paddingSize;
+    m_pos = headerSize;
+    m_run = 0;
+    m_px[0] = m_px[1] = m_px[2] = 0;
+    m_px[3] = 255;
+    std::memset(m_table, 0, sizeof(m_table));
+    return true;
+}
+
+bool QoiRowDecoder::NextRow(uint8_t* rgba) {
+    for (uint32_t x = 0; x < m_width; ++x) {
+        if (m_run > 0) {
+            --m_run;
+        }
+        else {
+            if (m_pos >= m_size) return false;
+            const uint8_t b1 = m_data[m_pos++];
+            if (b1 == 0xfe) {
+                if (m_pos + 3 > m_size) return false;
+                std::memcpy(m_px, m_data + m_pos, 3);
+                m_pos += 3;
+            }
+            else if (b1 == 0xff) {
+                if (m_pos + 4 > m_size) return false;
+                std::memcpy(m_px, m_data + m_pos, 4);
+                m_pos += 4;
+            }
+            else {
+                switch (b1 & 0xc0) {
+                case 0x00:
+                    std::memcpy(m_px, m_table[b1], 4);
+                    break;
+                case 0x40:
+                    m_px[0] = static_cast<uint8_t>(m_px[0] + ((b1 >> 4) & 0x03) - 2);
+                    m_px[1] = static_cast<uint8_t>(m_px[1] + ((b1 >> 2) & 0x03) - 2);
+                    m_px[2] = static_cast<uint8_t>(m_px[2] + (b1 & 0x03) - 2);
+                    break;
+                case 0x80: {
+                    if (m_pos >= m_size) return false;
+                    const uint8_t b2 = m_data[m_pos++];
+                    const int vg = (b1 & 0x3f) - 32;
+                    m_px[0] = static_cast<uint8_t>(m_px[0] + vg - 8 + ((b2 >> 4) & 0x0f));
+                    m_px[1] = static_cast<uint8_t>(m_px[1] + vg);
+                    m_px[2] = static_cast<uint8_t>(m_px[2] + vg - 8 + (b2 & 0x0f));
+                    break;
+                }
+                default:
+                    m_run = b1 & 0x3f;
+                    break;
+                }
+            }
+            std::memcpy(m_table[(m_px[0] * 3 + m_px[1] * 5 + m_px[2] * 7 + m_px[3] * 11) % 64], m_px, 4);
+        }
+        std::memcpy(rgba + x * 4, m_px, 4);
+    }
+    return true;
+}
+
+void PrunePyramidCache(const std::filesystem::path& folder, uint64_t maxBytes) {
+    struct CachedFile {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uint64_t size = 0;
+    };
+
+    std::error_code ec;
+    std::vector<CachedFile> files;
+    uint64_t total = 0;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        CachedFile file{ entry.path(), entry.last_write_time(ec), entry.file_size(ec) };
+        if (ec) continue;
+        total += file.size;
+        files.push_back(std::move(file));
+    }
+    if (total <= maxBytes) return;
+
+    std::sort(files.begin(), files.end(), [](const CachedFile& a, const CachedFile& b) { return a.time < b.time; });
+    for (const CachedFile& file : files) {
+        if (total <= maxBytes) break;
+        if (std::filesystem::remove(file.path, ec)) total -= file.size;
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "tile_cache.h"
+
+// Out-of-core tile pyramid for images too large to decode into memory.
+// The builder takes full-resolution rows top to bottom once, box-reduces them into every level of
+// the TileGrid layout and writes each tile QOI-compressed as soon as its band of rows is complete,
+// so it holds one band of tile rows per level and never the image. Later opens read single tiles.
+//
+// File layout, little endian:
+//   header   "MIVTILE1", width, height, tileSize, levelCount (u32), sourceKey, indexOffset (u64)
+//   tiles    QOI streams in the order they were finished
+//   index    offset (u64) and size (u32) per tile, level by level, rows top to bottom
+
+struct PyramidTileEntry {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+};
+
+class PyramidWriter {
+public:
+    ~PyramidWriter() { Abort(); }
+
+    // Writes next to path and renames into place on Finish, so a cancelled or crashed build never
+    // leaves a truncated pyramid behind. sourceKey identifies the source file version.
+    bool Open(const std::filesystem::path& path, uint32_t width, uint32_t height, uint64_t sourceKey, uint32_t tileSize = 256);
+
+    // 32bpp premultiplied BGRA rows, any strip size. False once a write has failed.
+    bool PushRows(const uint8_t* rows, size_t stride, uint32_t count);
+    bool Finish();
+    void Abort();
+
+    const TileGrid& Grid() const { return m_grid; }
+    size_t MemoryBytes() const;
+
+    // Levels down to the first one that fits in a single tile
+    static uint32_t LevelCountFor(uint32_t width, uint32_t height, uint32_t tileSize);
+
+private:
+    struct Level {
+        uint32_t rowsDone = 0;
+        uint32_t bandRows = 0;
+        std::vector<uint8_t> band;     // Up to tileSize rows of the level, width * 4 bytes each
+        std::vector<uint8_t> reduced;  // One row of the next level
+    };
+
+    bool AddRow(uint32_t level, const uint8_t* row);
+    bool FlushBand(uint32_t level);
+
+    std::filesystem::path m_path;
+    std::filesystem::path m_tempPath;
+    std::ofstream m_file;
+    TileGrid m_grid;
+    uint64_t m_sourceKey = 0;
+    uint64_t m_offset = 0;
+    bool m_failed = false;
+    std::vector<Level> m_levels;
+    std::vector<std::vector<PyramidTileEntry>> m_index;   // Per level, rows of tiles top to bottom
+    std::vector<uint8_t> m_tile;
+    std::vector<uint8_t> m_encoded;
+};
+
+class PyramidReader {
+public:
+    // Fails on anything but a complete pyramid written for sourceKey
+    bool Open(const std::filesystem::path& path, uint64_t sourceKey);
+    bool IsOpen() const { return m_file.is_open(); }
+
+    const TileGrid& Grid() const { return m_grid; }
+
+    // Not thread safe, each thread opens its own reader
+    bool ReadTile(const TileKey& key, TileData& out);
+
+    // All tiles of one tile row of a level, TileSize rows or fewer at the bottom edge
+    bool ReadBand(uint32_t level, uint32_t tileRow, uint8_t* dst, size_t stride);
+
+private:
+    const PyramidTileEntry* Find(const TileKey& key) const;
+    bool DecodeTile(const PyramidTileEntry& entry, uint32_t width, uint32_t height, uint8_t* dst, size_t stride);
+
+    std::ifstream m_file;
+    TileGrid m_grid;
+    std::vector<size_t> m_levelStart;
+    std::vector<PyramidTileEntry> m_entries;
+    std::vector<uint8_t> m_buffer;
+};
+
+// Row by row QOI decoder over an in-memory or mapped file, for sources too large to decode at once.
+// Rows come out as 8-bit RGBA whatever the stored channel count.
+class QoiRowDecoder {
+public:
+    bool Init(const uint8_t* data, size_t size);
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    // False on truncated data
+    bool NextRow(uint8_t* rgba);
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_run = 0;
+    uint8_t m_px[4] = { 0, 0, 0, 255 };
+    uint8_t m_table[64][4] = {};
+};
+
+// QOI-compresses a packed 32bpp image into out. QOI does not care about channel order, so
+// premultiplied BGRA goes in and comes back out of QoiRowDecoder as is.
+bool QoiEncodePixels(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& out);
+
+// Deletes the least recently used pyramids until the folder is within maxBytes. Files in use are skipped.
+void PrunePyramidCache(const std::filesystem::path& folder, uint64_t maxBytes);
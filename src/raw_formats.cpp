@@ -0,0 +1,165 @@
+#include "raw_formats.h"
+#include "cpu_features.h"
+#include <algorithm>
+
+namespace {
+
+    inline uint16_t ReadLE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    inline uint32_t ReadLE32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+    inline bool IsPnmSpace(uint8_t c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    // Skips whitespace and # comments, then reads a decimal field
+    bool ReadPnmNumber(const uint8_t* data, size_t size, size_t& pos, uint32_t& value) {
+        while (pos < size) {
+            if (IsPnmSpace(data[pos])) {
+                ++pos;
+            }
+            else if (data[pos] == '#') {
+                while (pos < size && data[pos] != '\n' && data[pos] != '\r') ++pos;
+            }
+            else {
+                break;
+            }
+        }
+
+        uint64_t v = 0;
+        const size_t start = pos;
+        while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+            v = v * 10 + (data[pos] - '0');
+            if (v > 0xFFFFFFFFull) return false;
+            ++pos;
+        }
+        if (pos == start) return false;
+        value = static_cast<uint32_t>(v);
+        return true;
+    }
+
+    bool FitsInFile(const RawImageInfo& info, size_t size) {
+        if (info.width == 0 || info.height == 0 || info.dataOffset > size) return false;
+        return info.rowStride != 0 && (size - info.dataOffset) / info.rowStride >= info.height;
+    }
+}
+
+uint32_t RawImageInfo::Channels() const {
+    switch (layout) {
+    case RawPixelLayout::Gray8:
+    case RawPixelLayout::Gray16BE: return 1;
+    case RawPixelLayout::RGB8:
+    case RawPixelLayout::RGB16BE:
+    case RawPixelLayout::BGR8:     return 3;
+    case RawPixelLayout::BGRX8:
+    case RawPixelLayout::BGRA8:    return 4;
+    }
+    return 0;
+}
+
+bool ParsePnmHeader(const uint8_t* data, size_t size, RawImageInfo& out) {
+    if (size < 3 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) return false;
+    const bool color = data[1] == '6';
+
+    size_t pos = 2;
+    uint32_t width = 0, height = 0, maxValue = 0;
+    if (!ReadPnmNumber(data, size, pos, width) ||
+        !ReadPnmNumber(data, size, pos, height) ||
+        !ReadPnmNumber(data, size, pos, maxValue)) {
+        return false;
+    }
+
+    // Exactly one whitespace byte separates the header from the raster
+    if (pos >= size || !IsPnmSpace(data[pos])) return false;
+    ++pos;
+
+    // 8-bit rasters with a reduced range need rescaling, leave those to stb
+    if (maxValue == 0 || maxValue > 65535 || (maxValue < 256 && maxValue != 255)) return false;
+    const bool wide = maxValue > 255;
+
+    RawImageInfo info;
+    info.width = width;
+    info.height = height;
+    info.maxValue = maxValue;
+    info.layout = color ? (wide ? RawPixelLayout::RGB16BE : RawPixelLayout::RGB8)
+                        : (wide ? RawPixelLayout::Gray16BE : RawPixelLayout::Gray8);
+    info.dataOffset = pos;
+    info.rowStride = static_cast<size_t>(width) * info.Channels() * (wide ? 2 : 1);
+    info.bottomUp = false;
+    if (width > (1u << 24) || height > (1u << 24) || !FitsInFile(info, size)) return false;
+
+    out = info;
+    return true;
+}
+
+bool ParseBmpHeader(const uint8_t* data, size_t size, RawImageInfo& out) {
+    constexpr size_t FileHeaderSize = 14;
+    constexpr uint32_t BiRgb = 0, BiBitfields = 3;
+
+    if (size < FileHeaderSize + 40 || data[0] != 'B' || data[1] != 'M') return false;
+
+    const uint32_t pixelOffset = ReadLE32(data + 10);
+    const uint8_t* dib = data + FileHeaderSize;
+    const uint32_t dibSize = ReadLE32(dib);
+    if (dibSize < 40 || FileHeaderSize + dibSize > size) return false;   // OS/2 core headers go to WIC
+
+    const int32_t width = static_cast<int32_t>(ReadLE32(dib + 4));
+    const int32_t height = static_cast<int32_t>(ReadLE32(dib + 8));
+    const uint16_t bitCount = ReadLE16(dib + 14);
+    const uint32_t compression = ReadLE32(dib + 16);
+    if (width <= 0 || height == 0 || height == INT32_MIN) return false;
+
+    RawImageInfo info;
+    if (compression == BiRgb && bitCount == 24) {
+        info.layout = RawPixelLayout::BGR8;
+    }
+    else if (compression == BiRgb && bitCount == 32) {
+        info.layout = RawPixelLayout::BGRX8;
+    }
+    else if (compression == BiBitfields && bitCount == 32) {
+        // Masks follow a plain info header, or live inside V2+ headers at the same offset
+        if (FileHeaderSize + 40 + 12 > size) return false;
+        const uint32_t redMask = ReadLE32(dib + 40);
+        const uint32_t greenMask = ReadLE32(dib + 44);
+        const uint32_t blueMask = ReadLE32(dib + 48);
+        if (redMask != 0x00FF0000u || greenMask != 0x0000FF00u || blueMask != 0x000000FFu) return false;
+        const uint32_t alphaMask = (dibSize >= 56) ? ReadLE32(dib + 52) : 0;
+        info.layout = (alphaMask == 0xFF000000u) ? RawPixelLayout::BGRA8 : RawPixelLayout::BGRX8;
+    }
+    else {
+        return false;
+    }
+
+    info.width = static_cast<uint32_t>(width);
+    info.height = static_cast<uint32_t>(height < 0 ? -static_cast<int64_t>(height) : height);
+    info.bottomUp = height > 0;
+    info.dataOffset = pixelOffset;
+    info.rowStride = ((static_cast<size_t>(info.width) * bitCount + 31) / 32) * 4;
+    if (info.width > (1u << 24) || info.height > (1u << 24) || !FitsInFile(info, size)) return false;
+
+    out = info;
+    return true;
+}
+
+void LoadBigEndian16(const uint8_t* src, uint16_t* dst, size_t count, uint32_t maxValue) {
+    size_t i = 0;
+    if (maxValue == 65535) {
+#if SIMD_X86
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+        }
+#endif
+        for (; i < count; ++i) {
+            dst[i] = static_cast<uint16_t>((src[i * 2] << 8) | src[i * 2 + 1]);
+        }
+        return;
+    }
+
+    // Out-of-range samples are clamped rather than wrapped
+    const uint32_t half = maxValue / 2;
+    for (; i < count; ++i) {
+        const uint32_t v = std::min<uint32_t>((src[i * 2] << 8) | src[i * 2 + 1], maxValue);
+        dst[i] = static_cast<uint16_t>((v * 65535u + half) / maxValue);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Header parsing for formats whose pixel data is a plain array in the file:
+// binary PNM (P5/P6) and uncompressed BMP. Rows are read in place, straight from a file mapping.
+
+enum class RawPixelLayout {
+    Gray8,
+    Gray16BE,
+    RGB8,
+    RGB16BE,
+    BGR8,
+    BGRX8,   // 32bpp BMP without an alpha mask, the fourth byte is padding
+    BGRA8
+};
+
+struct RawImageInfo {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    RawPixelLayout layout = RawPixelLayout::RGB8;
+    uint32_t maxValue = 255;   // PNM sample range, 16-bit samples are stretched to 65535 on load
+    size_t dataOffset = 0;     // First stored row
+    size_t rowStride = 0;
+    bool bottomUp = false;     // BMP rows stored bottom to top
+
+    uint32_t Channels() const;
+    bool Is16Bit() const { return layout == RawPixelLayout::Gray16BE || layout == RawPixelLayout::RGB16BE; }
+
+    // Top-down row y, bottom-up files are handled by walking the stride backwards
+    const uint8_t* Row(const uint8_t* base, uint32_t y) const {
+        const uint32_t stored = bottomUp ? height - 1 - y : y;
+        return base + dataOffset + static_cast<size_t>(stored) * rowStride;
+    }
+};
+
+// Both return false for anything outside the raw subset (ASCII PNM, 8-bit maxval other than 255,
+// RLE or paletted BMP) so the caller can fall back to the general decoders.
+// The full pixel array is checked to lie within size.
+bool ParsePnmHeader(const uint8_t* data, size_t size, RawImageInfo& out);
+bool ParseBmpHeader(const uint8_t* data, size_t size, RawImageInfo& out);
+
+// Big-endian PNM samples to native 16-bit, rescaled so maxValue maps to 65535
+void LoadBigEndian16(const uint8_t* src, uint16_t* dst, size_t count, uint32_t maxValue);
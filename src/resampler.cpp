@@ -0,0 +1,469 @@
+#include "resampler.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr uint32_t ChunkRows = 64;
+    constexpr int WeightBits = 14;
+    constexpr int WeightOne = 1 << WeightBits;
+
+    double FilterSupport(ResampleFilter filter) {
+        switch (filter) {
+        case ResampleFilter::Box:      return 0.5;
+        case ResampleFilter::Triangle: return 1.0;
+        case ResampleFilter::Mitchell: return 2.0;
+        case ResampleFilter::Lanczos3:
+        default:                       return 3.0;
+        }
+    }
+
+    double Sinc(double x) {
+        if (x == 0.0) return 1.0;
+        x *= Pi;
+        return std::sin(x) / x;
+    }
+
+    double FilterWeight(ResampleFilter filter, double x) {
+        x = std::fabs(x);
+        switch (filter) {
+        case ResampleFilter::Box:
+            return x <= 0.5 ? 1.0 : 0.0;
+        case ResampleFilter::Triangle:
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case ResampleFilter::Mitchell: {
+            // Mitchell-Netravali with B = C = 1/3
+            constexpr double B = 1.0 / 3.0, C = 1.0 / 3.0;
+            if (x < 1.0) {
+                return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+            }
+            if (x < 2.0) {
+                return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0;
+            }
+            return 0.0;
+        }
+        case ResampleFilter::Lanczos3:
+        default:
+            return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+        }
+    }
+
+    // sRGB transfer tables, linear values are kept on the same 0..255 scale as encoded ones
+    constexpr int LinearSteps = 16;   // Encode table resolution per linear unit
+
+    const float* SrgbToLinearTable() {
+        static const auto table = [] {
+            std::vector<float> t(256);
+            for (int i = 0; i < 256; ++i) {
+                double c = i / 255.0;
+                c = (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+                t[i] = static_cast<float>(c * 255.0);
+            }
+            return t;
+            }();
+        return table.data();
+    }
+
+    const uint8_t* LinearToSrgbTable() {
+        static const auto table = [] {
+            std::vector<uint8_t> t(256 * LinearSteps + 1);
+            for (size_t i = 0; i < t.size(); ++i) {
+                double c = static_cast<double>(i) / (255.0 * LinearSteps);
+                c = (c <= 0.0031308) ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+                t[i] = static_cast<uint8_t>(std::clamp(c * 255.0 + 0.5, 0.0, 255.0));
+            }
+            return t;
+            }();
+        return table.data();
+    }
+
+    // Premultiplied sRGB row to premultiplied linear floats
+    void LinearizeRow(const uint8_t* src, float* dst, uint32_t width) {
+        const float* toLinear = SrgbToLinearTable();
+        for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4) {
+            const uint32_t a = src[3];
+            if (a == 255) {
+                dst[0] = toLinear[src[0]];
+                dst[1] = toLinear[src[1]];
+                dst[2] = toLinear[src[2]];
+            }
+            else if (a == 0) {
+                dst[0] = dst[1] = dst[2] = 0.0f;
+            }
+            else {
+                const float scale = a / 255.0f;
+                for (int c = 0; c < 3; ++c) {
+                    const uint32_t straight = std::min(255u, (src[c] * 255u + a / 2) / a);
+                    dst[c] = toLinear[straight] * scale;
+                }
+            }
+            dst[3] = static_cast<float>(a);
+        }
+    }
+
+    void StoreRowLinear(const float* src, uint8_t* dst, uint32_t width) {
+        const uint8_t* toSrgb = LinearToSrgbTable();
+        for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4) {
+            const float a = std::clamp(src[3], 0.0f, 255.0f);
+            const uint32_t alpha = static_cast<uint32_t>(a + 0.5f);
+            if (alpha == 0) {
+                std::memset(dst, 0, 4);
+                continue;
+            }
+            const float unpremultiply = 255.0f / a;
+            for (int c = 0; c < 3; ++c) {
+                const float linear = std::clamp(src[c] * unpremultiply, 0.0f, 255.0f);
+                const uint32_t encoded = toSrgb[static_cast<uint32_t>(linear * LinearSteps + 0.5f)];
+                dst[c] = static_cast<uint8_t>((encoded * alpha + 127) / 255);
+            }
+            dst[3] = static_cast<uint8_t>(alpha);
+        }
+    }
+
+    // Rounds, clamps to 0..255 and keeps colour at or below alpha so the output stays valid PBGRA
+    void StoreRowScalar(const float* src, uint8_t* dst, uint32_t width) {
+        for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4) {
+            const int a = static_cast<int>(std::lrint(std::clamp(src[3], 0.0f, 255.0f)));
+            for (int c = 0; c < 3; ++c) {
+                const int v = static_cast<int>(std::lrint(std::clamp(src[c], 0.0f, 255.0f)));
+                dst[c] = static_cast<uint8_t>(std::min(v, a));
+            }
+            dst[3] = static_cast<uint8_t>(a);
+        }
+    }
+
+    template <typename Sample>
+    void HorizontalScalar(const Sample* in, float* out, const uint32_t* start, const float* w4, uint32_t taps, uint32_t width) {
+        for (uint32_t x = 0; x < width; ++x, out += 4, w4 += static_cast<size_t>(taps) * 4) {
+            const Sample* s = in + static_cast<size_t>(start[x]) * 4;
+            float sum[4] = {};
+            for (uint32_t t = 0; t < taps; ++t) {
+                const float w = w4[t * 4];
+                for (int c = 0; c < 4; ++c) sum[c] += w * static_cast<float>(s[t * 4 + c]);
+            }
+            for (int c = 0; c < 4; ++c) out[c] = sum[c];
+        }
+    }
+
+    void VerticalScalar(const float* const* rows, const float* w, uint32_t taps, float* out, size_t count) {
+        std::fill(out, out + count, 0.0f);
+        for (uint32_t t = 0; t < taps; ++t) {
+            const float wt = w[t];
+            const float* row = rows[t];
+            for (size_t i = 0; i < count; ++i) out[i] += wt * row[i];
+        }
+    }
+
+#if SIMD_X86
+    void StoreRowSse2(const float* src, uint8_t* dst, uint32_t width) {
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            const float* s = src + x * 4;
+            __m128i p01 = _mm_packs_epi32(_mm_cvtps_epi32(_mm_loadu_ps(s)), _mm_cvtps_epi32(_mm_loadu_ps(s + 4)));
+            __m128i p23 = _mm_packs_epi32(_mm_cvtps_epi32(_mm_loadu_ps(s + 8)), _mm_cvtps_epi32(_mm_loadu_ps(s + 12)));
+            __m128i v = _mm_packus_epi16(p01, p23);
+
+            // Broadcast each alpha across its pixel and clamp colour to it
+            __m128i a = _mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xFF000000u)));
+            a = _mm_or_si128(a, _mm_srli_epi32(a, 8));
+            a = _mm_or_si128(a, _mm_srli_epi32(a, 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_min_epu8(v, a));
+        }
+        if (x < width) {
+            StoreRowScalar(src + x * 4, dst + x * 4, width - x);
+        }
+    }
+
+    SIMD_TARGET_AVX2 inline __m256 LoadPair(const uint8_t* s) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s))));
+    }
+    SIMD_TARGET_AVX2 inline __m256 LoadPair(const float* s) {
+        return _mm256_loadu_ps(s);
+    }
+    SIMD_TARGET_AVX2 inline __m128 LoadOne(const uint8_t* s) {
+        int packed;
+        std::memcpy(&packed, s, 4);
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+    }
+    SIMD_TARGET_AVX2 inline __m128 LoadOne(const float* s) {
+        return _mm_loadu_ps(s);
+    }
+
+    // Two taps per 256-bit multiply, weights are pre-expanded so each pair loads as one vector
+    template <typename Sample>
+    SIMD_TARGET_AVX2 void HorizontalAvx2(const Sample* in, float* out, const uint32_t* start, const float* w4, uint32_t taps, uint32_t width) {
+        for (uint32_t x = 0; x < width; ++x, out += 4, w4 += static_cast<size_t>(taps) * 4) {
+            const Sample* s = in + static_cast<size_t>(start[x]) * 4;
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            uint32_t t = 0;
+            for (; t + 4 <= taps; t += 4) {
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(LoadPair(s + t * 4), _mm256_loadu_ps(w4 + t * 4)));
+                acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(LoadPair(s + t * 4 + 8), _mm256_loadu_ps(w4 + t * 4 + 8)));
+            }
+            for (; t + 2 <= taps; t += 2) {
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(LoadPair(s + t * 4), _mm256_loadu_ps(w4 + t * 4)));
+            }
+            acc0 = _mm256_add_ps(acc0, acc1);
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+            if (t < taps) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(LoadOne(s + t * 4), _mm_loadu_ps(w4 + t * 4)));
+            }
+            _mm_storeu_ps(out, sum);
+        }
+    }
+
+    // Fixed-point 8-bit path: pixels widened to 16 bits and paired with madd, four taps per 256-bit step.
+    // Weights are stored as [w(t), w(t+1)] repeated per channel, one 8 x int16 block per tap pair.
+    SIMD_TARGET_AVX2 void HorizontalFixedAvx2(const uint8_t* in, float* out, const uint32_t* start, const int16_t* w16, uint32_t taps, uint32_t width) {
+        // Interleave channel c of pixel 0 and 1 (and 2 and 3) so madd sums one tap pair per channel
+        const __m128i pairOrder = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+        const __m128 toFloat = _mm_set1_ps(1.0f / WeightOne);
+        const size_t blocksPerPixel = (taps + 1) / 2;
+
+        for (uint32_t x = 0; x < width; ++x, out += 4, w16 += blocksPerPixel * 8) {
+            const uint8_t* s = in + static_cast<size_t>(start[x]) * 4;
+            __m256i acc = _mm256_setzero_si256();
+            uint32_t t = 0;
+            for (; t + 4 <= taps; t += 4) {
+                __m128i px = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + t * 4)), pairOrder);
+                __m256i wide = _mm256_cvtepu8_epi16(px);
+                acc = _mm256_add_epi32(acc, _mm256_madd_epi16(wide, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w16 + t * 4))));
+            }
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            if (t + 2 <= taps) {
+                __m128i px = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + t * 4)), pairOrder);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_cvtepu8_epi16(px), _mm_loadu_si128(reinterpret_cast<const __m128i*>(w16 + t * 4))));
+                t += 2;
+            }
+            if (t < taps) {
+                // Odd last tap pairs with a zero weight, the pixel after it is never read
+                int packed;
+                std::memcpy(&packed, s + t * 4, 4);
+                __m128i px = _mm_unpacklo_epi16(_mm_cvtepu8_epi16(_mm_cvtsi32_si128(packed)), _mm_setzero_si128());
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(px, _mm_loadu_si128(reinterpret_cast<const __m128i*>(w16 + t * 4))));
+            }
+            _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(sum), toFloat));
+        }
+    }
+
+    // 32 floats per block so the accumulators stay in registers across all taps
+    SIMD_TARGET_AVX2 void VerticalAvx2(const float* const* rows, const float* w, uint32_t taps, float* out, size_t count) {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+            for (uint32_t t = 0; t < taps; ++t) {
+                const __m256 wt = _mm256_set1_ps(w[t]);
+                const float* r = rows[t] + i;
+                a0 = _mm256_add_ps(a0, _mm256_mul_ps(wt, _mm256_loadu_ps(r)));
+                a1 = _mm256_add_ps(a1, _mm256_mul_ps(wt, _mm256_loadu_ps(r + 8)));
+                a2 = _mm256_add_ps(a2, _mm256_mul_ps(wt, _mm256_loadu_ps(r + 16)));
+                a3 = _mm256_add_ps(a3, _mm256_mul_ps(wt, _mm256_loadu_ps(r + 24)));
+            }
+            _mm256_storeu_ps(out + i, a0);
+            _mm256_storeu_ps(out + i + 8, a1);
+            _mm256_storeu_ps(out + i + 16, a2);
+            _mm256_storeu_ps(out + i + 24, a3);
+        }
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = _mm_setzero_ps();
+            for (uint32_t t = 0; t < taps; ++t) {
+                a = _mm_add_ps(a, _mm_mul_ps(_mm_set1_ps(w[t]), _mm_loadu_ps(rows[t] + i)));
+            }
+            _mm_storeu_ps(out + i, a);
+        }
+    }
+#endif
+}
+
+void Resampler::Axis::Build(uint32_t srcSize, uint32_t dstSize, ResampleFilter filter) {
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const double filterScale = std::max(scale, 1.0);
+    const double support = FilterSupport(filter) * filterScale;
+
+    taps = std::min<uint32_t>(srcSize, static_cast<uint32_t>(std::ceil(support)) * 2 + 1);
+    start.assign(dstSize, 0);
+    weights.assign(static_cast<size_t>(dstSize) * taps, 0.0f);
+
+    std::vector<double> w(taps);
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        int64_t first = std::max<int64_t>(0, static_cast<int64_t>(std::floor(center - support + 0.5)));
+        int64_t last = std::min<int64_t>(srcSize, static_cast<int64_t>(std::floor(center + support + 0.5)));
+        if (last <= first) {
+            first = std::clamp<int64_t>(static_cast<int64_t>(center), 0, srcSize - 1);
+            last = first + 1;
+        }
+        const uint32_t n = std::min<uint32_t>(taps, static_cast<uint32_t>(last - first));
+
+        double sum = 0.0;
+        for (uint32_t j = 0; j < n; ++j) {
+            w[j] = FilterWeight(filter, (first + j + 0.5 - center) / filterScale);
+            sum += w[j];
+        }
+        if (sum == 0.0) {
+            std::fill(w.begin(), w.begin() + n, 0.0);
+            w[std::min<uint32_t>(n - 1, static_cast<uint32_t>(center - first))] = 1.0;
+            sum = 1.0;
+        }
+
+        // Every window is exactly taps wide and inside the source, so edge samples need no bounds checks
+        const uint32_t windowStart = std::min(static_cast<uint32_t>(first), srcSize - taps);
+        start[i] = windowStart;
+        float* dst = weights.data() + static_cast<size_t>(i) * taps + (first - windowStart);
+        for (uint32_t j = 0; j < n; ++j) {
+            dst[j] = static_cast<float>(w[j] / sum);
+        }
+    }
+}
+
+bool Resampler::Init(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, const ResampleOptions& options) {
+    if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) return false;
+
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+    m_options = options;
+    m_x.Build(srcWidth, dstWidth, options.filter);
+    m_y.Build(srcHeight, dstHeight, options.filter);
+
+    m_xWeights4.resize(m_x.weights.size() * 4);
+    for (size_t i = 0; i < m_x.weights.size(); ++i) {
+        std::fill_n(m_xWeights4.begin() + i * 4, 4, m_x.weights[i]);
+    }
+
+    // Fixed-point copy for the 8-bit path, rounding error goes to the largest tap so each row sums to one
+    const uint32_t pairBlocks = (m_x.taps + 1) / 2;
+    m_xWeights16.assign(static_cast<size_t>(dstWidth) * pairBlocks * 8, 0);
+    std::vector<int> fixed(m_x.taps);
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+        const float* w = m_x.weights.data() + static_cast<size_t>(x) * m_x.taps;
+        int sum = 0;
+        uint32_t largest = 0;
+        for (uint32_t t = 0; t < m_x.taps; ++t) {
+            fixed[t] = static_cast<int>(std::lround(w[t] * WeightOne));
+            sum += fixed[t];
+            if (std::abs(fixed[t]) > std::abs(fixed[largest])) largest = t;
+        }
+        fixed[largest] += WeightOne - sum;
+
+        int16_t* dst = m_xWeights16.data() + static_cast<size_t>(x) * pairBlocks * 8;
+        for (uint32_t t = 0; t < m_x.taps; ++t) {
+            int16_t* block = dst + (t / 2) * 8 + (t & 1);
+            for (int c = 0; c < 4; ++c) block[c * 2] = static_cast<int16_t>(fixed[t]);
+        }
+    }
+
+    // The ring must hold every source row one chunk of output rows can touch
+    m_chunkRows = std::min(ChunkRows, dstHeight);
+    m_cacheRows = 0;
+    for (uint32_t y0 = 0; y0 < dstHeight; y0 += m_chunkRows) {
+        const uint32_t y1 = std::min(dstHeight, y0 + m_chunkRows);
+        m_cacheRows = std::max(m_cacheRows, m_y.start[y1 - 1] + m_y.taps - m_y.start[y0]);
+    }
+    m_cache.assign(static_cast<size_t>(m_cacheRows) * dstWidth * 4, 0.0f);
+    return true;
+}
+
+void Resampler::HorizontalRows(const uint8_t* src, size_t stride, uint32_t firstRow, uint32_t count) {
+#if SIMD_X86
+    const bool avx2 = GetCpuFeatures().avx2;
+#endif
+    ParallelFor(count, 4, [&](uint32_t begin, uint32_t end) {
+        std::vector<float> linear(m_options.linearLight ? static_cast<size_t>(m_srcWidth) * 4 : 0);
+        for (uint32_t r = begin; r < end; ++r) {
+            const uint8_t* in = src + static_cast<size_t>(r) * stride;
+            float* out = CacheRow(firstRow + r);
+#if SIMD_X86
+            if (avx2) {
+                if (m_options.linearLight) {
+                    LinearizeRow(in, linear.data(), m_srcWidth);
+                    HorizontalAvx2(linear.data(), out, m_x.start.data(), m_xWeights4.data(), m_x.taps, m_dstWidth);
+                }
+                else {
+                    HorizontalFixedAvx2(in, out, m_x.start.data(), m_xWeights16.data(), m_x.taps, m_dstWidth);
+                }
+                continue;
+            }
+#endif
+            if (m_options.linearLight) {
+                LinearizeRow(in, linear.data(), m_srcWidth);
+                HorizontalScalar(linear.data(), out, m_x.start.data(), m_xWeights4.data(), m_x.taps, m_dstWidth);
+            }
+            else {
+                HorizontalScalar(in, out, m_x.start.data(), m_xWeights4.data(), m_x.taps, m_dstWidth);
+            }
+        }
+        });
+}
+
+void Resampler::VerticalRows(uint32_t dstY0, uint32_t dstY1, uint8_t* dst, size_t dstStride) const {
+#if SIMD_X86
+    const bool avx2 = GetCpuFeatures().avx2;
+#endif
+    const size_t rowFloats = static_cast<size_t>(m_dstWidth) * 4;
+    ParallelFor(dstY1 - dstY0, 2, [&](uint32_t begin, uint32_t end) {
+        std::vector<float> row(rowFloats);
+        std::vector<const float*> rows(m_y.taps);
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t y = dstY0 + i;
+            for (uint32_t t = 0; t < m_y.taps; ++t) rows[t] = CacheRow(m_y.start[y] + t);
+            const float* w = m_y.weights.data() + static_cast<size_t>(y) * m_y.taps;
+            uint8_t* out = dst + static_cast<size_t>(y) * dstStride;
+
+#if SIMD_X86
+            if (avx2) {
+                VerticalAvx2(rows.data(), w, m_y.taps, row.data(), rowFloats);
+            }
+            else {
+                VerticalScalar(rows.data(), w, m_y.taps, row.data(), rowFloats);
+            }
+            if (m_options.linearLight) StoreRowLinear(row.data(), out, m_dstWidth);
+            else StoreRowSse2(row.data(), out, m_dstWidth);
+#else
+            VerticalScalar(rows.data(), w, m_y.taps, row.data(), rowFloats);
+            if (m_options.linearLight) StoreRowLinear(row.data(), out, m_dstWidth);
+            else StoreRowScalar(row.data(), out, m_dstWidth);
+#endif
+        }
+        });
+}
+
+bool Resampler::Run(const FetchRows& fetch, uint8_t* dst, size_t dstStride) {
+    if (m_cache.empty()) return false;
+
+    uint32_t fetched = 0;
+    for (uint32_t y0 = 0; y0 < m_dstHeight; y0 += m_chunkRows) {
+        const uint32_t y1 = std::min(m_dstHeight, y0 + m_chunkRows);
+        const uint32_t needed = m_y.start[y1 - 1] + m_y.taps;
+
+        // Rows already filtered for the previous chunk stay in the ring, only new ones are fetched
+        if (needed > fetched) {
+            size_t stride = 0;
+            const uint8_t* rows = fetch(fetched, needed - fetched, stride);
+            if (!rows) return false;
+            HorizontalRows(rows, stride, fetched, needed - fetched);
+            fetched = needed;
+        }
+        VerticalRows(y0, y1, dst, dstStride);
+    }
+    return true;
+}
+
+bool ResampleBgra8(
+    const uint8_t* src, size_t srcStride, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstStride, uint32_t dstWidth, uint32_t dstHeight,
+    const ResampleOptions& options)
+{
+    Resampler resampler;
+    if (!resampler.Init(srcWidth, srcHeight, dstWidth, dstHeight, options)) return false;
+    return resampler.Run([&](uint32_t y, uint32_t, size_t& stride) {
+        stride = srcStride;
+        return src + static_cast<size_t>(y) * srcStride;
+        }, dst, dstStride);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Separable resampler for 32bpp premultiplied BGRA.
+// Filter weights are computed once per axis. Source rows go through the horizontal pass as they
+// arrive and are kept only while the vertical filter still needs them, so a huge source can be
+// streamed in strips. Both passes run across the worker pool, with AVX2 bodies where available.
+
+enum class ResampleFilter {
+    Box,
+    Triangle,
+    Mitchell,
+    Lanczos3
+};
+
+struct ResampleOptions {
+    ResampleFilter filter = ResampleFilter::Lanczos3;
+    bool linearLight = false;   // Filter in linear light instead of on sRGB-encoded values
+};
+
+class Resampler {
+public:
+    bool Init(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, const ResampleOptions& options);
+
+    // Hands out source rows [y, y + count). Called from the calling thread in increasing order,
+    // each row is requested once. Returns the first row and its stride, or nullptr to abort.
+    using FetchRows = std::function<const uint8_t* (uint32_t y, uint32_t count, size_t& stride)>;
+
+    bool Run(const FetchRows& fetch, uint8_t* dst, size_t dstStride);
+
+private:
+    struct Axis {
+        uint32_t taps = 0;                // Weights per output sample, zero padded
+        std::vector<uint32_t> start;      // First source index per output sample
+        std::vector<float> weights;       // taps per output sample
+        void Build(uint32_t srcSize, uint32_t dstSize, ResampleFilter filter);
+    };
+
+    void HorizontalRows(const uint8_t* src, size_t stride, uint32_t firstRow, uint32_t count);
+    void VerticalRows(uint32_t dstY0, uint32_t dstY1, uint8_t* dst, size_t dstStride) const;
+    float* CacheRow(uint32_t srcY) { return m_cache.data() + static_cast<size_t>(srcY % m_cacheRows) * m_dstWidth * 4; }
+    const float* CacheRow(uint32_t srcY) const { return m_cache.data() + static_cast<size_t>(srcY % m_cacheRows) * m_dstWidth * 4; }
+
+    uint32_t m_srcWidth = 0;
+    uint32_t m_srcHeight = 0;
+    uint32_t m_dstWidth = 0;
+    uint32_t m_dstHeight = 0;
+    ResampleOptions m_options;
+    Axis m_x;
+    Axis m_y;
+    std::vector<float> m_xWeights4;   // Horizontal weights with each one repeated per channel
+    std::vector<int16_t> m_xWeights16; // Same in 2.14 fixed point, interleaved per tap pair
+    uint32_t m_chunkRows = 0;         // Destination rows produced per fetched strip
+    uint32_t m_cacheRows = 0;         // Ring of horizontally filtered source rows
+    std::vector<float> m_cache;
+};
+
+// Whole-image convenience wrapper over Resampler for a source already in memory
+bool ResampleBgra8(
+    const uint8_t* src, size_t srcStride, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstStride, uint32_t dstWidth, uint32_t dstHeight,
+    const ResampleOptions& options = {});
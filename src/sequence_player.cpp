@@ -0,0 +1,224 @@
+#include "sequence_player.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    struct NumberedName {
+        std::wstring before;      // Directory and name up to the number
+        std::wstring after;       // Rest of the name and the extension
+        uint64_t number = 0;
+        bool valid = false;
+    };
+
+    bool IsDigit(wchar_t c) {
+        return c >= L'0' && c <= L'9';
+    }
+
+    NumberedName SplitNumber(const std::wstring& path) {
+        NumberedName name;
+        const size_t slash = path.find_last_of(L"\\/");
+        const size_t nameStart = slash == std::wstring::npos ? 0 : slash + 1;
+        size_t end = path.find_last_of(L'.');
+        if (end == std::wstring::npos || end < nameStart) end = path.size();
+
+        size_t last = end;
+        while (last > nameStart && !IsDigit(path[last - 1])) --last;
+        size_t first = last;
+        while (first > nameStart && IsDigit(path[first - 1])) --first;
+        if (first == last || last - first > 18) return name;
+
+        for (size_t i = first; i < last; ++i) name.number = name.number * 10 + (path[i] - L'0');
+        name.before = path.substr(0, first);
+        name.after = path.substr(last);
+        name.valid = true;
+        return name;
+    }
+}
+
+FrameSequenceRange FindFrameSequence(const std::vector<std::wstring>& files, size_t index) {
+    if (index >= files.size()) return {};
+    const NumberedName center = SplitNumber(files[index]);
+    if (!center.valid) return { index, 1 };
+
+    const auto sameRun = [&](const NumberedName& name) {
+        return name.valid && name.before == center.before && name.after == center.after;
+        };
+    size_t first = index;
+    for (uint64_t number = center.number; first > 0; --first) {
+        const NumberedName name = SplitNumber(files[first - 1]);
+        if (!sameRun(name) || name.number >= number) break;
+        number = name.number;
+    }
+    size_t last = index;
+    for (uint64_t number = center.number; last + 1 < files.size(); ++last) {
+        const NumberedName name = SplitNumber(files[last + 1]);
+        if (!sameRun(name) || name.number <= number) break;
+        number = name.number;
+    }
+    return { first, last - first + 1 };
+}
+
+void SequencePlayer::Start(size_t frameCount, size_t frame, double fps, Clock clock, DecodeFrame decode, uint32_t slots, uint32_t threads) {
+    Stop();
+    if (frameCount == 0 || fps <= 0.0 || !clock) return;
+
+    m_frameCount = frameCount;
+    m_fps = fps;
+    m_clock = std::move(clock);
+    m_startUs = m_clock();
+    m_startPosition = static_cast<int64_t>(frame % frameCount);
+    m_decode = std::move(decode);
+
+    // Every worker needs a buffer of its own to be of any use
+    threads = std::max(threads, 1u);
+    m_buffers.assign(static_cast<size_t>(std::max(slots, threads)) + 1, SequenceFrame{});
+    m_free.clear();
+    for (size_t i = m_buffers.size(); i-- > 0;) m_free.push_back(i);
+    m_ready.clear();
+    m_decoding.clear();
+    m_presented = m_startPosition;
+    m_presentedBuffer = SIZE_MAX;
+    m_next = m_presented + 1;
+    m_due = m_presented;
+    m_meanDecodeUs = 0;
+    m_strideCarry = 0.0;
+    m_stop = false;
+    m_threads = threads;
+    for (uint32_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back(&SequencePlayer::WorkerLoop, this);
+    }
+}
+
+void SequencePlayer::Stop() {
+    if (m_workers.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+    m_workers.clear();
+
+    m_ready.clear();
+    m_decoding.clear();
+    m_free.clear();
+    m_buffers.clear();
+    m_buffers.shrink_to_fit();
+    m_presentedBuffer = SIZE_MAX;
+    m_decode = nullptr;
+    m_clock = nullptr;
+}
+
+bool SequencePlayer::Present(Presented& out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_workers.empty()) return false;
+    const int64_t nowUs = m_clock();
+    const int64_t due = DueAt(nowUs);
+    if (due == m_presented) return false;
+    m_due = std::max(m_due, due);
+
+    // Frames finished before the due one have missed their turn, only the newest is shown
+    const int64_t previous = m_presented;
+    while (!m_ready.empty() && m_ready.begin()->first <= due) {
+        if (m_presentedBuffer != SIZE_MAX) m_free.push_back(m_presentedBuffer);
+        m_presentedBuffer = m_ready.begin()->second;
+        m_presented = m_ready.begin()->first;
+        m_ready.erase(m_ready.begin());
+    }
+
+    const auto pending = m_decoding.upper_bound(m_presented);
+    if (pending != m_decoding.end() && *pending <= due) ++m_stats.late;
+    if (m_presented == previous) return false;
+    if (m_stats.presented == 0) m_stats.firstPresentUs = nowUs;
+    ++m_stats.presented;
+    m_stats.lastPresentUs = nowUs;
+    m_stats.dropped += static_cast<uint64_t>(m_presented - previous - 1);
+
+    out.frame = &m_buffers[m_presentedBuffer];
+    out.index = static_cast<size_t>(m_presented % static_cast<int64_t>(m_frameCount));
+    lock.unlock();
+    m_wake.notify_all();
+    return true;
+}
+
+int64_t SequencePlayer::UntilNextUs() const {
+    if (m_fps <= 0.0 || !m_clock) return 0;
+    const int64_t nowUs = m_clock();
+    const int64_t next = DueAt(nowUs) + 1;
+    const int64_t at = m_startUs + static_cast<int64_t>(std::ceil((next - m_startPosition) * 1e6 / m_fps));
+    return std::max<int64_t>(at - nowUs, 0);
+}
+
+size_t SequencePlayer::Queued() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready.size();
+}
+
+SequencePlaybackStats SequencePlayer::Stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void SequencePlayer::ResetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = {};
+}
+
+int64_t SequencePlayer::DueAt(int64_t nowUs) const {
+    const double elapsed = static_cast<double>(std::max<int64_t>(nowUs - m_startUs, 0));
+    return m_startPosition + static_cast<int64_t>(elapsed * m_fps / 1e6);
+}
+
+void SequencePlayer::WorkerLoop() {
+    for (;;) {
+        int64_t position = 0;
+        size_t buffer = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || !m_free.empty(); });
+            if (m_stop) return;
+            buffer = m_free.back();
+            m_free.pop_back();
+
+            // Behind the timeline, go for the frame that will be due once this decode is done
+            const double decodeFrames = m_meanDecodeUs * m_fps / 1e6;
+            const int64_t lead = static_cast<int64_t>(std::ceil(decodeFrames));
+            if (m_next < m_due + lead) m_next = m_due + lead;
+
+            // More frames due than the workers together can decode, so frames are taken at an even
+            // fractional stride and the ones shown stay evenly spaced instead of arriving in bursts
+            const double stride = decodeFrames / m_threads;
+            m_strideCarry = stride > 1.0 ? m_strideCarry + stride : 1.0;
+            const int64_t step = std::max<int64_t>(static_cast<int64_t>(m_strideCarry), 1);
+            m_strideCarry -= static_cast<double>(step);
+            position = m_next;
+            m_next += step;
+            m_decoding.insert(position);
+        }
+
+        const int64_t start = m_clock();
+        const bool decoded = m_decode(static_cast<size_t>(position % static_cast<int64_t>(m_frameCount)), m_buffers[buffer]);
+        const int64_t elapsed = m_clock() - start;
+
+        bool keep = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding.erase(position);
+            if (decoded) {
+                ++m_stats.decoded;
+                m_stats.decodeUs += elapsed;
+                m_meanDecodeUs = m_meanDecodeUs ? (m_meanDecodeUs * 7 + elapsed) / 8 : elapsed;
+            }
+            else {
+                ++m_stats.failed;
+            }
+
+            // Shown past while it was decoding, the buffer goes straight back
+            keep = decoded && position > m_presented;
+            if (keep) m_ready.emplace(position, buffer);
+            else m_free.push_back(buffer);
+        }
+        if (!keep) m_wake.notify_one();
+    }
+}
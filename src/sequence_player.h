@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plays a numbered run of image files (frame_0001.png, frame_0002.png, ...) as video.
+// Several workers decode ahead of the frame on screen into a ring of reusable buffers, each taking
+// the next frame nobody has claimed, so frames finish out of order and wait in the ring until due.
+// The timeline runs at a fixed rate from the frame playback started on. Each tick shows the newest
+// finished frame at or before the due one. A worker that finds the timeline ahead of it jumps to
+// the frame that will be due once its decode is done, rather than decode frames already late.
+// Frames passed over either way count as dropped. Decoding is the caller's, through a callback,
+// so the core has no platform dependencies. So is the clock, microseconds on any monotonic scale,
+// read for the timeline and for the decode times alike.
+
+struct FrameSequenceRange {
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// The run of files around index whose names differ only in one number, rising from each file to
+// the next as renderers write them. The number is the last group of digits before the extension.
+// Count is 1 when the file is not part of a run.
+FrameSequenceRange FindFrameSequence(const std::vector<std::wstring>& files, size_t index);
+
+struct SequenceFrame {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;   // PBGRA, width * 4 bytes per row
+};
+
+struct SequencePlaybackStats {
+    uint64_t presented = 0;
+    uint64_t late = 0;             // Ticks where a frame meant for by then was still decoding
+    uint64_t dropped = 0;          // Frames never shown, skipped by either side or failed
+    uint64_t decoded = 0;
+    uint64_t failed = 0;
+    int64_t decodeUs = 0;          // Summed over the workers
+    int64_t firstPresentUs = 0;
+    int64_t lastPresentUs = 0;
+
+    double AchievedFps() const {
+        return presented > 1 && lastPresentUs > firstPresentUs ? (presented - 1) * 1e6 / static_cast<double>(lastPresentUs - firstPresentUs) : 0.0;
+    }
+    double MeanDecodeMs() const { return decoded ? static_cast<double>(decodeUs) / decoded / 1000.0 : 0.0; }
+};
+
+class SequencePlayer {
+public:
+    // Called from several workers at once. out still holds whatever frame was decoded into it
+    // last, so its buffer can be reused. False skips the frame.
+    using DecodeFrame = std::function<bool(size_t frame, SequenceFrame& out)>;
+
+    // Called from the workers too
+    using Clock = std::function<int64_t()>;
+
+    struct Presented {
+        const SequenceFrame* frame = nullptr;  // Valid until the next Present or Stop
+        size_t index = 0;
+    };
+
+    ~SequencePlayer() { Stop(); }
+
+    // frame is on screen now and the timeline starts from it, looping over frameCount.
+    // slots is how many decoded frames may wait, one more buffer holds the presented frame.
+    void Start(size_t frameCount, size_t frame, double fps, Clock clock, DecodeFrame decode, uint32_t slots, uint32_t threads);
+    void Stop();
+    bool IsRunning() const { return !m_workers.empty(); }
+
+    // Moves on to the frame due now, or the newest finished one short of it. False when
+    // nothing newer than the frame on screen is ready.
+    bool Present(Presented& out);
+
+    // Time left until the frame after the one due now
+    int64_t UntilNextUs() const;
+
+    double Fps() const { return m_fps; }
+    size_t Queued();
+    SequencePlaybackStats Stats();
+    void ResetStats();
+
+private:
+    void WorkerLoop();
+    int64_t DueAt(int64_t nowUs) const;
+
+    size_t m_frameCount = 0;
+    double m_fps = 0.0;
+    int64_t m_startUs = 0;
+    int64_t m_startPosition = 0;
+    Clock m_clock;
+    DecodeFrame m_decode;
+    std::vector<SequenceFrame> m_buffers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    std::map<int64_t, size_t> m_ready;  // Playback position to buffer, finished frames not yet shown
+    std::vector<size_t> m_free;
+    std::set<int64_t> m_decoding;       // Positions claimed by workers and not finished
+    int64_t m_presented = 0;            // Playback position on screen, frames repeat every loop
+    size_t m_presentedBuffer = SIZE_MAX;
+    int64_t m_next = 0;                 // Position the next idle worker decodes
+    int64_t m_due = 0;                  // Latest position asked for
+    int64_t m_meanDecodeUs = 0;         // Running average, how far ahead a late worker aims
+    double m_strideCarry = 0.0;         // Fraction of a frame the stride has yet to move on
+    uint32_t m_threads = 0;             // Worker count, read by workers while Start is still adding to m_workers
+    SequencePlaybackStats m_stats;
+    std::vector<std::thread> m_workers;
+};
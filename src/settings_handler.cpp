@@ -11,12 +11,14 @@ void ViewerApp::ReadSettings(const std::wstring& path, WINDOWPLACEMENT& wp, bool
     singleInstance = getInt(L"Settings", L"EnforceSingleInstance", 1) == 1;
     m_ctx.alwaysOnTop = getInt(L"Settings", L"AlwaysOnTop", 0) == 1;
     m_ctx.smoothScaling = getInt(L"Settings", L"SmoothScaling", 1) == 1;
+    m_ctx.linearLightScaling = getInt(L"Settings", L"LinearLightScaling", 0) == 1;
     m_ctx.enableFadeAnimation = getInt(L"Settings", L"EnableFadeAnimation", 1) == 1;
     m_ctx.isOsdVisible = getInt(L"Settings", L"ShowOSD", 0) == 1;
     m_ctx.askToDelete = getInt(L"Settings", L"AskToDelete", 1) == 1;
     m_ctx.preserveZoomOnResize = getInt(L"Settings", L"PreserveZoomOnResize", 0) == 1;
     m_ctx.isAutoRefresh = getInt(L"Settings", L"AutoRefresh", 0) == 1;
     m_ctx.slideshowIntervalSeconds = getInt(L"Settings", L"SlideshowInterval", 3);
+    m_ctx.sequenceFps = std::clamp(getInt(L"Settings", L"SequenceFps", 24), 1, 240);
 
     int bgChoice = getInt(L"Settings", L"BackgroundColor", 0);
     m_ctx.bgColor = static_cast<BackgroundColor>((bgChoice < 0 || bgChoice > 3) ? 0 : bgChoice);
@@ -28,6 +30,13 @@ void ViewerApp::ReadSettings(const std::wstring& path, WINDOWPLACEMENT& wp, bool
     m_ctx.currentSortCriteria = static_cast<SortCriteria>((sortChoice < 0 || sortChoice > 2) ? 0 : sortChoice);
 
     m_ctx.isSortAscending = getInt(L"Settings", L"SortAscending", 1) == 1;
+
+    int toneChoice = getInt(L"HDR", L"ToneOperator", 0);
+    m_ctx.hdrTone.op = static_cast<HdrToneOperator>((toneChoice < 0 || toneChoice > 3) ? 0 : toneChoice);
+    int gammaTenths = getInt(L"HDR", L"GammaTenths", 22);
+    m_ctx.hdrTone.gamma = std::clamp(gammaTenths, 10, 30) / 10.0f;
+    m_ctx.hdrAutoExposure = getInt(L"HDR", L"AutoExposure", 0) == 1;
+
     wp.length = sizeof(WINDOWPLACEMENT);
     wp.rcNormalPosition.left = CW_USEDEFAULT;
     wp.showCmd = SW_SHOWNORMAL;
@@ -37,12 +46,14 @@ void ViewerApp::ReadSettings(const std::wstring& path, WINDOWPLACEMENT& wp, bool
     const wchar_t* keyNames[Act_Count] = {
         L"Next", L"Prev", L"ZoomIn", L"ZoomOut", L"Fit", L"Actual", L"Fullscreen", L"RotateCW", L"RotateCCW", L"Flip", L"Crop", L"CustomZoom", L"Exit",
         L"Open", L"Refresh", L"Copy", L"Paste", L"Save", L"SaveAs", L"Delete", L"Undo", L"CenterImage", L"CommitCrop", L"ToggleOSD", L"PlayPause", L"ResumeAnim",
-        L"AnimNext", L"AnimPrev", L"AnimFirst", L"ContextMenu", L"Slideshow"
+        L"AnimNext", L"AnimPrev", L"AnimFirst", L"ContextMenu", L"Slideshow", L"HdrExposureUp", L"HdrExposureDown",
+        L"SequencePlay"
     };
     const WORD defaultKeys[Act_Count] = {
         MAKEWORD(VK_RIGHT, HOTKEYF_EXT), MAKEWORD(VK_LEFT, HOTKEYF_EXT), MAKEWORD(VK_ADD, HOTKEYF_CONTROL), MAKEWORD(VK_SUBTRACT, HOTKEYF_CONTROL), MAKEWORD('0', HOTKEYF_CONTROL), MAKEWORD(VK_MULTIPLY, HOTKEYF_CONTROL), VK_F11, MAKEWORD(VK_UP, HOTKEYF_EXT), MAKEWORD(VK_DOWN, HOTKEYF_EXT), 'F', 'C', MAKEWORD('Z', HOTKEYF_CONTROL | HOTKEYF_SHIFT), VK_ESCAPE,
         MAKEWORD('O', HOTKEYF_CONTROL), VK_F5, MAKEWORD('C', HOTKEYF_CONTROL), MAKEWORD('V', HOTKEYF_CONTROL), MAKEWORD('S', HOTKEYF_CONTROL), MAKEWORD('S', HOTKEYF_CONTROL | HOTKEYF_SHIFT), MAKEWORD(VK_DELETE, HOTKEYF_EXT), MAKEWORD('Z', HOTKEYF_CONTROL), 0, VK_RETURN, 'I', VK_SPACE, MAKEWORD(VK_SPACE, HOTKEYF_SHIFT),
-        MAKEWORD(VK_RIGHT, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_LEFT, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_UP, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_F10, HOTKEYF_SHIFT), 'P'
+        MAKEWORD(VK_RIGHT, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_LEFT, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_UP, HOTKEYF_SHIFT | HOTKEYF_EXT), MAKEWORD(VK_F10, HOTKEYF_SHIFT), 'P',
+        VK_OEM_6, VK_OEM_4, MAKEWORD('P', HOTKEYF_SHIFT)
     };
     for (int i = 0; i < Act_Count; ++i) {
         m_ctx.hotkeys[i] = (WORD)getInt(L"Keys", keyNames[i], defaultKeys[i]);
@@ -67,21 +78,27 @@ void ViewerApp::WriteSettings(const std::wstring& path, const WINDOWPLACEMENT& w
     writeInt(L"Settings", L"EnforceSingleInstance", singleInstance ? 1 : 0);
     writeInt(L"Settings", L"AlwaysOnTop", alwaysOnTop ? 1 : 0);
     writeInt(L"Settings", L"SmoothScaling", m_ctx.smoothScaling ? 1 : 0);
+    writeInt(L"Settings", L"LinearLightScaling", m_ctx.linearLightScaling ? 1 : 0);
     writeInt(L"Settings", L"EnableFadeAnimation", m_ctx.enableFadeAnimation ? 1 : 0);
     writeInt(L"Settings", L"ShowOSD", m_ctx.isOsdVisible ? 1 : 0);
     writeInt(L"Settings", L"AskToDelete", m_ctx.askToDelete ? 1 : 0);
     writeInt(L"Settings", L"PreserveZoomOnResize", m_ctx.preserveZoomOnResize ? 1 : 0);
     writeInt(L"Settings", L"AutoRefresh", m_ctx.isAutoRefresh ? 1 : 0);
     writeInt(L"Settings", L"SlideshowInterval", m_ctx.slideshowIntervalSeconds);
+    writeInt(L"Settings", L"SequenceFps", m_ctx.sequenceFps);
     writeInt(L"Settings", L"BackgroundColor", static_cast<int>(m_ctx.bgColor));
     writeInt(L"Settings", L"DefaultZoomMode", static_cast<int>(m_ctx.defaultZoomMode));
     writeInt(L"Settings", L"SortCriteria", static_cast<int>(m_ctx.currentSortCriteria));
     writeInt(L"Settings", L"SortAscending", m_ctx.isSortAscending ? 1 : 0);
+    writeInt(L"HDR", L"ToneOperator", static_cast<int>(m_ctx.hdrTone.op));
+    writeInt(L"HDR", L"GammaTenths", static_cast<int>(std::lround(m_ctx.hdrTone.gamma * 10.0f)));
+    writeInt(L"HDR", L"AutoExposure", m_ctx.hdrAutoExposure ? 1 : 0);
 
     const wchar_t* keyNames[Act_Count] = {
         L"Next", L"Prev", L"ZoomIn", L"ZoomOut", L"Fit", L"Actual", L"Fullscreen", L"RotateCW", L"RotateCCW", L"Flip", L"Crop", L"CustomZoom", L"Exit",
         L"Open", L"Refresh", L"Copy", L"Paste", L"Save", L"SaveAs", L"Delete", L"Undo", L"CenterImage", L"CommitCrop", L"ToggleOSD", L"PlayPause", L"ResumeAnim",
-        L"AnimNext", L"AnimPrev", L"AnimFirst", L"ContextMenu", L"Slideshow"
+        L"AnimNext", L"AnimPrev", L"AnimFirst", L"ContextMenu", L"Slideshow", L"HdrExposureUp", L"HdrExposureDown",
+        L"SequencePlay"
     };
     for (int i = 0; i < Act_Count; ++i) {
         writeInt(L"Keys", keyNames[i], m_ctx.hotkeys[i]);
@@ -117,7 +134,8 @@ void ViewerApp::UpdateAcceleratorTable() {
         IDM_CROP, IDM_CUSTOM_ZOOM, IDM_EXIT,
         IDM_OPEN, IDM_REFRESH, IDM_COPY, IDM_PASTE, IDM_SAVE, IDM_SAVE_AS, IDM_DELETE_IMG, IDM_UNDO,
         IDM_CENTER_IMAGE, IDM_COMMIT_CROP, IDM_TOGGLE_OSD, IDM_PLAY_PAUSE, IDM_RESUME_ANIM,
-        IDM_ANIM_NEXT_FRAME, IDM_ANIM_PREV_FRAME, IDM_ANIM_FIRST_FRAME, IDM_CONTEXT_MENU, IDM_SLIDESHOW
+        IDM_ANIM_NEXT_FRAME, IDM_ANIM_PREV_FRAME, IDM_ANIM_FIRST_FRAME, IDM_CONTEXT_MENU, IDM_SLIDESHOW,
+        IDM_HDR_EXPOSURE_UP, IDM_HDR_EXPOSURE_DOWN, IDM_SEQUENCE_PLAY
     };
 
     for (int i = 0; i < Act_Count; ++i) {
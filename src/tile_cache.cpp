@@ -0,0 +1,227 @@
+#include "tile_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+void TileGrid::Init(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t levelCount) {
+    m_width = width;
+    m_height = height;
+    m_tileSize = std::max(1u, tileSize);
+    m_levelCount = std::clamp(levelCount, 1u, 24u);
+}
+
+uint32_t TileGrid::LevelWidth(uint32_t level) const {
+    return static_cast<uint32_t>((static_cast<uint64_t>(m_width) + (1ull << level) - 1) >> level);
+}
+
+uint32_t TileGrid::LevelHeight(uint32_t level) const {
+    return static_cast<uint32_t>((static_cast<uint64_t>(m_height) + (1ull << level) - 1) >> level);
+}
+
+uint32_t TileGrid::TilesX(uint32_t level) const {
+    return (LevelWidth(level) + m_tileSize - 1) / m_tileSize;
+}
+
+uint32_t TileGrid::TilesY(uint32_t level) const {
+    return (LevelHeight(level) + m_tileSize - 1) / m_tileSize;
+}
+
+uint32_t TileGrid::TileWidth(const TileKey& key) const {
+    return std::min(m_tileSize, LevelWidth(key.level) - key.x * m_tileSize);
+}
+
+uint32_t TileGrid::TileHeight(const TileKey& key) const {
+    return std::min(m_tileSize, LevelHeight(key.level) - key.y * m_tileSize);
+}
+
+TileRect TileGrid::Bounds(const TileKey& key) const {
+    const double unit = static_cast<double>(1ull << key.level);
+    TileRect rc;
+    rc.left = static_cast<double>(key.x) * m_tileSize * unit;
+    rc.top = static_cast<double>(key.y) * m_tileSize * unit;
+    rc.right = std::min(static_cast<double>(m_width), rc.left + TileWidth(key) * unit);
+    rc.bottom = std::min(static_cast<double>(m_height), rc.top + TileHeight(key) * unit);
+    return rc;
+}
+
+uint32_t TileGrid::LevelForScale(float scale) const {
+    if (!(scale > 0.0f) || scale >= 1.0f) return 0;
+    const int level = static_cast<int>(std::floor(std::log2(1.0 / scale)));
+    return static_cast<uint32_t>(std::clamp(level, 0, static_cast<int>(m_levelCount) - 1));
+}
+
+std::shared_ptr<const TileData> TileCache::Find(const TileKey& key) {
+    auto it = m_index.find(key.Packed());
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->tile;
+}
+
+void TileCache::Insert(const TileKey& key, std::shared_ptr<const TileData> tile) {
+    if (!tile) return;
+    const uint64_t packed = key.Packed();
+    auto it = m_index.find(packed);
+    if (it != m_index.end()) {
+        m_bytes -= it->second->tile->pixels.size();
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+
+    m_bytes += tile->pixels.size();
+    m_lru.push_front({ key, std::move(tile) });
+    m_index[packed] = m_lru.begin();
+    Trim();
+}
+
+void TileCache::Clear() {
+    m_lru.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+void TileCache::SetBudget(size_t budgetBytes) {
+    m_budget = budgetBytes;
+    Trim();
+}
+
+void TileCache::Trim() {
+    while (m_bytes > m_budget && m_lru.size() > 1) {
+        const Entry& victim = m_lru.back();
+        m_bytes -= victim.tile->pixels.size();
+        m_index.erase(victim.key.Packed());
+        m_lru.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+void TileScheduler::Init(const TileGrid& grid) {
+    m_grid = grid;
+    m_hasLast = false;
+    m_velocityX = 0.0;
+    m_velocityY = 0.0;
+}
+
+void TileScheduler::CollectRange(uint32_t level, const TileRect& area, std::vector<TileKey>& keys) const {
+    const double span = static_cast<double>(m_grid.TileSize()) * static_cast<double>(1ull << level);
+    const double left = std::max(0.0, area.left);
+    const double top = std::max(0.0, area.top);
+    const double right = std::min(static_cast<double>(m_grid.Width()), area.right);
+    const double bottom = std::min(static_cast<double>(m_grid.Height()), area.bottom);
+    if (right <= left || bottom <= top) return;
+
+    const uint32_t x0 = static_cast<uint32_t>(left / span);
+    const uint32_t y0 = static_cast<uint32_t>(top / span);
+    const uint32_t x1 = std::min(m_grid.TilesX(level), static_cast<uint32_t>(std::ceil(right / span)));
+    const uint32_t y1 = std::min(m_grid.TilesY(level), static_cast<uint32_t>(std::ceil(bottom / span)));
+    for (uint32_t y = y0; y < y1; ++y) {
+        for (uint32_t x = x0; x < x1; ++x) {
+            keys.push_back({ level, x, y });
+        }
+    }
+}
+
+void TileScheduler::Update(const TileRect& viewport, float scale, double timeSeconds, TileCache& cache,
+    std::vector<TileDraw>& draws, std::vector<TileKey>& requests) {
+    draws.clear();
+    requests.clear();
+    if (m_grid.LevelCount() == 0) return;
+
+    const uint32_t level = m_grid.LevelForScale(scale);
+    const double centerX = (viewport.left + viewport.right) * 0.5;
+    const double centerY = (viewport.top + viewport.bottom) * 0.5;
+
+    // Smoothed pan velocity, a zoom step or a long pause starts over
+    const double dt = timeSeconds - m_lastTime;
+    if (m_hasLast && level == m_lastLevel && dt > 0.0 && dt < 0.5) {
+        m_velocityX = 0.5 * m_velocityX + 0.5 * (centerX - m_lastCenterX) / dt;
+        m_velocityY = 0.5 * m_velocityY + 0.5 * (centerY - m_lastCenterY) / dt;
+    }
+    else if (!m_hasLast || level != m_lastLevel || dt >= 0.5) {
+        m_velocityX = 0.0;
+        m_velocityY = 0.0;
+    }
+    m_hasLast = true;
+    m_lastTime = timeSeconds;
+    m_lastCenterX = centerX;
+    m_lastCenterY = centerY;
+    m_lastLevel = level;
+
+    std::vector<TileKey> visible;
+    CollectRange(level, viewport, visible);
+
+    auto distanceTo = [&](const TileKey& key, double x, double y) {
+        const TileRect rc = m_grid.Bounds(key);
+        const double dx = (rc.left + rc.right) * 0.5 - x;
+        const double dy = (rc.top + rc.bottom) * 0.5 - y;
+        return dx * dx + dy * dy;
+        };
+
+    std::vector<TileDraw> coarse;
+    std::unordered_set<uint64_t> coarseSeen;
+    std::unordered_set<uint64_t> visibleSet;
+    for (const TileKey& key : visible) {
+        visibleSet.insert(key.Packed());
+        if (std::shared_ptr<const TileData> tile = cache.Find(key)) {
+            draws.push_back({ key, std::move(tile), m_grid.Bounds(key) });
+            continue;
+        }
+
+        requests.push_back(key);
+
+        // Nearest cached ancestor stands in until this tile arrives
+        for (uint32_t up = 1; level + up < m_grid.LevelCount(); ++up) {
+            const TileKey parent = { level + up, key.x >> up, key.y >> up };
+            if (!cache.Contains(parent)) continue;
+            if (coarseSeen.insert(parent.Packed()).second) {
+                coarse.push_back({ parent, cache.Find(parent), m_grid.Bounds(parent) });
+            }
+            break;
+        }
+    }
+
+    std::sort(coarse.begin(), coarse.end(), [](const TileDraw& a, const TileDraw& b) { return a.key.level > b.key.level; });
+    draws.insert(draws.begin(), coarse.begin(), coarse.end());
+
+    std::sort(requests.begin(), requests.end(), [&](const TileKey& a, const TileKey& b) {
+        return distanceTo(a, centerX, centerY) < distanceTo(b, centerX, centerY);
+        });
+
+    // Prefetch where the pan is heading, or a one tile ring when the view is still
+    const double span = static_cast<double>(m_grid.TileSize()) * static_cast<double>(1ull << level);
+    TileRect ahead = viewport;
+    const double shiftX = m_velocityX * PrefetchSeconds;
+    const double shiftY = m_velocityY * PrefetchSeconds;
+    if (std::abs(shiftX) + std::abs(shiftY) < span * 0.25) {
+        ahead.left -= span;
+        ahead.top -= span;
+        ahead.right += span;
+        ahead.bottom += span;
+    }
+    else {
+        ahead.left += std::min(0.0, shiftX);
+        ahead.right += std::max(0.0, shiftX);
+        ahead.top += std::min(0.0, shiftY);
+        ahead.bottom += std::max(0.0, shiftY);
+    }
+
+    std::vector<TileKey> prefetch;
+    CollectRange(level, ahead, prefetch);
+    std::erase_if(prefetch, [&](const TileKey& key) {
+        return visibleSet.count(key.Packed()) != 0 || cache.Contains(key);
+        });
+
+    const double aheadX = centerX + shiftX;
+    const double aheadY = centerY + shiftY;
+    std::sort(prefetch.begin(), prefetch.end(), [&](const TileKey& a, const TileKey& b) {
+        return distanceTo(a, aheadX, aheadY) < distanceTo(b, aheadX, aheadY);
+        });
+
+    for (const TileKey& key : prefetch) {
+        if (requests.size() >= MaxRequests) break;
+        requests.push_back(key);
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-size tiles over a power-of-two pyramid of a large image, an LRU cache for their pixels and
+// the viewport logic that decides which tiles to draw and which to decode next.
+// Level 0 is full resolution and level L is reduced by 2^L, rounding sizes up.
+// Nothing here locks, the owner serializes access.
+
+struct TileKey {
+    uint32_t level = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+
+    uint64_t Packed() const { return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(y) << 24) | x; }
+    bool operator==(const TileKey&) const = default;
+};
+
+struct TileData {
+    uint32_t width = 0;             // Edge tiles are clipped to the level size
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;    // 32bpp premultiplied BGRA, width * 4 bytes per row
+};
+
+struct TileRect {
+    double left = 0.0;
+    double top = 0.0;
+    double right = 0.0;
+    double bottom = 0.0;
+};
+
+class TileGrid {
+public:
+    void Init(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t levelCount);
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t TileSize() const { return m_tileSize; }
+    uint32_t LevelCount() const { return m_levelCount; }
+    uint32_t LevelWidth(uint32_t level) const;
+    uint32_t LevelHeight(uint32_t level) const;
+    uint32_t TilesX(uint32_t level) const;
+    uint32_t TilesY(uint32_t level) const;
+
+    // Pixel size of the tile within its level
+    uint32_t TileWidth(const TileKey& key) const;
+    uint32_t TileHeight(const TileKey& key) const;
+
+    // Area the tile covers, in level 0 pixels
+    TileRect Bounds(const TileKey& key) const;
+
+    // Finest level that is not finer than needed for scale (screen pixels per level 0 pixel)
+    uint32_t LevelForScale(float scale) const;
+
+private:
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tileSize = 256;
+    uint32_t m_levelCount = 0;
+};
+
+struct TileCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+class TileCache {
+public:
+    explicit TileCache(size_t budgetBytes = 256u * 1024 * 1024) : m_budget(budgetBytes) {}
+
+    // Marks the tile most recently used. Null when it is not cached.
+    std::shared_ptr<const TileData> Find(const TileKey& key);
+    bool Contains(const TileKey& key) const { return m_index.count(key.Packed()) != 0; }
+
+    // Evicts least recently used tiles until the budget holds again, never the one just added
+    void Insert(const TileKey& key, std::shared_ptr<const TileData> tile);
+    void Clear();
+
+    void SetBudget(size_t budgetBytes);
+    size_t Budget() const { return m_budget; }
+    size_t Bytes() const { return m_bytes; }
+    size_t Count() const { return m_index.size(); }
+    const TileCacheStats& Stats() const { return m_stats; }
+
+private:
+    struct Entry {
+        TileKey key;
+        std::shared_ptr<const TileData> tile;
+    };
+
+    void Trim();
+
+    size_t m_budget = 0;
+    size_t m_bytes = 0;
+    std::list<Entry> m_lru;   // Front is the most recently used
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+    TileCacheStats m_stats;
+};
+
+struct TileDraw {
+    TileKey key;
+    std::shared_ptr<const TileData> tile;
+    TileRect dest;            // Level 0 pixels
+};
+
+class TileScheduler {
+public:
+    void Init(const TileGrid& grid);
+
+    // Collects the cached tiles to draw for the viewport (level 0 pixels), coarse fallbacks first
+    // so finer tiles paint over them, and the tiles to decode next, most urgent first.
+    // Panning velocity is tracked between calls and the viewport is extrapolated along it for prefetch.
+    void Update(const TileRect& viewport, float scale, double timeSeconds, TileCache& cache,
+        std::vector<TileDraw>& draws, std::vector<TileKey>& requests);
+
+    double VelocityX() const { return m_velocityX; }
+    double VelocityY() const { return m_velocityY; }
+
+    static constexpr double PrefetchSeconds = 0.3;
+    static constexpr size_t MaxRequests = 64;
+
+private:
+    void CollectRange(uint32_t level, const TileRect& area, std::vector<TileKey>& keys) const;
+
+    TileGrid m_grid;
+    bool m_hasLast = false;
+    double m_lastTime = 0.0;
+    double m_lastCenterX = 0.0;
+    double m_lastCenterY = 0.0;
+    uint32_t m_lastLevel = 0;
+    double m_velocityX = 0.0;   // Level 0 pixels per second
+    double m_velocityY = 0.0;
+};
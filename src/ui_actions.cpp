@@ -150,6 +150,7 @@ void ViewerApp::HandlePaste() {
                         m_ctx.d2dBitmap = nullptr;
                         m_ctx.animationFrameMetadata.clear();
                         m_ctx.animationFrameDelays.clear();
+                        m_ctx.animationPrefetcher.Stop();
                         m_ctx.isAnimated = false;
                         // clear file context
                         m_ctx.imageFiles.clear();
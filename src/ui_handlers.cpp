@@ -117,6 +117,7 @@ void ViewerApp::HandleCommand(WORD cmd) {
             KillTimer(m_ctx.hWnd, SLIDESHOW_TIMER_ID);
         }
         break;
+    case IDM_SEQUENCE_PLAY: ToggleSequencePlayback(); break;
     case IDM_PREFERENCES:   OpenPreferencesDialog(); break;
     case IDM_KEYBINDINGS:   OpenKeybindingsDialog(); break;
     case IDM_CUSTOM_ZOOM:   OpenZoomDialog(); break;
@@ -156,6 +157,7 @@ void ViewerApp::HandleCommand(WORD cmd) {
             if (!m_ctx.isAnimationPaused) {
                 m_ctx.isAnimationPaused = true;
                 KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
+                m_ctx.animationScheduler.Stop();
             }
             else {
                 m_ctx.currentAnimationFrame = (m_ctx.currentAnimationFrame + 1) % m_ctx.animationFrameDelays.size();
@@ -166,8 +168,7 @@ void ViewerApp::HandleCommand(WORD cmd) {
     case IDM_RESUME_ANIM:
         if (m_ctx.animationFrameDelays.size() > 1 && m_ctx.isAnimationPaused) {
             m_ctx.isAnimationPaused = false;
-            UINT delay = m_ctx.animationFrameDelays[m_ctx.currentAnimationFrame];
-            SetTimer(m_ctx.hWnd, ANIMATION_TIMER_ID, delay > 0 ? delay : 100, nullptr);
+            StartAnimationPlayback();
         }
         break;
     case IDM_ANIM_NEXT_FRAME:
@@ -198,6 +199,19 @@ void ViewerApp::HandleCommand(WORD cmd) {
             UpdateViewToCurrentFrame();
         }
         break;
+    case IDM_HDR_EXPOSURE_UP:
+    case IDM_HDR_EXPOSURE_DOWN:
+    case IDM_HDR_EXPOSURE_RESET:
+    case IDM_HDR_AUTO_EXPOSURE:
+    case IDM_HDR_OP_REINHARD:
+    case IDM_HDR_OP_ACES:
+    case IDM_HDR_OP_HABLE:
+    case IDM_HDR_OP_CLIP:
+    case IDM_HDR_GAMMA_18:
+    case IDM_HDR_GAMMA_22:
+    case IDM_HDR_GAMMA_24:
+        AdjustHdrTone(cmd);
+        break;
     case IDM_SORT_BY_NAME_ASC:
     case IDM_SORT_BY_NAME_DESC:
     case IDM_SORT_BY_DATE_ASC:
@@ -278,8 +292,40 @@ void ViewerApp::OnContextMenu(HWND hWnd, POINT pt) {
     AppendMenuW(hViewMenu, MF_SEPARATOR, 0, nullptr);
     addAction(hViewMenu, IDM_FULLSCREEN, Act_Fullscreen, L"Full Screen");
     addAction(hViewMenu, IDM_SLIDESHOW, Act_Slideshow, L"Toggle Slideshow");
+    addAction(hViewMenu, IDM_SEQUENCE_PLAY, Act_SequencePlay, L"Play Image Sequence");
     AppendMenuW(hMenu, MF_POPUP, (UINT_PTR)hViewMenu, L"View");
 
+    if (m_ctx.isHdr) {
+        HMENU hHdrMenu = CreatePopupMenu();
+        addAction(hHdrMenu, IDM_HDR_EXPOSURE_UP, Act_HdrExposureUp, L"Increase Exposure");
+        addAction(hHdrMenu, IDM_HDR_EXPOSURE_DOWN, Act_HdrExposureDown, L"Decrease Exposure");
+        AppendMenuW(hHdrMenu, MF_STRING, IDM_HDR_EXPOSURE_RESET, L"Reset Exposure");
+        AppendMenuW(hHdrMenu, MF_STRING | (m_ctx.hdrAutoExposure ? MF_CHECKED : MF_UNCHECKED), IDM_HDR_AUTO_EXPOSURE, L"Auto Exposure");
+        AppendMenuW(hHdrMenu, MF_SEPARATOR, 0, nullptr);
+
+        auto addToneItem = [&](UINT id, HdrToneOperator op, LPCWSTR text) {
+            UINT flags = MF_STRING | (m_ctx.hdrTone.op == op ? MF_CHECKED : MF_UNCHECKED);
+            AppendMenuW(hHdrMenu, flags, id, text);
+            };
+        addToneItem(IDM_HDR_OP_REINHARD, HdrToneOperator::Reinhard, L"Reinhard");
+        addToneItem(IDM_HDR_OP_ACES, HdrToneOperator::Aces, L"ACES Filmic");
+        addToneItem(IDM_HDR_OP_HABLE, HdrToneOperator::Hable, L"Hable Filmic");
+        addToneItem(IDM_HDR_OP_CLIP, HdrToneOperator::Clip, L"Clip");
+        AppendMenuW(hHdrMenu, MF_SEPARATOR, 0, nullptr);
+
+        auto addGammaItem = [&](UINT id, float gamma, LPCWSTR text) {
+            UINT flags = MF_STRING | (std::abs(m_ctx.hdrTone.gamma - gamma) < 0.05f ? MF_CHECKED : MF_UNCHECKED);
+            AppendMenuW(hHdrMenu, flags, id, text);
+            };
+        addGammaItem(IDM_HDR_GAMMA_18, 1.8f, L"Gamma 1.8");
+        addGammaItem(IDM_HDR_GAMMA_22, 2.2f, L"Gamma 2.2");
+        addGammaItem(IDM_HDR_GAMMA_24, 2.4f, L"Gamma 2.4");
+
+        // Edits detach the view from the radiance buffer
+        UINT hdrFlags = MF_POPUP | (CanRetoneHdr() ? 0 : MF_GRAYED);
+        AppendMenuW(hMenu, hdrFlags, (UINT_PTR)hHdrMenu, L"HDR");
+    }
+
     AppendMenuW(hMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenuW(hMenu, MF_STRING, IDM_SAVE, L"Save\tCtrl+S");
     AppendMenuW(hMenu, MF_STRING, IDM_SAVE_AS, L"Save As\tCtrl+Shift+S");
@@ -300,6 +346,9 @@ void ViewerApp::OnContextMenu(HWND hWnd, POINT pt) {
     if (m_ctx.isSlideshowActive) {
         CheckMenuItem(hMenu, IDM_SLIDESHOW, MF_BYCOMMAND | MF_CHECKED);
     }
+    if (m_ctx.sequencePlayer.IsRunning()) {
+        CheckMenuItem(hMenu, IDM_SEQUENCE_PLAY, MF_BYCOMMAND | MF_CHECKED);
+    }
 
     int cmd = TrackPopupMenu(hMenu, TPM_RIGHTBUTTON | TPM_RETURNCMD, pt.x, pt.y, 0, hWnd, nullptr);
     DestroyMenu(hMenu);
@@ -339,6 +388,15 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
     case WM_APP_DIR_READY:
         OnDirReady((int)lParam);
         break;
+    case WM_APP_MIPS_READY:
+        OnMipsReady((int)lParam);
+        break;
+    case WM_APP_ANIMATION_HEADERS:
+        ContinueAnimationHeaders((int)lParam);
+        break;
+    case WM_APP_HIGH_RES_READY:
+        InvalidateRect(hWnd, nullptr, FALSE);
+        break;
     case WM_APP_IMAGE_LOADED:
         FinalizeImageLoad(true, static_cast<int>(wParam));
         break;
@@ -358,23 +416,17 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
         if (wParam == ANIMATION_TIMER_ID) {
             std::lock_guard<std::recursive_mutex> lock(m_ctx.wicMutex);
             if (m_ctx.isAnimated && !m_ctx.animationFrameDelays.empty()) {
-                const UINT frameCount = static_cast<UINT>(m_ctx.animationFrameDelays.size());
-
-                UINT currentDelay = m_ctx.animationFrameDelays[m_ctx.currentAnimationFrame];
-                m_ctx.currentAnimationFrame = (m_ctx.currentAnimationFrame + 1) % frameCount;
-                UINT nextDelay = m_ctx.animationFrameDelays[m_ctx.currentAnimationFrame];
-
-                m_ctx.currentAnimatedConverter = GetCompositedAnimationFrame(m_ctx.currentAnimationFrame);
-                m_ctx.wicConverterOriginal = m_ctx.currentAnimatedConverter;
-                m_ctx.wicConverter = m_ctx.currentAnimatedConverter;
-                m_ctx.d2dBitmap = nullptr; // Force D2D recreation
-
-                UpdateWindowTitle();
-                InvalidateRect(hWnd, nullptr, FALSE);
-                if (currentDelay != nextDelay) {
-                    KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
-                    SetTimer(m_ctx.hWnd, ANIMATION_TIMER_ID, nextDelay, nullptr);
+                // The schedule moves on regardless, a frame the worker has not finished is skipped
+                if (AdvanceAnimationSchedule() && PresentAnimationFrame(static_cast<UINT>(m_ctx.animationScheduler.Frame()))) {
+                    m_ctx.currentAnimatedConverter = m_ctx.animationBitmap;
+                    m_ctx.wicConverterOriginal = m_ctx.currentAnimatedConverter;
+                    m_ctx.wicConverter = m_ctx.currentAnimatedConverter;
+                    if (m_ctx.isOsdVisible) m_ctx.isOsdCacheValid = false;
+
+                    UpdateWindowTitle();
+                    InvalidateRect(hWnd, nullptr, FALSE);
                 }
+                ScheduleAnimationTick();
             }
         }
         else if (wParam == LOADING_TIMER_ID) {
@@ -390,6 +442,15 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
                 m_ctx.pendingNavIndex = -1;
             }
         }
+        else if (wParam == HDR_RETONE_TIMER_ID) {
+            FinishHdrRetone();
+        }
+        else if (wParam == DECODE_BOOST_TIMER_ID) {
+            ApplyDecodeBoost();
+        }
+        else if (wParam == SEQUENCE_TIMER_ID) {
+            OnSequenceTick();
+        }
         else if (wParam == SLIDESHOW_TIMER_ID) {
             if (m_ctx.isSlideshowActive) {
                 HandleCommand(IDM_NEXT_IMG);
@@ -397,7 +458,7 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
         }
         
         else if (wParam == AUTO_REFRESH_TIMER_ID) {
-            if (m_ctx.isAutoRefresh && !m_ctx.isLoading && !m_ctx.imageFiles.empty() && m_ctx.currentImageIndex >= 0) {
+            if (m_ctx.isAutoRefresh && !m_ctx.isLoading && !m_ctx.sequencePlayer.IsRunning() && !m_ctx.imageFiles.empty() && m_ctx.currentImageIndex >= 0) {
                 const std::wstring& currentFile = m_ctx.imageFiles[m_ctx.currentImageIndex];
                 WIN32_FILE_ATTRIBUTE_DATA fad;
                 if (GetFileAttributesExW(currentFile.c_str(), GetFileExInfoStandard, &fad)) {
@@ -657,6 +718,7 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
         if (m_ctx.renderTarget) {
             if (wParam == SIZE_MINIMIZED) {
                 KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
+                m_ctx.animationScheduler.Stop();
             }
             else {
                 if (m_ctx.swapChain) {
@@ -669,9 +731,10 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
                     m_ctx.renderTarget->CreateBitmapFromDxgiSurface(backBuffer.Get(), &bmpProps, &targetBmp);
                     m_ctx.renderTarget->SetTarget(targetBmp.Get());
                 }
-                if (m_ctx.isAnimated && !m_ctx.animationFrameDelays.empty()) {
-                    KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
-                    SetTimer(m_ctx.hWnd, ANIMATION_TIMER_ID, m_ctx.animationFrameDelays[m_ctx.currentAnimationFrame], nullptr);
+                // Back from minimized the timeline restarts at the frame on screen, a resize keeps it
+                if (m_ctx.isAnimated && !m_ctx.animationFrameDelays.empty() && !m_ctx.isAnimationPaused) {
+                    if (m_ctx.animationScheduler.IsRunning()) ScheduleAnimationTick();
+                    else StartAnimationPlayback();
                 }
             }
         }
@@ -687,6 +750,7 @@ LRESULT ViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
     case WM_DESTROY:
         KillTimer(m_ctx.hWnd, ANIMATION_TIMER_ID);
         KillTimer(m_ctx.hWnd, AUTO_REFRESH_TIMER_ID);
+        StopSequencePlayback();
         if (m_ctx.hPropsWnd) {
             DestroyWindow(m_ctx.hPropsWnd);
         }
@@ -11,7 +11,10 @@ void ViewerApp::UpdateWindowTitle() {
     }
 
     std::wstring title = m_ctx.loadingFilePath;
-    if (m_ctx.animationFrameDelays.size() > 1) {
+    if (m_ctx.sequencePlayer.IsRunning() && m_ctx.currentImageIndex >= static_cast<int>(m_ctx.sequenceFirst)) {
+        title = std::format(L"{} (Sequence {}/{}) - {}", m_ctx.loadingFilePath, m_ctx.currentImageIndex - m_ctx.sequenceFirst + 1, m_ctx.sequenceCount, appNameAndVersion);
+    }
+    else if (m_ctx.animationFrameDelays.size() > 1) {
         title = std::format(L"{} (Frame {}/{}) - {}", m_ctx.loadingFilePath, m_ctx.currentAnimationFrame + 1, m_ctx.animationFrameDelays.size(), appNameAndVersion);
     }
     else {
@@ -38,6 +38,16 @@
 using Microsoft::WRL::ComPtr;
 #include <wil/resource.h>
 #include "resource.h"
+#include "hdr_decode.h"
+#include "mip_pyramid.h"
+#include "deep_zoom.h"
+#include "gif_decode.h"
+#include "png_decode.h"
+#include "animation_compositor.h"
+#include "frame_prefetch.h"
+#include "animation_scheduler.h"
+#include "sequence_player.h"
+#include <memory>
 #include <compare>
 #include <ranges>
 
@@ -65,6 +75,8 @@ constexpr UINT WM_APP_IMAGE_LOAD_FAILED = (WM_APP + 2);
 constexpr UINT WM_APP_IMAGE_READY = (WM_APP + 7);
 constexpr UINT WM_APP_DIR_READY = (WM_APP + 8);
 constexpr UINT WM_APP_HIGH_RES_READY = (WM_APP + 9);
+constexpr UINT WM_APP_MIPS_READY = (WM_APP + 10);
+constexpr UINT WM_APP_ANIMATION_HEADERS = (WM_APP + 11);
 
 constexpr UINT ANIMATION_TIMER_ID = 1;
 constexpr UINT AUTO_REFRESH_TIMER_ID = 3;
@@ -72,6 +84,9 @@ constexpr UINT LOADING_TIMER_ID = 4;
 constexpr UINT NAV_DEBOUNCE_TIMER_ID = 6;
 constexpr UINT KEYBINDING_TIMER_ID = 7;
 constexpr UINT SLIDESHOW_TIMER_ID = 8;
+constexpr UINT HDR_RETONE_TIMER_ID = 9;
+constexpr UINT DECODE_BOOST_TIMER_ID = 10;
+constexpr UINT SEQUENCE_TIMER_ID = 11;
 
 enum class BackgroundColor {
     Grey = 0,
@@ -97,6 +112,7 @@ enum ActionID {
     Act_Open, Act_Refresh, Act_Copy, Act_Paste, Act_Save, Act_SaveAs, Act_Delete, Act_Undo,
     Act_CenterImage, Act_CommitCrop, Act_ToggleOSD, Act_PlayPause, Act_ResumeAnim,
     Act_AnimNext, Act_AnimPrev, Act_AnimFirst, Act_ContextMenu, Act_Slideshow,
+    Act_HdrExposureUp, Act_HdrExposureDown, Act_SequencePlay,
     Act_Count
 };
 
@@ -181,11 +197,23 @@ struct AppContext {
     FastByteBuffer stagedRawFileData;
     ComPtr<IWICStream> wicStream;
     ComPtr<IWICStream> stagedWicStream;
-    ComPtr<ID2D1ImageSourceFromWic> highResImageSource = nullptr;
+    std::unique_ptr<TiledDeepZoom> deepZoom;          // Reads rawFileData, declared after it so it stops first
+    std::wstring tilePyramidPath;                     // Disk tile pyramid of a gigapixel image, its deep zoom source
+    uint64_t tilePyramidKey = 0;
+    std::wstring stagedTilePyramidPath;
+    uint64_t stagedTilePyramidKey = 0;
+    ComPtr<IWICBitmapSource> mipSource;               // wicConverter the pyramid belongs to
+    std::shared_ptr<MipPyramid> mipPyramid;
+    std::shared_ptr<MipPyramid> stagedMipPyramid;
+    std::vector<ComPtr<ID2D1Bitmap>> mipBitmaps;      // Uploaded lazily per level
     UINT originalWidth = 0;
     UINT originalHeight = 0;
     bool isDownscaled = false;
     float downscaleRatio = 1.0f;
+    std::wstring decodeBoostPath;        // File re-decoded above the display limit after zooming in
+    UINT decodeBoostLimit = 0;
+    bool isDecodeBoostReload = false;
+    bool isPartialImage = false;         // Early interlaced pass on screen, the full decode still running
     std::vector<ComPtr<IWICBitmapSource>> undoStack;
     ComPtr<IDWriteTextFormat> textFormat = nullptr;
     ComPtr<ID2D1SolidColorBrush> textBrush = nullptr;
@@ -232,6 +260,7 @@ struct AppContext {
     UINT stagedHeight = 0;
     UINT stagedOrientation = 1;
     ComPtr<IWICFormatConverter> stagedStaticConverter; // Fast static 
+    bool stagedIsPartial = false;
 
     std::vector<std::wstring> stagedImageFiles;
     int stagedFoundIndex = -1;
@@ -265,20 +294,49 @@ struct AppContext {
         UINT height = 0;
     };
 
+    // HDR State
+    bool isHdr = false;
+    HdrRadianceBuffer hdrRadiance;
+    HdrRadianceBuffer stagedHdrRadiance;
+    ComPtr<IWICBitmap> hdrBitmap; // Tone-mapped copy of hdrRadiance backing the view
+    ComPtr<IWICBitmap> stagedHdrBitmap;
+    ComPtr<IWICBitmapSource> hdrSource; // Edits replace wicConverterOriginal and detach it
+    float stagedHdrExposure = 0.0f;
+    HdrToneSettings hdrTone;
+    HdrToneLut hdrToneLut;
+    bool hdrAutoExposure = false;
+    WICRect hdrRetonedRect = {};
+    bool hdrRetonePending = false;
+
     // Animation State
     bool isAnimated = false;
     bool isAnimationPaused = false;
-    std::vector<ComPtr<ID2D1Bitmap>> animationD2DBitmaps;
+    ComPtr<IWICBitmap> animationBitmap;      // Mirrors the compositor canvas, only dirty rects are copied
+    ComPtr<ID2D1Bitmap> animationD2DBitmap;
+    AnimationCompositor::Rect animationD2DDirty; // Canvas area the device bitmap has not caught up with
     std::vector<AnimationFrameMetadata> animationFrameMetadata;
     std::vector<AnimationFrameMetadata> stagedFrameMetadata;
-    std::vector<BYTE> animationCanvas;
-    std::vector<BYTE> animationCanvasPrev;
-    int lastCompositedFrame = -1;
+    std::unique_ptr<GifDecoder> stagedGifDecoder; // Walked as far as the first frame by the loader
+    std::unique_ptr<PngDecoder> stagedApngDecoder;
+    AnimationCompositor animationCompositor;
     ComPtr<IWICBitmapDecoder> animationDecoder;
+    std::unique_ptr<GifDecoder> gifDecoder; // Reads rawFileData, composites GIFs without WIC
+    std::unique_ptr<PngDecoder> apngDecoder; // Same for APNG, which WIC only shows the default image of
+    FramePrefetcher animationPrefetcher;    // Owns the compositor and decoders while playing
+    AnimationScheduler animationScheduler;  // Which frame is due, the timer only wakes it up
     ComPtr<IWICBitmapSource> currentAnimatedConverter;
     std::vector<UINT> animationFrameDelays;
     UINT currentAnimationFrame = 0;
 
+    // Image sequence playback, the still stays loaded underneath
+    SequencePlayer sequencePlayer;
+    size_t sequenceFirst = 0;                // imageFiles index of the sequence's first frame
+    size_t sequenceCount = 0;
+    const SequenceFrame* sequenceFrame = nullptr;  // On screen, owned by the player
+    ComPtr<ID2D1Bitmap> sequenceD2DBitmap;
+    bool sequenceD2DStale = false;
+    int sequenceFps = 24;
+
     std::atomic<bool> isInitialized{ false };
     bool isOsdVisible = false;
     bool isOsdCacheValid = false;
@@ -303,6 +361,7 @@ struct AppContext {
     bool isSlideshowActive = false;
     int slideshowIntervalSeconds = 3;
     bool smoothScaling = true;
+    bool linearLightScaling = false;   // Downscale in linear light
     bool enableFadeAnimation = true;
     bool askToDelete = true;
     bool preserveZoomOnResize = false;
@@ -375,6 +434,8 @@ public:
     void SaveImageAs();
     void ResizeImageAction();
     void ApplyEffectsToView();
+    void AdjustHdrTone(WORD cmd);
+    void FinishHdrRetone();
     void CommitCrop();
     void UpdateViewToCurrentFrame();
     void DeleteCurrentImage();
@@ -390,6 +451,9 @@ public:
     void Render();
     void CreateDeviceResources();
     void DiscardDeviceResources();
+    void StartMipBuild();
+    void OnMipsReady(int seqId);
+    void ContinueAnimationHeaders(int seqId);
     void FitImageToWindow();
     void ZoomImage(float factor, POINT pt);
     void RotateImage(bool clockwise);
@@ -409,6 +473,14 @@ public:
     static LRESULT CALLBACK PropsWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
     ComPtr<IWICBitmapSource> GetCompositedAnimationFrame(UINT targetIndex);
+    bool PresentAnimationFrame(UINT targetIndex);
+    void StartAnimationPrefetch();
+    void StartAnimationPlayback();
+    bool AdvanceAnimationSchedule();
+    void ScheduleAnimationTick();
+    void ToggleSequencePlayback();
+    void StopSequencePlayback();
+    void OnSequenceTick();
 
 private:
     AppContext m_ctx;
@@ -452,12 +524,30 @@ private:
         return nullptr;
     }
 
+    ComPtr<IWICBitmap> ResampleToBitmap(IWICImagingFactory* pFactory, IWICBitmapSource* pSource, UINT width, UINT height);
+
     HRESULT EncodeAndSaveImage(ComPtr<IWICBitmapSource> source, const std::wstring& filePath, const GUID& containerFormat);
     ComPtr<IWICBitmapSource> GetSaveSource(const GUID& targetFormat);
     void SaveImageWithResize(const std::wstring& filePath, const GUID& containerFormat, UINT newWidth, UINT newHeight);
     ComPtr<IWICBitmapSource> ApplyCropAndTransform(ComPtr<IWICBitmapSource> source);
+    bool CanRetoneHdr();
+    bool CanUpdateHdrBitmapInPlace();
+    WICRect GetVisibleHdrRect();
+    void RetoneHdrRect(const WICRect& rc);
 
     // IO Helpers
     bool IsSequenceValid(int seqId);
     HRESULT CreateDecoderFromStream_FullFileRead(IWICImagingFactory* pFactory, const wchar_t* filePath, IWICBitmapDecoder** ppDecoder, int seqId);
+    bool LoadMappedRawImage(const std::wstring& filePath, int seqId, UINT maxDim);
+    std::wstring GetTilePyramidPath(const std::wstring& filePath, uint64_t& sourceKey);
+    bool BuildTilePyramid(const std::wstring& filePath, int seqId, const std::wstring& pyramidPath, uint64_t sourceKey);
+    bool LoadTilePyramidImage(const std::wstring& filePath, int seqId, UINT maxDim);
+    bool HasDeepZoomSource();
+    UINT GetDecodeLimitCap();
+    size_t GetTileCacheBudget();
+    UINT ComputeDecodeLimit();
+    void CheckDecodeResolution();
+    void ApplyDecodeBoost();
+    AnimationCompositor::DrawFrame MakeAnimationFrameDrawer();
+    bool UpdateAnimationBitmap(const BYTE* pixels, AnimationCompositor::Rect dirty);
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "animation_compositor.h"
+#include "bench_util.h"
+#include "gif_decode.h"
+#include "gif_writer.h"
+#include "pixel_composite.h"
+#include "png_decode.h"
+#include "png_writer.h"
+#include <cstdio>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+// Usage: animation_compositor_bench [frames width height loopFrames]
+// Seeking in a long GIF with and without keyframes: playing forward, stepping backwards from the
+// last frame and jumping to random frames, at a quarter of the length and at the full length so
+// it shows whether a step grows with the animation. The frame cache is off for that part.
+// Then a short animation loops three times as an APNG, with the frame cache at its default
+// budget, at a quarter of what the loop needs and off, and as a GIF with the cache off and the
+// decoder keeping its indices, which is how the viewer plays each. The dirty rect is copied to a
+// mirror the way the viewer's bitmaps are. Every canvas is checked against plain playback.
+
+namespace {
+
+    uint64_t Hash(const uint8_t* data, size_t size) {
+        uint64_t h = 1469598103934665603ull;
+        for (size_t i = 0; i < size; ++i) h = (h ^ data[i]) * 1099511628211ull;
+        return h;
+    }
+
+    struct Animation {
+        std::vector<uint8_t> file;
+        GifDecoder gif;
+        std::vector<AnimationCompositor::Frame> frames;
+        size_t draws = 0;
+
+        explicit Animation(std::vector<uint8_t> data) : file(std::move(data)) {
+            gif.ReadHeader(file.data(), file.size());
+            for (size_t i = 0; i < gif.FrameCount(); ++i) {
+                const GifDecoder::Frame& frame = gif.GetFrame(i);
+                frames.push_back({ frame.left, frame.top, frame.width, frame.height, frame.disposal });
+            }
+        }
+
+        // What the viewer's drawer does for a GIF: cached indices through the palette onto the canvas
+        AnimationCompositor::DrawFrame Drawer() {
+            return [this](size_t i, uint8_t* canvas, size_t stride) {
+                ++draws;
+                const GifDecoder::Frame& frame = gif.GetFrame(i);
+                const uint8_t* indices = gif.FrameIndices(i);
+                if (!indices || frame.left >= gif.Width() || frame.top >= gif.Height()) return;
+                uint32_t palette[256];
+                gif.GetBgraPalette(i, palette);
+                BlendRectPalette(canvas + static_cast<size_t>(frame.top) * stride + static_cast<size_t>(frame.left) * 4, stride, indices, frame.width, palette,
+                    std::min(frame.width, gif.Width() - frame.left), std::min(frame.height, gif.Height() - frame.top));
+                };
+        }
+    };
+
+    // Milliseconds per seek, spent inside Seek only, with the canvas checked against the reference after each
+    template <class Next>
+    double SeekMs(AnimationCompositor& compositor, const AnimationCompositor::DrawFrame& draw, const std::vector<uint64_t>& reference,
+        size_t seeks, Next&& next, size_t& mismatches) {
+        const size_t bytes = compositor.Stride() * compositor.Height();
+        double total = 0;
+        for (size_t k = 0; k < seeks; ++k) {
+            const size_t index = next(k);
+            const auto start = std::chrono::steady_clock::now();
+            compositor.Seek(index, draw);
+            total += ElapsedMs(start);
+            if (Hash(compositor.Canvas(), bytes) != reference[index]) ++mismatches;
+        }
+        return total / seeks;
+    }
+
+    void Run(uint32_t frameCount, uint32_t width, uint32_t height) {
+        Animation animation(WriteSpriteAnimation(width, height, frameCount));
+        const auto draw = animation.Drawer();
+        const size_t n = animation.frames.size();
+        const size_t bytes = static_cast<size_t>(width) * height * 4;
+        std::printf("%zu frames, %ux%u, %.1f MB\n", n, width, height, animation.file.size() / 1e6);
+
+        std::vector<uint64_t> reference(n);
+        AnimationCompositor plain;
+        plain.Reset(width, height, animation.frames, 0, 0);
+        for (size_t i = 0; i < n; ++i) {
+            plain.Seek(i, draw);
+            reference[i] = Hash(plain.Canvas(), bytes);
+        }
+
+        size_t mismatches = 0;
+        AnimationCompositor bare;
+        bare.Reset(width, height, animation.frames, 0, 0);
+        const double bareMs = SeekMs(bare, draw, reference, n, [](size_t k) { return k; }, mismatches);
+        AnimationCompositor keyed;
+        keyed.Reset(width, height, animation.frames, AnimationCompositor::DefaultKeyframeBudget, 0);
+        const double keyedMs = SeekMs(keyed, draw, reference, n, [](size_t k) { return k; }, mismatches);
+        std::printf("  forward          %7.3f ms/frame without keyframes, %7.3f taking them (%zu kept, %.1f MB, every %u)\n",
+            bareMs, keyedMs, keyed.KeyframeCount(), keyed.KeyframeBytes() / 1e6, keyed.KeyframeInterval());
+
+        animation.draws = 0;
+        const double backMs = SeekMs(keyed, draw, reference, n, [&](size_t k) { return n - 1 - k; }, mismatches);
+        const double backDraws = static_cast<double>(animation.draws) / n;
+
+        // Without keyframes each step back replays from frame 0, so only a sample is timed
+        const size_t samples = std::min<size_t>(20, n - 1);
+        bare.Seek(n - 1, draw);
+        animation.draws = 0;
+        const double bareBackMs = SeekMs(bare, draw, reference, samples, [&](size_t k) { return n - 2 - k; }, mismatches);
+        std::printf("  step back        %7.3f ms/step without keyframes (%.0f draws), %7.3f with (%.1f draws)\n",
+            bareBackMs, static_cast<double>(animation.draws) / samples, backMs, backDraws);
+
+        std::mt19937 rng(5);
+        std::vector<size_t> targets(200);
+        for (size_t& target : targets) target = rng() % n;
+        const double bareRandomMs = SeekMs(bare, draw, reference, 40, [&](size_t k) { return targets[k]; }, mismatches);
+        animation.draws = 0;
+        const double randomMs = SeekMs(keyed, draw, reference, targets.size(), [&](size_t k) { return targets[k]; }, mismatches);
+        std::printf("  random seek      %7.3f ms without keyframes, %7.3f with (%.1f draws)\n",
+            bareRandomMs, randomMs, static_cast<double>(animation.draws) / targets.size());
+        if (mismatches) std::printf("  %zu canvases differ from plain playback\n", mismatches);
+    }
+
+    // The same animation as an APNG: the palette looked up, transparent pixels over the canvas
+    std::vector<uint8_t> GifToApng(Animation& animation) {
+        std::vector<ApngWriteFrame> frames(animation.frames.size());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const GifDecoder::Frame& gifFrame = animation.gif.GetFrame(i);
+            ApngWriteFrame& frame = frames[i];
+            frame.left = gifFrame.left;
+            frame.top = gifFrame.top;
+            frame.width = gifFrame.width;
+            frame.height = gifFrame.height;
+            frame.delay = gifFrame.delay;
+            frame.dispose = static_cast<uint8_t>(gifFrame.disposal == 2 ? 1 : gifFrame.disposal == 3 ? 2 : 0);
+            frame.blendOver = gifFrame.transparentIndex >= 0;
+            uint32_t palette[256];
+            animation.gif.GetBgraPalette(i, palette);
+            const uint8_t* indices = animation.gif.FrameIndices(i);
+            frame.rgba.resize(static_cast<size_t>(frame.width) * frame.height * 4);
+            for (size_t k = 0; k < static_cast<size_t>(frame.width) * frame.height; ++k) {
+                const uint32_t bgra = palette[indices[k]];
+                frame.rgba[k * 4 + 0] = static_cast<uint8_t>(bgra >> 16);
+                frame.rgba[k * 4 + 1] = static_cast<uint8_t>(bgra >> 8);
+                frame.rgba[k * 4 + 2] = static_cast<uint8_t>(bgra);
+                frame.rgba[k * 4 + 3] = static_cast<uint8_t>(bgra >> 24);
+            }
+        }
+        return WriteApng(animation.gif.Width(), animation.gif.Height(), frames);
+    }
+
+    // Three loops through a fresh compositor, the dirty rect copied to a mirror after each frame
+    void PlayLoops(const char* name, const std::vector<AnimationCompositor::Frame>& frames, uint32_t width, uint32_t height,
+        const AnimationCompositor::DrawFrame& draw, size_t budget) {
+        const size_t n = frames.size();
+        const size_t stride = static_cast<size_t>(width) * 4;
+        const size_t bytes = stride * height;
+        std::vector<uint64_t> reference(n);
+        AnimationCompositor plain;
+        plain.Reset(width, height, frames, 0, 0);
+        for (size_t i = 0; i < n; ++i) {
+            plain.Seek(i, draw);
+            reference[i] = Hash(plain.Canvas(), bytes);
+        }
+
+        AnimationCompositor compositor;
+        compositor.Reset(width, height, frames, AnimationCompositor::DefaultKeyframeBudget, budget);
+        std::vector<uint8_t> mirror(bytes);
+        double seekMs[3] = {};
+        double copyMs = 0;
+        size_t mismatches = 0;
+        for (int loop = 0; loop < 3; ++loop) {
+            for (size_t i = 0; i < n; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                compositor.Seek(i, draw);
+                seekMs[loop] += ElapsedMs(start);
+                const auto copyStart = std::chrono::steady_clock::now();
+                const AnimationCompositor::Rect dirty = compositor.TakeDirtyRect();
+                const size_t offset = static_cast<size_t>(dirty.top) * stride + static_cast<size_t>(dirty.left) * 4;
+                CopyRect(mirror.data() + offset, stride, compositor.Canvas() + offset, stride, dirty.width, dirty.height);
+                copyMs += ElapsedMs(copyStart);
+                if (Hash(compositor.Canvas(), bytes) != reference[i] || Hash(mirror.data(), bytes) != reference[i]) ++mismatches;
+            }
+        }
+        std::printf("  %-5s cache budget %5.2f MB  %3zu frames in %.2f MB  loop 1 %6.3f ms/frame, loop 2 %6.3f, loop 3 %6.3f, mirror copy %6.3f\n",
+            name, budget / 1e6, compositor.CachedFrameCount(), compositor.FrameCacheBytes() / 1e6,
+            seekMs[0] / n, seekMs[1] / n, seekMs[2] / n, copyMs / (3 * n));
+        if (mismatches) std::printf("  %zu canvases differ from plain playback\n", mismatches);
+    }
+
+    void RunLoops(uint32_t frameCount, uint32_t width, uint32_t height) {
+        const std::vector<uint8_t> gif = WriteSpriteAnimation(width, height, frameCount);
+        Animation source(gif);
+        const std::vector<uint8_t> apngFile = GifToApng(source);
+        std::printf("%zu frame loop, %ux%u\n", source.frames.size(), width, height);
+
+        // APNG frames inflate and unfilter on every draw, the viewer keeps them composited after
+        // the first loop, with the frames' disposal mapped the way the loader does it
+        PngDecoder apng;
+        apng.ReadHeader(apngFile.data(), apngFile.size());
+        std::vector<AnimationCompositor::Frame> apngFrames;
+        for (size_t i = 0; i < apng.AnimationFrameCount(); ++i) {
+            const PngDecoder::AnimationFrame& frame = apng.GetAnimationFrame(i);
+            const uint32_t disposal = frame.dispose == 1 || (frame.dispose == 2 && i == 0) ? 2 : frame.dispose == 2 ? 3 : 0;
+            apngFrames.push_back({ frame.left, frame.top, frame.width, frame.height, disposal });
+        }
+        const AnimationCompositor::DrawFrame drawApng = [&](size_t i, uint8_t* canvas, size_t stride) {
+            apng.DrawAnimationFrame(i, canvas, stride);
+            };
+
+        // A budget-free run gives what the whole loop takes, the small budget is a quarter of it
+        AnimationCompositor full;
+        full.Reset(width, height, apngFrames, AnimationCompositor::DefaultKeyframeBudget, SIZE_MAX);
+        for (size_t i = 0; i < apngFrames.size(); ++i) full.Seek(i, drawApng);
+        const size_t loopBytes = full.FrameCacheBytes();
+        for (size_t budget : { AnimationCompositor::DefaultFrameCacheBudget, loopBytes / 4, size_t{ 0 } }) {
+            PlayLoops("APNG", apngFrames, width, height, drawApng, budget);
+        }
+
+        // GIFs keep their palette indices instead, the LZW is skipped from the second loop on
+        Animation animation(gif);
+        PlayLoops("GIF", animation.frames, width, height, animation.Drawer(), 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t frames = IntArg(argc, argv, 1, 2000);
+    const uint32_t width = IntArg(argc, argv, 2, 480);
+    const uint32_t height = IntArg(argc, argv, 3, 270);
+    Run(std::max(1u, frames / 4), width, height);
+    Run(frames, width, height);
+    RunLoops(IntArg(argc, argv, 4, 120), width, height);
+    return 0;
+}
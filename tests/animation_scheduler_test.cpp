@@ -0,0 +1,111 @@
+#include "animation_scheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+// The scheduler driven by a fake clock: no drift over a long run, and the skip, resync, wrap,
+// zero-delay and growing-list cases
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (ok) return;
+        std::printf("FAIL %s\n", what);
+        ++failures;
+    }
+
+    // Frame an ideal player shows at nowUs, starting from frame 0 at time 0
+    size_t IdealFrame(const std::vector<uint32_t>& delaysMs, int64_t nowUs) {
+        int64_t t = 0;
+        size_t frame = 0;
+        for (;;) {
+            const int64_t next = t + static_cast<int64_t>(delaysMs[frame]) * 1000;
+            if (next > nowUs) return frame;
+            t = next;
+            frame = (frame + 1) % delaysMs.size();
+        }
+    }
+
+    // Timer fires in whole milliseconds and up to 2 ms late, each tick then works up to 4 ms
+    // before the timer is armed again. After 1000 frames the timeline is where it should be.
+    void CheckNoDrift() {
+        std::mt19937 rng(3);
+        std::vector<uint32_t> delays(50, 40);
+        for (size_t i = 0; i < delays.size(); i += 7) delays[i] = static_cast<uint32_t>(20 + i);
+        int64_t loopUs = 0;
+        for (uint32_t delay : delays) loopUs += static_cast<int64_t>(delay) * 1000;
+
+        AnimationScheduler scheduler;
+        int64_t now = 0;
+        int64_t lastTick = 0;
+        scheduler.Start(0, now, delays);
+        while (now < 20 * loopUs) {
+            const int64_t wait = (scheduler.UntilNextUs(now) + 999) / 1000 * 1000;
+            now += std::max<int64_t>(wait, 1000) + rng() % 2000;
+            lastTick = now;
+            scheduler.Advance(now, delays);
+            now += rng() % 4000;
+        }
+        Check(scheduler.Frame() == IdealFrame(delays, lastTick), "timeline drifted");
+        Check(scheduler.Stats().resyncs == 0, "resynced without a stall");
+        Check(scheduler.Stats().maxLateUs < 7000, "frame picked up later than timer and work allow");
+    }
+
+    void CheckSkipAndResync() {
+        const std::vector<uint32_t> delays(10, 40);
+        AnimationScheduler scheduler;
+        scheduler.Start(0, 0, delays);
+        Check(!scheduler.Advance(39999, delays) && scheduler.Frame() == 0, "early tick moved on");
+        Check(scheduler.Stats().early == 1, "early tick not counted");
+
+        // Two and a half frames late: two passed over, the third due, its deadline on the timeline
+        Check(scheduler.Advance(40000 + 80000 + 20000, delays) && scheduler.Frame() == 3, "skip to the due frame");
+        Check(scheduler.Stats().skipped == 2, "skipped frames not counted");
+        Check(scheduler.UntilNextUs(140000) == 20000, "deadline left the timeline");
+
+        // A stall of seconds restarts the timeline from the next frame
+        Check(scheduler.Advance(5000000, delays) && scheduler.Frame() == 4, "resync frame");
+        Check(scheduler.Stats().resyncs == 1 && scheduler.UntilNextUs(5000000) == 40000, "resync deadline");
+    }
+
+    void CheckWrapAndGrowth() {
+        std::vector<uint32_t> delays(2, 10);
+        AnimationScheduler scheduler;
+        scheduler.Start(1, 0, delays);
+        delays.push_back(30);
+        Check(scheduler.Advance(10000, delays) && scheduler.Frame() == 2, "frame added after start not reached");
+        Check(scheduler.Advance(40000, delays) && scheduler.Frame() == 0, "no wrap at the end");
+
+        // Start wraps a frame past the end
+        scheduler.Start(7, 0, delays);
+        Check(scheduler.Frame() == 1, "start frame not wrapped");
+
+        // Nothing to play
+        scheduler.Start(0, 0, {});
+        Check(!scheduler.IsRunning() && !scheduler.Advance(1000000, {}), "empty animation runs");
+    }
+
+    void CheckZeroDelays() {
+        const std::vector<uint32_t> delays(3, 0);
+        AnimationScheduler scheduler;
+        scheduler.Start(0, 0, delays);
+        Check(scheduler.Advance(1000, delays) && scheduler.Frame() == 1, "zero delay never moves on");
+        Check(scheduler.Advance(3000, delays) && scheduler.Frame() == 0, "zero delays not stepped 1 ms each");
+    }
+}
+
+int main() {
+    CheckNoDrift();
+    CheckSkipAndResync();
+    CheckWrapAndGrowth();
+    CheckZeroDelays();
+
+    if (failures) {
+        std::printf("%d scheduler failures\n", failures);
+        return 1;
+    }
+    std::printf("animation scheduler: timeline, skip, resync, wrap and zero delays pass\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "animation_compositor.h"
+#include "png_decode.h"
+#include "test_data.h"
+#include <algorithm>
+#include <cstdlib>
+
+// APNG frames composited the way the viewer plays them, against canvases from data/apng,
+// which generate.py composites in floating point from the pixels it wrote. Covers every
+// dispose/blend pair, a mix of them, palette and interlaced 16-bit frames, a default image
+// that is not part of the animation, and a file cut off inside a frame.
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what, const char* file) {
+        if (ok) return;
+        std::printf("FAIL %s: %s\n", file, what);
+        ++failures;
+    }
+
+    // The same mapping the viewer uses: APNG dispose to the compositor's GIF numbering, with
+    // restore on the first frame meaning clear
+    std::vector<AnimationCompositor::Frame> CompositorFrames(const PngDecoder& png) {
+        std::vector<AnimationCompositor::Frame> frames;
+        for (size_t i = 0; i < png.AnimationFrameCount(); ++i) {
+            const PngDecoder::AnimationFrame& frame = png.GetAnimationFrame(i);
+            const uint32_t disposal = frame.dispose == 1 || (frame.dispose == 2 && i == 0) ? 2 : frame.dispose == 2 ? 3 : 0;
+            frames.push_back({ frame.left, frame.top, frame.width, frame.height, disposal });
+        }
+        return frames;
+    }
+
+    // Largest channel difference between the BGRA canvas and an RGBA reference frame
+    int CanvasDifference(const AnimationCompositor& compositor, const uint8_t* expected) {
+        int worst = 0;
+        for (uint32_t y = 0; y < compositor.Height(); ++y) {
+            const uint8_t* row = compositor.Canvas() + y * compositor.Stride();
+            for (uint32_t x = 0; x < compositor.Width(); ++x) {
+                const uint8_t* p = row + x * 4;
+                const uint8_t* q = expected + (static_cast<size_t>(y) * compositor.Width() + x) * 4;
+                worst = std::max({ worst, std::abs(p[2] - q[0]), std::abs(p[1] - q[1]), std::abs(p[0] - q[2]), std::abs(p[3] - q[3]) });
+            }
+        }
+        return worst;
+    }
+
+    // Two loops forward then backwards, so frames come from live decodes, the frame cache and
+    // keyframe replays. Frames from checkedFrames on only have to draw without failing.
+    void CheckFile(const char* name, size_t expectedFrames, size_t checkedFrames, size_t frameCacheBudget) {
+        const std::string path = std::string("apng/") + name;
+        const std::vector<uint8_t> data = ReadTestFile(path);
+        const std::vector<uint8_t> reference = ReadTestFile(path + ".rgba");
+        PngDecoder png;
+        if (!png.ReadHeader(data.data(), data.size())) {
+            Check(false, "header rejected", name);
+            return;
+        }
+        Check(png.AnimationFrameCount() == expectedFrames, "frame count", name);
+        const size_t frameBytes = static_cast<size_t>(png.Width()) * png.Height() * 4;
+        if (png.AnimationFrameCount() == 0 || reference.size() < checkedFrames * frameBytes) {
+            Check(false, "nothing to compare", name);
+            return;
+        }
+
+        AnimationCompositor compositor;
+        compositor.Reset(png.Width(), png.Height(), CompositorFrames(png), AnimationCompositor::DefaultKeyframeBudget, frameCacheBudget);
+        const AnimationCompositor::DrawFrame draw = [&](size_t index, uint8_t* canvas, size_t stride) {
+            png.DrawAnimationFrame(index, canvas, stride);
+            };
+
+        const size_t count = png.AnimationFrameCount();
+        std::vector<size_t> order;
+        for (size_t loop = 0; loop < 2; ++loop) {
+            for (size_t i = 0; i < count; ++i) order.push_back(i);
+        }
+        for (size_t i = count; i-- > 0;) order.push_back(i);
+
+        for (size_t i : order) {
+            if (!compositor.Seek(i, draw)) {
+                Check(false, "seek failed", name);
+                return;
+            }
+            if (i < checkedFrames && CanvasDifference(compositor, reference.data() + i * frameBytes) > 2) {
+                std::printf("FAIL %s: frame %zu differs from the reference\n", name, i);
+                ++failures;
+                return;
+            }
+        }
+    }
+}
+
+int main() {
+    const char* const combinations[] = {
+        "dispose0_blend0.png", "dispose0_blend1.png",
+        "dispose1_blend0.png", "dispose1_blend1.png",
+        "dispose2_blend0.png", "dispose2_blend1.png"
+    };
+    for (size_t cacheBudget : { AnimationCompositor::DefaultFrameCacheBudget, size_t{ 0 } }) {
+        for (const char* name : combinations) CheckFile(name, 5, 5, cacheBudget);
+        CheckFile("mixed.png", 8, 8, cacheBudget);
+        CheckFile("palette.png", 5, 5, cacheBudget);
+        CheckFile("interlaced16.png", 5, 5, cacheBudget);
+        CheckFile("hidden_default.png", 5, 5, cacheBudget);
+        CheckFile("truncated.png", 4, 3, cacheBudget);
+    }
+
+    if (failures) {
+        std::printf("%d APNG failures\n", failures);
+        return 1;
+    }
+    std::printf("apng decode: every dispose/blend pair, hidden default and truncated files match\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "area_downscale.h"
+#include "bench_util.h"
+#include "pixel_convert.h"
+#include <cstdio>
+#include <vector>
+
+// Usage: area_downscale_bench [width] [height] [dstWidth] [dstHeight]
+// The display bitmap path for stb and native decoder output: rows pushed through the area
+// downscaler at the source depth, quantized once and converted to PBGRA. 16-bit sources against
+// their 8-bit equivalent, with a 1:1 convert for scale.
+
+namespace {
+
+    // A smooth gradient with a little texture, the case 16 bits exist for
+    template <typename Sample>
+    std::vector<Sample> MakeImage(uint32_t width, uint32_t height, uint32_t channels) {
+        const uint32_t maxValue = sizeof(Sample) == 1 ? 255 : 65535;
+        std::vector<Sample> image(static_cast<size_t>(width) * height * channels);
+        size_t i = 0;
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                for (uint32_t c = 0; c < channels; ++c, ++i) {
+                    const double t = c == 3 ? 1.0 - 0.5 * y / height : (x + c * 97.0 + ((x ^ y) & 3)) / (width + 300.0);
+                    image[i] = static_cast<Sample>(t * maxValue);
+                }
+            }
+        }
+        return image;
+    }
+
+    template <typename Sample>
+    double Downscale(PixelSource layout, uint32_t channels, uint32_t width, uint32_t height, uint32_t dstWidth, uint32_t dstHeight) {
+        const std::vector<Sample> image = MakeImage<Sample>(width, height, channels);
+        const PixelRowConverter convert = GetPixelRowConverter(layout, true);
+        std::vector<Sample> quantized(static_cast<size_t>(dstWidth) * channels);
+        std::vector<uint8_t> bgra(static_cast<size_t>(dstWidth) * dstHeight * 4);
+        return BestMs(3, [&] {
+            AreaDownscaler downscaler;
+            downscaler.Init(width, height, dstWidth, dstHeight, channels);
+            const size_t rowSamples = static_cast<size_t>(width) * channels;
+            for (uint32_t y = 0; y < height; ++y) {
+                uint32_t dstRow = 0;
+                if (const float* done = downscaler.PushRow(image.data() + y * rowSamples, &dstRow)) {
+                    QuantizeRow(done, quantized.data(), quantized.size());
+                    convert(quantized.data(), bgra.data() + static_cast<size_t>(dstRow) * dstWidth * 4, dstWidth);
+                }
+            }
+            });
+    }
+
+    template <typename Sample>
+    double Convert(PixelSource layout, uint32_t channels, uint32_t width, uint32_t height) {
+        const std::vector<Sample> image = MakeImage<Sample>(width, height, channels);
+        std::vector<uint8_t> bgra(static_cast<size_t>(width) * height * 4);
+        return BestMs(3, [&] {
+            ConvertPixels(layout, true, image.data(), static_cast<size_t>(width) * channels * sizeof(Sample), bgra.data(), static_cast<size_t>(width) * 4, width, height);
+            });
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 8000);
+    const uint32_t height = IntArg(argc, argv, 2, 6000);
+    const uint32_t dstWidth = IntArg(argc, argv, 3, 3840);
+    const uint32_t dstHeight = IntArg(argc, argv, 4, 2880);
+    std::printf("%ux%u to %ux%u PBGRA\n", width, height, dstWidth, dstHeight);
+
+    std::printf("downscale RGB8     %8.1f ms\n", Downscale<uint8_t>(PixelSource::RGB8, 3, width, height, dstWidth, dstHeight));
+    std::printf("downscale RGB16    %8.1f ms\n", Downscale<uint16_t>(PixelSource::RGB16, 3, width, height, dstWidth, dstHeight));
+    std::printf("downscale RGBA8    %8.1f ms\n", Downscale<uint8_t>(PixelSource::RGBA8, 4, width, height, dstWidth, dstHeight));
+    std::printf("downscale RGBA16   %8.1f ms\n", Downscale<uint16_t>(PixelSource::RGBA16, 4, width, height, dstWidth, dstHeight));
+    std::printf("convert RGB8 1:1   %8.1f ms\n", Convert<uint8_t>(PixelSource::RGB8, 3, width, height));
+    std::printf("convert RGB16 1:1  %8.1f ms\n", Convert<uint16_t>(PixelSource::RGB16, 3, width, height));
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+// Shared by the *_bench programs. These take their sizes from the command line, make their
+// own input and print one line per measurement; build them in Release for numbers that mean anything.
+
+inline double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Fastest of several runs, the least disturbed by whatever else the machine is doing
+template <class F>
+double BestMs(int runs, F&& run) {
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, ElapsedMs(start));
+    }
+    return best;
+}
+
+// Positional integer argument, or the default when it is missing
+inline int IntArg(int argc, char** argv, int index, int fallback) {
+    return index < argc ? std::atoi(argv[index]) : fallback;
+}
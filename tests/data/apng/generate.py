@@ -0,0 +1,102 @@
+# Writes the APNG test files and their expected canvases. Frames are random pixels at random
+# offsets, the reference composites them in floating point straight from the generated pixels:
+# premultiplied RGBA per frame, rounded to 8 bits, in <name>.png.rgba.
+import struct, zlib, random
+import numpy as np
+
+random.seed(49)
+rng = np.random.default_rng(49)
+
+W, H = 17, 11
+ADAM7 = [(0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2)]
+
+def chunk(kind, data):
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data) & 0xffffffff)
+
+def compress(img, interlace, bits):
+    def rows(sub):
+        dtype = '>u2' if bits == 16 else 'u1'
+        return b''.join(b'\x00' + sub[y].astype(dtype).tobytes() for y in range(sub.shape[0]))
+    if not interlace:
+        return zlib.compress(rows(img))
+    out = b''
+    for x0, y0, dx, dy in ADAM7:
+        sub = img[y0::dy, x0::dx]
+        if sub.shape[0] and sub.shape[1]:
+            out += rows(sub)
+    return zlib.compress(out)
+
+def make(name, frames, dispose, blend, interlace=0, bits=8, palette=False, hidden=False):
+    maxv = 65535 if bits == 16 else 255
+    color = 3 if palette else 6
+    head = [chunk(b'IHDR', struct.pack('>IIBBBBB', W, H, bits, color, 0, 0, interlace)), chunk(b'acTL', struct.pack('>II', frames, 0))]
+    if palette:
+        entries = rng.integers(0, 256, (256, 3))
+        alphas = rng.choice([0, 90, 255], 256)
+        head += [chunk(b'PLTE', entries.astype('u1').tobytes()), chunk(b'tRNS', alphas.astype('u1').tobytes())]
+    body = []
+    seq = 0
+    if hidden:
+        body.append(chunk(b'IDAT', compress(rng.integers(0, maxv + 1, (H, W, 1 if palette else 4)), interlace, bits)))
+
+    canvas = np.zeros((H, W, 4))
+    expected = []
+    for i in range(frames):
+        if i == 0:
+            w, h, x, y = W, H, 0, 0
+        else:
+            w, h = random.randrange(1, W + 1), random.randrange(1, H + 1)
+            x, y = random.randrange(W - w + 1), random.randrange(H - h + 1)
+        dop = dispose[i % len(dispose)]
+        bop = blend[i % len(blend)]
+        body.append(chunk(b'fcTL', struct.pack('>IIIIIHHBB', seq, w, h, x, y, 1 + i, 100, dop, bop)))
+        seq += 1
+        if palette:
+            img = rng.integers(0, 256, (h, w, 1))
+            rgba = np.concatenate([entries[img[..., 0]], alphas[img[..., 0]][..., None]], -1) / 255.0
+        else:
+            img = rng.integers(0, maxv + 1, (h, w, 4))
+            img[..., 3] = rng.choice([0, maxv // 3, maxv], (h, w))
+            rgba = np.round(img * (255.0 / maxv)) / 255.0 if bits == 16 else img / 255.0
+        data = compress(img, interlace, bits)
+        if i == 0 and not hidden:
+            body.append(chunk(b'IDAT', data))
+        else:
+            for k in range(0, len(data), 100):
+                body.append(chunk(b'fdAT', struct.pack('>I', seq) + data[k:k + 100]))
+                seq += 1
+
+        src = rgba.copy()
+        src[..., :3] *= src[..., 3:4]
+        region = (slice(y, y + h), slice(x, x + w))
+        saved = canvas[region].copy()
+        canvas[region] = src + canvas[region] * (1 - src[..., 3:4]) if bop == 1 else src
+        expected.append(np.round(canvas * 255).astype(np.uint8).tobytes())
+        if dop == 1 or (dop == 2 and i == 0):
+            canvas[region] = 0
+        elif dop == 2:
+            canvas[region] = saved
+
+    data = b'\x89PNG\r\n\x1a\n' + b''.join(head) + b''.join(body) + chunk(b'IEND', b'')
+    open(name + '.png', 'wb').write(data)
+    open(name + '.png.rgba', 'wb').write(b''.join(expected))
+    return data
+
+for dop in (0, 1, 2):
+    for bop in (0, 1):
+        make(f'dispose{dop}_blend{bop}', 5, [dop], [bop])
+make('mixed', 8, [0, 1, 2, 0, 2, 1, 0, 2], [0, 1, 1, 0, 1, 0, 1, 1])
+make('palette', 5, [0, 2, 1], [1, 0])
+make('hidden_default', 5, [0, 2, 1], [1])
+make('interlaced16', 5, [2, 0, 1], [1, 0], interlace=1, bits=16)
+
+# Cut halfway through the data of frame 3, frames 0-2 are whole. The expected canvases are the full file's.
+full = make('truncated', 6, [0, 2, 1], [1])
+starts = []
+pos = 8
+while pos < len(full):
+    length = struct.unpack('>I', full[pos:pos + 4])[0]
+    if full[pos + 4:pos + 8] == b'fcTL':
+        starts.append(pos)
+    pos += length + 12
+open('truncated.png', 'wb').write(full[:(starts[3] + starts[4]) // 2])
@@ -0,0 +1,171 @@
+#include "gif_decode.h"
+#include "gif_writer.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// GIF streams written with the plain LZW encoder from gif_writer.h, decoded back to the indices
+// they were made from: random sizes and bit depths, sub-blocks of random lengths, a table that
+// fills up with and without a clear code after it, interlaced rows, data cut off mid-frame and a
+// screen size of zero.
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what, uint32_t seed) {
+        if (ok) return;
+        std::printf("FAIL %s (stream %u)\n", what, seed);
+        ++failures;
+    }
+
+    struct Stream {
+        std::vector<uint8_t> gif;
+        std::vector<uint8_t> indices;   // Display order
+        uint32_t width = 0;
+        uint32_t height = 0;
+        int32_t transparentIndex = -1;
+        size_t dataStart = 0;           // First sub-block
+    };
+
+    // Runs of repeated values make long strings. With fillTable the frame is larger and the runs
+    // short, so the 4096 entries run out and the table is cleared or left full.
+    Stream MakeStream(std::mt19937& rng, bool clearWhenFull, bool interlaced, bool fillTable = false) {
+        Stream s;
+        s.width = fillTable ? 256 + rng() % 45 : 1 + rng() % 300;
+        s.height = fillTable ? 256 + rng() % 45 : 1 + rng() % 300;
+        const uint32_t bits = fillTable ? 5 + rng() % 4 : 1 + rng() % 8;
+        const uint32_t minCodeSize = std::max(2u, bits);
+        const uint32_t runs[] = { 1, 1, 2, 5, 40, 300 };
+        std::vector<uint8_t> stored;
+        while (stored.size() < static_cast<size_t>(s.width) * s.height) {
+            const uint8_t value = static_cast<uint8_t>(rng() % (1u << bits));
+            stored.insert(stored.end(), runs[rng() % (fillTable ? 3 : 6)], value);
+        }
+        stored.resize(static_cast<size_t>(s.width) * s.height);
+
+        // Interlaced data is stored as rows 0, 8, .. then 4, 12, .. then 2, 6, .. then the odd ones
+        s.indices = stored;
+        if (interlaced) {
+            size_t row = 0;
+            const uint32_t starts[] = { 0, 4, 2, 1 };
+            const uint32_t steps[] = { 8, 8, 4, 2 };
+            for (uint32_t pass = 0; pass < 4; ++pass) {
+                for (uint32_t y = starts[pass]; y < s.height; y += steps[pass], ++row) {
+                    std::copy_n(stored.begin() + row * s.width, s.width, s.indices.begin() + static_cast<size_t>(y) * s.width);
+                }
+            }
+        }
+
+        const std::vector<uint8_t> lzw = EncodeLzw(stored, minCodeSize, clearWhenFull);
+        auto put16 = [&](uint32_t v) {
+            s.gif.push_back(static_cast<uint8_t>(v));
+            s.gif.push_back(static_cast<uint8_t>(v >> 8));
+            };
+        const char* signature = "GIF89a";
+        s.gif.assign(signature, signature + 6);
+        put16(s.width);
+        put16(s.height);
+        s.gif.push_back(static_cast<uint8_t>(0x80 | (bits - 1)));
+        s.gif.push_back(0);
+        s.gif.push_back(0);
+        for (uint32_t i = 0; i < 3 * (1u << bits); ++i) s.gif.push_back(static_cast<uint8_t>(rng()));
+        if (rng() % 2) {
+            s.transparentIndex = static_cast<int32_t>(rng() % (1u << bits));
+            const uint8_t control[] = { 0x21, 0xF9, 4, 1, 0, 0, static_cast<uint8_t>(s.transparentIndex), 0 };
+            s.gif.insert(s.gif.end(), control, control + sizeof(control));
+        }
+        s.gif.push_back(0x2C);
+        put16(0);
+        put16(0);
+        put16(s.width);
+        put16(s.height);
+        s.gif.push_back(interlaced ? 0x40 : 0);
+        s.gif.push_back(static_cast<uint8_t>(minCodeSize));
+        s.dataStart = s.gif.size();
+        for (size_t i = 0; i < lzw.size();) {
+            const size_t n = std::min<size_t>(1 + rng() % 255, lzw.size() - i);
+            s.gif.push_back(static_cast<uint8_t>(n));
+            s.gif.insert(s.gif.end(), lzw.begin() + i, lzw.begin() + i + n);
+            i += n;
+        }
+        s.gif.push_back(0);
+        s.gif.push_back(0x3B);
+        return s;
+    }
+
+    bool DecodeIndices(const std::vector<uint8_t>& gif, std::vector<uint8_t>& out) {
+        GifDecoder decoder;
+        if (!decoder.ReadHeader(gif.data(), gif.size()) || decoder.FrameCount() != 1) return false;
+        const GifDecoder::Frame& frame = decoder.GetFrame(0);
+        out.assign(static_cast<size_t>(frame.width) * frame.height, 0xEE);
+        return decoder.DecodeFrame(0, out.data(), frame.width);
+    }
+
+    void CheckStreams() {
+        for (uint32_t seed = 0; seed < 150; ++seed) {
+            std::mt19937 rng(seed);
+            const Stream s = MakeStream(rng, seed % 2 == 0, seed % 5 == 0, seed % 3 == 0);
+            std::vector<uint8_t> decoded;
+            Check(DecodeIndices(s.gif, decoded) && decoded == s.indices, "indices differ", seed);
+        }
+    }
+
+    // Cut inside the LZW data: what was decoded still matches, the rest is the transparent index or 0
+    void CheckTruncated() {
+        for (uint32_t seed = 200; seed < 240; ++seed) {
+            std::mt19937 rng(seed);
+            Stream s = MakeStream(rng, true, false);
+            const size_t dataBytes = s.gif.size() - 2 - s.dataStart;
+            if (dataBytes < 8) continue;
+            s.gif.resize(s.dataStart + dataBytes / 2);
+
+            std::vector<uint8_t> decoded;
+            if (!DecodeIndices(s.gif, decoded)) {
+                Check(false, "truncated frame rejected", seed);
+                continue;
+            }
+            size_t same = 0;
+            while (same < decoded.size() && decoded[same] == s.indices[same]) ++same;
+            const uint8_t fill = s.transparentIndex >= 0 ? static_cast<uint8_t>(s.transparentIndex) : 0;
+            size_t filled = decoded.size();
+            while (filled > same && decoded[filled - 1] == fill) --filled;
+            Check(same > 0 && same < decoded.size(), "truncated frame decoded all or nothing", seed);
+            Check(filled == same, "missing pixels not filled", seed);
+        }
+    }
+
+    // A zero screen size grows to cover the frames, but only those walked so far
+    void CheckZeroScreen() {
+        uint8_t palette[768] = {};
+        std::vector<GifWriteFrame> frames(3);
+        frames[0] = { 0, 0, 10, 10 };
+        frames[1] = { 5, 20, 30, 4 };
+        frames[2] = { 60, 2, 8, 50 };
+        for (GifWriteFrame& frame : frames) frame.indices.assign(static_cast<size_t>(frame.width) * frame.height, 1);
+        const std::vector<uint8_t> gif = WriteGif(0, 0, palette, frames);
+
+        GifDecoder decoder;
+        Check(decoder.BeginHeader(gif.data(), gif.size()) && decoder.ReadFrames(2) == 2, "zero screen frames not found", 0);
+        Check(decoder.SizeFromFrames() && decoder.Width() == 35 && decoder.Height() == 24, "zero screen not grown to the frames so far", 0);
+        decoder.ReadFrames(SIZE_MAX);
+        Check(decoder.HeaderComplete() && decoder.Width() == 68 && decoder.Height() == 52, "zero screen not grown to every frame", 0);
+
+        std::vector<uint8_t> indices(8 * 50);
+        Check(decoder.DecodeFrame(2, indices.data(), 8) && indices.back() == 1, "frame past the first batch not decoded", 0);
+    }
+}
+
+int main() {
+    CheckStreams();
+    CheckTruncated();
+    CheckZeroScreen();
+
+    if (failures) {
+        std::printf("%d GIF decode failures\n", failures);
+        return 1;
+    }
+    std::printf("gif decode: generated streams match their indices\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// LZW encoder for the GIF test and the animation benchmarks, and a writer for whole animations:
+// one global palette, every frame with a graphic control block for its delay, disposal and
+// transparent index.
+
+namespace gif_writer {
+
+    class BitWriter {
+    public:
+        void Put(uint32_t code, uint32_t size) {
+            m_bits |= static_cast<uint64_t>(code) << m_count;
+            m_count += size;
+            while (m_count >= 8) {
+                m_out.push_back(static_cast<uint8_t>(m_bits));
+                m_bits >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        std::vector<uint8_t> Finish() {
+            if (m_count) m_out.push_back(static_cast<uint8_t>(m_bits));
+            return m_out;
+        }
+
+    private:
+        std::vector<uint8_t> m_out;
+        uint64_t m_bits = 0;
+        uint32_t m_count = 0;
+    };
+}
+
+// Textbook LZW. A full table is either cleared or left full, in which case the codes stay
+// 12 bits and nothing more is added, the deferred clear some encoders rely on.
+inline std::vector<uint8_t> EncodeLzw(const std::vector<uint8_t>& data, uint32_t minCodeSize, bool clearWhenFull) {
+    const uint32_t clear = 1u << minCodeSize;
+    const uint32_t end = clear + 1;
+    std::vector<std::vector<int32_t>> children;   // Per code, the code for each appended byte
+    uint32_t next = 0;
+    uint32_t size = 0;
+    auto reset = [&] {
+        children.assign(4096, std::vector<int32_t>());
+        next = clear + 2;
+        size = minCodeSize + 1;
+        };
+    reset();
+
+    gif_writer::BitWriter bits;
+    bits.Put(clear, size);
+    int32_t current = -1;
+    for (uint8_t byte : data) {
+        if (current < 0) {
+            current = byte;
+            continue;
+        }
+        std::vector<int32_t>& links = children[current];
+        if (links.size() > byte && links[byte] >= 0) {
+            current = links[byte];
+            continue;
+        }
+        bits.Put(current, size);
+        if (next < 4096) {
+            if (links.size() <= byte) links.resize(byte + 1, -1);
+            links[byte] = static_cast<int32_t>(next++);
+            if (next > (1u << size) && size < 12) ++size;
+        }
+        else if (clearWhenFull) {
+            bits.Put(clear, size);
+            reset();
+        }
+        current = byte;
+    }
+    if (current >= 0) bits.Put(current, size);
+    bits.Put(end, size);
+    return bits.Finish();
+}
+
+struct GifWriteFrame {
+    uint32_t left = 0;
+    uint32_t top = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t delay = 0;                 // Hundredths of a second
+    uint32_t disposal = 0;
+    int32_t transparentIndex = -1;
+    std::vector<uint8_t> indices;       // width * height, rows top to bottom
+};
+
+// palette holds 256 RGB triples
+inline std::vector<uint8_t> WriteGif(uint32_t width, uint32_t height, const uint8_t* palette, const std::vector<GifWriteFrame>& frames) {
+    std::vector<uint8_t> gif = { 'G', 'I', 'F', '8', '9', 'a' };
+    auto put16 = [&](uint32_t v) {
+        gif.push_back(static_cast<uint8_t>(v));
+        gif.push_back(static_cast<uint8_t>(v >> 8));
+        };
+    put16(width);
+    put16(height);
+    gif.push_back(0xF7);
+    gif.push_back(0);
+    gif.push_back(0);
+    gif.insert(gif.end(), palette, palette + 768);
+    for (const GifWriteFrame& frame : frames) {
+        const bool transparent = frame.transparentIndex >= 0;
+        gif.push_back(0x21);
+        gif.push_back(0xF9);
+        gif.push_back(4);
+        gif.push_back(static_cast<uint8_t>((frame.disposal & 7) << 2 | (transparent ? 1 : 0)));
+        put16(frame.delay);
+        gif.push_back(static_cast<uint8_t>(transparent ? frame.transparentIndex : 0));
+        gif.push_back(0);
+
+        gif.push_back(0x2C);
+        put16(frame.left);
+        put16(frame.top);
+        put16(frame.width);
+        put16(frame.height);
+        gif.push_back(0);
+        gif.push_back(8);
+        const std::vector<uint8_t> lzw = EncodeLzw(frame.indices, 8, true);
+        for (size_t i = 0; i < lzw.size();) {
+            const size_t n = std::min<size_t>(255, lzw.size() - i);
+            gif.push_back(static_cast<uint8_t>(n));
+            gif.insert(gif.end(), lzw.begin() + i, lzw.begin() + i + n);
+            i += n;
+        }
+        gif.push_back(0);
+    }
+    gif.push_back(0x3B);
+    return gif;
+}
+
+// Synthetic animation for the benchmarks: a full frame every 50, and between them a round sprite
+// moving across it, kept on the canvas except every fourth frame, which clears, and every seventh,
+// which restores to previous. Delays are 40 ms.
+inline std::vector<uint8_t> WriteSpriteAnimation(uint32_t width, uint32_t height, uint32_t frameCount) {
+    uint8_t palette[768];
+    for (uint32_t i = 0; i < 256; ++i) {
+        palette[i * 3 + 0] = static_cast<uint8_t>(i);
+        palette[i * 3 + 1] = static_cast<uint8_t>((i * 7) & 0xFF);
+        palette[i * 3 + 2] = static_cast<uint8_t>(255 - i);
+    }
+    const uint32_t sprite = std::min({ 96u, width, height });
+    std::vector<GifWriteFrame> frames(frameCount);
+    uint32_t noise = 1;
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        GifWriteFrame& frame = frames[i];
+        frame.delay = 4;
+        if (i % 50 == 0) {
+            frame.width = width;
+            frame.height = height;
+            frame.disposal = 1;
+            frame.indices.resize(static_cast<size_t>(width) * height);
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    noise = noise * 1664525u + 1013904223u;
+                    const uint32_t band = ((x + i * 3) / 24 + y / 24) % 6;
+                    frame.indices[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>((band * 40 + (noise >> 30) + i) % 255);
+                }
+            }
+            continue;
+        }
+        frame.width = sprite;
+        frame.height = sprite;
+        frame.left = (i * 7) % (width - sprite + 1);
+        frame.top = (i * 5 + (i / 50) * 31) % (height - sprite + 1);
+        frame.disposal = i % 7 == 0 ? 3 : i % 4 == 0 ? 2 : 1;
+        frame.transparentIndex = 255;
+        frame.indices.resize(static_cast<size_t>(sprite) * sprite);
+        const int32_t r = static_cast<int32_t>(sprite / 2);
+        for (int32_t y = 0; y < static_cast<int32_t>(sprite); ++y) {
+            for (int32_t x = 0; x < static_cast<int32_t>(sprite); ++x) {
+                const int32_t dx = x - r, dy = y - r;
+                const bool inside = dx * dx + dy * dy < r * r;
+                frame.indices[static_cast<size_t>(y) * sprite + x] = inside ? static_cast<uint8_t>((i + (dx * dx + dy * dy) / 64) % 255) : 255;
+            }
+        }
+    }
+    return WriteGif(width, height, palette, frames);
+}
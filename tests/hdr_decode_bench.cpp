@@ -0,0 +1,111 @@
+#include "bench_util.h"
+#include "hdr_decode.h"
+#include "stb_image.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Usage: hdr_decode_bench [width] [height] [maxDim]
+// A synthetic RLE .hdr decoded whole to floats by stb, as the viewer used to, against the streaming
+// decoder going straight to a display-size radiance buffer and tone-mapping it to BGRA.
+
+namespace {
+
+    void ToRgbe(float r, float g, float b, uint8_t* out) {
+        const float v = std::max(r, std::max(g, b));
+        if (v < 1e-32f) {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            return;
+        }
+        int exponent;
+        const float scale = std::frexp(v, &exponent) * 256.0f / v;
+        out[0] = static_cast<uint8_t>(r * scale);
+        out[1] = static_cast<uint8_t>(g * scale);
+        out[2] = static_cast<uint8_t>(b * scale);
+        out[3] = static_cast<uint8_t>(exponent + 128);
+    }
+
+    // New-style RLE scanlines: a sky gradient over several stops with a noisy foreground
+    std::vector<uint8_t> MakeHdr(int width, int height) {
+        const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+        std::vector<uint8_t> file(header.begin(), header.end());
+        std::vector<uint8_t> line(static_cast<size_t>(width) * 4);
+        uint32_t noise = 1;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                const float sky = std::exp2(8.0f * (1.0f - static_cast<float>(y) / height) - 2.0f);
+                const float grain = y > height / 2 ? static_cast<float>(noise >> 24) / 255.0f : 0.0f;
+                ToRgbe(sky * 0.8f + grain, sky * 0.9f + grain * 0.5f, sky + 0.1f * (x % 64) / 64.0f, &line[static_cast<size_t>(x) * 4]);
+            }
+            file.insert(file.end(), { 2, 2, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width & 255) });
+            for (int c = 0; c < 4; ++c) {
+                for (int x = 0; x < width;) {
+                    int run = 1;
+                    while (x + run < width && run < 127 && line[(x + run) * 4 + c] == line[x * 4 + c]) ++run;
+                    if (run >= 3) {
+                        file.push_back(static_cast<uint8_t>(128 + run));
+                        file.push_back(line[x * 4 + c]);
+                        x += run;
+                        continue;
+                    }
+                    // Literals up to the next run of three
+                    const int start = x;
+                    while (x < width && x - start < 128) {
+                        if (x + 2 < width && line[x * 4 + c] == line[(x + 1) * 4 + c] && line[x * 4 + c] == line[(x + 2) * 4 + c]) break;
+                        ++x;
+                    }
+                    file.push_back(static_cast<uint8_t>(x - start));
+                    for (int i = start; i < x; ++i) file.push_back(line[i * 4 + c]);
+                }
+            }
+        }
+        return file;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int width = IntArg(argc, argv, 1, 8000);
+    const int height = IntArg(argc, argv, 2, 4000);
+    const int maxDim = IntArg(argc, argv, 3, 3840);
+    const std::vector<uint8_t> file = MakeHdr(width, height);
+    std::printf("%dx%d RLE .hdr, %.1f MB\n", width, height, file.size() / 1e6);
+
+    size_t stbBytes = 0;
+    const double stbMs = BestMs(3, [&] {
+        int w = 0, h = 0, channels = 0;
+        float* pixels = stbi_loadf_from_memory(file.data(), static_cast<int>(file.size()), &w, &h, &channels, 3);
+        stbBytes = pixels ? static_cast<size_t>(w) * h * 3 * sizeof(float) : 0;
+        stbi_image_free(pixels);
+        });
+    std::printf("stb float decode          %8.1f ms  %7.1f MB image\n", stbMs, stbBytes / 1e6);
+
+    const float ratio = std::min(1.0f, std::min(static_cast<float>(maxDim) / width, static_cast<float>(maxDim) / height));
+    const uint32_t dstWidth = std::max(1u, static_cast<uint32_t>(width * ratio));
+    const uint32_t dstHeight = std::max(1u, static_cast<uint32_t>(height * ratio));
+    HdrRadianceBuffer radiance;
+    const double decodeMs = BestMs(3, [&] {
+        HdrScanlineReader reader;
+        radiance.clear();
+        if (!reader.Open(file.data(), file.size()) || !DecodeHdrToRadiance(reader, dstWidth, dstHeight, radiance, [] { return true; })) {
+            std::printf("streaming decode failed\n");
+            std::exit(1);
+        }
+        });
+    // RGBE and float source scanlines with the column map, the accumulator row with its counts
+    const size_t workBytes = static_cast<size_t>(width) * (4 + 3 * sizeof(float) + sizeof(uint32_t)) + static_cast<size_t>(dstWidth) * (3 * sizeof(float) + sizeof(uint32_t));
+    std::printf("streaming to %ux%u     %8.1f ms  %7.1f MB radiance + %.2f MB rows\n",
+        dstWidth, dstHeight, decodeMs, radiance.pixels.size() * sizeof(uint16_t) / 1e6, workBytes / 1e6);
+
+    HdrToneSettings settings;
+    settings.exposure = radiance.histogram.AutoExposure();
+    HdrToneLut lut;
+    std::vector<uint8_t> bgra(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    const double toneMs = BestMs(5, [&] {
+        lut.Build(settings);
+        ToneMapRadianceRect(radiance, lut, 0, 0, dstWidth, dstHeight, bgra.data(), static_cast<size_t>(dstWidth) * 4);
+        });
+    std::printf("re-tone to BGRA           %8.1f ms\n", toneMs);
+    return 0;
+}
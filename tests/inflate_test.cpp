@@ -0,0 +1,383 @@
+#include "inflate.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Random deflate streams written here, with stored, fixed and dynamic blocks whose codes are
+// random complete prefix codes up to 15 bits, matches reaching back the whole 32 KB and repeat
+// codes that cross from the literal to the distance lengths. Each one is handed to Inflater in
+// random spans, read back through Read in pieces of random size and through Inflate, and checked
+// against the bytes it was made from and against stb's zlib decoder.
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what, uint32_t seed) {
+        if (ok) return;
+        std::printf("FAIL %s (stream %u)\n", what, seed);
+        ++failures;
+    }
+
+    const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    class BitWriter {
+    public:
+        void Put(uint32_t value, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) PutBit((value >> i) & 1);
+        }
+
+        // Huffman codes go out most significant bit first
+        void PutCode(uint32_t code, uint32_t length) {
+            for (uint32_t i = length; i-- > 0;) PutBit((code >> i) & 1);
+        }
+
+        void Align() {
+            while (m_count) PutBit(0);
+        }
+
+        std::vector<uint8_t>& Bytes() { return m_out; }
+
+    private:
+        void PutBit(uint32_t bit) {
+            if (m_count == 0) m_out.push_back(0);
+            m_out.back() |= static_cast<uint8_t>(bit << m_count);
+            m_count = (m_count + 1) & 7;
+        }
+
+        std::vector<uint8_t> m_out;
+        uint32_t m_count = 0;
+    };
+
+    struct Code {
+        std::vector<uint8_t> lengths;
+        std::vector<uint32_t> codes;
+    };
+
+    Code Canonical(std::vector<uint8_t> lengths) {
+        uint32_t counts[16] = {};
+        for (uint8_t length : lengths) ++counts[length];
+        counts[0] = 0;
+        uint32_t next[16] = {};
+        uint32_t code = 0;
+        for (uint32_t length = 1; length < 16; ++length) {
+            code = (code + counts[length - 1]) << 1;
+            next[length] = code;
+        }
+        Code result;
+        result.codes.resize(lengths.size());
+        for (size_t i = 0; i < lengths.size(); ++i) {
+            if (lengths[i]) result.codes[i] = next[lengths[i]]++;
+        }
+        result.lengths = std::move(lengths);
+        return result;
+    }
+
+    // A random complete code over the required symbols and a few others, grown by splitting
+    // leaves of a binary tree. Often the newest leaf is split again, which makes long codes.
+    Code RandomCode(std::mt19937& rng, size_t alphabet, std::vector<bool> used, uint32_t limit) {
+        for (size_t extra = rng() % 8; extra > 0; --extra) used[rng() % alphabet] = true;
+        std::vector<size_t> symbols;
+        for (size_t i = 0; i < alphabet; ++i) {
+            if (used[i]) symbols.push_back(i);
+        }
+        while (symbols.size() < 2) {
+            const size_t symbol = rng() % alphabet;
+            if (std::find(symbols.begin(), symbols.end(), symbol) == symbols.end()) symbols.push_back(symbol);
+        }
+
+        std::vector<uint8_t> depths = { 0 };
+        while (depths.size() < symbols.size()) {
+            size_t leaf = rng() % 2 ? depths.size() - 1 : rng() % depths.size();
+            while (depths[leaf] >= limit) leaf = rng() % depths.size();
+            ++depths[leaf];
+            depths.push_back(depths[leaf]);
+        }
+        std::shuffle(depths.begin(), depths.end(), rng);
+        std::vector<uint8_t> lengths(alphabet, 0);
+        for (size_t i = 0; i < symbols.size(); ++i) lengths[symbols[i]] = depths[i];
+        return Canonical(std::move(lengths));
+    }
+
+    Code FixedLiterals() {
+        std::vector<uint8_t> lengths(288);
+        for (size_t i = 0; i < 288; ++i) lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        return Canonical(std::move(lengths));
+    }
+
+    struct Token {
+        uint32_t length;     // 0 for a literal
+        uint32_t value;      // The literal or the distance
+    };
+
+    uint32_t LengthSymbol(uint32_t length) {
+        uint32_t i = 28;
+        while (LengthBase[i] > length) --i;
+        return i;
+    }
+
+    uint32_t DistanceSymbol(uint32_t distance) {
+        uint32_t i = 29;
+        while (DistanceBase[i] > distance) --i;
+        return i;
+    }
+
+    // Literals and matches, applied to the expected output as they are made
+    std::vector<Token> RandomTokens(std::mt19937& rng, std::vector<uint8_t>& expected) {
+        std::vector<Token> tokens;
+        const size_t count = rng() % 4 ? rng() % 2000 : rng() % 30000;
+        const uint32_t alphabet = 1 + rng() % 256;
+        for (size_t i = 0; i < count; ++i) {
+            if (expected.empty() || rng() % 3 == 0) {
+                const uint8_t literal = static_cast<uint8_t>(rng() % alphabet);
+                tokens.push_back({ 0, literal });
+                expected.push_back(literal);
+                continue;
+            }
+            const uint32_t length = rng() % 4 ? 3 + rng() % 16 : 3 + rng() % 256;
+            const uint32_t reach = static_cast<uint32_t>(std::min<size_t>(expected.size(), 32768));
+            const uint32_t distance = rng() % 4 ? 1 + rng() % std::min(reach, 64u) : 1 + rng() % reach;
+            tokens.push_back({ length, distance });
+            const size_t from = expected.size() - distance;
+            for (uint32_t k = 0; k < length; ++k) expected.push_back(expected[from + k]);
+        }
+        return tokens;
+    }
+
+    void WriteTokens(BitWriter& out, const std::vector<Token>& tokens, const Code& literals, const Code& distances) {
+        for (const Token& token : tokens) {
+            if (token.length == 0) {
+                out.PutCode(literals.codes[token.value], literals.lengths[token.value]);
+                continue;
+            }
+            const uint32_t l = LengthSymbol(token.length);
+            out.PutCode(literals.codes[257 + l], literals.lengths[257 + l]);
+            out.Put(token.length - LengthBase[l], LengthExtra[l]);
+            const uint32_t d = DistanceSymbol(token.value);
+            out.PutCode(distances.codes[d], distances.lengths[d]);
+            out.Put(token.value - DistanceBase[d], DistanceExtra[d]);
+        }
+        out.PutCode(literals.codes[256], literals.lengths[256]);
+    }
+
+    void WriteDynamicBlock(std::mt19937& rng, BitWriter& out, const std::vector<Token>& tokens) {
+        std::vector<bool> usedLiterals(286, false);
+        std::vector<bool> usedDistances(30, false);
+        usedLiterals[256] = true;
+        for (const Token& token : tokens) {
+            if (token.length == 0) {
+                usedLiterals[token.value] = true;
+            }
+            else {
+                usedLiterals[257 + LengthSymbol(token.length)] = true;
+                usedDistances[DistanceSymbol(token.value)] = true;
+            }
+        }
+        const Code literals = RandomCode(rng, 286, usedLiterals, 15);
+        const Code distances = RandomCode(rng, 30, usedDistances, 15);
+
+        uint32_t literalCount = 286;
+        while (literalCount > 257 && literals.lengths[literalCount - 1] == 0) --literalCount;
+        uint32_t distanceCount = 30;
+        while (distanceCount > 1 && distances.lengths[distanceCount - 1] == 0) --distanceCount;
+        std::vector<uint8_t> all(literals.lengths.begin(), literals.lengths.begin() + literalCount);
+        all.insert(all.end(), distances.lengths.begin(), distances.lengths.begin() + distanceCount);
+
+        // Runs become repeat codes when the dice allow, and may cross into the distance lengths
+        struct Run { uint32_t symbol, extra, extraBits; };
+        std::vector<Run> runs;
+        for (size_t i = 0; i < all.size();) {
+            size_t same = 1;
+            while (i + same < all.size() && all[i + same] == all[i]) ++same;
+            if (all[i] == 0 && same >= 11 && rng() % 4) {
+                const uint32_t n = static_cast<uint32_t>(std::min<size_t>(same, 11 + rng() % 128));
+                runs.push_back({ 18, n - 11, 7 });
+                i += n;
+            }
+            else if (all[i] == 0 && same >= 3 && rng() % 4) {
+                const uint32_t n = static_cast<uint32_t>(std::min<size_t>(same, 3 + rng() % 8));
+                runs.push_back({ 17, n - 3, 3 });
+                i += n;
+            }
+            else if (i > 0 && all[i - 1] == all[i] && same >= 3 && rng() % 4) {
+                const uint32_t n = static_cast<uint32_t>(std::min<size_t>(same, 3 + rng() % 4));
+                runs.push_back({ 16, n - 3, 2 });
+                i += n;
+            }
+            else {
+                runs.push_back({ all[i], 0, 0 });
+                ++i;
+            }
+        }
+        std::vector<bool> usedLengths(19, false);
+        for (const Run& run : runs) usedLengths[run.symbol] = true;
+        const Code lengthCode = RandomCode(rng, 19, usedLengths, 7);
+        uint32_t lengthCount = 19;
+        while (lengthCount > 4 && lengthCode.lengths[CodeLengthOrder[lengthCount - 1]] == 0) --lengthCount;
+
+        out.Put(2, 2);
+        out.Put(literalCount - 257, 5);
+        out.Put(distanceCount - 1, 5);
+        out.Put(lengthCount - 4, 4);
+        for (uint32_t i = 0; i < lengthCount; ++i) out.Put(lengthCode.lengths[CodeLengthOrder[i]], 3);
+        for (const Run& run : runs) {
+            out.PutCode(lengthCode.codes[run.symbol], lengthCode.lengths[run.symbol]);
+            out.Put(run.extra, run.extraBits);
+        }
+        WriteTokens(out, tokens, literals, distances);
+    }
+
+    struct Stream {
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> expected;
+    };
+
+    Stream MakeStream(std::mt19937& rng, Inflater::Format format) {
+        Stream s;
+        BitWriter out;
+        static const Code fixedLiterals = FixedLiterals();
+        static const Code fixedDistances = Canonical(std::vector<uint8_t>(30, 5));
+        const uint32_t blocks = 1 + rng() % 6;
+        for (uint32_t block = 0; block < blocks; ++block) {
+            out.Put(block + 1 == blocks, 1);
+            const uint32_t type = rng() % 4;
+            if (type == 0) {
+                const uint32_t length = rng() % 2 ? rng() % 300 : rng() % 65536;
+                out.Put(0, 2);
+                out.Align();
+                out.Put(length, 16);
+                out.Put(~length & 0xFFFF, 16);
+                for (uint32_t i = 0; i < length; ++i) {
+                    const uint8_t byte = static_cast<uint8_t>(rng());
+                    out.Put(byte, 8);
+                    s.expected.push_back(byte);
+                }
+            }
+            else {
+                const std::vector<Token> tokens = RandomTokens(rng, s.expected);
+                if (type == 1) {
+                    out.Put(1, 2);
+                    WriteTokens(out, tokens, fixedLiterals, fixedDistances);
+                }
+                else {
+                    WriteDynamicBlock(rng, out, tokens);
+                }
+            }
+        }
+        out.Align();
+
+        if (format == Inflater::Format::Raw) {
+            s.compressed = std::move(out.Bytes());
+            return s;
+        }
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (uint8_t byte : s.expected) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        const uint32_t adler = (b << 16) | a;
+        s.compressed = { 0x78, 0x9C };
+        s.compressed.insert(s.compressed.end(), out.Bytes().begin(), out.Bytes().end());
+        for (int shift = 24; shift >= 0; shift -= 8) s.compressed.push_back(static_cast<uint8_t>(adler >> shift));
+        return s;
+    }
+
+    // Spans of 1 to 7 bytes, of up to 70000, or the whole stream at once
+    void AddSpans(std::mt19937& rng, Inflater& inflater, const std::vector<uint8_t>& data) {
+        const uint32_t mode = rng() % 3;
+        for (size_t pos = 0; pos < data.size();) {
+            const size_t n = mode == 0 ? data.size() : std::min<size_t>(data.size() - pos, 1 + rng() % (mode == 1 ? 7 : 70000));
+            inflater.AddInput(data.data() + pos, n);
+            pos += n;
+        }
+    }
+
+    std::vector<uint8_t> ReadAll(std::mt19937& rng, Inflater& inflater) {
+        std::vector<uint8_t> out;
+        for (;;) {
+            const size_t want = rng() % 2 ? 1 + rng() % 16 : 1 + rng() % 100000;
+            const size_t at = out.size();
+            out.resize(at + want);
+            const size_t got = inflater.Read(out.data() + at, want);
+            out.resize(at + got);
+            if (got == 0) return out;
+        }
+    }
+
+    std::vector<uint8_t> StbDecode(const std::vector<uint8_t>& compressed, size_t capacity, Inflater::Format format) {
+        std::vector<uint8_t> out(capacity + 1);
+        const char* in = reinterpret_cast<const char*>(compressed.data());
+        char* dst = reinterpret_cast<char*>(out.data());
+        const int size = format == Inflater::Format::Zlib
+            ? stbi_zlib_decode_buffer(dst, static_cast<int>(out.size()), in, static_cast<int>(compressed.size()))
+            : stbi_zlib_decode_noheader_buffer(dst, static_cast<int>(out.size()), in, static_cast<int>(compressed.size()));
+        out.resize(size < 0 ? 0 : size);
+        return out;
+    }
+
+    void CheckStreams() {
+        for (uint32_t seed = 0; seed < 300; ++seed) {
+            std::mt19937 rng(seed);
+            const Inflater::Format format = seed % 4 == 3 ? Inflater::Format::Raw : Inflater::Format::Zlib;
+            const Stream s = MakeStream(rng, format);
+            Check(StbDecode(s.compressed, s.expected.size(), format) == s.expected, "stb disagrees with the generator", seed);
+
+            Inflater reader(format);
+            AddSpans(rng, reader, s.compressed);
+            Check(ReadAll(rng, reader) == s.expected && reader.Finished(), "Read output differs", seed);
+
+            Inflater pusher(format);
+            AddSpans(rng, pusher, s.compressed);
+            std::vector<uint8_t> pushed;
+            const bool done = pusher.Inflate([&](const uint8_t* data, size_t size) {
+                pushed.insert(pushed.end(), data, data + size);
+                return true;
+                });
+            Check(done && pushed == s.expected && pusher.Finished(), "Inflate output differs", seed);
+        }
+    }
+
+    // Cut short, both paths give a prefix of the output and Inflate reports the failure
+    void CheckTruncated() {
+        for (uint32_t seed = 1000; seed < 1060; ++seed) {
+            std::mt19937 rng(seed);
+            Stream s = MakeStream(rng, Inflater::Format::Zlib);
+            if (s.compressed.size() < 16) continue;
+            s.compressed.resize(2 + rng() % (s.compressed.size() - 8));
+
+            Inflater reader;
+            AddSpans(rng, reader, s.compressed);
+            const std::vector<uint8_t> read = ReadAll(rng, reader);
+            Check(read.size() < s.expected.size() && std::equal(read.begin(), read.end(), s.expected.begin()), "truncated Read not a prefix", seed);
+            Check(!reader.Finished(), "truncated stream finished", seed);
+
+            Inflater pusher;
+            AddSpans(rng, pusher, s.compressed);
+            std::vector<uint8_t> pushed;
+            const bool done = pusher.Inflate([&](const uint8_t* data, size_t size) {
+                pushed.insert(pushed.end(), data, data + size);
+                return true;
+                });
+            Check(!done && pushed.size() < s.expected.size() && std::equal(pushed.begin(), pushed.end(), s.expected.begin()), "truncated Inflate not a prefix", seed);
+        }
+    }
+}
+
+int main() {
+    CheckStreams();
+    CheckTruncated();
+
+    if (failures) {
+        std::printf("%d inflate failures\n", failures);
+        return 1;
+    }
+    std::printf("inflate: random streams match the generator and stb\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "bench_util.h"
+#include "jpeg_decode.h"
+#include "jpeg_writer.h"
+#include "resampler.h"
+#include "stb_image.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Usage: jpeg_decode_bench [width height | file.jpg ...]
+// Screen-size previews of large JPEGs: stb's full decode followed by a resample to 1920 wide, the
+// old fallback, against the native decoder at 1/1 to 1/8 followed by the same resample. Without
+// files a 50 MP photo-like image is written as baseline and as progressive 4:2:0.
+
+namespace {
+
+    std::vector<uint8_t> MakePhoto(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        uint32_t noise = 1;
+        for (uint32_t y = 0; y < height; ++y) {
+            uint8_t* row = rgb.data() + static_cast<size_t>(y) * width * 3;
+            for (uint32_t x = 0; x < width; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                const float wave = std::sin(x * 0.013f) * std::cos(y * 0.011f) * 60.0f + std::sin((x + y) * 0.2f) * 12.0f;
+                const int grain = static_cast<int>(noise >> 28) - 8;
+                row[x * 3 + 0] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 160 / width + wave) + grain, 0, 255));
+                row[x * 3 + 1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 160 / height + 40 + wave * 0.5f) + grain, 0, 255));
+                row[x * 3 + 2] = static_cast<uint8_t>(std::clamp(static_cast<int>(128 - wave) + grain, 0, 255));
+            }
+        }
+        return rgb;
+    }
+
+    void Run(const std::string& name, const std::vector<uint8_t>& file) {
+        JpegDecoder header;
+        if (!header.ReadHeader(file.data(), file.size())) {
+            std::printf("%s: not a JPEG the decoder takes\n", name.c_str());
+            return;
+        }
+        const uint32_t width = header.Width();
+        const uint32_t height = header.Height();
+        const uint32_t targetWidth = std::min(width, 1920u);
+        const uint32_t targetHeight = std::max(1u, static_cast<uint32_t>(static_cast<uint64_t>(height) * targetWidth / width));
+        std::vector<uint8_t> target(static_cast<size_t>(targetWidth) * targetHeight * 4);
+        std::printf("%s: %ux%u %s, %.1f MB, preview %ux%u\n", name.c_str(), width, height,
+            header.IsProgressive() ? "progressive" : "baseline", file.size() / 1e6, targetWidth, targetHeight);
+
+        const double stbMs = BestMs(3, [&] {
+            int w = 0, h = 0, channels = 0;
+            uint8_t* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &w, &h, &channels, 4);
+            if (pixels) ResampleBgra8(pixels, static_cast<size_t>(w) * 4, w, h, target.data(), static_cast<size_t>(targetWidth) * 4, targetWidth, targetHeight);
+            stbi_image_free(pixels);
+            });
+        std::printf("  stb full decode + resample  %8.1f ms\n", stbMs);
+
+        for (uint32_t scale : { 1u, 2u, 4u, 8u }) {
+            const uint32_t w = JpegDecoder::ScaledSize(width, scale);
+            const uint32_t h = JpegDecoder::ScaledSize(height, scale);
+            std::vector<uint8_t> decoded(static_cast<size_t>(w) * h * 4);
+            double decodeMs = 1e300;
+            const double totalMs = BestMs(3, [&] {
+                const auto start = std::chrono::steady_clock::now();
+                JpegDecoder decoder;
+                decoder.ReadHeader(file.data(), file.size());
+                decoder.Decode(scale, decoded.data(), static_cast<size_t>(w) * 4);
+                decodeMs = std::min(decodeMs, ElapsedMs(start));
+                ResampleBgra8(decoded.data(), static_cast<size_t>(w) * 4, w, h, target.data(), static_cast<size_t>(targetWidth) * 4, targetWidth, targetHeight);
+                });
+            std::printf("  native 1/%u decode + resample %8.1f ms (decode %.1f)\n", scale, totalMs, decodeMs);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const bool files = argc > 1 && std::string(argv[1]).find_first_not_of("0123456789") != std::string::npos;
+    if (files) {
+        for (int i = 1; i < argc; ++i) {
+            std::ifstream in(argv[i], std::ios::binary);
+            Run(argv[i], std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {}));
+        }
+        return 0;
+    }
+
+    const uint32_t width = IntArg(argc, argv, 1, 8660);
+    const uint32_t height = IntArg(argc, argv, 2, 5773);
+    const std::vector<uint8_t> photo = MakePhoto(width, height);
+    JpegWriteOptions options;
+    Run("generated", WriteJpeg(photo.data(), width, height, options));
+    options.progressive = true;
+    Run("generated", WriteJpeg(photo.data(), width, height, options));
+    return 0;
+}
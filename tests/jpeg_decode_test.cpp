@@ -0,0 +1,210 @@
+#include "jpeg_decode.h"
+#include "test_data.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+
+// Scaled decodes of the sample files, rejection of malformed Huffman tables, and mutated
+// files that must fail or decode without touching memory outside the decoder. The mutation
+// pass is most useful with -DTEST_SANITIZE=ON.
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what, const char* file) {
+        if (ok) return;
+        std::printf("FAIL %s: %s\n", file, what);
+        ++failures;
+    }
+
+    const char* const kSamples[] = {
+        "baseline420.jpg",
+        "baseline444.jpg",
+        "progressive420.jpg",
+        "progressive_restart420.jpg",
+        "restart420.jpg",
+        "gray_progressive.jpg",
+        "cmyk.jpg"
+    };
+
+    bool DecodeAt(const std::vector<uint8_t>& data, uint32_t scale, std::vector<uint8_t>& out, uint32_t& width, uint32_t& height) {
+        JpegDecoder decoder;
+        if (!decoder.ReadHeader(data.data(), data.size())) return false;
+        width = JpegDecoder::ScaledSize(decoder.Width(), scale);
+        height = JpegDecoder::ScaledSize(decoder.Height(), scale);
+        if (static_cast<uint64_t>(width) * height > 64ull * 1024 * 1024) return false;
+        out.assign(static_cast<size_t>(width) * height * 4, 0);
+        return decoder.Decode(scale, out.data(), static_cast<size_t>(width) * 4);
+    }
+
+    // A reduced decode has to agree with the full decode averaged over the same blocks
+    void CheckScaledDecodes(const char* name) {
+        const std::vector<uint8_t> data = ReadTestFile(name);
+        std::vector<uint8_t> full;
+        uint32_t fullW = 0, fullH = 0;
+        if (!DecodeAt(data, 1, full, fullW, fullH)) {
+            Check(false, "full decode", name);
+            return;
+        }
+
+        for (uint32_t scale : { 2u, 4u, 8u }) {
+            std::vector<uint8_t> scaled;
+            uint32_t w = 0, h = 0;
+            if (!DecodeAt(data, scale, scaled, w, h)) {
+                Check(false, "scaled decode", name);
+                continue;
+            }
+            uint64_t error = 0, samples = 0;
+            for (uint32_t y = 0; y + 1 < h; ++y) {
+                for (uint32_t x = 0; x + 1 < w; ++x) {
+                    for (uint32_t c = 0; c < 3; ++c) {
+                        uint32_t sum = 0;
+                        for (uint32_t dy = 0; dy < scale; ++dy) {
+                            for (uint32_t dx = 0; dx < scale; ++dx) {
+                                sum += full[((static_cast<size_t>(y) * scale + dy) * fullW + x * scale + dx) * 4 + c];
+                            }
+                        }
+                        const int mean = static_cast<int>(sum / (scale * scale));
+                        error += std::abs(mean - scaled[(static_cast<size_t>(y) * w + x) * 4 + c]);
+                        ++samples;
+                    }
+                }
+            }
+            Check(samples == 0 || error / samples <= 8, "scaled decode strays from the averaged full decode", name);
+        }
+    }
+
+    // Encodes of the same pixels with the same tables hold the same coefficients, so every
+    // scale has to decode byte for byte like the baseline file
+    void CheckSameAsBaseline(const char* name) {
+        const std::vector<uint8_t> reference = ReadTestFile("baseline420.jpg");
+        const std::vector<uint8_t> data = ReadTestFile(name);
+        for (uint32_t scale : { 1u, 2u, 4u, 8u }) {
+            std::vector<uint8_t> expected, actual;
+            uint32_t w = 0, h = 0;
+            const bool decoded = DecodeAt(reference, scale, expected, w, h) && DecodeAt(data, scale, actual, w, h);
+            if (!decoded || expected != actual) {
+                std::printf("FAIL %s: differs from baseline at 1/%u\n", name, scale);
+                ++failures;
+            }
+        }
+    }
+
+    size_t FindRestartMarker(const std::vector<uint8_t>& data, uint32_t n) {
+        for (size_t p = 0; p + 1 < data.size(); ++p) {
+            if (data[p] == 0xFF && data[p + 1] == 0xD0 + n) return p;
+        }
+        return 0;
+    }
+
+    // Intervals decode on their own. An out-of-sequence marker drops back to the serial path,
+    // which still resynchronizes on it, and damage inside one interval stays there.
+    void CheckRestartIntervals() {
+        const char* name = "restart420.jpg";
+        CheckSameAsBaseline(name);
+
+        const std::vector<uint8_t> reference = ReadTestFile("baseline420.jpg");
+        const std::vector<uint8_t> original = ReadTestFile(name);
+        std::vector<uint8_t> expected, actual;
+        uint32_t w = 0, h = 0;
+        DecodeAt(reference, 1, expected, w, h);
+
+        std::vector<uint8_t> renumbered = original;
+        const size_t marker = FindRestartMarker(renumbered, 1);
+        Check(marker != 0, "restart markers", name);
+        renumbered[marker + 1] = 0xD5;
+        Check(DecodeAt(renumbered, 1, actual, w, h) && actual == expected, "out-of-sequence marker not resynchronized", name);
+
+        // Interval 1 holds MCUs 4-7, the last MCU row is rows 48-55 and from intervals 3 and 4
+        std::vector<uint8_t> damaged = original;
+        const size_t first = FindRestartMarker(damaged, 0);
+        for (size_t p = first + 40; p < first + 60; ++p) {
+            if (damaged[p] != 0xFF && damaged[p - 1] != 0xFF) damaged[p] ^= 0x5A;
+            if (damaged[p] == 0xFF) damaged[p] = 0xFE;
+        }
+        const bool decoded = DecodeAt(damaged, 1, actual, w, h);
+        const size_t untouched = static_cast<size_t>(50) * w * 4;
+        Check(decoded && std::equal(actual.begin() + untouched, actual.end(), expected.begin() + untouched),
+            "damage spread past its restart interval", name);
+    }
+
+    // Sixteen 1-bit codes used to fill the lookahead far past its end from ReadHeader. The
+    // decoder sits in a guarded buffer so the check does not depend on a sanitizer.
+    void CheckOverfullHuffmanTable() {
+        const char* name = "huffman_overflow.jpg";
+        const std::vector<uint8_t> data = ReadTestFile(name);
+        constexpr size_t Guard = 64 * 1024;
+        std::vector<uint8_t> storage(sizeof(JpegDecoder) + Guard + alignof(JpegDecoder), 0xA5);
+        void* place = storage.data();
+        size_t space = storage.size();
+        place = std::align(alignof(JpegDecoder), sizeof(JpegDecoder), place, space);
+        JpegDecoder* decoder = new (place) JpegDecoder();
+        Check(!decoder->ReadHeader(data.data(), data.size()), "overfull Huffman table accepted", name);
+        decoder->~JpegDecoder();
+
+        const uint8_t* tail = static_cast<uint8_t*>(place) + sizeof(JpegDecoder);
+        const uint8_t* end = storage.data() + storage.size();
+        bool intact = true;
+        for (const uint8_t* p = tail; p < end; ++p) intact &= (*p == 0xA5);
+        Check(intact, "Huffman table written past the decoder", name);
+    }
+
+    void CheckDcCategoryRejected() {
+        const char* name = "dc_category.jpg";
+        const std::vector<uint8_t> data = ReadTestFile(name);
+        std::vector<uint8_t> out;
+        uint32_t w = 0, h = 0;
+        Check(!DecodeAt(data, 1, out, w, h), "DC category above 11 accepted", name);
+    }
+
+    // Truncations, random byte changes and Huffman count changes. Each result only has to be
+    // a clean success or failure.
+    void Mutate(uint32_t iterations) {
+        std::mt19937 rng(2024);
+        for (const char* name : kSamples) {
+            const std::vector<uint8_t> original = ReadTestFile(name);
+            if (original.empty()) continue;
+            for (uint32_t i = 0; i < iterations; ++i) {
+                std::vector<uint8_t> data = original;
+                switch (i % 3) {
+                case 0:
+                    data.resize(rng() % data.size());
+                    break;
+                case 1:
+                    for (uint32_t k = 0; k < 1 + i % 8; ++k) data[rng() % data.size()] = static_cast<uint8_t>(rng());
+                    break;
+                default:
+                    for (size_t p = 0; p + 21 < data.size(); ++p) {
+                        if (data[p] == 0xFF && data[p + 1] == 0xC4 && rng() % 2) data[p + 5 + rng() % 16] = static_cast<uint8_t>(rng());
+                    }
+                    break;
+                }
+                data.shrink_to_fit();
+                std::vector<uint8_t> out;
+                uint32_t w = 0, h = 0;
+                DecodeAt(data, (i / 3) % 2 ? 8 : 1, out, w, h);
+            }
+        }
+    }
+}
+
+int main() {
+    for (const char* name : kSamples) CheckScaledDecodes(name);
+    CheckSameAsBaseline("progressive420.jpg");
+    CheckSameAsBaseline("progressive_restart420.jpg");
+    CheckRestartIntervals();
+    CheckOverfullHuffmanTable();
+    CheckDcCategoryRejected();
+    Mutate(600);
+
+    if (failures) {
+        std::printf("%d JPEG decode failures\n", failures);
+        return 1;
+    }
+    std::printf("jpeg decode: samples, malformed tables and mutations pass\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "bench_util.h"
+#include "jpeg_decode.h"
+#include "jpeg_writer.h"
+#include "parallel.h"
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Usage: jpeg_restart_bench [width] [height]
+// Decode time on the worker pool against one thread, for a 50 MP 4:2:0 image written without
+// restart markers, with one interval per MCU row and with one every 8 MCUs, baseline and
+// progressive. Pool output is checked against the serial output, which must be identical.
+
+namespace {
+
+    // Inside a pool task the decoder's own ParallelFor calls run inline, which gives the serial time
+    void RunSerial(const std::function<void()>& body) {
+        ParallelFor(ParallelThreadCount(), 1, [&](uint32_t begin, uint32_t) {
+            if (begin == 0) body();
+            });
+    }
+
+    void Run(const char* name, const std::vector<uint8_t>& file) {
+        JpegDecoder header;
+        header.ReadHeader(file.data(), file.size());
+        std::printf("%s, %.1f MB\n", name, file.size() / 1e6);
+        for (uint32_t scale : { 1u, 2u, 4u, 8u }) {
+            const uint32_t w = JpegDecoder::ScaledSize(header.Width(), scale);
+            const uint32_t h = JpegDecoder::ScaledSize(header.Height(), scale);
+            std::vector<uint8_t> pooled(static_cast<size_t>(w) * h * 4);
+            std::vector<uint8_t> serial(pooled.size());
+            auto decode = [&](std::vector<uint8_t>& out) {
+                JpegDecoder decoder;
+                decoder.ReadHeader(file.data(), file.size());
+                decoder.Decode(scale, out.data(), static_cast<size_t>(w) * 4);
+                };
+            const double pooledMs = BestMs(5, [&] { decode(pooled); });
+            const double serialMs = BestMs(5, [&] { RunSerial([&] { decode(serial); }); });
+            std::printf("  1/%u  %8.1f ms pool  %8.1f ms serial  %5.2fx%s\n", scale, pooledMs, serialMs, serialMs / pooledMs,
+                pooled == serial ? "" : "  OUTPUT DIFFERS");
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 8660);
+    const uint32_t height = IntArg(argc, argv, 2, 5773);
+    std::printf("%ux%u, %u threads\n", width, height, ParallelThreadCount());
+
+    std::vector<uint8_t> photo(static_cast<size_t>(width) * height * 3);
+    uint32_t noise = 1;
+    for (size_t i = 0; i < photo.size(); i += 3) {
+        noise = noise * 1664525u + 1013904223u;
+        const uint32_t x = static_cast<uint32_t>(i / 3 % width);
+        const uint32_t y = static_cast<uint32_t>(i / 3 / width);
+        const float wave = std::sin(x * 0.013f) * std::cos(y * 0.011f) * 60.0f;
+        photo[i + 0] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 160 / width + wave) + static_cast<int>(noise >> 28), 0, 255));
+        photo[i + 1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 160 / height + 40 + wave * 0.5f), 0, 255));
+        photo[i + 2] = static_cast<uint8_t>(std::clamp(static_cast<int>(128 - wave) + static_cast<int>(noise >> 29), 0, 255));
+    }
+
+    const uint32_t mcuRow = (width + 15) / 16;
+    JpegWriteOptions options;
+    Run("baseline, no restarts", WriteJpeg(photo.data(), width, height, options));
+    options.restartInterval = mcuRow;
+    Run("baseline, restart every MCU row", WriteJpeg(photo.data(), width, height, options));
+    options.restartInterval = 8;
+    Run("baseline, restart every 8 MCUs", WriteJpeg(photo.data(), width, height, options));
+    options.progressive = true;
+    options.restartInterval = mcuRow;
+    Run("progressive, restart every MCU row", WriteJpeg(photo.data(), width, height, options));
+    return 0;
+}
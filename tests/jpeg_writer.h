@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+// Small JPEG writer so the benchmarks can make large files of any shape: YCbCr 4:2:0 or 4:4:4 with
+// the Annex K tables, baseline with optional restart intervals, or progressive by spectral
+// selection alone (a DC scan, then AC 1-5 and 6-63 per component, no successive approximation).
+
+struct JpegWriteOptions {
+    uint32_t quality = 90;
+    bool subsample = true;          // 4:2:0, otherwise 4:4:4
+    uint32_t restartInterval = 0;   // In MCUs, 0 for none
+    bool progressive = false;
+};
+
+namespace jpeg_writer {
+
+    inline constexpr uint8_t Zigzag[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+    inline constexpr uint8_t LumaQuant[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99 };
+
+    inline constexpr uint8_t ChromaQuant[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99 };
+
+    inline constexpr uint8_t DcLumaCounts[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    inline constexpr uint8_t DcChromaCounts[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    inline constexpr uint8_t DcSymbols[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    inline constexpr uint8_t AcLumaCounts[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 125 };
+    inline constexpr uint8_t AcLumaSymbols[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08,
+        0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+        0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6,
+        0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+        0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+
+    inline constexpr uint8_t AcChromaCounts[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 119 };
+    inline constexpr uint8_t AcChromaSymbols[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+        0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+        0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+        0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4,
+        0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+        0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+
+    // Code and length per symbol, canonical from the counts
+    struct HuffmanCode {
+        uint16_t code[256] = {};
+        uint8_t length[256] = {};
+
+        HuffmanCode(const uint8_t* counts, const uint8_t* symbols) {
+            uint32_t next = 0;
+            size_t k = 0;
+            for (uint32_t len = 1; len <= 16; ++len, next <<= 1) {
+                for (uint32_t i = 0; i < counts[len - 1]; ++i, ++k, ++next) {
+                    code[symbols[k]] = static_cast<uint16_t>(next);
+                    length[symbols[k]] = static_cast<uint8_t>(len);
+                }
+            }
+        }
+    };
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+        void Put(uint32_t value, uint32_t count) {
+            m_bits = (m_bits << count) | (value & ((1u << count) - 1));
+            m_count += count;
+            while (m_count >= 8) {
+                m_count -= 8;
+                const uint8_t byte = static_cast<uint8_t>(m_bits >> m_count);
+                m_out.push_back(byte);
+                if (byte == 0xFF) m_out.push_back(0);
+            }
+        }
+
+        void Code(const HuffmanCode& table, uint32_t symbol) { Put(table.code[symbol], table.length[symbol]); }
+
+        // Pads the last byte with ones, as before a marker
+        void Flush() {
+            if (m_count) Put(0x7F, 8 - m_count);
+        }
+
+    private:
+        std::vector<uint8_t>& m_out;
+        uint64_t m_bits = 0;
+        uint32_t m_count = 0;
+    };
+
+    inline uint32_t Category(int32_t value) {
+        uint32_t magnitude = static_cast<uint32_t>(value < 0 ? -value : value);
+        uint32_t bits = 0;
+        while (magnitude) {
+            ++bits;
+            magnitude >>= 1;
+        }
+        return bits;
+    }
+
+    inline void PutValue(BitWriter& bits, int32_t value, uint32_t category) {
+        bits.Put(static_cast<uint32_t>(value < 0 ? value - 1 : value), category);
+    }
+
+    // AAN float forward DCT on one row or column, in place with the given step
+    inline void Fdct8(float* d, size_t step) {
+        const float t0 = d[0] + d[7 * step], t7 = d[0] - d[7 * step];
+        const float t1 = d[step] + d[6 * step], t6 = d[step] - d[6 * step];
+        const float t2 = d[2 * step] + d[5 * step], t5 = d[2 * step] - d[5 * step];
+        const float t3 = d[3 * step] + d[4 * step], t4 = d[3 * step] - d[4 * step];
+
+        const float t10 = t0 + t3, t13 = t0 - t3, t11 = t1 + t2, t12 = t1 - t2;
+        d[0] = t10 + t11;
+        d[4 * step] = t10 - t11;
+        const float z1 = (t12 + t13) * 0.707106781f;
+        d[2 * step] = t13 + z1;
+        d[6 * step] = t13 - z1;
+
+        const float s10 = t4 + t5, s11 = t5 + t6, s12 = t6 + t7;
+        const float z5 = (s10 - s12) * 0.382683433f;
+        const float z2 = 0.541196100f * s10 + z5;
+        const float z4 = 1.306562965f * s12 + z5;
+        const float z3 = s11 * 0.707106781f;
+        const float z11 = t7 + z3, z13 = t7 - z3;
+        d[5 * step] = z13 + z2;
+        d[3 * step] = z13 - z2;
+        d[step] = z11 + z4;
+        d[7 * step] = z11 - z4;
+    }
+
+    struct Plane {
+        uint32_t h = 1;
+        uint32_t v = 1;
+        uint32_t blocksW = 0;       // Padded to whole MCUs
+        uint32_t blocksH = 0;
+        uint32_t dataBlocksW = 0;   // Blocks a non-interleaved scan covers
+        uint32_t dataBlocksH = 0;
+        std::vector<int16_t> coefs; // 64 per block in zigzag order, quantized
+    };
+}
+
+inline std::vector<uint8_t> WriteJpeg(const uint8_t* rgb, uint32_t width, uint32_t height, const JpegWriteOptions& options) {
+    using namespace jpeg_writer;
+    const uint32_t quality = std::clamp(options.quality, 1u, 100u);
+    const uint32_t scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    uint8_t quant[2][64];
+    float divisor[2][64];
+    for (int t = 0; t < 2; ++t) {
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t base = t == 0 ? LumaQuant[i] : ChromaQuant[i];
+            quant[t][i] = static_cast<uint8_t>(std::clamp((base * scale + 50) / 100, 1u, 255u));
+            const auto aan = [](int k) { return k == 0 ? 1.0 : std::cos(k * 3.14159265358979 / 16.0) * std::sqrt(2.0); };
+            divisor[t][i] = static_cast<float>(quant[t][i] * 8.0 * aan(i / 8) * aan(i % 8));
+        }
+    }
+
+    const uint32_t maxH = options.subsample ? 2 : 1;
+    const uint32_t mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+    const uint32_t mcusY = (height + 8 * maxH - 1) / (8 * maxH);
+    Plane planes[3];
+    for (int c = 0; c < 3; ++c) {
+        Plane& p = planes[c];
+        p.h = p.v = c == 0 ? maxH : 1;
+        p.blocksW = mcusX * p.h;
+        p.blocksH = mcusY * p.v;
+        p.dataBlocksW = ((width * p.h + maxH - 1) / maxH + 7) / 8;
+        p.dataBlocksH = ((height * p.v + maxH - 1) / maxH + 7) / 8;
+        p.coefs.resize(static_cast<size_t>(p.blocksW) * p.blocksH * 64);
+    }
+
+    // Colour conversion, chroma averaged over the sampling factor, edges replicated into the padding
+    auto sample = [&](int c, uint32_t x, uint32_t y) {
+        const uint8_t* px = rgb + (static_cast<size_t>(std::min(y, height - 1)) * width + std::min(x, width - 1)) * 3;
+        if (c == 0) return 0.299f * px[0] + 0.587f * px[1] + 0.114f * px[2];
+        if (c == 1) return -0.168736f * px[0] - 0.331264f * px[1] + 0.5f * px[2] + 128.0f;
+        return 0.5f * px[0] - 0.418688f * px[1] - 0.081312f * px[2] + 128.0f;
+        };
+    for (int c = 0; c < 3; ++c) {
+        Plane& p = planes[c];
+        const uint32_t factor = maxH / p.h;
+        const int t = c == 0 ? 0 : 1;
+        for (uint32_t by = 0; by < p.blocksH; ++by) {
+            for (uint32_t bx = 0; bx < p.blocksW; ++bx) {
+                float block[64];
+                for (uint32_t y = 0; y < 8; ++y) {
+                    for (uint32_t x = 0; x < 8; ++x) {
+                        float sum = 0.0f;
+                        for (uint32_t sy = 0; sy < factor; ++sy) {
+                            for (uint32_t sx = 0; sx < factor; ++sx) {
+                                sum += sample(c, ((bx * 8 + x) * factor) + sx, ((by * 8 + y) * factor) + sy);
+                            }
+                        }
+                        block[y * 8 + x] = sum / (factor * factor) - 128.0f;
+                    }
+                }
+                for (int i = 0; i < 8; ++i) Fdct8(block + i * 8, 1);
+                for (int i = 0; i < 8; ++i) Fdct8(block + i, 8);
+                int16_t* out = p.coefs.data() + (static_cast<size_t>(by) * p.blocksW + bx) * 64;
+                for (int k = 0; k < 64; ++k) {
+                    out[k] = static_cast<int16_t>(std::lround(block[Zigzag[k]] / divisor[t][Zigzag[k]]));
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t> out = { 0xFF, 0xD8 };
+    auto marker = [&](uint8_t type, size_t length) {
+        out.push_back(0xFF);
+        out.push_back(type);
+        out.push_back(static_cast<uint8_t>((length + 2) >> 8));
+        out.push_back(static_cast<uint8_t>(length + 2));
+        };
+    marker(0xDB, 2 * 65);
+    for (int t = 0; t < 2; ++t) {
+        out.push_back(static_cast<uint8_t>(t));
+        for (int k = 0; k < 64; ++k) out.push_back(quant[t][Zigzag[k]]);
+    }
+    marker(options.progressive ? 0xC2 : 0xC0, 6 + 3 * 3);
+    out.insert(out.end(), { 8, static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width), 3 });
+    for (int c = 0; c < 3; ++c) {
+        out.insert(out.end(), { static_cast<uint8_t>(c + 1), static_cast<uint8_t>(planes[c].h << 4 | planes[c].v), static_cast<uint8_t>(c == 0 ? 0 : 1) });
+    }
+    const struct {
+        uint8_t id;
+        const uint8_t* counts;
+        const uint8_t* symbols;
+    } tables[4] = { { 0x00, DcLumaCounts, DcSymbols }, { 0x10, AcLumaCounts, AcLumaSymbols }, { 0x01, DcChromaCounts, DcSymbols }, { 0x11, AcChromaCounts, AcChromaSymbols } };
+    for (const auto& table : tables) {
+        size_t total = 0;
+        for (int i = 0; i < 16; ++i) total += table.counts[i];
+        marker(0xC4, 17 + total);
+        out.push_back(table.id);
+        out.insert(out.end(), table.counts, table.counts + 16);
+        out.insert(out.end(), table.symbols, table.symbols + total);
+    }
+    if (options.restartInterval) {
+        marker(0xDD, 2);
+        out.insert(out.end(), { static_cast<uint8_t>(options.restartInterval >> 8), static_cast<uint8_t>(options.restartInterval) });
+    }
+    const HuffmanCode dcCodes[2] = { HuffmanCode(DcLumaCounts, DcSymbols), HuffmanCode(DcChromaCounts, DcSymbols) };
+    const HuffmanCode acCodes[2] = { HuffmanCode(AcLumaCounts, AcLumaSymbols), HuffmanCode(AcChromaCounts, AcChromaSymbols) };
+
+    // One scan over the given components and coefficient band. Interleaved scans walk MCUs, a
+    // single-component scan walks that component's data blocks one by one.
+    auto scan = [&](std::initializer_list<int> components, uint32_t start, uint32_t end) {
+        marker(0xDA, 1 + 2 * components.size() + 3);
+        out.push_back(static_cast<uint8_t>(components.size()));
+        for (int c : components) {
+            out.push_back(static_cast<uint8_t>(c + 1));
+            out.push_back(c == 0 ? 0x00 : 0x11);
+        }
+        out.insert(out.end(), { static_cast<uint8_t>(start), static_cast<uint8_t>(end), 0 });
+
+        BitWriter bits(out);
+        int32_t dcPred[3] = {};
+        auto block = [&](int c, uint32_t bx, uint32_t by) {
+            const int t = c == 0 ? 0 : 1;
+            const int16_t* coefs = planes[c].coefs.data() + (static_cast<size_t>(by) * planes[c].blocksW + bx) * 64;
+            if (start == 0) {
+                const int32_t diff = coefs[0] - dcPred[c];
+                dcPred[c] = coefs[0];
+                const uint32_t category = Category(diff);
+                bits.Code(dcCodes[t], category);
+                PutValue(bits, diff, category);
+            }
+            uint32_t run = 0;
+            for (uint32_t k = std::max(start, 1u); k <= end; ++k) {
+                if (coefs[k] == 0) {
+                    ++run;
+                    continue;
+                }
+                for (; run >= 16; run -= 16) bits.Code(acCodes[t], 0xF0);
+                const uint32_t category = Category(coefs[k]);
+                bits.Code(acCodes[t], run << 4 | category);
+                PutValue(bits, coefs[k], category);
+                run = 0;
+            }
+            if (run) bits.Code(acCodes[t], 0x00);
+            };
+
+        const bool interleaved = components.size() > 1;
+        const int only = *components.begin();
+        const uint32_t unitsX = interleaved ? mcusX : planes[only].dataBlocksW;
+        const uint32_t units = unitsX * (interleaved ? mcusY : planes[only].dataBlocksH);
+        for (uint32_t unit = 0, restart = 0; unit < units; ++unit) {
+            if (options.restartInterval && unit && unit % options.restartInterval == 0) {
+                bits.Flush();
+                out.insert(out.end(), { 0xFF, static_cast<uint8_t>(0xD0 + (restart++ & 7)) });
+                dcPred[0] = dcPred[1] = dcPred[2] = 0;
+            }
+            const uint32_t ux = unit % unitsX;
+            const uint32_t uy = unit / unitsX;
+            if (!interleaved) {
+                block(only, ux, uy);
+                continue;
+            }
+            for (int c : components) {
+                for (uint32_t v = 0; v < planes[c].v; ++v) {
+                    for (uint32_t h = 0; h < planes[c].h; ++h) block(c, ux * planes[c].h + h, uy * planes[c].v + v);
+                }
+            }
+        }
+        bits.Flush();
+        };
+
+    if (!options.progressive) {
+        scan({ 0, 1, 2 }, 0, 63);
+    }
+    else {
+        scan({ 0, 1, 2 }, 0, 0);
+        for (int c = 0; c < 3; ++c) {
+            scan({ c }, 1, 5);
+            scan({ c }, 6, 63);
+        }
+    }
+    out.insert(out.end(), { 0xFF, 0xD9 });
+    return out;
+}
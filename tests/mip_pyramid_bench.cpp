@@ -0,0 +1,40 @@
+#include "bench_util.h"
+#include "mip_pyramid.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// Usage: mip_pyramid_bench [width] [height] [stripRows]
+// Builds the full pyramid of a PBGRA image pushed in strips, as the viewer does after load, and
+// reports its memory against the base image.
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 12000);
+    const uint32_t height = IntArg(argc, argv, 2, 8000);
+    const uint32_t stripRows = std::max(1, IntArg(argc, argv, 3, 256));
+    const size_t stride = static_cast<size_t>(width) * 4;
+
+    std::vector<uint8_t> image(stride * height);
+    uint32_t noise = 1;
+    for (uint8_t& byte : image) {
+        noise = noise * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(noise >> 24);
+    }
+
+    MipPyramid pyramid;
+    const double ms = BestMs(5, [&] {
+        pyramid.Init(width, height);
+        for (uint32_t y = 0; y < height; y += stripRows) {
+            pyramid.PushRows(image.data() + y * stride, stride, std::min(stripRows, height - y));
+        }
+        });
+    if (!pyramid.IsComplete()) {
+        std::printf("pyramid incomplete\n");
+        return 1;
+    }
+    std::printf("%ux%u in %u-row strips: %zu levels in %.1f ms, %.0f MP/s\n",
+        width, height, stripRows, pyramid.LevelCount(), ms, width * static_cast<double>(height) / ms / 1000.0);
+    std::printf("pyramid %.1f MB, %.2f%% of the %.1f MB base\n",
+        pyramid.MemoryBytes() / 1e6, 100.0 * pyramid.MemoryBytes() / image.size(), image.size() / 1e6);
+    return 0;
+}
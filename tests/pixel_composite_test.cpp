@@ -0,0 +1,188 @@
+#include "pixel_composite.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The compositing kernels must match the animation compositor's original per-pixel loops
+
+namespace {
+
+    int failures = 0;
+
+    // Source-over as the compositor did it before the kernels existed
+    void OldBlend(uint8_t* destRow, const uint8_t* srcRow, uint32_t width) {
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t p = x * 4;
+            const uint8_t alpha = srcRow[p + 3];
+            if (alpha == 255) {
+                destRow[p] = srcRow[p];
+                destRow[p + 1] = srcRow[p + 1];
+                destRow[p + 2] = srcRow[p + 2];
+                destRow[p + 3] = 255;
+            }
+            else if (alpha > 0) {
+                const uint8_t inv = 255 - alpha;
+                destRow[p] = srcRow[p] + (destRow[p] * inv) / 255;
+                destRow[p + 1] = srcRow[p + 1] + (destRow[p + 1] * inv) / 255;
+                destRow[p + 2] = srcRow[p + 2] + (destRow[p + 2] * inv) / 255;
+                destRow[p + 3] = alpha + (destRow[p + 3] * inv) / 255;
+            }
+        }
+    }
+
+    void OldFill(uint8_t* destRow, uint32_t width, uint32_t bgra) {
+        for (uint32_t x = 0; x < width; ++x) {
+            destRow[x * 4] = bgra & 0xFF;
+            destRow[x * 4 + 1] = (bgra >> 8) & 0xFF;
+            destRow[x * 4 + 2] = (bgra >> 16) & 0xFF;
+            destRow[x * 4 + 3] = bgra >> 24;
+        }
+    }
+
+    // GIF frames: transparent entries are zero and leave the canvas alone
+    void OldPalette(uint8_t* destRow, const uint8_t* indices, const uint32_t* palette, uint32_t width) {
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t color = palette[indices[x]];
+            if (color >> 24) OldFill(destRow + x * 4, 1, color);
+        }
+    }
+
+    void Check(bool ok, const char* what, uint32_t width, uint32_t offset) {
+        if (ok) return;
+        if (failures < 20) std::printf("FAIL %s width=%u offset=%u\n", what, width, offset);
+        ++failures;
+    }
+
+    void RandomBytes(std::mt19937& rng, std::vector<uint8_t>& bytes) {
+        for (uint8_t& b : bytes) b = static_cast<uint8_t>(rng());
+    }
+
+    // Runs of opaque and transparent pixels hit the block fast paths, the rest blends
+    void RandomSource(std::mt19937& rng, uint8_t* src, uint32_t width) {
+        const uint32_t style = rng() % 3;
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* p = src + x * 4;
+            for (int c = 0; c < 4; ++c) p[c] = static_cast<uint8_t>(rng());
+            const uint32_t k = style == 0 ? rng() % 4 : ((x / 8 + style) % 2);
+            if (k == 0) p[3] = 255;
+            else if (k == 1) p[3] = 0;
+        }
+    }
+
+    // Every source value at every alpha over a spread of destination values
+    void CheckBlendExhaustive() {
+        std::vector<uint8_t> src(256 * 4), dst(256 * 4);
+        for (uint32_t alpha = 0; alpha < 256; ++alpha) {
+            for (uint32_t c = 0; c < 256; ++c) {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    src[i * 4] = static_cast<uint8_t>(c);
+                    src[i * 4 + 1] = static_cast<uint8_t>(255 - c);
+                    src[i * 4 + 2] = static_cast<uint8_t>(c ^ 0x55);
+                    src[i * 4 + 3] = static_cast<uint8_t>(alpha);
+                    dst[i * 4] = static_cast<uint8_t>(i);
+                    dst[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+                    dst[i * 4 + 2] = static_cast<uint8_t>(i ^ 0xAA);
+                    dst[i * 4 + 3] = static_cast<uint8_t>(i * 7);
+                }
+                std::vector<uint8_t> expected(dst), fast(dst), scalar(dst);
+                OldBlend(expected.data(), src.data(), 256);
+                BlendRowSourceOver(fast.data(), src.data(), 256);
+                BlendRowSourceOverScalar(scalar.data(), src.data(), 256);
+                Check(expected == fast, "BlendRowSourceOver exhaustive", 256, alpha);
+                Check(expected == scalar, "BlendRowSourceOverScalar exhaustive", 256, alpha);
+            }
+        }
+    }
+
+    // Odd widths and byte offsets so every vector width leaves a scalar tail
+    void CheckRows(std::mt19937& rng, uint32_t width, uint32_t offset) {
+        const size_t bytes = width * 4 + offset + 16;
+        std::vector<uint8_t> src(bytes), dst(bytes), indices(width + offset + 16);
+        RandomSource(rng, src.data() + offset, width);
+        RandomBytes(rng, dst);
+        RandomBytes(rng, indices);
+
+        std::vector<uint8_t> expected(dst), actual(dst);
+        OldBlend(expected.data() + offset, src.data() + offset, width);
+        BlendRowSourceOver(actual.data() + offset, src.data() + offset, width);
+        Check(expected == actual, "BlendRowSourceOver", width, offset);
+
+        const uint32_t color = rng();
+        expected = dst;
+        actual = dst;
+        OldFill(expected.data() + offset, width, color);
+        FillRow(actual.data() + offset, color, width);
+        Check(expected == actual, "FillRow", width, offset);
+
+        uint32_t palette[256];
+        for (uint32_t& entry : palette) entry = (rng() % 3 == 0) ? 0 : (rng() | 0xFF000000u);
+        expected = dst;
+        actual = dst;
+        std::vector<uint8_t> scalar(dst);
+        OldPalette(expected.data() + offset, indices.data() + offset, palette, width);
+        BlendRowPalette(actual.data() + offset, indices.data() + offset, palette, width);
+        BlendRowPaletteScalar(scalar.data() + offset, indices.data() + offset, palette, width);
+        Check(expected == actual, "BlendRowPalette", width, offset);
+        Check(expected == scalar, "BlendRowPaletteScalar", width, offset);
+    }
+
+    // Rect helpers over padded strides, bytes past each row must stay untouched
+    void CheckRects(std::mt19937& rng, uint32_t width, uint32_t height) {
+        const size_t dstStride = width * 4 + 12;
+        const size_t srcStride = width * 4 + 20;
+        const size_t indexStride = width + 7;
+        std::vector<uint8_t> src(srcStride * height + 4), dst(dstStride * height + 4), indices(indexStride * height + 4);
+        for (uint32_t y = 0; y < height; ++y) RandomSource(rng, src.data() + y * srcStride, width);
+        RandomBytes(rng, dst);
+        RandomBytes(rng, indices);
+
+        std::vector<uint8_t> expected(dst), actual(dst);
+        for (uint32_t y = 0; y < height; ++y) OldBlend(expected.data() + y * dstStride, src.data() + y * srcStride, width);
+        BlendRect(actual.data(), dstStride, src.data(), srcStride, width, height);
+        Check(expected == actual, "BlendRect", width, height);
+
+        const uint32_t color = rng();
+        expected = dst;
+        actual = dst;
+        for (uint32_t y = 0; y < height; ++y) OldFill(expected.data() + y * dstStride, width, color);
+        FillRect(actual.data(), dstStride, width, height, color);
+        Check(expected == actual, "FillRect", width, height);
+
+        expected = dst;
+        actual = dst;
+        for (uint32_t y = 0; y < height; ++y) std::memcpy(expected.data() + y * dstStride, src.data() + y * srcStride, width * 4);
+        CopyRect(actual.data(), dstStride, src.data(), srcStride, width, height);
+        Check(expected == actual, "CopyRect", width, height);
+
+        uint32_t palette[256];
+        for (uint32_t& entry : palette) entry = (rng() % 4 == 0) ? 0 : (rng() | 0xFF000000u);
+        expected = dst;
+        actual = dst;
+        for (uint32_t y = 0; y < height; ++y) OldPalette(expected.data() + y * dstStride, indices.data() + y * indexStride, palette, width);
+        BlendRectPalette(actual.data(), dstStride, indices.data(), indexStride, palette, width, height);
+        Check(expected == actual, "BlendRectPalette", width, height);
+    }
+}
+
+int main() {
+    std::mt19937 rng(54321);
+
+    CheckBlendExhaustive();
+    for (uint32_t width = 0; width <= 70; ++width) {
+        for (uint32_t offset = 0; offset < 8; ++offset) {
+            for (int round = 0; round < 8; ++round) CheckRows(rng, width, offset);
+        }
+    }
+    for (uint32_t width : { 127u, 255u, 1000u, 1921u }) CheckRows(rng, width, 3);
+    for (uint32_t width : { 0u, 1u, 7u, 8u, 9u, 15u, 31u, 33u, 67u, 301u }) {
+        for (uint32_t height : { 0u, 1u, 5u }) CheckRects(rng, width, height);
+    }
+
+    if (failures) {
+        std::printf("%d compositing mismatches\n", failures);
+        return 1;
+    }
+    std::printf("pixel compositing: kernels match the original loops\n");
+    return 0;
+}
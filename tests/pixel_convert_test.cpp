@@ -0,0 +1,148 @@
+#include "pixel_convert.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Every layout's selected kernel must match the scalar kernel byte for byte
+
+namespace {
+
+    struct SourceInfo {
+        PixelSource source;
+        const char* name;
+    };
+
+    const SourceInfo kSources[] = {
+        { PixelSource::Gray8, "Gray8" },
+        { PixelSource::GrayA8, "GrayA8" },
+        { PixelSource::RGB8, "RGB8" },
+        { PixelSource::BGR8, "BGR8" },
+        { PixelSource::RGBA8, "RGBA8" },
+        { PixelSource::BGRA8, "BGRA8" },
+        { PixelSource::BGRX8, "BGRX8" },
+        { PixelSource::Gray16, "Gray16" },
+        { PixelSource::GrayA16, "GrayA16" },
+        { PixelSource::RGB16, "RGB16" },
+        { PixelSource::RGBA16, "RGBA16" },
+        { PixelSource::RGBFloat, "RGBFloat" },
+        { PixelSource::RGBAFloat, "RGBAFloat" }
+    };
+
+    int failures = 0;
+
+    bool IsFloat(PixelSource source) {
+        return source == PixelSource::RGBFloat || source == PixelSource::RGBAFloat;
+    }
+
+    size_t SampleBytes(PixelSource source) {
+        if (IsFloat(source)) return sizeof(float);
+        const bool wide = source == PixelSource::Gray16 || source == PixelSource::GrayA16 ||
+            source == PixelSource::RGB16 || source == PixelSource::RGBA16;
+        return wide ? sizeof(uint16_t) : 1;
+    }
+
+    // Random samples, biased so alpha hits the 0 and 255 special cases often
+    void FillSource(std::mt19937& rng, PixelSource source, uint8_t* src, uint32_t width) {
+        const size_t bpp = PixelSourceBytesPerPixel(source);
+        if (IsFloat(source)) {
+            std::uniform_real_distribution<float> dist(-0.25f, 1.25f);
+            const size_t count = width * bpp / sizeof(float);
+            for (size_t i = 0; i < count; ++i) {
+                float v = dist(rng);
+                if ((rng() & 7) == 0) v = (rng() & 1) ? 1.0f : 0.0f;
+                std::memcpy(src + i * sizeof(float), &v, sizeof(float));
+            }
+            return;
+        }
+        for (size_t i = 0; i < width * bpp; ++i) {
+            src[i] = static_cast<uint8_t>(rng());
+        }
+        // Force whole runs of opaque / transparent pixels for the fast-path branches
+        const size_t alphaBytes = (source == PixelSource::GrayA16 || source == PixelSource::RGBA16) ? 2 : 1;
+        const bool hasAlpha = source == PixelSource::GrayA8 || source == PixelSource::RGBA8 ||
+            source == PixelSource::BGRA8 || source == PixelSource::GrayA16 || source == PixelSource::RGBA16;
+        if (!hasAlpha) return;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t mode = (x / 8 + rng() % 2) % 4;
+            if (mode == 3) continue;
+            const uint8_t value = mode == 0 ? 0xFF : (mode == 1 ? 0x00 : src[x * bpp]);
+            std::memset(src + x * bpp + bpp - alphaBytes, value, alphaBytes);
+        }
+    }
+
+    void CheckRow(const SourceInfo& info, bool premultiply, std::mt19937& rng, uint32_t width) {
+        PixelRowConverter fast = GetPixelRowConverter(info.source, premultiply);
+        PixelRowConverter scalar = GetScalarPixelRowConverter(info.source, premultiply);
+        const size_t bpp = PixelSourceBytesPerPixel(info.source);
+
+        for (uint32_t offset = 0; offset < 4; ++offset) {
+            // Offsets by whole samples exercise unaligned vector loads, samples stay naturally aligned
+            const size_t srcOffset = offset * SampleBytes(info.source);
+            std::vector<uint8_t> src(width * bpp + srcOffset + 16);
+            std::vector<uint8_t> expected(width * 4 + offset + 16, 0xCD);
+            std::vector<uint8_t> actual(expected);
+            FillSource(rng, info.source, src.data() + srcOffset, width);
+
+            scalar(src.data() + srcOffset, expected.data() + offset, width);
+            fast(src.data() + srcOffset, actual.data() + offset, width);
+
+            if (expected != actual) {
+                size_t i = 0;
+                while (expected[i] == actual[i]) ++i;
+                std::printf("FAIL %s premultiply=%d width=%u offset=%u: byte %zu expected %u got %u\n",
+                    info.name, premultiply ? 1 : 0, width, offset, i, expected[i], actual[i]);
+                ++failures;
+                return;
+            }
+        }
+    }
+
+    void CheckConvertPixels(const SourceInfo& info, bool premultiply, std::mt19937& rng) {
+        const uint32_t width = 37, height = 5;
+        const size_t bpp = PixelSourceBytesPerPixel(info.source);
+        const size_t srcStride = width * bpp + 8;
+        const size_t dstStride = width * 4 + 12;
+        std::vector<uint8_t> src(srcStride * height);
+        for (uint32_t y = 0; y < height; ++y) {
+            FillSource(rng, info.source, src.data() + y * srcStride, width);
+        }
+
+        std::vector<uint8_t> expected(dstStride * height, 0xCD);
+        std::vector<uint8_t> actual(expected);
+        PixelRowConverter scalar = GetScalarPixelRowConverter(info.source, premultiply);
+        for (uint32_t y = 0; y < height; ++y) {
+            scalar(src.data() + y * srcStride, expected.data() + y * dstStride, width);
+        }
+        ConvertPixels(info.source, premultiply, src.data(), srcStride, actual.data(), dstStride, width, height);
+
+        if (expected != actual) {
+            std::printf("FAIL ConvertPixels %s premultiply=%d\n", info.name, premultiply ? 1 : 0);
+            ++failures;
+        }
+    }
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    const uint32_t largeWidths[] = { 127, 128, 129, 255, 1000, 1023, 4097 };
+
+    for (const SourceInfo& info : kSources) {
+        for (bool premultiply : { false, true }) {
+            for (uint32_t width = 0; width <= 70; ++width) {
+                CheckRow(info, premultiply, rng, width);
+            }
+            for (uint32_t width : largeWidths) {
+                CheckRow(info, premultiply, rng, width);
+            }
+            CheckConvertPixels(info, premultiply, rng);
+        }
+    }
+
+    if (failures) {
+        std::printf("%d pixel conversion mismatches\n", failures);
+        return 1;
+    }
+    std::printf("pixel conversion: all layouts match the scalar kernels\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "bench_util.h"
+#include "parallel.h"
+#include "pixel_convert.h"
+#include "png_decode.h"
+#include "png_writer.h"
+#include "stb_image.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Usage: png_decode_bench [width height | file.png ...]
+// Large PNGs to premultiplied BGRA: stb's decode followed by the conversion, the old fallback,
+// against the native decoder converting rows as they arrive, on the worker pool and on one thread.
+// Without files a screenshot is made up as RGB and as RGBA, plus a noisy photo-like RGB.
+
+namespace {
+
+    // Flat panels, lines of glyph-like strokes and a gradient-filled picture in one corner
+    std::vector<uint8_t> MakeScreenshot(uint32_t width, uint32_t height, uint32_t channels) {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+        uint32_t noise = 1;
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                uint8_t* p = pixels.data() + (static_cast<size_t>(y) * width + x) * channels;
+                int r = 243, g = 243, b = 243;
+                if (y < 40) {
+                    r = 32; g = 32; b = 40;
+                }
+                else if (x < width / 6) {
+                    r = 225; g = 228; b = 232;
+                }
+                if (x > width / 2 && y > height / 2) {
+                    noise = noise * 1664525u + 1013904223u;
+                    r = static_cast<int>(128 + 90 * std::sin(x * 0.02f) * std::cos(y * 0.017f)) + static_cast<int>(noise >> 29);
+                    g = static_cast<int>(y * 200 / height);
+                    b = static_cast<int>(x * 200 / width);
+                }
+                else if ((y / 20) % 3 != 2 && (y % 20) >= 4 && (y % 20) < 16) {
+                    // Strokes repeat per glyph cell with a pattern that changes per cell
+                    const uint32_t cell = x / 9 + (y / 20) * 977;
+                    const uint32_t glyph = (cell * 2654435761u) >> 24;
+                    if ((x % 9) < 7 && ((glyph >> ((x % 9) + (y % 20) % 3)) & 1) && (cell % 11) != 0) {
+                        r = 30; g = 30; b = 30;
+                    }
+                }
+                p[0] = static_cast<uint8_t>(std::clamp(r, 0, 255));
+                if (channels >= 3) {
+                    p[1] = static_cast<uint8_t>(std::clamp(g, 0, 255));
+                    p[2] = static_cast<uint8_t>(std::clamp(b, 0, 255));
+                }
+                if (channels == 4) p[3] = y < 40 ? 230 : 255;
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<uint8_t> MakePhoto(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        uint32_t noise = 1;
+        for (uint32_t y = 0; y < height; ++y) {
+            uint8_t* row = rgb.data() + static_cast<size_t>(y) * width * 3;
+            for (uint32_t x = 0; x < width; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                const float wave = std::sin(x * 0.013f) * std::cos(y * 0.011f) * 60.0f;
+                const int grain = static_cast<int>(noise >> 28) - 8;
+                row[x * 3 + 0] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 160 / width + wave) + grain, 0, 255));
+                row[x * 3 + 1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 160 / height + 40 + wave * 0.5f) + grain, 0, 255));
+                row[x * 3 + 2] = static_cast<uint8_t>(std::clamp(static_cast<int>(128 - wave) + grain, 0, 255));
+            }
+        }
+        return rgb;
+    }
+
+    bool DecodeNative(const std::vector<uint8_t>& file, std::vector<uint8_t>& bgra) {
+        PngDecoder decoder;
+        if (!decoder.ReadHeader(file.data(), file.size())) return false;
+        const size_t stride = static_cast<size_t>(decoder.Width()) * 4;
+        const PixelRowConverter convert = GetPixelRowConverter(decoder.Layout(), true);
+        return decoder.Decode([&](uint32_t y, const uint8_t* row) {
+            convert(row, bgra.data() + y * stride, decoder.Width());
+            return true;
+            });
+    }
+
+    void Run(const std::string& name, const std::vector<uint8_t>& file) {
+        PngDecoder header;
+        if (!header.ReadHeader(file.data(), file.size())) {
+            std::printf("%s: not a PNG the decoder takes\n", name.c_str());
+            return;
+        }
+        const uint32_t width = header.Width();
+        const uint32_t height = header.Height();
+        const size_t stride = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> stbBgra(stride * height);
+        std::vector<uint8_t> nativeBgra(stride * height);
+        std::printf("%s: %ux%u%s, %.1f MB\n", name.c_str(), width, height, header.IsInterlaced() ? " interlaced" : "", file.size() / 1e6);
+
+        const double stbMs = BestMs(3, [&] {
+            int w = 0, h = 0, channels = 0;
+            uint8_t* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &w, &h, &channels, 4);
+            if (pixels) ConvertPixels(PixelSource::RGBA8, true, pixels, stride, stbBgra.data(), stride, width, height);
+            stbi_image_free(pixels);
+            });
+        std::printf("  stb decode + convert  %8.1f ms\n", stbMs);
+
+        const double nativeMs = BestMs(3, [&] { DecodeNative(file, nativeBgra); });
+        std::printf("  native, pool of %-2u    %8.1f ms  %.2fx\n", ParallelThreadCount(), nativeMs, stbMs / nativeMs);
+
+        // Nested ParallelFor calls run inline, so the whole decode stays on one thread
+        const double serialMs = BestMs(3, [&] {
+            ParallelFor(ParallelThreadCount(), 1, [&](uint32_t begin, uint32_t) {
+                if (begin == 0) DecodeNative(file, nativeBgra);
+                });
+            });
+        std::printf("  native, one thread    %8.1f ms  %.2fx\n", serialMs, stbMs / serialMs);
+
+        if (std::memcmp(stbBgra.data(), nativeBgra.data(), stbBgra.size()) != 0) std::printf("  output differs from stb\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    const bool files = argc > 1 && std::string(argv[1]).find_first_not_of("0123456789") != std::string::npos;
+    if (files) {
+        for (int i = 1; i < argc; ++i) {
+            std::ifstream in(argv[i], std::ios::binary);
+            Run(argv[i], std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {}));
+        }
+        return 0;
+    }
+
+    const uint32_t width = IntArg(argc, argv, 1, 3840);
+    const uint32_t height = IntArg(argc, argv, 2, 2160);
+    Run("screenshot RGB", WritePng(MakeScreenshot(width, height, 3).data(), width, height, 3));
+    Run("screenshot RGBA", WritePng(MakeScreenshot(width, height, 4).data(), width, height, 4));
+    Run("photo RGB", WritePng(MakePhoto(width, height).data(), width, height, 3));
+    return 0;
+}
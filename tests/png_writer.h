@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+
+// Small PNG and APNG writer so the benchmarks can make large files of any shape: 8-bit gray, RGB
+// or RGBA, non-interlaced, each row filtered with whichever filter gives the smallest absolute
+// sum, then greedy LZ77 over a 32 KB window into dynamic Huffman blocks. Slower and a little
+// larger than zlib, but the streams exercise the same decode paths.
+
+namespace png_writer {
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+        void Put(uint32_t value, uint32_t count) {
+            m_bits |= static_cast<uint64_t>(value) << m_count;
+            m_count += count;
+            while (m_count >= 8) {
+                m_out.push_back(static_cast<uint8_t>(m_bits));
+                m_bits >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        // Huffman codes go out most significant bit first
+        void PutCode(uint32_t code, uint32_t length) {
+            uint32_t reversed = 0;
+            for (uint32_t i = 0; i < length; ++i) reversed |= ((code >> i) & 1) << (length - 1 - i);
+            Put(reversed, length);
+        }
+
+        void Flush() {
+            if (m_count) Put(0, 8 - m_count);
+        }
+
+    private:
+        std::vector<uint8_t>& m_out;
+        uint64_t m_bits = 0;
+        uint32_t m_count = 0;
+    };
+
+    // Huffman code lengths from frequencies, at most maxLength bits. Frequencies are halved until
+    // the tree is shallow enough. A lone symbol gets a partner so the code stays complete.
+    inline std::vector<uint8_t> CodeLengths(std::vector<uint32_t> freqs, uint32_t maxLength) {
+        std::vector<uint8_t> lengths(freqs.size(), 0);
+        size_t used = 0;
+        for (uint32_t f : freqs) used += f != 0;
+        if (used < 2) {
+            for (size_t i = 0; i < freqs.size() && used < 2; ++i) {
+                if (freqs[i] == 0) {
+                    freqs[i] = 1;
+                    ++used;
+                }
+            }
+        }
+        for (;;) {
+            struct Node {
+                uint64_t weight;
+                int32_t left, right;
+            };
+            std::vector<Node> nodes;
+            using Item = std::pair<uint64_t, int32_t>;
+            std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+            for (size_t i = 0; i < freqs.size(); ++i) {
+                if (freqs[i]) {
+                    nodes.push_back({ freqs[i], -1, static_cast<int32_t>(i) });
+                    queue.push({ freqs[i], static_cast<int32_t>(nodes.size() - 1) });
+                }
+            }
+            while (queue.size() > 1) {
+                const Item a = queue.top();
+                queue.pop();
+                const Item b = queue.top();
+                queue.pop();
+                nodes.push_back({ a.first + b.first, a.second, b.second });
+                queue.push({ a.first + b.first, static_cast<int32_t>(nodes.size() - 1) });
+            }
+
+            // Leaves carry their symbol in right with left at -1
+            uint32_t deepest = 0;
+            std::vector<std::pair<int32_t, uint32_t>> stack = { { queue.top().second, 0 } };
+            while (!stack.empty()) {
+                const auto [index, depth] = stack.back();
+                stack.pop_back();
+                const Node& node = nodes[index];
+                if (node.left < 0) {
+                    lengths[node.right] = static_cast<uint8_t>(depth);
+                    deepest = std::max(deepest, depth);
+                    continue;
+                }
+                stack.push_back({ node.left, depth + 1 });
+                stack.push_back({ node.right, depth + 1 });
+            }
+            if (deepest <= maxLength) return lengths;
+            for (uint32_t& f : freqs) {
+                if (f) f = (f + 1) / 2;
+            }
+        }
+    }
+
+    inline std::vector<uint32_t> CanonicalCodes(const std::vector<uint8_t>& lengths) {
+        uint32_t counts[16] = {};
+        for (uint8_t length : lengths) ++counts[length];
+        counts[0] = 0;
+        uint32_t next[16] = {};
+        for (uint32_t length = 1, code = 0; length < 16; ++length) {
+            code = (code + counts[length - 1]) << 1;
+            next[length] = code;
+        }
+        std::vector<uint32_t> codes(lengths.size(), 0);
+        for (size_t i = 0; i < lengths.size(); ++i) {
+            if (lengths[i]) codes[i] = next[lengths[i]]++;
+        }
+        return codes;
+    }
+
+    inline constexpr uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    inline constexpr uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    inline constexpr uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    inline constexpr uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    inline constexpr uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    inline uint32_t LengthSymbol(uint32_t length) {
+        uint32_t i = 28;
+        while (LengthBase[i] > length) --i;
+        return i;
+    }
+
+    inline uint32_t DistanceSymbol(uint32_t distance) {
+        uint32_t i = 29;
+        while (DistanceBase[i] > distance) --i;
+        return i;
+    }
+
+    struct Token {
+        uint16_t length;     // 0 for a literal
+        uint16_t value;      // The literal or the distance
+    };
+
+    inline void WriteBlock(BitWriter& bits, const std::vector<Token>& tokens, bool last) {
+        std::vector<uint32_t> literalFreqs(286, 0);
+        std::vector<uint32_t> distanceFreqs(30, 0);
+        literalFreqs[256] = 1;
+        for (const Token& t : tokens) {
+            if (t.length == 0) {
+                ++literalFreqs[t.value];
+            }
+            else {
+                ++literalFreqs[257 + LengthSymbol(t.length)];
+                ++distanceFreqs[DistanceSymbol(t.value)];
+            }
+        }
+        const std::vector<uint8_t> literalLengths = CodeLengths(literalFreqs, 15);
+        const std::vector<uint8_t> distanceLengths = CodeLengths(distanceFreqs, 15);
+        const std::vector<uint32_t> literalCodes = CanonicalCodes(literalLengths);
+        const std::vector<uint32_t> distanceCodes = CanonicalCodes(distanceLengths);
+
+        uint32_t literalCount = 286;
+        while (literalCount > 257 && literalLengths[literalCount - 1] == 0) --literalCount;
+        uint32_t distanceCount = 30;
+        while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) --distanceCount;
+        std::vector<uint8_t> all(literalLengths.begin(), literalLengths.begin() + literalCount);
+        all.insert(all.end(), distanceLengths.begin(), distanceLengths.begin() + distanceCount);
+
+        // Runs of code lengths as repeat codes: symbol, extra value, extra bits
+        std::vector<uint32_t> runs;
+        for (size_t i = 0; i < all.size();) {
+            size_t same = 1;
+            while (i + same < all.size() && all[i + same] == all[i]) ++same;
+            if (all[i] == 0 && same >= 11) {
+                const uint32_t n = static_cast<uint32_t>(std::min<size_t>(same, 138));
+                runs.insert(runs.end(), { 18, n - 11, 7 });
+                i += n;
+            }
+            else if (all[i] == 0 && same >= 3) {
+                runs.insert(runs.end(), { 17, static_cast<uint32_t>(same - 3), 3 });
+                i += same;
+            }
+            else if (i > 0 && all[i - 1] == all[i] && same >= 3) {
+                const uint32_t n = static_cast<uint32_t>(std::min<size_t>(same, 6));
+                runs.insert(runs.end(), { 16, n - 3, 2 });
+                i += n;
+            }
+            else {
+                runs.insert(runs.end(), { all[i], 0, 0 });
+                ++i;
+            }
+        }
+        std::vector<uint32_t> lengthFreqs(19, 0);
+        for (size_t i = 0; i < runs.size(); i += 3) ++lengthFreqs[runs[i]];
+        const std::vector<uint8_t> lengthLengths = CodeLengths(lengthFreqs, 7);
+        const std::vector<uint32_t> lengthCodes = CanonicalCodes(lengthLengths);
+        uint32_t lengthCount = 19;
+        while (lengthCount > 4 && lengthLengths[CodeLengthOrder[lengthCount - 1]] == 0) --lengthCount;
+
+        bits.Put(last ? 1 : 0, 1);
+        bits.Put(2, 2);
+        bits.Put(literalCount - 257, 5);
+        bits.Put(distanceCount - 1, 5);
+        bits.Put(lengthCount - 4, 4);
+        for (uint32_t i = 0; i < lengthCount; ++i) bits.Put(lengthLengths[CodeLengthOrder[i]], 3);
+        for (size_t i = 0; i < runs.size(); i += 3) {
+            bits.PutCode(lengthCodes[runs[i]], lengthLengths[runs[i]]);
+            bits.Put(runs[i + 1], runs[i + 2]);
+        }
+        for (const Token& t : tokens) {
+            if (t.length == 0) {
+                bits.PutCode(literalCodes[t.value], literalLengths[t.value]);
+                continue;
+            }
+            const uint32_t l = LengthSymbol(t.length);
+            bits.PutCode(literalCodes[257 + l], literalLengths[257 + l]);
+            bits.Put(t.length - LengthBase[l], LengthExtra[l]);
+            const uint32_t d = DistanceSymbol(t.value);
+            bits.PutCode(distanceCodes[d], distanceLengths[d]);
+            bits.Put(t.value - DistanceBase[d], DistanceExtra[d]);
+        }
+        bits.PutCode(literalCodes[256], literalLengths[256]);
+    }
+
+    // zlib stream of data: greedy matches from a hash of the next three bytes, blocks of 64K tokens
+    inline std::vector<uint8_t> Compress(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out = { 0x78, 0x9C };
+        BitWriter bits(out);
+        constexpr uint32_t HashBits = 16;
+        constexpr size_t Window = 32768;
+        std::vector<int64_t> head(size_t{ 1 } << HashBits, -1);
+        std::vector<Token> tokens;
+        auto hash = [&](size_t i) {
+            return ((data[i] << 16 | data[i + 1] << 8 | data[i + 2]) * 2654435761u) >> (32 - HashBits);
+            };
+        for (size_t i = 0; i < data.size();) {
+            uint32_t length = 0;
+            size_t distance = 0;
+            if (i + 3 <= data.size()) {
+                const uint32_t h = hash(i);
+                const int64_t candidate = head[h];
+                head[h] = static_cast<int64_t>(i);
+                if (candidate >= 0 && i - candidate <= Window) {
+                    const size_t limit = std::min<size_t>(258, data.size() - i);
+                    while (length < limit && data[candidate + length] == data[i + length]) ++length;
+                    distance = i - candidate;
+                }
+            }
+            if (length >= 3) {
+                tokens.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+                for (size_t k = i + 1; k < i + length && k + 3 <= data.size(); ++k) head[hash(k)] = static_cast<int64_t>(k);
+                i += length;
+            }
+            else {
+                tokens.push_back({ 0, data[i] });
+                ++i;
+            }
+            if (tokens.size() == 65536) {
+                WriteBlock(bits, tokens, false);
+                tokens.clear();
+            }
+        }
+        WriteBlock(bits, tokens, true);
+        bits.Flush();
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : data) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(((b << 16) | a) >> shift));
+        return out;
+    }
+
+    inline uint32_t Crc32(const uint8_t* data, size_t size) {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+            }();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    inline void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& body) {
+        const uint32_t size = static_cast<uint32_t>(body.size());
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(size >> shift));
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), body.begin(), body.end());
+        const uint32_t crc = Crc32(out.data() + start, out.size() - start);
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(crc >> shift));
+    }
+
+    inline uint8_t Paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+    }
+
+    // Each row with whichever filter gives the smallest sum of absolute values, filter byte first
+    inline std::vector<uint8_t> FilterRows(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels) {
+        const size_t rowBytes = static_cast<size_t>(width) * channels;
+        std::vector<uint8_t> filtered;
+        filtered.reserve((rowBytes + 1) * height);
+        std::vector<uint8_t> candidate(rowBytes);
+        std::vector<uint8_t> best(rowBytes);
+        const std::vector<uint8_t> zeros(rowBytes, 0);
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* row = pixels + y * rowBytes;
+            const uint8_t* prior = y ? row - rowBytes : zeros.data();
+            uint64_t bestSum = UINT64_MAX;
+            uint8_t bestFilter = 0;
+            for (uint8_t filter = 0; filter < 5; ++filter) {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < rowBytes; ++i) {
+                    const int a = i >= channels ? row[i - channels] : 0;
+                    const int b = prior[i];
+                    const int c = i >= channels ? prior[i - channels] : 0;
+                    const int predicted = filter == 0 ? 0 : filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : Paeth(a, b, c);
+                    candidate[i] = static_cast<uint8_t>(row[i] - predicted);
+                    sum += static_cast<uint64_t>(std::abs(static_cast<int8_t>(candidate[i])));
+                }
+                if (sum < bestSum) {
+                    bestSum = sum;
+                    bestFilter = filter;
+                    best.swap(candidate);
+                }
+            }
+            filtered.push_back(bestFilter);
+            filtered.insert(filtered.end(), best.begin(), best.end());
+        }
+        return filtered;
+    }
+
+    inline void Put32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    // Signature and IHDR for an 8-bit image
+    inline std::vector<uint8_t> StartPng(uint32_t width, uint32_t height, uint32_t channels) {
+        std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::vector<uint8_t> header;
+        Put32(header, width);
+        Put32(header, height);
+        const uint8_t colorType = channels == 1 ? 0 : channels == 3 ? 2 : 6;
+        header.insert(header.end(), { 8, colorType, 0, 0, 0 });
+        PutChunk(out, "IHDR", header);
+        return out;
+    }
+}
+
+// channels is 1 (gray), 3 (RGB) or 4 (RGBA), rows tightly packed
+inline std::vector<uint8_t> WritePng(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels) {
+    using namespace png_writer;
+    std::vector<uint8_t> out = StartPng(width, height, channels);
+    PutChunk(out, "IDAT", Compress(FilterRows(pixels, width, height, channels)));
+    PutChunk(out, "IEND", {});
+    return out;
+}
+
+struct ApngWriteFrame {
+    uint32_t left = 0;
+    uint32_t top = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t delay = 0;                 // Milliseconds
+    uint8_t dispose = 0;                // APNG numbering: 1 clears the rect, 2 restores what was there before
+    bool blendOver = false;
+    std::vector<uint8_t> rgba;          // width * height, rows top to bottom
+};
+
+// RGBA animation that loops forever. The first frame is the default image, so it has to cover
+// the whole image.
+inline std::vector<uint8_t> WriteApng(uint32_t width, uint32_t height, const std::vector<ApngWriteFrame>& frames) {
+    using namespace png_writer;
+    std::vector<uint8_t> out = StartPng(width, height, 4);
+    std::vector<uint8_t> control;
+    Put32(control, static_cast<uint32_t>(frames.size()));
+    Put32(control, 0);
+    PutChunk(out, "acTL", control);
+    uint32_t sequence = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const ApngWriteFrame& frame = frames[i];
+        control.clear();
+        Put32(control, sequence++);
+        Put32(control, frame.width);
+        Put32(control, frame.height);
+        Put32(control, frame.left);
+        Put32(control, frame.top);
+        control.insert(control.end(), { static_cast<uint8_t>(frame.delay >> 8), static_cast<uint8_t>(frame.delay), 0x03, 0xE8 });
+        control.insert(control.end(), { frame.dispose, static_cast<uint8_t>(frame.blendOver ? 1 : 0) });
+        PutChunk(out, "fcTL", control);
+
+        const std::vector<uint8_t> data = Compress(FilterRows(frame.rgba.data(), frame.width, frame.height, 4));
+        if (i == 0) {
+            PutChunk(out, "IDAT", data);
+            continue;
+        }
+        std::vector<uint8_t> body;
+        Put32(body, sequence++);
+        body.insert(body.end(), data.begin(), data.end());
+        PutChunk(out, "fdAT", body);
+    }
+    PutChunk(out, "IEND", {});
+    return out;
+}
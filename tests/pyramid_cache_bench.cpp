@@ -0,0 +1,110 @@
+#include "bench_util.h"
+#include "pyramid_cache.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+// Usage: pyramid_cache_bench [width] [height] [directory]
+// Streams a synthetic image of the given size into an on-disk tile pyramid in 64-row strips, as
+// the viewer does for gigapixel sources, then opens it again and reads a reduced level and random
+// full-resolution tiles. The pyramid file is deleted afterwards.
+
+namespace {
+
+    // Peak resident set in MB where the platform reports it, otherwise 0
+    long PeakRssMb() {
+#if defined(__linux__)
+        rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024;
+#else
+        return 0;
+#endif
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 50000);
+    const uint32_t height = IntArg(argc, argv, 2, 50000);
+    const std::filesystem::path path = (argc > 3 ? std::filesystem::path(argv[3]) : std::filesystem::temp_directory_path()) / "pyramid_cache_bench.mivtiles";
+    constexpr uint32_t StripRows = 64;
+    constexpr uint64_t SourceKey = 42;
+
+    const size_t stride = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> strip(stride * StripRows);
+    const long baselineRss = PeakRssMb();
+
+    auto start = std::chrono::steady_clock::now();
+    PyramidWriter writer;
+    if (!writer.Open(path, width, height, SourceKey)) {
+        std::printf("cannot create %s\n", path.string().c_str());
+        return 1;
+    }
+    // Gradients with a little noise, about as compressible as a scan or a render
+    uint32_t noise = 1;
+    size_t peakWriter = 0;
+    for (uint32_t y = 0; y < height; y += StripRows) {
+        const uint32_t count = std::min(StripRows, height - y);
+        for (uint32_t r = 0; r < count; ++r) {
+            uint8_t* row = strip.data() + r * stride;
+            for (uint32_t x = 0; x < width; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                row[x * 4 + 0] = static_cast<uint8_t>(x / 196 + (noise >> 29));
+                row[x * 4 + 1] = static_cast<uint8_t>((y + r) / 196);
+                row[x * 4 + 2] = static_cast<uint8_t>((x ^ (y + r)) >> 7);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        if (!writer.PushRows(strip.data(), stride, count)) {
+            std::printf("write failed\n");
+            return 1;
+        }
+        peakWriter = std::max(peakWriter, writer.MemoryBytes());
+    }
+    if (!writer.Finish()) {
+        std::printf("finish failed\n");
+        return 1;
+    }
+    const double buildMs = ElapsedMs(start);
+    const double fileMb = std::filesystem::file_size(path) / 1048576.0;
+    std::printf("build %ux%u   %9.0f ms, %.0f MP/s\n", width, height, buildMs, width * static_cast<double>(height) / buildMs / 1000.0);
+    std::printf("file %.0f MB against %.0f MB raw, writer buffers %.1f MB, peak RSS %ld MB (%ld before)\n",
+        fileMb, width * static_cast<double>(height) * 4 / 1048576.0, peakWriter / 1048576.0, PeakRssMb(), baselineRss);
+
+    start = std::chrono::steady_clock::now();
+    PyramidReader reader;
+    if (!reader.Open(path, SourceKey)) {
+        std::printf("reopen failed\n");
+        return 1;
+    }
+    std::printf("reopen          %9.2f ms\n", ElapsedMs(start));
+
+    // The coarsest level still larger than a 4K screen, read whole as the view would at fit
+    const TileGrid& grid = reader.Grid();
+    uint32_t level = grid.LevelCount() - 1;
+    while (level > 0 && grid.LevelWidth(level) < 3840 && grid.LevelHeight(level) < 3840) --level;
+    std::vector<uint8_t> band(static_cast<size_t>(grid.LevelWidth(level)) * 4 * grid.TileSize());
+    const double levelMs = BestMs(3, [&] {
+        for (uint32_t tileRow = 0; tileRow < grid.TilesY(level); ++tileRow) {
+            reader.ReadBand(level, tileRow, band.data(), static_cast<size_t>(grid.LevelWidth(level)) * 4);
+        }
+        });
+    std::printf("level %u %ux%u %9.1f ms\n", level, grid.LevelWidth(level), grid.LevelHeight(level), levelMs);
+
+    std::mt19937 rng(1);
+    TileData tile;
+    constexpr int Tiles = 200;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Tiles; ++i) {
+        reader.ReadTile({ 0, static_cast<uint32_t>(rng() % grid.TilesX(0)), static_cast<uint32_t>(rng() % grid.TilesY(0)) }, tile);
+    }
+    std::printf("random tile     %9.2f ms\n", ElapsedMs(start) / Tiles);
+
+    reader = PyramidReader();
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+    return 0;
+}
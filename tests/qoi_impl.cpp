@@ -0,0 +1,3 @@
+// The viewer compiles the QOI implementation into image_io.cpp, which needs Win32
+#define QOI_IMPLEMENTATION
+#include "qoi.h"
@@ -0,0 +1,54 @@
+#include "bench_util.h"
+#include "parallel.h"
+#include "resampler.h"
+#include <cstdio>
+#include <vector>
+
+// Usage: resampler_bench [width] [height] [dstWidth] [dstHeight]
+// A 100 MP PBGRA image in memory scaled to 4K with each filter, on sRGB values and in linear light,
+// across the whole worker pool.
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 12000);
+    const uint32_t height = IntArg(argc, argv, 2, 8400);
+    const uint32_t dstWidth = IntArg(argc, argv, 3, 3840);
+    const uint32_t dstHeight = IntArg(argc, argv, 4, 2688);
+    std::printf("%ux%u to %ux%u, %u threads\n", width, height, dstWidth, dstHeight, ParallelThreadCount());
+
+    // Opaque noise over a gradient, so no filter gets to skip work on flat input
+    std::vector<uint8_t> src(static_cast<size_t>(width) * height * 4);
+    uint32_t noise = 1;
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* row = src.data() + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x) {
+            noise = noise * 1664525u + 1013904223u;
+            row[x * 4 + 0] = static_cast<uint8_t>(x * 255 / width);
+            row[x * 4 + 1] = static_cast<uint8_t>(y * 255 / height);
+            row[x * 4 + 2] = static_cast<uint8_t>(noise >> 24);
+            row[x * 4 + 3] = 255;
+        }
+    }
+    std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+    const struct {
+        ResampleFilter filter;
+        const char* name;
+    } filters[] = {
+        { ResampleFilter::Box, "box" },
+        { ResampleFilter::Triangle, "triangle" },
+        { ResampleFilter::Mitchell, "mitchell" },
+        { ResampleFilter::Lanczos3, "lanczos3" },
+    };
+    for (bool linearLight : { false, true }) {
+        for (const auto& f : filters) {
+            ResampleOptions options;
+            options.filter = f.filter;
+            options.linearLight = linearLight;
+            const double ms = BestMs(3, [&] {
+                ResampleBgra8(src.data(), static_cast<size_t>(width) * 4, width, height, dst.data(), static_cast<size_t>(dstWidth) * 4, dstWidth, dstHeight, options);
+                });
+            std::printf("%-9s %-6s %8.1f ms\n", f.name, linearLight ? "linear" : "sRGB", ms);
+        }
+    }
+    return 0;
+}
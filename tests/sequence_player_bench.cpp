@@ -0,0 +1,106 @@
+#include "bench_util.h"
+#include "pixel_convert.h"
+#include "png_decode.h"
+#include "png_writer.h"
+#include "sequence_player.h"
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Usage: sequence_player_bench [width height frames seconds decodeMs]
+// Plays a numbered run of PNG frames, made up in memory like a render's output, through the
+// sequence player at 24, 60 and 120 fps with 1 to 8 workers on the steady clock, for a few seconds
+// each, and prints the achieved rate with what was dropped and late. A decodeMs above 0 swaps the
+// PNG decode for a sleep that long, which shows what the workers would give with cores to spare.
+
+namespace {
+
+    int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Smooth shading that moves from frame to frame, with a band of noise like a sampling pass
+    std::vector<uint8_t> MakeFrame(uint32_t width, uint32_t height, uint32_t index) {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        uint32_t noise = index + 1;
+        for (uint32_t y = 0; y < height; ++y) {
+            uint8_t* row = rgb.data() + static_cast<size_t>(y) * width * 3;
+            for (uint32_t x = 0; x < width; ++x) {
+                const float shade = std::sin((x + index * 8) * 0.01f) * std::cos(y * 0.013f) * 80.0f;
+                int grain = 0;
+                if (y > height / 3 && y < height / 2) {
+                    noise = noise * 1664525u + 1013904223u;
+                    grain = static_cast<int>(noise >> 28) - 8;
+                }
+                row[x * 3 + 0] = static_cast<uint8_t>(std::clamp(static_cast<int>(120 + shade) + grain, 0, 255));
+                row[x * 3 + 1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 200 / height + shade * 0.3f) + grain, 0, 255));
+                row[x * 3 + 2] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 200 / width) + grain, 0, 255));
+            }
+        }
+        return rgb;
+    }
+
+    bool DecodePng(const std::vector<uint8_t>& file, SequenceFrame& out) {
+        PngDecoder png;
+        if (!png.ReadHeader(file.data(), file.size())) return false;
+        out.width = png.Width();
+        out.height = png.Height();
+        out.pixels.resize(static_cast<size_t>(out.width) * out.height * 4);
+        const PixelRowConverter convert = GetPixelRowConverter(png.Layout(), true);
+        return png.Decode([&](uint32_t y, const uint8_t* row) {
+            convert(row, out.pixels.data() + static_cast<size_t>(y) * out.width * 4, out.width);
+            return true;
+            });
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t width = IntArg(argc, argv, 1, 1920);
+    const uint32_t height = IntArg(argc, argv, 2, 1080);
+    const uint32_t frameCount = std::max(IntArg(argc, argv, 3, 24), 2);
+    const int seconds = std::max(IntArg(argc, argv, 4, 2), 1);
+    const int decodeMs = IntArg(argc, argv, 5, 0);
+
+    std::vector<std::vector<uint8_t>> files;
+    for (uint32_t i = 0; i < frameCount; ++i) files.push_back(WritePng(MakeFrame(width, height, i).data(), width, height, 3));
+
+    // Frames one after another on the calling thread, what stepping through the folder costs
+    SequenceFrame frame;
+    const double serialMs = BestMs(1, [&] {
+        for (const std::vector<uint8_t>& file : files) DecodePng(file, frame);
+        }) / frameCount;
+    std::printf("%u frames %ux%u, one by one %.1f ms/frame (%.1f fps)\n", frameCount, width, height, serialMs, 1000.0 / serialMs);
+    if (decodeMs > 0) std::printf("decode replaced by a %d ms sleep\n", decodeMs);
+
+    const SequencePlayer::DecodeFrame decode = [&](size_t index, SequenceFrame& out) {
+        if (decodeMs <= 0) return DecodePng(files[index], out);
+        std::this_thread::sleep_for(std::chrono::milliseconds(decodeMs));
+        out.width = width;
+        out.height = height;
+        out.pixels.resize(static_cast<size_t>(width) * height * 4);
+        return true;
+        };
+
+    // Slots as the viewer sizes them on a 64-bit build
+    const size_t frameBytes = static_cast<size_t>(width) * height * 4;
+    const uint32_t slots = static_cast<uint32_t>(std::clamp<size_t>((size_t{ 384 } << 20) / frameBytes, 4, 96));
+    for (double fps : { 24.0, 60.0, 120.0 }) {
+        for (uint32_t threads : { 1u, 2u, 4u, 8u }) {
+            SequencePlayer player;
+            player.Start(frameCount, 0, fps, NowUs, decode, slots, threads);
+            const int64_t end = NowUs() + static_cast<int64_t>(seconds) * 1000000;
+            while (NowUs() < end) {
+                std::this_thread::sleep_for(std::chrono::microseconds(std::max<int64_t>(player.UntilNextUs(), 200)));
+                SequencePlayer::Presented presented;
+                player.Present(presented);
+            }
+            const SequencePlaybackStats stats = player.Stats();
+            player.Stop();
+            std::printf("target %5.1f fps, %u workers: achieved %6.2f fps, presented %4llu, dropped %4llu, late %4llu, decode %.1f ms\n",
+                fps, threads, stats.AchievedFps(), static_cast<unsigned long long>(stats.presented), static_cast<unsigned long long>(stats.dropped),
+                static_cast<unsigned long long>(stats.late), stats.MeanDecodeMs());
+        }
+    }
+    return 0;
+}
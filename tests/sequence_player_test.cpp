@@ -0,0 +1,62 @@
+#include "sequence_player.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// The player on a fake clock that only moves while a frame decodes: decode times, the frame
+// shown and the wait for the next one all come from that clock, none from the real one
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (ok) return;
+        std::printf("FAIL %s\n", what);
+        ++failures;
+    }
+
+    // Each decode takes 5 ms of fake time, frames are 10 ms apart at 100 fps
+    void CheckFakeClock() {
+        std::atomic<int64_t> now = 1000000;
+        SequencePlayer player;
+        const SequencePlayer::DecodeFrame decode = [&](size_t frame, SequenceFrame& out) {
+            out.width = 1;
+            out.height = 1;
+            out.pixels.assign(4, static_cast<uint8_t>(frame));
+            now += 5000;
+            return true;
+            };
+        player.Start(10, 0, 100.0, [&] { return now.load(); }, decode, 4, 1);
+
+        // One worker fills all five buffers and then waits for one to come back
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (player.Queued() < 5 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const SequencePlaybackStats stats = player.Stats();
+        Check(stats.decoded == 5, "decoded frames");
+        Check(stats.decodeUs == 25000, "decode time not taken from the clock passed in");
+
+        // 25 ms in, frame 2 is due and frame 1 was passed over. Presenting frees a buffer and the
+        // worker moves the clock on again, so the wait is checked first.
+        Check(player.UntilNextUs() == 5000, "wait for the next frame");
+        SequencePlayer::Presented presented;
+        Check(player.Present(presented), "nothing presented");
+        Check(presented.index == 2 && presented.frame && presented.frame->pixels[0] == 2, "wrong frame presented");
+        Check(player.Stats().dropped == 1, "passed-over frame not counted");
+        player.Stop();
+    }
+}
+
+int main() {
+    CheckFakeClock();
+
+    if (failures) {
+        std::printf("%d sequence player failures\n", failures);
+        return 1;
+    }
+    std::printf("sequence player: decode times and timeline follow the clock passed in\n");
+    return 0;
+}
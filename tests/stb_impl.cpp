@@ -0,0 +1,4 @@
+// Same as in image_io.cpp, the inflate test checks against stb's zlib decoder
+#define STBI_NO_STDIO
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
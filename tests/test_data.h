@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Files checked in under tests/data, found through the directory CMake passes in
+
+inline std::vector<uint8_t> ReadTestFile(const std::string& name) {
+    std::vector<uint8_t> data;
+    FILE* file = std::fopen((std::string(TEST_DATA_DIR) + "/" + name).c_str(), "rb");
+    if (!file) {
+        std::printf("missing test file %s\n", name.c_str());
+        return data;
+    }
+    std::fseek(file, 0, SEEK_END);
+    data.resize(static_cast<size_t>(std::ftell(file)));
+    std::fseek(file, 0, SEEK_SET);
+    if (std::fread(data.data(), 1, data.size(), file) != data.size()) data.clear();
+    std::fclose(file);
+    return data;
+}
@@ -0,0 +1,77 @@
+#include "bench_util.h"
+#include "tile_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Usage: tile_cache_bench [decodesPerFrame] [panSpeed]
+// Headless deep zoom: a 1920x1080 viewport pans across a 40000x30000 image at 60 fps, right and then
+// diagonally, with a fixed number of tile decodes finishing each frame. Reports how much of the
+// viewport had its full-resolution tiles, with and without the scheduler's prefetch, and what the
+// scheduler costs per frame.
+
+namespace {
+
+    bool Overlaps(const TileRect& a, const TileRect& b) {
+        return a.right > b.left && a.left < b.right && a.bottom > b.top && a.top < b.bottom;
+    }
+
+    void Simulate(bool prefetch, int decodesPerFrame, double panSpeed) {
+        constexpr double Fps = 60.0;
+        constexpr int Frames = 600;
+        TileGrid grid;
+        grid.Init(40000, 30000, 256, 5);
+        TileScheduler scheduler;
+        scheduler.Init(grid);
+        TileCache cache;
+        std::vector<TileDraw> draws;
+        std::vector<TileKey> requests;
+
+        double fineTiles = 0.0;
+        double visibleTiles = 0.0;
+        double schedulerMs = 0.0;
+        for (int frame = 0; frame < Frames; ++frame) {
+            const double t = frame / Fps;
+            const double x = 5000.0 + panSpeed * t;
+            const double y = 8000.0 + (frame > Frames / 2 ? panSpeed * 0.5 * (t - Frames / 2 / Fps) : 0.0);
+            const TileRect viewport = { x, y, x + 1920.0, y + 1080.0 };
+
+            const auto start = std::chrono::steady_clock::now();
+            scheduler.Update(viewport, 1.0f, t, cache, draws, requests);
+            schedulerMs += ElapsedMs(start);
+
+            // Without prefetch only tiles already on screen are decoded
+            if (!prefetch) {
+                std::erase_if(requests, [&](const TileKey& key) { return !Overlaps(grid.Bounds(key), viewport); });
+            }
+            for (const TileDraw& draw : draws) {
+                if (draw.key.level == 0) ++fineTiles;
+            }
+            const uint32_t tile = grid.TileSize();
+            visibleTiles += (static_cast<uint32_t>(viewport.right + tile - 1) / tile - static_cast<uint32_t>(viewport.left) / tile) *
+                static_cast<double>(static_cast<uint32_t>(viewport.bottom + tile - 1) / tile - static_cast<uint32_t>(viewport.top) / tile);
+
+            for (int i = 0; i < decodesPerFrame && i < static_cast<int>(requests.size()); ++i) {
+                auto data = std::make_shared<TileData>();
+                data->width = grid.TileWidth(requests[i]);
+                data->height = grid.TileHeight(requests[i]);
+                data->pixels.resize(static_cast<size_t>(data->width) * data->height * 4);
+                cache.Insert(requests[i], std::move(data));
+            }
+        }
+        const TileCacheStats& stats = cache.Stats();
+        std::printf("%-11s full resolution %5.1f%% of visible tiles, cache %zu tiles %.0f MB, %llu evictions, scheduler %.3f ms/frame\n",
+            prefetch ? "prefetch" : "no prefetch", 100.0 * fineTiles / visibleTiles, cache.Count(), cache.Bytes() / 1048576.0,
+            static_cast<unsigned long long>(stats.evictions), schedulerMs / Frames);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int decodesPerFrame = IntArg(argc, argv, 1, 3);
+    const double panSpeed = IntArg(argc, argv, 2, 3000);
+    std::printf("%d decodes per frame, panning %.0f px/s\n", decodesPerFrame, panSpeed);
+    Simulate(false, decodesPerFrame, panSpeed);
+    Simulate(true, decodesPerFrame, panSpeed);
+    return 0;
+}